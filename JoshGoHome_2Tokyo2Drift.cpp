@@ -6,9 +6,13 @@
 // date: fall 2014
 //----------------------------------------------------------------------------
 #include <iostream>
+#include <string.h>
 #include "core/jgh-audio.h"
 #include "core/jgh-gfx.h"
 #include "core/jgh-globals.h"
+#include "core/jgh-headless.h"
+#include "core/jgh-set.h"
+#include "core/jgh-score.h"
 
 using namespace std;
 
@@ -18,6 +22,14 @@ using namespace std;
 //----------------------------------------------------------------------------
 int main( int argc, const char ** argv )
 {
+    // offscreen benchmark (no window, no audio)
+    JGHHeadlessOptions headless;
+    if( jgh_headless_parse( argc, argv, headless ) )
+    {
+        // render and report
+        return jgh_headless_run( headless ) ? 0 : -1;
+    }
+
        // start real-time audio
     if( !jgh_audio_init( JGH_SRATE, JGH_FRAMESIZE, JGH_NUMCHANNELS ) )
     {
@@ -25,6 +37,22 @@ int main( int argc, const char ** argv )
         cerr << "[2Tokyo2Drift]: cannot initialize real-time audio I/O..." << endl;
         return -1;
     }
+
+    // patterns: the set named, or the one saved last time
+    const char * setPath = JGH_SET_DEFAULT;
+    for( int i = 1; i < argc; i++ )
+        if( !strncmp( argv[i], "--set=", 6 ) ) setPath = argv[i] + 6;
+    jgh_set_load( setPath );
+
+    // drum patterns from a MIDI file, a score to play, clock sync
+    bool score = false;
+    for( int i = 1; i < argc; i++ )
+    {
+        if( !strncmp( argv[i], "--midi=", 7 ) ) jgh_import_midi( argv[i] + 7 );
+        else if( !strncmp( argv[i], "--score=", 8 ) ) score = jgh_score_load( argv[i] + 8 );
+        else if( !strcmp( argv[i], "--clock=master" ) ) Globals::clockMode = JGH_CLOCK_MASTER;
+        else if( !strcmp( argv[i], "--clock=slave" ) ) Globals::clockMode = JGH_CLOCK_SLAVE;
+    }
     
 	// invoke graphics setup and loop
     if( !jgh_gfx_init( argc, argv ) )
@@ -42,6 +70,13 @@ int main( int argc, const char ** argv )
         cerr << "[2Tokyo2Drift]: cannot start real-time audio I/O..." << endl;
         return -1;
     }
+
+    // MIDI input (optional)
+    jgh_midi_start();
+    // keep the patterns saved
+    jgh_set_autosave( setPath );
+    // and play the score
+    if( score ) jgh_score_play();
     
     // graphics loop
     jgh_gfx_loop();
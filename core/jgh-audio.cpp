@@ -10,32 +10,65 @@
 #include "jgh-sim.h"
 #include "y-fft.h"
 #include "jgh-me.h"
+#include "jgh-pattern.h"
+#include "jgh-score.h"
 #include "y-waveform.h"
 #include "y-fluidsynth.h"
+#include "jgh-profiler.h"
 #include <iostream>
 #include "x-fun.h"
+#include "y-score-reader.h"
+#include "MidiFileOut.h"
+#include "x-midi.h"
+#include "x-buffer.h"
+#include <math.h>
 using namespace std;
 
+// longest pattern a MIDI import fills (in beats)
+#define JGH_IMPORT_MAX_BEATS 64
+// MIDI export resolution (ticks per beat divisor step)
+#define JGH_EXPORT_STEP_TICKS 120
+// MIDI input notes in flight (MIDI thread to audio thread)
+#define JGH_MIDI_QUEUE_SIZE 256
+// hits in flight (to record: audio thread to GL thread; to play: the other way)
+#define JGH_HIT_QUEUE_SIZE 256
+// MIDI clock: ticks per beat, tempo loop bandwidth (Hz), and how long
+// without a tick before a follower stops stepping (seconds)
+#define JGH_CLOCK_PPQN 24
+#define JGH_CLOCK_BANDWIDTH 1.0
+#define JGH_CLOCK_TIMEOUT 0.5
+
     
 JGHSynth *g_synth;  
 
-double g_now;
-double g_nextTime;
-double g_currBeat = Globals::samplesPerBeatDivisor;
+// sample position of the next step (audio thread)
+double g_nextStep;
 
-vector<Track*>g_tracks;
+// steps remembered (at least as many as can be queued up in the latency)
+#define JGH_STEP_MARKS 64
 
-XMutex g_mutex;
+//-----------------------------------------------------------------------------
+// name: struct JGHStepMark
+// desc: where a step starts to be heard (written by the audio thread)
+//-----------------------------------------------------------------------------
+struct JGHStepMark
+{
+    double sample;
+    unsigned int beat;
+    unsigned int divisor;
+};
 
+JGHStepMark g_stepMarks[JGH_STEP_MARKS];
+volatile unsigned int g_numStepMarks;
 
-Track *getCurrentTrack()
-{
-    return g_tracks[Globals::currentTrack % Globals::numberOfTracks];
-}
 
-unsigned short  getCurrentDrum()
+//-----------------------------------------------------------------------------
+// name: getDrumForTrack()
+// desc: the GM drum note a track plays
+//-----------------------------------------------------------------------------
+unsigned short getDrumForTrack( unsigned int track )
 {
-    switch(Globals::currentTrack % Globals::numberOfTracks)
+    switch(track)
     {
         case JGH_KICK_DRUM:
         {
@@ -95,95 +128,95 @@ unsigned short  getCurrentDrum()
     }
 };
 
-void addNote()
+unsigned short  getCurrentDrum()
 {
-    g_mutex.acquire();
-    JGHNoteEvent * h = new JGHNoteEvent();
-    h -> pitch = getCurrentDrum();
-    h -> velocity = 1;
-    
-    if(Globals::isRecording)
-    {
-        Track *currTrack = getCurrentTrack();
-        currTrack->addNote(h,currTrack ->nearestBeatDivision());
-    }else
-    {
-        g_synth->playNotes(h);
-    }
-    g_mutex.release();
+    return getDrumForTrack(Globals::currentTrack % Globals::numberOfTracks);
 }
-    
-JGHNoteEvent *connectNotes(vector<JGHNoteEvent *> notes)
+
+//-----------------------------------------------------------------------------
+// name: getDrumNameForTrack()
+// desc: what a track is called
+//-----------------------------------------------------------------------------
+const char * getDrumNameForTrack( unsigned int track )
 {
-    if(notes.size() == 0) return NULL;
-  
-    JGHNoteEvent *currentNote = new JGHNoteEvent(notes[0]);
-    JGHNoteEvent *firstNote = currentNote;
-    for(int i = 1; i < notes.size() ; i++)
+    switch( track )
     {
-        JGHNoteEvent *nextNote = new JGHNoteEvent(notes[i]);
-        currentNote -> simultaneous = nextNote;
-        currentNote = nextNote;
+        case JGH_KICK_DRUM: return "kick";
+        case JGH_CLAP: return "clap";
+        case JGH_HIHAT: return "high hat";
+        case JGH_OPEN_HI: return "open hi";
+        case JGH_COWBELL: return "cowbell";
+        case JGH_METRONOME: return "woodblock";
+        case JGH_LOW_TOM: return "low tom";
+        case JGH_SHAKER: return "shaker";
+        case JGH_HIGH_TOM: return "high tom";
+        case JGH_MID_TOM: return "mid tom";
+        default: return "nothing";
     }
+}
 
-
-    return firstNote;
+//-----------------------------------------------------------------------------
+// name: drumNote()
+// desc: a hit of a track's drum (a chord of one)
+//-----------------------------------------------------------------------------
+static NoteEvent drumNote( unsigned int track, unsigned char velocity )
+{
+    NoteEvent note = NoteEvent();
+    note.channel = JGH_KIT_CHANNEL;
+    note.pitch = (unsigned char)getDrumForTrack( track );
+    note.velocity = velocity > 127 ? 127 : velocity;
+    note.chord = 1;
+    return note;
 }
 
-JGHNoteEvent *g_metronomeNote;
+NoteEvent g_metronomeNote;
+// the notes a step plays together (audio thread)
+NoteEvent g_stepNotes[JGH_MAX_CHORD];
+// program the score last set on each channel (audio thread; -1 for none)
+int g_scorePrograms[16];
 
 //-----------------------------------------------------------------------------
 // doTheBeat?
 //-----------------------------------------------------------------------------
-void doBeat(){
-     g_mutex.acquire();
-     vector<JGHNoteEvent *> notes; 
-    for(int i = 0; i < g_tracks.size(); i++)
+void doBeat( double sample ){
+     const JGHPattern * pattern = jgh_pattern_begin( JGH_READER_AUDIO );
+     unsigned int count = 0;
+    for(size_t i = 0; i < pattern->tracks.size() && count < JGH_MAX_CHORD; i++)
     {
-        JGHNoteEvent *note = g_tracks[i] -> getNextNote();
-        if(note)notes.push_back(note);
+        const NoteEvent *note = pattern->tracks[i] -> getNextNote();
+        if(note) g_stepNotes[count++] = *note;
     }
-    if(Globals::isMetronomeOn && Globals::currentBeatDivisorIndex == 0)
+    jgh_pattern_end( JGH_READER_AUDIO );
+    if(Globals::isMetronomeOn && Globals::currentBeatDivisorIndex == 0 && count < JGH_MAX_CHORD)
     {
         if(Globals::currentBeatIndex == 0)
         {
-            g_metronomeNote -> velocity = 1;
+            g_metronomeNote.velocity = 127;
         }else
         {
-            g_metronomeNote -> velocity = .4;
+            g_metronomeNote.velocity = 51;
         }
-        notes.push_back(g_metronomeNote);
-    }
-    JGHNoteEvent *combinedNotes = connectNotes(notes);
-    if (combinedNotes != NULL)
-    { 
-    
-        g_synth-> playNotes(combinedNotes);
-        SAFE_DELETE(combinedNotes);
+        g_stepNotes[count++] = g_metronomeNote;
     }
+    // a chord: [g_stepNotes, g_stepNotes + count)
+    for(unsigned int i = 0; i < count; i++) g_stepNotes[i].chord = count - i;
+    g_synth-> playNotes(g_stepNotes, count);
 
-    g_mutex.release();
-    calculateBeat();
+    jgh_sequencer_step( sample );
 }
 
+// synthesize a buffer, playing steps, MIDI input and score notes where they fall in it
+static void synthesizeBuffer( SAMPLE * buffer, unsigned int numFrames );
+
 //-----------------------------------------------------------------------------
 // name: audio_callback
 // desc: audio callback
 //-----------------------------------------------------------------------------
 static void audio_callback( SAMPLE * buffer, unsigned int numFrames, void * userData )
 {
+    // mark (for DSP load)
+    double start = XGfx::getMonotonicTime();
 
-
-    //calculate beat
-    if((int)g_currBeat > (int)Globals::samplesPerBeatDivisor)
-    {
-        g_currBeat = (int)Globals::samplesPerBeatDivisor % (int)(g_currBeat - Globals::samplesPerBeatDivisor);
-        doBeat();
-    }
-
-    g_now += numFrames;
-    g_currBeat += numFrames;
-    
     // sum
     SAMPLE sum = 0;
 
@@ -215,6 +248,9 @@ static void audio_callback( SAMPLE * buffer, unsigned int numFrames, void * user
         // set
         Globals::lastAudioBufferMono[i] = sum / channels;
     }
+
+    // stream the waveform (before the window)
+    if( Globals::waveform ) Globals::waveform->push( Globals::lastAudioBufferMono, numFrames );
     
     // window it
     for( int i = 0; i < numFrames; i++ )
@@ -223,15 +259,28 @@ static void audio_callback( SAMPLE * buffer, unsigned int numFrames, void * user
         Globals::lastAudioBufferMono[i] *= Globals::audioBufferWindow[i];
     }
 
-    g_synth ->synthesize2(buffer, numFrames);
+    synthesizeBuffer( buffer, numFrames );
 
+    // DSP load: time spent vs. time available
+    if( Globals::profiler && Globals::profiler->isEnabled() )
+        Globals::profiler->reportAudio( XGfx::getMonotonicTime() - start,
+                                        (double)numFrames / JGH_SRATE );
 }
 
 //setBPM
 void setBPM(unsigned int BPM)
 {
-    Globals::BPM = BPM;
-    Globals::samplesPerBeatDivisor = Globals::samplesPerMinute / (double)Globals::BPM/ (double)Globals::beatDivisor;
+    setTempo( BPM );
+}
+
+//-----------------------------------------------------------------------------
+// name: setTempo()
+// desc: set the tempo to a fractional BPM (Globals::BPM is it rounded)
+//-----------------------------------------------------------------------------
+void setTempo( double bpm )
+{
+    Globals::BPM = (unsigned int)( bpm + .5 );
+    Globals::samplesPerBeatDivisor = Globals::samplesPerMinute / bpm / (double)Globals::beatDivisor;
 }
 
 //-----------------------------------------------------------------------------
@@ -247,9 +296,6 @@ bool jgh_audio_init( unsigned int srate, unsigned int frameSize, unsigned channe
         return false;
     }
 
-    //set BPM
-    setBPM(DEFAULT_BPM);
-
     // allocate
     Globals::lastAudioBuffer = new SAMPLE[frameSize*channels];
     // allocate mono buffer
@@ -266,24 +312,985 @@ bool jgh_audio_init( unsigned int srate, unsigned int frameSize, unsigned channe
   
     g_synth = new JGHSynth();
     g_synth->init( srate,frameSize, 32, channels );
-    g_synth->loadFont( "data/sfonts/TR-808_Drums.sf2", "" );
+    g_synth->loadFont( JGH_KIT_FONT, "" );
+    // no score programs yet
+    for( int i = 0; i < 16; i++ ) g_scorePrograms[i] = -1;
    
-    for(int i = 0; i < Globals::numberOfTracks; i++)
+    // tracks and tempo
+    jgh_sequencer_init();
+    
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_sequencer_init()
+// desc: set up tracks and tempo (no audio I/O; also used by headless mode)
+//-----------------------------------------------------------------------------
+void jgh_sequencer_init()
+{
+    //set BPM
+    setBPM(DEFAULT_BPM);
+
+    // empty tracks, a measure long
+    jgh_pattern_init( Globals::numberOfTracks, Globals::beatsPerMeasure );
+
+    g_metronomeNote = NoteEvent();
+    g_metronomeNote.channel = JGH_KIT_CHANNEL;
+    g_metronomeNote.pitch = 75;
+    g_metronomeNote.velocity = 38;
+    // a second
+    g_metronomeNote.duration = JGH_SRATE;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_sequencer_step()
+// desc: remember the step just played, heard from sample; then move on
+//-----------------------------------------------------------------------------
+void jgh_sequencer_step( double sample )
+{
+    // next slot
+    JGHStepMark & mark = g_stepMarks[g_numStepMarks % JGH_STEP_MARKS];
+    mark.sample = sample;
+    mark.beat = Globals::currentBeat;
+    mark.divisor = Globals::currentBeatDivisorIndex;
+    // publish
+    __sync_synchronize();
+    g_numStepMarks = g_numStepMarks + 1;
+
+    // move on
+    calculateBeat();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: findStepMark()
+// desc: the latest step heard from a sample position (the oldest remembered
+//       if all are still ahead; the latest of all if any is true); returns
+//       false if nothing has played yet
+//-----------------------------------------------------------------------------
+static bool findStepMark( double sample, bool any, JGHStepMark & found )
+{
+    // nothing played yet
+    unsigned int count = g_numStepMarks;
+    if( count == 0 ) return false;
+    __sync_synchronize();
+
+    // latest step heard by then (oldest one if all are still ahead)
+    unsigned int oldest = count > JGH_STEP_MARKS ? count - JGH_STEP_MARKS + 1 : 0;
+    for( unsigned int i = count; i-- > oldest; )
     {
-        Track *track = new Track(4);
-        g_tracks.push_back(track);
+        JGHStepMark mark = g_stepMarks[i % JGH_STEP_MARKS];
+        __sync_synchronize();
+        // overwritten while reading (we were very late): keep what we had
+        if( g_numStepMarks - i >= JGH_STEP_MARKS ) return false;
+        // found it
+        if( any || mark.sample <= sample || i == oldest )
+        {
+            found = mark;
+            return true;
+        }
     }
 
-    g_metronomeNote = new JGHNoteEvent();
-    g_metronomeNote-> pitch = 75;
-    g_metronomeNote -> velocity = .3;
-    g_metronomeNote -> duration = 1;
-    
+    return false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_audible_update()
+// desc: find the step audible at a monotonic time; without a running audio
+//       clock (e.g., headless), the step played last
+//-----------------------------------------------------------------------------
+void jgh_audible_update( double when )
+{
+    // the sample being heard then
+    bool running = XAudioIO::isClockRunning();
+    double sample = running ? XAudioIO::audibleSample( when ) : 0;
+
+    // the step
+    JGHStepMark mark;
+    if( !findStepMark( sample, !running, mark ) ) return;
+    Globals::audibleBeat = mark.beat;
+    Globals::audibleBeatDivisorIndex = mark.divisor;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getTrackForDrum()
+// desc: the track a GM drum note goes to (-1 for none)
+//-----------------------------------------------------------------------------
+int getTrackForDrum( unsigned short pitch )
+{
+    switch( pitch )
+    {
+        // acoustic/bass drum
+        case 35: case 36:
+            return JGH_KICK_DRUM;
+        // side stick, clap
+        case 37: case 39:
+            return JGH_CLAP;
+        // closed/pedal hi-hat
+        case 42: case 44:
+            return JGH_HIHAT;
+        // open hi-hat, cymbals
+        case 46: case 49: case 51: case 52: case 53: case 55: case 57: case 59:
+            return JGH_OPEN_HI;
+        // cowbell, agogos
+        case 56: case 67: case 68:
+            return JGH_COWBELL;
+        // claves, wood blocks
+        case 75: case 76: case 77:
+            return JGH_METRONOME;
+        // low toms
+        case 41: case 43: case 45:
+            return JGH_LOW_TOM;
+        // tambourine, cabasa, maracas
+        case 54: case 69: case 70:
+            return JGH_SHAKER;
+        // snares, high tom (the high tom track plays a snare)
+        case 38: case 40: case 50:
+            return JGH_HIGH_TOM;
+        // mid toms, bongos, congas, timbales
+        case 47: case 48: case 60: case 61: case 62: case 63: case 64: case 65: case 66:
+            return JGH_MID_TOM;
+        default:
+            return -1;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHMidiImport
+// desc: what a MIDI import has found so far (one velocity per step per track)
+//-----------------------------------------------------------------------------
+struct JGHMidiImport
+{
+    // channel to take notes from (-1 for all)
+    int channel;
+    // velocity (1-127) of the hit on each step, 0 if none
+    vector< vector<unsigned char> > steps;
+    // counts
+    unsigned long numNotes;
+    unsigned long numSkipped;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: importNote()
+// desc: quantize one note on to the step grid (YScoreReader::scan callback);
+//       stops reading a track once past the longest pattern
+//-----------------------------------------------------------------------------
+static bool importNote( long /* track */, double beats, unsigned short channel,
+                        unsigned short pitch, unsigned short velocity, void * userData )
+{
+    JGHMidiImport * import = (JGHMidiImport *)userData;
+
+    // nearest step; past the end, nothing more from this track
+    long step = (long)floor( beats * Globals::beatDivisor + .5 );
+    if( step >= JGH_IMPORT_MAX_BEATS * (long)Globals::beatDivisor ) return false;
+
+    // other channel
+    if( import->channel >= 0 && channel != import->channel ) return true;
+
+    // which track
+    int drum = getTrackForDrum( pitch );
+    if( drum < 0 || drum >= (int)import->steps.size() )
+    {
+        import->numSkipped++;
+        return true;
+    }
+
+    // loudest hit on a step wins
+    vector<unsigned char> & steps = import->steps[drum];
+    if( step >= (long)steps.size() ) steps.resize( step + 1, 0 );
+    steps[step] = max( steps[step], (unsigned char)min( velocity, (unsigned short)127 ) );
+    import->numNotes++;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_import_midi()
+// desc: replace the patterns with the drum notes of a MIDI file (GM drums,
+//       quantized to the beat divisor, whole measures)
+//-----------------------------------------------------------------------------
+bool jgh_import_midi( const char * path, int channel )
+{
+    JGHMidiImport import;
+    import.channel = channel;
+    import.steps.resize( Globals::numberOfTracks );
+    import.numNotes = import.numSkipped = 0;
+
+    // stream it through
+    if( !YScoreReader::scan( path, importNote, &import ) ) return false;
+
+    // length: whole measures, long enough for the last hit
+    size_t numSteps = 0;
+    for( size_t i = 0; i < import.steps.size(); i++ )
+        numSteps = max( numSteps, import.steps[i].size() );
+    unsigned int measure = Globals::beatsPerMeasure * Globals::beatDivisor;
+    unsigned int numBeats = (unsigned int)( numSteps + measure - 1 ) / measure * Globals::beatsPerMeasure;
+    if( numBeats == 0 ) numBeats = Globals::beatsPerMeasure;
+
+    // a new version (undoable)
+    JGHPattern * draft = jgh_pattern_edit();
+    for( size_t i = 0; i < draft->tracks.size() && i < import.steps.size(); i++ )
+    {
+        Track * track = jgh_pattern_change( draft, i );
+        // out with the old
+        track->changeBeatLength( numBeats );
+        track->clearTrack();
+
+        // in with the new
+        const vector<unsigned char> & steps = import.steps[i];
+        for( size_t j = 0; j < steps.size(); j++ )
+            if( steps[j] ) track->addNote( drumNote( i, steps[j] ), j );
+    }
+    jgh_pattern_publish( draft );
+
+    // log
+    cerr << "[2Tokyo2Drift]: imported " << import.numNotes << " notes (" << import.numSkipped
+         << " skipped) in " << numBeats << " beats from: " << path << endl;
+
     return true;
 }
-Track* getTrack(unsigned int trackNumber)
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_export_midi()
+// desc: write the patterns as a format 1 MIDI file at the current tempo (one
+//       MIDI track per track, GM drums on channel 10); numBeats of 0 means
+//       whole measures up to the end of the longest pattern, and shorter
+//       patterns loop as they do when playing
+//-----------------------------------------------------------------------------
+bool jgh_export_midi( const char * path, unsigned int numBeats )
+{
+    // snapshot the hits, velocity per step
+    vector< vector<unsigned char> > steps;
+    jgh_pattern_read( steps, JGH_READER_GFX );
+    unsigned int bpm = Globals::BPM;
+    unsigned int divisor = Globals::beatDivisor;
+
+    // length: whole measures, long enough for the longest pattern
+    unsigned int measure = Globals::beatsPerMeasure * divisor;
+    if( numBeats == 0 )
+    {
+        size_t numSteps = 0;
+        for( size_t i = 0; i < steps.size(); i++ )
+            numSteps = max( numSteps, steps[i].size() );
+        numBeats = (unsigned int)( numSteps + measure - 1 ) / measure * Globals::beatsPerMeasure;
+        if( numBeats == 0 ) numBeats = Globals::beatsPerMeasure;
+    }
+    unsigned long numSteps = (unsigned long)numBeats * divisor;
+
+    // a beat is a quarter note
+    const unsigned long step = JGH_EXPORT_STEP_TICKS;
+    unsigned long numNotes = 0;
+    try
+    {
+        stk::MidiFileOut file( path, step * divisor, 1 );
+
+        // tempo track
+        file.startTrack();
+        file.writeText( 0, 0x03, "2Tokyo2Drift" );
+        file.writeTimeSignature( 0, Globals::beatsPerMeasure, 4 );
+        file.writeTempo( 0, bpm );
+        file.endTrack( numSteps * step );
+
+        // one per track
+        for( size_t i = 0; i < steps.size(); i++ )
+        {
+            const vector<unsigned char> & hits = steps[i];
+            unsigned char pitch = (unsigned char)getDrumForTrack( i );
+
+            file.startTrack();
+            file.writeText( 0, 0x03, getDrumNameForTrack( i ) );
+            // ticks since the last event
+            unsigned long delta = 0;
+            for( unsigned long j = 0; j < numSteps; j++ )
+            {
+                unsigned char velocity = hits.size() ? hits[j % hits.size()] : 0;
+                if( velocity == 0 )
+                {
+                    delta += step;
+                    continue;
+                }
+                // note on, and off (as a note on at 0) half a step later
+                file.writeEvent( delta, 0x99, pitch, velocity );
+                file.writeEvent( step / 2, 0x99, pitch, 0 );
+                delta = step - step / 2;
+                numNotes++;
+            }
+            file.endTrack( delta );
+        }
+
+        file.close();
+    }
+    catch( stk::StkError & )
+    {
+        cerr << "[2Tokyo2Drift]: cannot export MIDI file: " << path << endl;
+        return false;
+    }
+
+    // log
+    cerr << "[2Tokyo2Drift]: exported " << numNotes << " notes in " << numBeats
+         << " beats to: " << path << endl;
+
+    return true;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_read()
+// desc: copy out the pattern playing, velocity (1-127) per step per track,
+//       0 for none
+//-----------------------------------------------------------------------------
+void jgh_pattern_read( vector< vector<unsigned char> > & steps, unsigned int reader )
+{
+    const JGHPattern * pattern = jgh_pattern_begin( reader );
+    steps.resize( pattern->tracks.size() );
+    for( size_t i = 0; i < pattern->tracks.size(); i++ )
+    {
+        const vector<NoteEvent> & notes = pattern->tracks[i]->notes;
+        steps[i].resize( notes.size() );
+        for( size_t j = 0; j < notes.size(); j++ )
+            steps[i][j] = notes[j].velocity;
+    }
+    jgh_pattern_end( reader );
+}
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_write()
+// desc: replace the pattern playing (a track's length is whole beats long
+//       enough for its steps; tracks with no steps get one measure), as an
+//       undoable version or starting the history over
+//-----------------------------------------------------------------------------
+void jgh_pattern_write( const vector< vector<unsigned char> > & steps, bool undoable )
+{
+    JGHPattern * draft = jgh_pattern_edit();
+    for( size_t i = 0; i < draft->tracks.size(); i++ )
+    {
+        Track * track = jgh_pattern_change( draft, i );
+
+        // length
+        size_t numSteps = i < steps.size() ? steps[i].size() : 0;
+        unsigned int numBeats = (unsigned int)( numSteps + Globals::beatDivisor - 1 ) / Globals::beatDivisor;
+        track->changeBeatLength( numBeats ? numBeats : Globals::beatsPerMeasure );
+        track->clearTrack();
+
+        // in with the new
+        for( size_t j = 0; j < numSteps; j++ )
+            if( steps[i][j] ) track->addNote( drumNote( i, steps[i][j] ), j );
+    }
+    jgh_pattern_publish( draft, undoable );
+}
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHMidiInput
+// desc: a note on or clock message from MIDI input, stamped with the audio
+//       clock
+//-----------------------------------------------------------------------------
+struct JGHMidiInput
+{
+    // sample position being computed when it came in (clock ticks: smoothed)
+    double sample;
+    // sample position being heard when it came in
+    double audible;
+    // tempo estimate (clock ticks)
+    double tempo;
+    // the message
+    unsigned char status;
+    unsigned char data1;
+    unsigned char data2;
+};
+
+XLockFreeQueue<JGHMidiInput> g_midiQueue( JGH_MIDI_QUEUE_SIZE );
+
+//-----------------------------------------------------------------------------
+// name: struct JGHHit
+// desc: a drum hit passed between threads: played by the audio thread, or
+//       recorded (into a new pattern version) by the GL thread
+//-----------------------------------------------------------------------------
+struct JGHHit
+{
+    unsigned int track;
+    // the step to record it on
+    unsigned int step;
+    // 1-127
+    unsigned char velocity;
+};
+
+// hits to record (audio thread to GL thread), and to play (the other way)
+XLockFreeQueue<JGHHit> g_recordQueue( JGH_HIT_QUEUE_SIZE );
+XLockFreeQueue<JGHHit> g_playQueue( JGH_HIT_QUEUE_SIZE );
+// hits dropped with the record queue full (audio thread; reported by
+// jgh_record_update())
+volatile unsigned int g_recordDropped;
+
+// clock follower tempo loop (MIDI thread): predicted time of the next tick,
+// smoothed tick period, and arrival of the last tick (seconds)
+double g_clockNext;
+double g_clockPeriod;
+double g_clockLast;
+
+// clock sync (audio thread): mode last seen; master waiting to start the
+// followers; follower state (running, has a tick to step from, ticks since
+// the start of the song, sample position of the last tick)
+unsigned int g_clockMode = JGH_CLOCK_INTERNAL;
+bool g_clockStarting;
+bool g_clockRunning;
+bool g_clockAnchored;
+unsigned long g_clockTick;
+double g_clockTickSample;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: smoothClockTick()
+// desc: run an incoming clock tick through the tempo loop (second order,
+//       critically damped); returns the smoothed time of the tick
+//-----------------------------------------------------------------------------
+static double smoothClockTick( double when )
+{
+    // first tick, or after a gap: start at the current tempo
+    if( g_clockLast == 0 || when - g_clockLast > JGH_CLOCK_TIMEOUT || g_clockPeriod <= 0 )
+    {
+        g_clockPeriod = Globals::samplesPerBeatDivisor * Globals::beatDivisor / JGH_SRATE / JGH_CLOCK_PPQN;
+        g_clockNext = when + g_clockPeriod;
+        g_clockLast = when;
+        return when;
+    }
+    g_clockLast = when;
+
+    // loop gains for the bandwidth at this tick rate
+    double omega = 2 * M_PI * JGH_CLOCK_BANDWIDTH * g_clockPeriod;
+    // how far off the prediction was
+    double error = when - g_clockNext;
+    // correct phase and period
+    double smoothed = g_clockNext + sqrt( 2.0 ) * omega * error;
+    g_clockPeriod += omega * omega * error;
+    g_clockNext = smoothed + g_clockPeriod;
+
+    return smoothed;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: midi_callback()
+// desc: MIDI input (MIDI thread): stamp note ons (and, when following, clock
+//       and transport) and queue them for the audio thread
+//-----------------------------------------------------------------------------
+static void midi_callback( const XMidiMessage & message, void * /* userData */ )
+{
+    JGHMidiInput input;
+    input.status = message.status;
+    input.data1 = message.data1;
+    input.data2 = message.data2;
+    input.tempo = 0;
+
+    double when = message.when;
+    if( (message.status & 0xf0) == 0x90 )
+    {
+        // note ons only
+        if( message.data2 == 0 ) return;
+    }
+    else if( message.status >= 0xf0 )
+    {
+        // clock and transport, when following
+        if( Globals::clockMode != JGH_CLOCK_SLAVE ) return;
+        if( message.status == 0xf8 )
+        {
+            when = smoothClockTick( message.when );
+            input.tempo = 60.0 / ( JGH_CLOCK_PPQN * g_clockPeriod );
+        }
+        else if( message.status != 0xf2 && message.status != 0xfa &&
+                 message.status != 0xfb && message.status != 0xfc ) return;
+    }
+    else return;
+
+    // not running yet: at the start of the first buffer
+    input.sample = XAudioIO::isClockRunning() ? XAudioIO::clockSample( when ) : 0;
+    input.audible = XAudioIO::isClockRunning() ? XAudioIO::audibleSample( when ) : 0;
+
+    // full (audio thread stalled): drop it
+    if( !g_midiQueue.put( input ) )
+        cerr << "[2Tokyo2Drift]: MIDI input queue full, message dropped..." << endl;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: nearestStep()
+// desc: the step of a track nearest to a sample being heard (what the
+//       performer played along to)
+//-----------------------------------------------------------------------------
+static unsigned int nearestStep( const Track * track, double audible )
+{
+    // the step heard then
+    JGHStepMark mark;
+    if( !findStepMark( audible, !XAudioIO::isClockRunning(), mark ) )
+        return (unsigned int)track->nearestBeatDivision();
+
+    // its index in the pattern, rounded to the nearer of it and the next
+    unsigned int index = (mark.beat % track->beatLength) * Globals::beatDivisor + mark.divisor;
+    if( audible - mark.sample >= Globals::samplesPerBeatDivisor / 2 ) index++;
+
+    return index % track->notes.size();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: playDrum()
+// desc: play a track's drum now (audio thread)
+//-----------------------------------------------------------------------------
+static void playDrum( unsigned int which, unsigned char velocity )
+{
+    // the synth keeps its own copy
+    NoteEvent note = drumNote( which, velocity );
+    g_synth->playNotes( &note, 1 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: playInput()
+// desc: play a MIDI input note now, or send it to be recorded (audio
+//       thread); channel 10 GM drums go to their own track, anything else to
+//       the current one
+//-----------------------------------------------------------------------------
+static void playInput( const JGHMidiInput & input )
+{
+    // which track
+    int which = (input.status & 0x0f) == 9 ? getTrackForDrum( input.data1 ) : -1;
+    if( which < 0 || which >= (int)Globals::numberOfTracks )
+        which = Globals::currentTrack % Globals::numberOfTracks;
+    unsigned char velocity = input.data2;
+
+    // play it
+    if( !Globals::isRecording )
+    {
+        playDrum( which, velocity );
+        return;
+    }
+
+    // the step it goes on (the pattern as heard)
+    JGHHit hit;
+    hit.track = which;
+    hit.velocity = velocity;
+    const JGHPattern * pattern = jgh_pattern_begin( JGH_READER_AUDIO );
+    hit.step = nearestStep( pattern->tracks[which], input.audible );
+    jgh_pattern_end( JGH_READER_AUDIO );
+
+    // recorded on the GL thread (see jgh_record_update())
+    if( !g_recordQueue.put( hit ) ) g_recordDropped = g_recordDropped + 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_record_update()
+// desc: record the hits the audio thread has sent, as one new version; a
+//       second hit on a step keeps the louder (GL thread)
+//-----------------------------------------------------------------------------
+void jgh_record_update()
+{
+    // dropped since last time
+    static unsigned int dropped = 0;
+    if( g_recordDropped != dropped )
+    {
+        unsigned int now = g_recordDropped;
+        cerr << "[2Tokyo2Drift]: record queue full, " << now - dropped << " hit(s) dropped..." << endl;
+        dropped = now;
+    }
+
+    // nothing
+    JGHHit hit;
+    if( !g_recordQueue.peek( hit ) ) return;
+
+    JGHPattern * draft = jgh_pattern_edit();
+    while( g_recordQueue.peek( hit ) )
+    {
+        Track * track = jgh_pattern_change( draft, hit.track );
+        unsigned int index = hit.step % track->notes.size();
+        NoteEvent & note = track->notes[index];
+        if( note.velocity ) note.velocity = max( note.velocity, hit.velocity );
+        else track->addNote( drumNote( hit.track, hit.velocity ), index );
+        g_recordQueue.pop();
+    }
+    jgh_pattern_publish( draft );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: addNote()
+// desc: hit the current track's drum: record it on the step playing, or
+//       have the audio thread play it (GL thread)
+//-----------------------------------------------------------------------------
+void addNote()
+{
+    unsigned int which = Globals::currentTrack % Globals::numberOfTracks;
+
+    if(Globals::isRecording)
+    {
+        JGHPattern * draft = jgh_pattern_edit();
+        Track *currTrack = jgh_pattern_change( draft, which );
+        currTrack->addNote(drumNote(which, 127),currTrack ->nearestBeatDivision());
+        jgh_pattern_publish( draft );
+    }else
+    {
+        JGHHit hit;
+        hit.track = which;
+        hit.step = 0;
+        hit.velocity = 127;
+        g_playQueue.put( hit );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: clearCurrentTrack()
+// desc: clear the current track (a new version)
+//-----------------------------------------------------------------------------
+void clearCurrentTrack()
+{
+    JGHPattern * draft = jgh_pattern_edit();
+    jgh_pattern_change( draft, Globals::currentTrack % Globals::numberOfTracks )->clearTrack();
+    jgh_pattern_publish( draft );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: changeCurrentBeatLength()
+// desc: lengthen/shorten the current track by some beats (at least one);
+//       returns its length
+//-----------------------------------------------------------------------------
+unsigned int changeCurrentBeatLength( int by )
+{
+    JGHPattern * draft = jgh_pattern_edit();
+    unsigned int which = Globals::currentTrack % Globals::numberOfTracks;
+    int length = (int)draft->tracks[which]->beatLength + by;
+
+    // no change
+    if( length < 1 || by == 0 )
+    {
+        unsigned int beatLength = draft->tracks[which]->beatLength;
+        jgh_pattern_discard( draft );
+        return beatLength;
+    }
+
+    jgh_pattern_change( draft, which )->changeBeatLength( length );
+    jgh_pattern_publish( draft );
+
+    return length;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getPosition() / setPosition()
+// desc: the step to play next, counted from the start of the song
+//-----------------------------------------------------------------------------
+static unsigned long getPosition()
+{
+    return (unsigned long)Globals::currentBeat * Globals::beatDivisor + Globals::currentBeatDivisorIndex;
+}
+
+static void setPosition( unsigned long step )
+{
+    Globals::currentBeat = step / Globals::beatDivisor;
+    Globals::currentBeatDivisorIndex = step % Globals::beatDivisor;
+    Globals::currentBeatIndex = Globals::currentBeat % Globals::beatsPerMeasure;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: sendClock()
+// desc: send a MIDI clock/transport message, heard with a sample position
+//-----------------------------------------------------------------------------
+static void sendClock( double sample, unsigned char status,
+                       unsigned char data1 = 0, unsigned char data2 = 0 )
+{
+    XMidiMessage message;
+    message.when = XAudioIO::audibleTime( sample );
+    message.status = status;
+    message.data1 = data1;
+    message.data2 = data2;
+    XMidiOut::send( message );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: leadStep()
+// desc: as clock master, send the clock ticks of the step about to play at a
+//       sample position (after starting the followers, at a sixteenth)
+//-----------------------------------------------------------------------------
+static void leadStep( double sample )
+{
+    unsigned long step = getPosition();
+    unsigned long divisor = Globals::beatDivisor;
+
+    // start the followers where we are (song position is in sixteenths)
+    if( g_clockStarting )
+    {
+        if( step * JGH_CLOCK_PPQN % (6 * divisor) != 0 ) return;
+        unsigned long position = ( step * 4 / divisor ) % 16384;
+        if( position == 0 ) sendClock( sample, 0xfa );
+        else
+        {
+            sendClock( sample, 0xf2, position & 0x7f, position >> 7 );
+            sendClock( sample, 0xfb );
+        }
+        g_clockStarting = false;
+    }
+
+    // the ticks from this step to the next (not every step starts on a tick)
+    double samplesPerTick = Globals::samplesPerBeatDivisor * divisor / JGH_CLOCK_PPQN;
+    unsigned long first = ( step * JGH_CLOCK_PPQN + divisor - 1 ) / divisor;
+    unsigned long last = ( (step + 1) * JGH_CLOCK_PPQN + divisor - 1 ) / divisor;
+    for( unsigned long tick = first; tick < last; tick++ )
+        sendClock( sample + ( tick - (double)step * JGH_CLOCK_PPQN / divisor ) * samplesPerTick, 0xf8 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: followClock()
+// desc: as clock follower, take a clock or transport message heard at a
+//       sample position; a tick puts the next step where it falls between
+//       ticks at the followed tempo
+//-----------------------------------------------------------------------------
+static void followClock( const JGHMidiInput & input, double sample )
+{
+    unsigned long divisor = Globals::beatDivisor;
+
+    switch( input.status )
+    {
+        // start: from the top, at the next tick
+        case 0xfa:
+            g_clockTick = 0;
+            setPosition( 0 );
+            g_clockRunning = true;
+            g_clockAnchored = false;
+            break;
+        // continue: from here, at the next tick
+        case 0xfb:
+            g_clockRunning = true;
+            g_clockAnchored = false;
+            break;
+        // stop
+        case 0xfc:
+            g_clockRunning = false;
+            g_clockAnchored = false;
+            break;
+        // song position (sixteenths)
+        case 0xf2:
+            g_clockTick = ( input.data1 | (input.data2 << 7) ) * 6;
+            setPosition( ( g_clockTick * divisor + JGH_CLOCK_PPQN - 1 ) / JGH_CLOCK_PPQN );
+            g_clockAnchored = false;
+            break;
+        // tick
+        case 0xf8:
+        {
+            // tempo
+            if( input.tempo > 0 ) setTempo( input.tempo );
+            if( !g_clockRunning ) break;
+
+            // the first step at or after this tick; one already played waits
+            // for its place after it, and missed ones are skipped
+            unsigned long tick = g_clockTick++;
+            unsigned long step = ( tick * divisor + JGH_CLOCK_PPQN - 1 ) / JGH_CLOCK_PPQN;
+            if( g_clockAnchored && step < getPosition() ) step = getPosition();
+            if( step != getPosition() ) setPosition( step );
+
+            // where it falls
+            double samplesPerTick = Globals::samplesPerBeatDivisor * divisor / JGH_CLOCK_PPQN;
+            g_nextStep = sample + ( (double)step * JGH_CLOCK_PPQN / divisor - tick ) * samplesPerTick;
+            g_clockTickSample = sample;
+            g_clockAnchored = true;
+            break;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: playScoreNote()
+// desc: play (or let go of) a score note, changing its channel's program first
+//       if the file set one; the kit's channel keeps the kit (audio thread)
+//-----------------------------------------------------------------------------
+static void playScoreNote( const NoteEvent & note )
+{
+    if( note.velocity && ( note.flags & Y_NOTE_PROGRAM ) && note.channel != JGH_KIT_CHANNEL &&
+        note.channel < 16 && g_scorePrograms[note.channel] != note.program )
+    {
+        g_synth->synth().programChange( note.channel, note.program );
+        g_scorePrograms[note.channel] = note.program;
+    }
+    g_synth->synth().noteOn( note.channel, note.pitch, note.velocity );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: synthesizeBuffer()
+// desc: synthesize a buffer, playing steps, MIDI input and score notes where
+//       they fall in it, to the sample; input sounds one buffer after it came
+//       in, so its timing within a buffer is kept (as is that of followed
+//       clock)
+//-----------------------------------------------------------------------------
+static void synthesizeBuffer( SAMPLE * buffer, unsigned int numFrames )
+{
+    double start = XAudioIO::bufferSample();
+    double end = start + numFrames;
+    unsigned int done = 0;
+
+    // clock mode changed
+    unsigned int mode = Globals::clockMode;
+    if( mode != g_clockMode )
+    {
+        // leaving master: stop the followers
+        if( g_clockMode == JGH_CLOCK_MASTER ) sendClock( start, 0xfc );
+        // entering master: start them
+        g_clockStarting = mode == JGH_CLOCK_MASTER;
+        // entering slave: carry on from here once ticks come in
+        g_clockRunning = mode == JGH_CLOCK_SLAVE;
+        g_clockAnchored = false;
+        g_clockTick = ( getPosition() * JGH_CLOCK_PPQN + Globals::beatDivisor - 1 ) / Globals::beatDivisor;
+        g_clockMode = mode;
+    }
+    bool slave = mode == JGH_CLOCK_SLAVE;
+
+    // our own clock: no steps in the past (e.g., just out of slave mode)
+    if( !slave && g_nextStep < start ) g_nextStep = start;
+    // following: stop stepping once the ticks stop
+    if( slave && g_clockAnchored && start - g_clockTickSample > JGH_CLOCK_TIMEOUT * JGH_SRATE )
+        g_clockAnchored = false;
+
+    // hits from the GL thread: now
+    JGHHit hit;
+    while( g_playQueue.peek( hit ) )
+    {
+        playDrum( hit.track, hit.velocity );
+        g_playQueue.pop();
+    }
+
+    // score stopped: drop its notes yet to start, let go of the rest now
+    NoteEvent note;
+    if( jgh_score_flushing() )
+    {
+        for( ; jgh_score_next( note ); jgh_score_pop() )
+            if( note.velocity == 0 ) g_synth->synth().noteOn( note.channel, note.pitch, 0 );
+        jgh_score_flushed();
+    }
+
+    JGHMidiInput input;
+    for( ;; )
+    {
+        // next step
+        bool stepping = !slave || ( g_clockRunning && g_clockAnchored );
+        double step = stepping ? g_nextStep : end;
+        // next input
+        bool more = g_midiQueue.peek( input );
+        double heard = more ? input.sample + numFrames : end;
+        // next score note
+        double due = jgh_score_next( note ) ? note.time : end;
+        // none in this buffer
+        double next = min( min( step, heard ), due );
+        if( next >= end ) break;
+
+        // up to it
+        unsigned int frame = next > start ? (unsigned int)( next - start ) : 0;
+        if( frame > done )
+        {
+            g_synth->synthesize2( buffer + done * JGH_NUMCHANNELS, frame - done );
+            done = frame;
+        }
+
+        // and on
+        if( step == next )
+        {
+            if( mode == JGH_CLOCK_MASTER ) leadStep( g_nextStep );
+            doBeat( g_nextStep );
+            g_nextStep += Globals::samplesPerBeatDivisor;
+        }
+        else if( heard == next )
+        {
+            if( input.status >= 0xf0 ) followClock( input, heard );
+            else playInput( input );
+            g_midiQueue.pop();
+        }
+        else
+        {
+            playScoreNote( note );
+            jgh_score_pop();
+        }
+    }
+
+    // the rest
+    if( done < numFrames )
+        g_synth->synthesize2( buffer + done * JGH_NUMCHANNELS, numFrames - done );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_midi_start()
+// desc: open the MIDI ports (input: notes, and clock to follow; output:
+//       clock as master)
+//-----------------------------------------------------------------------------
+bool jgh_midi_start()
 {
-    return g_tracks[trackNumber];
+    bool in = XMidiIn::open( "2Tokyo2Drift", midi_callback, NULL );
+    bool out = XMidiOut::open( "2Tokyo2Drift clock" );
+    return in || out;
 }
 
 
@@ -8,18 +8,41 @@
 #ifndef __JGH_AUDIO_H__
 #define __JGH_AUDIO_H__
 #include "jgh-me.h"
+#include "jgh-pattern.h"
 
 // init audio
 bool jgh_audio_init( unsigned int srate, unsigned int frameSize, unsigned channels );
 // start audio
 bool jgh_audio_start();
+// open the MIDI input port (notes play, or record while recording)
+bool jgh_midi_start();
+// set up tracks and tempo (called by jgh_audio_init)
+void jgh_sequencer_init();
+// play position moves on a step, which is heard from a sample position
+void jgh_sequencer_step( double sample );
+// find the step audible at a monotonic time (GL thread; sets Globals::audible*)
+void jgh_audible_update( double when );
 
-//getCurrentTrack();
-Track* getCurrentTrack();
 //get synth
 JGHSynth *getSynth();
-Track* getTrack(unsigned int trackNumber);
 
-//addNote
+//addNote (record it, or play it)
 void addNote();
+// clear the current track / change its length by some beats (returns it)
+void clearCurrentTrack();
+unsigned int changeCurrentBeatLength( int by );
+// record the hits sent by the audio thread (GL thread, once a frame)
+void jgh_record_update();
+// replace the patterns with the drum notes of a MIDI file (channel 10 by default; -1 for all)
+bool jgh_import_midi( const char * path, int channel = 9 );
+// write the patterns to a MIDI file (whole measures up to the longest pattern if numBeats is 0)
+bool jgh_export_midi( const char * path, unsigned int numBeats = 0 );
+// the GM drum note a track plays / what it is called
+unsigned short getDrumForTrack( unsigned int track );
+const char * getDrumNameForTrack( unsigned int track );
+// the track a GM drum note goes to (-1 for none)
+int getTrackForDrum( unsigned short pitch );
+// copy out / replace the pattern playing (velocity 1-127 per step per track, 0 for none)
+void jgh_pattern_read( vector< vector<unsigned char> > & steps, unsigned int reader = JGH_READER_GFX );
+void jgh_pattern_write( const vector< vector<unsigned char> > & steps, bool undoable = true );
 #endif
@@ -10,6 +10,9 @@
 #include "x-fun.h"
 #include "jgh-audio.h"
 #include "y-entity.h"
+#include "jgh-profiler.h"
+#include "jgh-sim.h"
+#include <stdio.h>
 using namespace std;
 
 
@@ -55,13 +58,16 @@ void JGHIris::update(YTimeInterval dt)
 
 void JGHIris::render()
 {
+    // the track as it is now (the version stays put while drawing)
+    const JGHPattern * pattern = jgh_pattern_begin( JGH_READER_GFX );
+    const Track * connectedTrack = pattern->tracks[trackNumber];
     m_numBlades = connectedTrack -> beatLength * Globals::beatDivisor;
 
       // push
     glPushMatrix();
     
     // enable
-    glEnable( GL_DEPTH_TEST );
+    XGfx::enable( GL_DEPTH_TEST );
     
     // enable
     glEnableClientState( GL_VERTEX_ARRAY );
@@ -88,7 +94,7 @@ void JGHIris::render()
     // color
     glColor4f( col.x, col.y, col.z, 1 );
     // enable lighting
-    glEnable( GL_LIGHTING );
+    XGfx::enable( GL_LIGHTING );
     // loop overs
     for( int i = 0; i < m_numBlades; i++ )
     {
@@ -101,9 +107,9 @@ void JGHIris::render()
         // rotate
         glRotatef( pos * 90, 0, 0, 1 );
 
-        if(connectedTrack -> getNextNote() ==NULL)
+        if(connectedTrack -> getAudibleNote() ==NULL)
         {
-            if(i == (int)  connectedTrack-> currentBeatIndex())
+            if(i == (int)  connectedTrack-> audibleBeatIndex())
             {   
                 glColor4f( 1, 1, 1, 1 );
             }else
@@ -112,7 +118,7 @@ void JGHIris::render()
             }
         }else
         {
-            if(i == (int)  connectedTrack-> currentBeatIndex())
+            if(i == (int)  connectedTrack-> audibleBeatIndex())
             {   
                     glColor4f( col.x, col.y, col.z, 0 );
             }else
@@ -122,7 +128,7 @@ void JGHIris::render()
             }
         }
         // triangle strip
-        glDrawArrays( GL_TRIANGLE_STRIP, 0, 3 );
+        XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 3 );
         // pop
         glPopMatrix();
     }
@@ -134,11 +140,11 @@ void JGHIris::render()
     // linewidth
     glLineWidth( m_outlineWidth );
     // no lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     // no normal
     glDisableClientState( GL_NORMAL_ARRAY );
     // // second pass for outline
-    if(getCurrentTrack() == connectedTrack)
+    if(Globals::currentTrack % Globals::numberOfTracks == trackNumber)
     {
          for( int i = 0; i < m_numBlades; i++ )
     {
@@ -152,7 +158,7 @@ void JGHIris::render()
         glRotatef( pos * 90, 0, 0, 1 );
 
         // triangle strip
-        glDrawArrays( GL_LINE_LOOP, 0, 3 );
+        XGfx::drawArrays( GL_LINE_LOOP, 0, 3 );
         // pop
         glPopMatrix();
     }
@@ -165,6 +171,9 @@ void JGHIris::render()
     
     // pop
     glPopMatrix();
+
+    // done with the track
+    jgh_pattern_end( JGH_READER_GFX );
 }
 
 
@@ -175,11 +184,165 @@ void JGHIris::render()
 void JGHTeapot::render()
 {
     // enable lighting
-    glEnable( GL_LIGHTING );
+    XGfx::enable( GL_LIGHTING );
     // set color
     glColor4f( col.x, col.y, col.z, alpha );
     // render stuff
     glutSolidTeapot( 1.0 );
+    XGfx::countDrawCalls();
     // disable lighting
+    XGfx::disable( GL_LIGHTING );
+}
+
+
+
+
+//-------------------------------------------------------------------------------
+// name: project()
+// desc: set up the projection from the current window size
+//-------------------------------------------------------------------------------
+void JGHHud::project()
+{
+    m_width = Globals::windowWidth > 0 ? Globals::windowWidth : 1;
+    m_height = Globals::windowHeight > 0 ? Globals::windowHeight : 1;
+}
+
+
+
+
+//-------------------------------------------------------------------------------
+// name: drawAll()
+// desc: draws with all children, over the scene
+//-------------------------------------------------------------------------------
+void JGHHud::drawAll()
+{
+    // check
+    if( !active ) return;
+
+    // pixel projection
+    glMatrixMode( GL_PROJECTION );
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho( 0, m_width, 0, m_height, -1, 1 );
+    // fresh modelview
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix();
+    glLoadIdentity();
+
+    // save state
+    glPushAttrib( GL_ENABLE_BIT | GL_LINE_BIT | GL_CURRENT_BIT | GL_COLOR_BUFFER_BIT );
+    // flat
+    glDisable( GL_DEPTH_TEST );
     glDisable( GL_LIGHTING );
+    glDisable( GL_FOG );
+
+    // draw
+    YEntity::drawAll();
+
+    // restore state
+    glPopAttrib();
+    // restore matrices
+    glMatrixMode( GL_PROJECTION );
+    glPopMatrix();
+    glMatrixMode( GL_MODELVIEW );
+    glPopMatrix();
+}
+
+
+
+
+//-------------------------------------------------------------------------------
+// name: addLine()
+// desc: add one line of text at a pixel location
+//-------------------------------------------------------------------------------
+void JGHProfilerView::addLine( GLfloat x, GLfloat y, const char * text )
+{
+    // stroke font is ~120 units tall; YText scales by .001
+    m_text.add( text, x, y, 100 );
+}
+
+
+
+
+//-------------------------------------------------------------------------------
+// name: render()
+// desc: ...
+//-------------------------------------------------------------------------------
+void JGHProfilerView::render()
+{
+    JGHProfiler * profiler = Globals::profiler;
+    // check
+    if( !profiler || !profiler->isShowing() ) return;
+
+    const JGHProfileFrame & f = profiler->smoothed();
+    // frame budget
+    double budget = 1.0 / Globals::sim->getDesiredFrameRate();
+    // layout
+    GLfloat x = 12, y = Globals::windowHeight - 24, lineHeight = 18;
+    GLfloat barWidth = 240, barHeight = 8;
+    char buffer[256];
+
+    // blend
+    glEnable( GL_BLEND );
+    glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+    // budget bar: update | draw | rest of the cpu time, scaled to the budget
+    GLfloat u = barWidth * f.update / budget;
+    GLfloat d = barWidth * f.draw / budget;
+    GLfloat c = barWidth * f.cpu / budget;
+    glBegin( GL_QUADS );
+    // background
+    glColor4f( 0, 0, 0, .5f );
+    glVertex2f( x, y ); glVertex2f( x + barWidth, y );
+    glVertex2f( x + barWidth, y + barHeight ); glVertex2f( x, y + barHeight );
+    // update
+    glColor4f( .3f, 1, .3f, .9f );
+    glVertex2f( x, y ); glVertex2f( x + u, y );
+    glVertex2f( x + u, y + barHeight ); glVertex2f( x, y + barHeight );
+    // draw
+    glColor4f( .3f, .6f, 1, .9f );
+    glVertex2f( x + u, y ); glVertex2f( x + u + d, y );
+    glVertex2f( x + u + d, y + barHeight ); glVertex2f( x + u, y + barHeight );
+    // everything else
+    glColor4f( 1, .6f, .2f, .9f );
+    glVertex2f( x + u + d, y ); glVertex2f( x + c, y );
+    glVertex2f( x + c, y + barHeight ); glVertex2f( x + u + d, y + barHeight );
+    glEnd();
+
+    // text (rebuilt every frame, one draw call)
+    m_text.clear();
+    y -= lineHeight;
+
+    sprintf( buffer, "frame %6.2f ms (%5.1f fps)  budget %.2f ms",
+             1000 * f.period, f.period > 0 ? 1 / f.period : 0, 1000 * budget );
+    addLine( x, y, buffer ); y -= lineHeight;
+    sprintf( buffer, "cpu %6.2f ms  update %6.2f  draw %6.2f",
+             1000 * f.cpu, 1000 * f.update, 1000 * f.draw );
+    addLine( x, y, buffer ); y -= lineHeight;
+    if( f.gpu >= 0 ) sprintf( buffer, "gpu %6.2f ms", 1000 * f.gpu );
+    else sprintf( buffer, "gpu n/a" );
+    addLine( x, y, buffer ); y -= lineHeight;
+    sprintf( buffer, "draw calls %.0f  state changes %.0f", f.drawCalls, f.stateChanges );
+    addLine( x, y, buffer ); y -= lineHeight;
+    sprintf( buffer, "audio dsp %5.1f%%", 100 * f.audioLoad );
+    addLine( x, y, buffer ); y -= lineHeight;
+
+    // per entity type (only what drew or updated last frame)
+    const vector<JGHProfileType> & types = profiler->types();
+    for( size_t i = 0; i < types.size(); i++ )
+    {
+        const JGHProfileType & t = types[i];
+        if( t.lastCount == 0 && t.lastUpdate == 0 ) continue;
+        snprintf( buffer, sizeof(buffer), "%-16.16s x%-4lu update %6.3f  draw %6.3f",
+                  t.name.c_str(), t.lastCount, 1000 * t.avgUpdate, 1000 * t.avgDraw );
+        addLine( x, y, buffer ); y -= lineHeight;
+    }
+
+    // draw
+    glLineWidth( 1 );
+    glColor4f( 1, 1, 1, 1 );
+    m_text.draw();
+
+    // done
+    glDisable( GL_BLEND );
 }
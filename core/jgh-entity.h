@@ -33,7 +33,8 @@ class JGHIris: public YIris
 {
 public:
 	
-	Track *connectedTrack;
+	// which track it shows
+	unsigned int trackNumber;
 
 public:
 	void update(YTimeInterval dt);
@@ -41,6 +42,52 @@ public:
 
 };
 
+
+
+
+//-----------------------------------------------------------------------------
+// name: class JGHHud
+// desc: root for heads-up display entities (pixel coordinates, origin at
+//       bottom left, no depth/lighting/fog)
+//-----------------------------------------------------------------------------
+class JGHHud : public YEntity
+{
+public:
+    JGHHud() : m_width(1), m_height(1) { }
+
+public:
+    // set up the projection from the current window size
+    void project();
+    // draws with all children, in the HUD projection
+    virtual void drawAll();
+
+protected:
+    GLfloat m_width;
+    GLfloat m_height;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class JGHProfilerView
+// desc: on-screen profiler readout (see jgh-profiler.h)
+//-----------------------------------------------------------------------------
+class JGHProfilerView : public YEntity
+{
+public:
+    // render
+    void render();
+
+protected:
+    // add one line of text at a pixel location
+    void addLine( GLfloat x, GLfloat y, const char * text );
+
+protected:
+    // all text, drawn with one call
+    YTextMesh m_text;
+};
+
 #endif
 
 
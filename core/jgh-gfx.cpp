@@ -12,9 +12,13 @@
 #include "jgh-sim.h"
 #include "x-fun.h"
 #include "x-gfx.h"
-#include "x-loadlum.h"
+#include "x-texture.h"
 #include "x-vector3d.h"
 #include "jgh-me.h"
+#include "jgh-profiler.h"
+#include "jgh-set.h"
+#include "jgh-score.h"
+#include <time.h>
 #include <iostream>
 #include <vector>
 #include "y-fluidsynth.h" 
@@ -37,77 +41,18 @@ void initialize_simulation();
 bool initialize_data();
 void loadTextures();
 bool checkTexDim( int dim );
-void setupTexture( const char * filename, GLuint texobj,
-                  GLenum minFilter, GLenum maxFilter,
-                  int useMipMaps = 0 );
 
 void renderBackground();
 void blendPane();
 void updateNodeEntities();
+void updateSpectrogram();
 void renderNodeEntities();
 
 
-char * getCurrentDrumString()
+const char * getCurrentDrumString()
 {
-    switch(Globals::currentTrack % Globals::numberOfTracks)
-    {
-        case JGH_KICK_DRUM:
-        {
-            return "kick";
-            break;
-        }
-        case JGH_CLAP:
-        {
-            return "clap";
-            break;
-        }
-        case JGH_HIHAT:
-        {
-            return "high hat";
-            break;
-        }
-        case JGH_OPEN_HI:
-        {
-            return "open hi";
-            break;
-        }
-        case JGH_COWBELL:
-        {
-            return "cowbell";
-            break;
-        }
-        case JGH_METRONOME:
-        {
-            return "woodblock";
-            break;
-        }
-        case JGH_LOW_TOM:
-        {
-            return "low tom";
-            break;
-        } 
-        case JGH_SHAKER:
-        {
-            return "shaker";
-            break;
-        } 
-        case JGH_HIGH_TOM:
-        {
-            return "high tom";
-            break;
-        } 
-        case JGH_MID_TOM:
-        {
-            return "mid tom";
-            break;
-        }
-        default:
-        {
-            return "nothing";
-        }
-
-    }
-};
+    return getDrumNameForTrack( Globals::currentTrack % Globals::numberOfTracks );
+}
 
 
 //-----------------------------------------------------------------------------
@@ -171,12 +116,7 @@ bool jgh_gfx_init( int argc, const char ** argv )
 	glutSpecialFunc (specialFunc );
     
     // do our own initialization
-    initialize_graphics();
-    // simulation
-    initialize_simulation();
-    // do data
-
-    if( !initialize_data() )
+    if( !jgh_gfx_setup() )
     {
         // done
         return false;
@@ -194,6 +134,23 @@ bool jgh_gfx_init( int argc, const char ** argv )
 
 
 
+//-----------------------------------------------------------------------------
+// name: jgh_gfx_setup( )
+// desc: GL state, simulation, and data (assumes a current GL context)
+//-----------------------------------------------------------------------------
+bool jgh_gfx_setup()
+{
+    // do our own initialization
+    initialize_graphics();
+    // simulation
+    initialize_simulation();
+    // do data
+    return initialize_data();
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: jgh_gfx_loop( )
 // desc: hand off to graphics loop
@@ -312,6 +269,11 @@ void initialize_simulation()
 {
     // instantiate simulation
     Globals::sim = new JGHSim();
+    // profiler
+    Globals::profiler = new JGHProfiler();
+    // heads-up display
+    Globals::hud = new JGHHud();
+    Globals::hud->addChild( new JGHProfilerView() );
     
     // create test cube
    // JGHTeapot * teapot = new JGHTeapot();
@@ -334,10 +296,36 @@ void initialize_simulation()
 //-----------------------------------------------------------------------------
 bool initialize_data()
 {
+    // spectrogram and waveform of the audio in, behind the irises (none
+    // without audio)
+    if( Globals::lastAudioBufferFrames )
+    {
+        Globals::spectrogram = new YSpectrogram();
+        // one column per frame, bins from the whole buffer (draws nothing if
+        // this fails)
+        Globals::spectrogram->init( Globals::lastAudioBufferFrames / 2, JGH_SPECTROGRAM_COLUMNS );
+        Globals::spectrogram->setRange( -90, -10 );
+        Globals::spectrogram->setWidth( 5 );
+        Globals::spectrogram->setHeight( 2.6f );
+        Globals::spectrogram->fade( .5f, 0 );
+        Globals::spectrogram->loc = Vector3D( 0, -1.3f, -1 );
+        Globals::sim->root().addChild( Globals::spectrogram );
+
+        // waveform, between the rows of irises
+        Globals::waveform = new YWaveformStream();
+        Globals::waveform->init( JGH_WAVEFORM_COLUMNS, JGH_WAVEFORM_DECIMATE );
+        Globals::waveform->setWidth( 5 );
+        Globals::waveform->setHeight( .4f );
+        Globals::waveform->col = Globals::ourWhite;
+        Globals::waveform->fade( .5f, 0 );
+        Globals::waveform->loc = Vector3D( 0, 0, -.5f );
+        Globals::waveform->active = Globals::renderWaveform;
+        Globals::sim->root().addChild( Globals::waveform );
+    }
+
         for(int i = 0; i < Globals::numberOfTracks; i++)
     {
         JGHIris * iris = new JGHIris();
-        Track * connectTrack = getTrack(i);
         iris -> selected = TRUE;
         iris -> init(1, 1);
         iris->sca = Vector3D(.5,.5,.5);
@@ -351,7 +339,7 @@ bool initialize_data()
         }
         
 
-        iris -> connectedTrack = connectTrack;
+        iris -> trackNumber = i;
         Globals::sim->root().addChild(iris);
     }
     return true;
@@ -407,6 +395,13 @@ void jgh_keys()
     fprintf( stderr, "  'd' and 'k' - adjust beat length\n" );
 
     fprintf( stderr, "  'c' - clear track \n" );
+    fprintf( stderr, "  'z' and 'Z' - undo/redo pattern changes\n" );
+    fprintf( stderr, "  'u' and 'i' - previous/next pattern (saved as you go)\n" );
+    fprintf( stderr, "  'p' - toggle profiler overlay\n" );
+    fprintf( stderr, "  'P' - start/stop profiler CSV dump\n" );
+    fprintf( stderr, "  'e' - export patterns as a MIDI file\n" );
+    fprintf( stderr, "  'y' - MIDI clock: internal/master/slave\n" );
+    fprintf( stderr, "  'o' - play/stop the score (--score=file.mid)\n" );
     fprintf( stderr, "  'q' - quit\n" );
 }
 
@@ -437,7 +432,14 @@ void jgh_usage()
     fprintf( stderr, "[2Tokyo2Drift]: command line arguments\n" );
     jgh_line();
     fprintf( stderr, "usage: 2Tokyo2Drift --[options] [name]\n" );
-    fprintf( stderr, "   [options] = help | fullscreen" );
+    fprintf( stderr, "   [options] = help | fullscreen\n" );
+    fprintf( stderr, "   --set=file.jgh - pattern set to load and autosave (default: %s)\n", JGH_SET_DEFAULT );
+    fprintf( stderr, "   --midi=file.mid - import drum patterns from a MIDI file\n" );
+    fprintf( stderr, "   --score=file.mid - play a MIDI file along with the patterns\n" );
+    fprintf( stderr, "   --clock=master|slave - send/follow MIDI clock (make ALSA=1)\n" );
+    fprintf( stderr, "   --headless [--frames=N] [--dt=S] [--size=WxH] [--dump=prefix]\n" );
+    fprintf( stderr, "              [--set=file.jgh] [--midi=file.mid] [--export=file.mid]\n" );
+    fprintf( stderr, "      render offscreen at a fixed timestep and report timing\n" );
 }
 
 
@@ -496,14 +498,12 @@ void reshapeFunc( int w, int h )
 //-----------------------------------------------------------------------------
 void look( )
 {
-    // go
-    Globals::fov.interp( XGfx::delta() );
     // set the matrix mode to project
     glMatrixMode( GL_PROJECTION );
     // load the identity matrix
     glLoadIdentity( );
     // create the viewing frustum
-    gluPerspective( Globals::fov.value, (GLfloat)Globals::windowWidth / (GLfloat)Globals::windowHeight, .005, 500.0 );
+    gluPerspective( Globals::fov.value(), (GLfloat)Globals::windowWidth / (GLfloat)Globals::windowHeight, .005, 500.0 );
     
     // set the matrix mode to modelview
     glMatrixMode( GL_MODELVIEW );
@@ -511,10 +511,10 @@ void look( )
     glLoadIdentity();
     // position the view point
     gluLookAt( 0.0f,
-              Globals::viewRadius.x * sin( Globals::viewEyeY.x ),
-              Globals::viewRadius.x * cos( Globals::viewEyeY.x ),
+              Globals::viewRadius.value() * sin( Globals::viewEyeY.value() ),
+              Globals::viewRadius.value() * cos( Globals::viewEyeY.value() ),
               0.0f, 0.0f, 0.0f,
-              0.0f, ( cos( Globals::viewEyeY.x ) < 0 ? -1.0f : 1.0f ), 0.0f );
+              0.0f, ( cos( Globals::viewEyeY.value() ) < 0 ? -1.0f : 1.0f ), 0.0f );
     
     // set the position of the lights
     glLightfv( GL_LIGHT0, GL_POSITION, Globals::light0_pos );
@@ -552,13 +552,12 @@ void keyboardFunc( unsigned char key, int x, int y )
             Globals::blendScreen = !Globals::blendScreen;
             if( Globals::blendScreen )
             {
-                Globals::blendAlpha.goal = blendAlpha;
-                Globals::blendAlpha.slew = .5f;
+                Globals::blendAlpha.update( blendAlpha, .5f );
             }
             else
             {
-                blendAlpha = Globals::blendAlpha.goal;
-                Globals::blendAlpha.goal = 1;
+                blendAlpha = Globals::blendAlpha.goal();
+                Globals::blendAlpha.update( 1 );
             }
             fprintf( stderr, "[2Tokyo2Drift]: blendscreen:%s\n", Globals::blendScreen ? "ON" : "OFF" );
             break;
@@ -589,22 +588,22 @@ void keyboardFunc( unsigned char key, int x, int y )
         case 'm':
             if( Globals::blendScreen )
             {
-                Globals::blendAlpha.goal -= .005;
-                if( Globals::blendAlpha.goal < 0 ) Globals::blendAlpha.goal = 0;
+                Globals::blendAlpha.update( Globals::blendAlpha.goal() - .005f );
+                if( Globals::blendAlpha.goal() < 0 ) Globals::blendAlpha.update( 0 );
             }
             break;
         case 'n':
             if( Globals::blendScreen )
             {
-                Globals::blendAlpha.goal += .01;
-                if( Globals::blendAlpha.goal > 1 ) Globals::blendAlpha.goal = 1;
+                Globals::blendAlpha.update( Globals::blendAlpha.goal() + .01f );
+                if( Globals::blendAlpha.goal() > 1 ) Globals::blendAlpha.update( 1 );
             }
             break;
         case 'M':
         case 'N':
             if( Globals::blendScreen )
             {
-                Globals::blendAlpha.goal = .15f;
+                Globals::blendAlpha.update( .15f );
             }
             break;
         case 't':
@@ -647,23 +646,27 @@ void keyboardFunc( unsigned char key, int x, int y )
             glFogf(GL_FOG_DENSITY, Globals::fog_density);
             break;
         case 'c':
-            getCurrentTrack() -> clearTrack();
+            clearCurrentTrack();
             fprintf( stderr, "[2Tokyo2Drift]: track cleared\n" );
             break;
         case 'k':
         {
-            Track *track = getCurrentTrack();
-            unsigned int currBeatLength = track->beatLength;
-            track->changeBeatLength(currBeatLength + 1);
-            fprintf( stderr, "[2Tokyo2Drift]: beat length is now %d\n" ,  track-> beatLength);
+            fprintf( stderr, "[2Tokyo2Drift]: beat length is now %d\n" , changeCurrentBeatLength( 1 ) );
             break;
         }
         case 'd':
         {
-            Track *track = getCurrentTrack();
-            unsigned int currBeatLength = track->beatLength;
-            if(currBeatLength > 1)track->changeBeatLength(currBeatLength-1);
-            fprintf( stderr, "[2Tokyo2Drift]: beat length is now %d\n" , track-> beatLength);
+            fprintf( stderr, "[2Tokyo2Drift]: beat length is now %d\n" , changeCurrentBeatLength( -1 ) );
+            break;
+        }
+        case 'z':
+        {
+            fprintf( stderr, "[2Tokyo2Drift]: %s\n", jgh_pattern_undo() ? "undo" : "nothing to undo" );
+            break;
+        }
+        case 'Z':
+        {
+            fprintf( stderr, "[2Tokyo2Drift]: %s\n", jgh_pattern_redo() ? "redo" : "nothing to redo" );
             break;
         }
         case 'l':
@@ -680,6 +683,64 @@ void keyboardFunc( unsigned char key, int x, int y )
             break;
             
         }
+        case 'p':
+        {
+            Globals::profiler->setShowing( !Globals::profiler->isShowing() );
+            fprintf( stderr, "[2Tokyo2Drift]: profiler:%s\n", Globals::profiler->isShowing() ? "ON" : "OFF" );
+            break;
+        }
+        case 'P':
+        {
+            if( Globals::profiler->isDumping() )
+            {
+                Globals::profiler->stopDump();
+                fprintf( stderr, "[2Tokyo2Drift]: profiler dump:OFF\n" );
+            }
+            else
+            {
+                // timestamped file next to the executable
+                char filename[64];
+                time_t now = time( NULL );
+                strftime( filename, sizeof(filename), "jgh-profile-%Y%m%d-%H%M%S.csv", localtime( &now ) );
+                if( Globals::profiler->startDump( Globals::path + filename ) )
+                    fprintf( stderr, "[2Tokyo2Drift]: profiler dump:ON (%s)\n", filename );
+            }
+            break;
+        }
+        case 'e':
+        {
+            // timestamped file next to the executable
+            char filename[64];
+            time_t now = time( NULL );
+            strftime( filename, sizeof(filename), "jgh-pattern-%Y%m%d-%H%M%S.mid", localtime( &now ) );
+            jgh_export_midi( (Globals::path + filename).c_str() );
+            break;
+        }
+        case 'u':
+        {
+            if( jgh_set_current() > 0 ) jgh_set_select( jgh_set_current() - 1 );
+            fprintf( stderr, "[2Tokyo2Drift]: pattern %u of %u\n", jgh_set_current() + 1, jgh_set_count() );
+            break;
+        }
+        case 'i':
+        {
+            jgh_set_select( jgh_set_current() + 1 );
+            fprintf( stderr, "[2Tokyo2Drift]: pattern %u of %u\n", jgh_set_current() + 1, jgh_set_count() );
+            break;
+        }
+        case 'y':
+        {
+            static const char * modes[] = { "internal", "master", "slave" };
+            Globals::clockMode = ( Globals::clockMode + 1 ) % 3;
+            fprintf( stderr, "[2Tokyo2Drift]: MIDI clock:%s\n", modes[Globals::clockMode] );
+            break;
+        }
+        case 'o':
+        {
+            if( jgh_score_playing() ) jgh_score_stop();
+            else jgh_score_play();
+            break;
+        }
 
     }
     
@@ -692,25 +753,25 @@ void keyboardFunc( unsigned char key, int x, int y )
         switch( key )
         {
             case ']':
-                Globals::viewEyeY.y -= .1f;
+                Globals::viewEyeY.update( Globals::viewEyeY.goal() - .1f );
                 //fprintf( stderr, "[vismule]: yview:%f\n", g_eye_y.y );
                 break;
             case '[':
-                Globals::viewEyeY.y += .1f;
+                Globals::viewEyeY.update( Globals::viewEyeY.goal() + .1f );
                 //fprintf( st[[[[[[[[[[[[[derr, "[vismule]: yview:%f\n", g_eye_y.y );
                 break;
             case '=':
-                Globals::viewRadius.y = .975 * Globals::viewRadius.y;
-                if( Globals::viewRadius.y < .001 ) Globals::viewRadius.y = .001;
-                // fprintf( stderr, "[vismule]: view radius:%f->%f\n", Globals::viewRadius.x, Globals::viewRadius.y );
+                Globals::viewRadius.update( .975f * Globals::viewRadius.goal() );
+                if( Globals::viewRadius.goal() < .001f ) Globals::viewRadius.update( .001f );
+                // fprintf( stderr, "[vismule]: view radius:%f->%f\n", Globals::viewRadius.value(), Globals::viewRadius.goal() );
                 break;
             case '-':
-                Globals::viewRadius.y = 1.025 * Globals::viewRadius.y;
-                // fprintf( stderr, "[vismule]: view radius:%f->%f\n", Globals::viewRadius.x, Globals::viewRadius.y );
+                Globals::viewRadius.update( 1.025f * Globals::viewRadius.goal() );
+                // fprintf( stderr, "[vismule]: view radius:%f->%f\n", Globals::viewRadius.value(), Globals::viewRadius.goal() );
                 break;
             case '_':
             case '+':
-                Globals::viewRadius.y = Globals::viewRadius.x + .7*(Globals::viewRadius.y-Globals::viewRadius.x);
+                Globals::viewRadius.update( Globals::viewRadius.value() + .7f*(Globals::viewRadius.goal()-Globals::viewRadius.value()) );
                 break;
             case '\'':
                 Globals::bgColor.update( Vector3D( 1,1,1 ) );
@@ -817,20 +878,57 @@ void idleFunc( )
 // Desc: callback function invoked to draw the client area
 //-----------------------------------------------------------------------------
 void displayFunc( )
+{
+    // render the frame
+    jgh_gfx_render();
+    
+    // flush gl commands
+    glFlush();
+    // swap the buffers
+    glutSwapBuffers();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// Name: jgh_gfx_render( )
+// Desc: draw one frame into the current context (does not swap)
+//-----------------------------------------------------------------------------
+void jgh_gfx_render()
 {
     // if(Globals::onBeat){
        
     //     Globals::onBeat = FALSE;
     // }
+    // profiler
+    Globals::profiler->beginFrame();
+
     // get current time (once per frame)
     XGfx::getCurrentTime( true );
 
-    // update
-    Globals::bgColor.interp( XGfx::delta() );
-    Globals::blendAlpha.interp( XGfx::delta() );
+    // this frame shows up about a frame period from now: find the step heard then
+    static double lastFrameTime = 0;
+    static double framePeriod = 1.0 / 60;
+    double frameTime = XGfx::getMonotonicTime();
+    // smooth (skipping stalls)
+    if( lastFrameTime > 0 && frameTime - lastFrameTime < .25 )
+        framePeriod += (frameTime - lastFrameTime - framePeriod) * .1;
+    lastFrameTime = frameTime;
+    jgh_audible_update( frameTime + framePeriod );
+    // take in what was recorded since
+    jgh_record_update();
+    // the newest spectrum
+    updateSpectrogram();
+
+    // finished textures (bounded per frame)
+    Globals::textureManager->update();
+
+    // advance the view/screen slews (all of them, one pass)
+    Globals::slews.advance( XGfx::delta() );
     
     // clear or blend
-    if( Globals::blendScreen && Globals::blendAlpha.value > .0001 )
+    if( Globals::blendScreen && Globals::blendAlpha.value() > .0001 )
     {
         // clear the depth buffer
         glClear( GL_DEPTH_BUFFER_BIT );
@@ -846,14 +944,12 @@ void displayFunc( )
     }
     
     // enable depth test
-    glEnable( GL_DEPTH_TEST );
+    XGfx::enable( GL_DEPTH_TEST );
     
     // save state
     glPushMatrix();
     
-    // slew
-    Globals::viewEyeY.interp( XGfx::delta());
-    Globals::viewRadius.interp( XGfx::delta() );
+    // look
     look();
     
 
@@ -861,16 +957,37 @@ void displayFunc( )
     
     // pop state
     glPopMatrix();
+
+    // profiler (HUD not included)
+    Globals::profiler->endFrame();
     
-   // draw any HUD here
-   // Globals::hud->project();
-   // Globals::hud->updateAll( Globals::sim->delta() );
-   // Globals::hud->drawAll();
-    
-    // flush gl commands
-    glFlush();
-    // swap the buffers
-    glutSwapBuffers();
+    // draw any HUD here
+    Globals::hud->project();
+    Globals::hud->updateAll( Globals::sim->delta() );
+    Globals::hud->drawAll();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: updateSpectrogram()
+// desc: one spectrogram column per frame, from the last audio buffer (read as
+//       the audio thread leaves it; a torn buffer is one odd column)
+//-----------------------------------------------------------------------------
+void updateSpectrogram()
+{
+    // no audio
+    if( !Globals::spectrogram || !Globals::lastAudioBufferMono ) return;
+
+    // copy (already windowed), then in place
+    static vector<SAMPLE> frame;
+    unsigned int numFrames = Globals::lastAudioBufferFrames;
+    frame.assign( Globals::lastAudioBufferMono, Globals::lastAudioBufferMono + numFrames );
+    rfft( &frame[0], numFrames / 2, FFT_FORWARD );
+
+    // one column
+    Globals::spectrogram->set( (complex *)&frame[0], numFrames / 2 );
 }
 
 
@@ -883,14 +1000,14 @@ void displayFunc( )
 void blendPane()
 {
     // enable blending
-    glEnable( GL_BLEND );
-    glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    XGfx::enable( GL_BLEND );
+    XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
     // disable lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     // disable depth test
-    glDisable( GL_DEPTH_TEST );
+    XGfx::disable( GL_DEPTH_TEST );
     // blend in a polygon
-    glColor4f( Globals::bgColor.actual().x, Globals::bgColor.actual().y, Globals::bgColor.actual().z, Globals::blendAlpha.value );
+    glColor4f( Globals::bgColor.actual().x, Globals::bgColor.actual().y, Globals::bgColor.actual().z, Globals::blendAlpha.value() );
     // glColor4f( Globals::blendRed, Globals::blendRed, Globals::blendRed, Globals::blendAlpha );
     // reduce the red component
     // Globals::blendRed -= .02f;
@@ -906,13 +1023,15 @@ void blendPane()
     glVertex3f( h, h, d );
     glVertex3f( -h, h, d );
     glEnd();
+    // count it
+    XGfx::countDrawCalls();
     
     // enable lighting
-    glEnable( GL_LIGHTING );
+    XGfx::enable( GL_LIGHTING );
     // enable depth test
-    glEnable( GL_DEPTH_TEST );
+    XGfx::enable( GL_DEPTH_TEST );
     // disable blending
-    glDisable( GL_BLEND );
+    XGfx::disable( GL_BLEND );
 }
 
 
@@ -936,7 +1055,7 @@ void renderBackground()
 
 //-------------------------------------------------------------------------------
 // name: loadTexture()
-// desc: load textures
+// desc: request textures (decoded in the background, uploaded per frame)
 //-------------------------------------------------------------------------------
 void loadTextures()
 {
@@ -947,61 +1066,30 @@ void loadTextures()
     // log
     fprintf( stderr, "[2Tokyo2Drift]: loading textures...\n" );
     
+    // the manager
+    if( !Globals::textureManager )
+    {
+        Globals::textureManager = new XTextureManager();
+        Globals::textureManager->init();
+    }
+    
     // set store alignment
     glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    // modulate (texture unit state)
+    glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
     
     // set filter types
-    minFilter = GL_LINEAR;
+    minFilter = GL_LINEAR_MIPMAP_LINEAR;
     maxFilter = GL_LINEAR;
     
-    // load tng flares
+    // tng flares, baked into one mipmapped atlas (placeholder until uploaded)
+    vector<string> flares;
     for( i = JGH_TEX_FLARE_TNG_1; i <= JGH_TEX_FLARE_TNG_5; i++ )
     {
-        glGenTextures( 1, &(Globals::textures[i]) );
         sprintf( filename, "%sflare-tng-%d.bw", Globals::datapath.c_str(), i - JGH_TEX_FLARE_TNG_1 + 1 );
-        setupTexture( filename, Globals::textures[i], minFilter, maxFilter );
+        flares.push_back( filename );
     }
-}
-
-
-
-//--------------------------------------------------------------------------------
-// name: setupTexture()
-// desc: ...
-//--------------------------------------------------------------------------------
-void setupTexture( const char * filename, GLuint texobj,
-                  GLenum minFilter, GLenum maxFilter, int useMipMaps )
-{
-    unsigned char * buf = NULL;
-    int width = 0, height = 0, components = 0;
-    
-    glBindTexture( GL_TEXTURE_2D, texobj );
-    glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter );
-    glTexParameterf( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, maxFilter );
-    
-    // log
-    // fprintf( stderr, "[bokeh]: loading %s...\n", filename );
-    
-    // load luminance
-    buf = loadLuminance( filename, &width, &height, &components );
-    
-    // log
-    // fprintf( stderr, "[bokeh]: '%s' : %dx%dx%d\n", filename, width, height, components);
-    
-    // build mip maps
-    if( useMipMaps )
-    {
-        gluBuild2DMipmaps( GL_TEXTURE_2D, 1, width, height,
-                          GL_LUMINANCE, GL_UNSIGNED_BYTE, buf );
-    }
-    else
-    {
-        glTexImage2D( GL_TEXTURE_2D, 0, 1, width, height, 0,
-                     GL_LUMINANCE, GL_UNSIGNED_BYTE, buf );
-    }
-    
-    free(buf);
+    Globals::flareAtlas = Globals::textureManager->loadAtlas( flares, minFilter, maxFilter );
 }
 
 
@@ -16,6 +16,10 @@
 // entry point for graphics
 bool jgh_gfx_init( int argc, const char ** argv );
 void jgh_gfx_loop();
+// set up GL state, simulation and data (needs a current GL context)
+bool jgh_gfx_setup();
+// render one frame into the current context (no swap)
+void jgh_gfx_render();
 void jgh_about();
 void jgh_keys();
 void jgh_help();
@@ -18,6 +18,10 @@
 
 
 JGHSim * Globals::sim = NULL;
+JGHHud * Globals::hud = NULL;
+JGHProfiler * Globals::profiler = NULL;
+XTextureManager * Globals::textureManager = NULL;
+XTextureAtlas * Globals::flareAtlas = NULL;
 
 GLsizei Globals::windowWidth = DEFAULT_WINDOW_WIDTH;
 GLsizei Globals::windowHeight = DEFAULT_WINDOW_HEIGHT;
@@ -29,7 +33,8 @@ SAMPLE * Globals::lastAudioBufferMono = NULL;
 SAMPLE * Globals::audioBufferWindow = NULL;
 unsigned int Globals::lastAudioBufferFrames = 0;
 unsigned int Globals::lastAudioBufferChannels = 0;
-YWaveform * Globals::waveform = NULL;
+YWaveformStream * Globals::waveform = NULL;
+YSpectrogram * Globals::spectrogram = NULL;
 
 unsigned int Globals::BPM;
 unsigned int Globals::LOW_BPM = 40;
@@ -43,11 +48,14 @@ unsigned int Globals::currentBeatIndex;
 unsigned int Globals::currentBeatDivisorIndex;
 unsigned int Globals::beatsPerMeasure = 4;
 unsigned int Globals::currentBeat;
+unsigned int Globals::audibleBeat;
+unsigned int Globals::audibleBeatDivisorIndex;
 unsigned int Globals::currentTrack;
 
 bool Globals::isRecording;
 unsigned int Globals::numberOfTracks = 10;
 bool Globals::isMetronomeOn = FALSE;
+unsigned int Globals::clockMode = JGH_CLOCK_INTERNAL;
 
 
 
@@ -55,13 +63,15 @@ GLboolean Globals::fullscreen = DEFAULT_FULLSCREEN;
 GLboolean Globals::blendScreen = DEFAULT_BLENDSCREEN;
 GLboolean Globals::renderWaveform = TRUE;
 
-Vector3D Globals::blendAlpha( 1, 1, .5f );
+// (defined before the slews that live in it)
+XSlewBank Globals::slews;
+XSlew Globals::blendAlpha( 1, 1, .5f, &Globals::slews );
 GLfloat Globals::blendRed = 0.0f;
 GLenum Globals::fillmode = GL_FILL;
-iSlew3D Globals::bgColor( .5 );
-Vector3D Globals::viewRadius( 5, 2, 1 );
-Vector3D Globals::viewEyeY( 1, 0, 1.5f );
-Vector3D Globals::fov( 120, 80, .2f );
+XSlew3D Globals::bgColor( .5f, &Globals::slews );
+XSlew Globals::viewRadius( 5, 2, 1, &Globals::slews );
+XSlew Globals::viewEyeY( 1, 0, 1.5f, &Globals::slews );
+XSlew Globals::fov( 120, 80, .2f, &Globals::slews );
 
 GLuint Globals::textures[JGH_MAX_TEXTURES];
 
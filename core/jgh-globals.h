@@ -13,6 +13,7 @@
 #include "x-audio.h"
 #include "x-gfx.h"
 #include "x-vector3d.h"
+#include "x-slew.h"
 #include "y-waveform.h"
 
 // c++
@@ -27,6 +28,16 @@
 #define JGH_NUMCHANNELS  2
 #define JGH_MAX_TEXTURES 32
 #define DEFAULT_BPM      120
+// spectrogram history (frames)
+#define JGH_SPECTROGRAM_COLUMNS 256
+// waveform history (columns, and samples in each)
+#define JGH_WAVEFORM_COLUMNS 512
+#define JGH_WAVEFORM_DECIMATE 128
+// the drum kit (soundfont) played
+#define JGH_KIT_NAME     "TR-808"
+#define JGH_KIT_FONT     "data/sfonts/TR-808_Drums.sf2"
+// the channel the patterns play it on
+#define JGH_KIT_CHANNEL  0
 
 
 //-----------------------------------------------------------------------------
@@ -59,10 +70,29 @@ enum JoshGoHomeTrackNames
 };
 
 
+//-----------------------------------------------------------------------------
+// name: enum JoshGoHomeClockModes
+// desc: where the tempo comes from
+//-----------------------------------------------------------------------------
+enum JoshGoHomeClockModes
+{
+    // our own
+    JGH_CLOCK_INTERNAL = 0,
+    // our own, sent out as MIDI clock
+    JGH_CLOCK_MASTER,
+    // MIDI clock coming in
+    JGH_CLOCK_SLAVE
+};
+
+
 
 
 // forward reference
 class JGHSim;
+class JGHHud;
+class JGHProfiler;
+class XTextureManager;
+struct XTextureAtlas;
 
 
 
@@ -76,6 +106,14 @@ class Globals
 public:
     // top level root simulation
     static JGHSim * sim;
+    // heads-up display (drawn over the scene, in pixels)
+    static JGHHud * hud;
+    // frame profiler
+    static JGHProfiler * profiler;
+    // texture loading/uploading
+    static XTextureManager * textureManager;
+    // flare set, one atlas (region = JGH_TEX_FLARE_TNG_N - JGH_TEX_FLARE_TNG_1)
+    static XTextureAtlas * flareAtlas;
     
     // path
     static std::string path;
@@ -106,8 +144,13 @@ public:
     static unsigned int currentBeatIndex;
     static unsigned int beatsPerMeasure;
     static unsigned int currentBeat;
+    // step being heard at the next frame presentation (see jgh_audible_update)
+    static unsigned int audibleBeat;
+    static unsigned int audibleBeatDivisorIndex;
     static unsigned int currentTrack;
     static bool isMetronomeOn;
+    // MIDI clock sync (JGH_CLOCK_*; see jgh_midi_start)
+    static unsigned int clockMode;
 
 
     //controls
@@ -116,8 +159,10 @@ public:
     static unsigned int numberOfTracks;
 
 
-    // waveform
-    static YWaveform * waveform;
+    // waveform of the audio in (streamed from the audio callback)
+    static YWaveformStream * waveform;
+    // spectrogram of the audio in (behind the irises)
+    static YSpectrogram * spectrogram;
 
     // width and height of the window
     static GLsizei windowWidth;
@@ -131,17 +176,19 @@ public:
     static GLboolean renderWaveform;
     // blend pane instead of clearing screen
     static GLboolean blendScreen;
+    // view/screen slews (advanced once per frame)
+    static XSlewBank slews;
     // blend screen parameters
-    static Vector3D blendAlpha;
+    static XSlew blendAlpha;
     static GLfloat blendRed;
     // fill mode
     static GLenum fillmode;
     // background color
-    static iSlew3D bgColor;
+    static XSlew3D bgColor;
     // view stuff
-    static Vector3D viewRadius;
-    static Vector3D viewEyeY;
-    static Vector3D fov;
+    static XSlew viewRadius;
+    static XSlew viewEyeY;
+    static XSlew fov;
     
     // textures
     static GLuint textures[];
@@ -0,0 +1,262 @@
+//-----------------------------------------------------------------------------
+// name: jgh-headless.cpp
+// desc: offscreen (windowless) rendering, for benchmarking the render path
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "jgh-headless.h"
+#include "jgh-globals.h"
+#include "jgh-audio.h"
+#include "jgh-gfx.h"
+#include "jgh-sim.h"
+#include "jgh-me.h"
+#include "jgh-set.h"
+#include "x-texture.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#ifdef __JGH_HEADLESS__
+#include <GL/osmesa.h>
+#endif
+using namespace std;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_headless_parse()
+// desc: parse command line; returns true if --headless was given
+//-----------------------------------------------------------------------------
+bool jgh_headless_parse( int argc, const char ** argv, JGHHeadlessOptions & options )
+{
+    bool headless = false;
+
+    // iterate over arguments
+    for( int i = 1; i < argc; i++ )
+    {
+        const char * arg = argv[i];
+
+        if( !strcmp( arg, "--headless" ) ) headless = true;
+        else if( !strncmp( arg, "--frames=", 9 ) ) options.numFrames = atoi( arg + 9 );
+        else if( !strncmp( arg, "--dt=", 5 ) ) options.dt = atof( arg + 5 );
+        else if( !strncmp( arg, "--dump=", 7 ) ) options.dumpPrefix = arg + 7;
+        else if( !strncmp( arg, "--set=", 6 ) ) options.setFile = arg + 6;
+        else if( !strncmp( arg, "--midi=", 7 ) ) options.midiFile = arg + 7;
+        else if( !strncmp( arg, "--export=", 9 ) ) options.exportFile = arg + 9;
+        else if( !strncmp( arg, "--size=", 7 ) )
+            sscanf( arg + 7, "%ux%u", &options.width, &options.height );
+    }
+
+    // sanity check
+    if( options.dt <= 0 ) options.dt = 1.0/60;
+    if( options.width == 0 || options.height == 0 )
+    {
+        options.width = 1280;
+        options.height = 720;
+    }
+
+    return headless;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: writePPM()
+// desc: write an RGBA (bottom-up) framebuffer as binary PPM
+//-----------------------------------------------------------------------------
+static bool writePPM( const char * filename, const unsigned char * rgba,
+                      unsigned int width, unsigned int height )
+{
+    FILE * fp = fopen( filename, "wb" );
+    // check
+    if( !fp ) return false;
+
+    // header
+    fprintf( fp, "P6\n%u %u\n255\n", width, height );
+
+    // one row at a time
+    vector<unsigned char> row( width * 3 );
+    // top row first (GL is bottom-up)
+    for( long y = (long)height - 1; y >= 0; y-- )
+    {
+        const unsigned char * src = rgba + y * width * 4;
+        // drop alpha
+        for( unsigned int x = 0; x < width; x++ )
+        {
+            row[x*3] = src[x*4];
+            row[x*3+1] = src[x*4+1];
+            row[x*3+2] = src[x*4+2];
+        }
+        fwrite( &row[0], 1, row.size(), fp );
+    }
+
+    fclose( fp );
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: report()
+// desc: print summary of a series of timings (in seconds)
+//-----------------------------------------------------------------------------
+static void report( const char * what, vector<double> times )
+{
+    // sanity check
+    if( times.size() == 0 ) return;
+
+    // sort for median
+    sort( times.begin(), times.end() );
+    // sum
+    double sum = 0;
+    for( size_t i = 0; i < times.size(); i++ ) sum += times[i];
+
+    fprintf( stderr, "[2Tokyo2Drift]: %-7s mean: %.3f ms | median: %.3f ms | min: %.3f ms | max: %.3f ms\n",
+             what, 1000 * sum / times.size(), 1000 * times[times.size()/2],
+             1000 * times[0], 1000 * times.back() );
+}
+
+
+
+
+#ifdef __JGH_HEADLESS__
+//-----------------------------------------------------------------------------
+// name: jgh_headless_run()
+// desc: build the scene offscreen, render, and report timing
+//-----------------------------------------------------------------------------
+bool jgh_headless_run( const JGHHeadlessOptions & options )
+{
+    // log
+    cerr << "[2Tokyo2Drift]: headless: " << options.numFrames << " frames at dt="
+         << options.dt << " (" << options.width << "x" << options.height << ")" << endl;
+
+    // the framebuffer
+    vector<unsigned char> pixels( options.width * options.height * 4 );
+
+    // offscreen context (RGBA, 24-bit depth)
+    OSMesaContext context = OSMesaCreateContextExt( OSMESA_RGBA, 24, 0, 0, NULL );
+    // check
+    if( !context )
+    {
+        cerr << "[2Tokyo2Drift]: cannot create offscreen GL context..." << endl;
+        return false;
+    }
+    // bind to our buffer
+    if( !OSMesaMakeCurrent( context, &pixels[0], GL_UNSIGNED_BYTE,
+                            options.width, options.height ) )
+    {
+        cerr << "[2Tokyo2Drift]: cannot bind offscreen framebuffer..." << endl;
+        OSMesaDestroyContext( context );
+        return false;
+    }
+
+    // data path (no GLUT to move the working directory around)
+    Globals::path = "./";
+    Globals::datapath = Globals::path + Globals::relpath;
+    // size
+    Globals::windowWidth = options.width;
+    Globals::windowHeight = options.height;
+    glViewport( 0, 0, options.width, options.height );
+
+    // tracks and tempo, no audio I/O
+    jgh_sequencer_init();
+    // patterns
+    if( options.setFile != "" ) jgh_set_load( options.setFile.c_str() );
+    if( options.midiFile != "" ) jgh_import_midi( options.midiFile.c_str() );
+    if( options.exportFile != "" ) jgh_export_midi( options.exportFile.c_str() );
+
+    // GL state, simulation, scene
+    if( !jgh_gfx_setup() )
+    {
+        OSMesaDestroyContext( context );
+        return false;
+    }
+    // all textures in before the first timed frame
+    Globals::textureManager->finish();
+
+    // fixed timestep
+    XGfx::setFixedDelta( options.dt );
+    Globals::sim->setDesiredFrameRate( 1.0 / options.dt );
+    Globals::sim->setUseFixedTimeStep( true );
+
+    // timings
+    vector<double> updateTimes, drawTimes, finishTimes, frameTimes;
+    // audio samples elapsed since the last step (to advance the sequencer)
+    double samples = 0;
+    // and in all
+    double position = 0;
+    char filename[1024];
+
+    // per-frame header
+    fprintf( stdout, "frame,update_ms,draw_ms,finish_ms,frame_ms\n" );
+
+    // go
+    for( unsigned int i = 0; i < options.numFrames; i++ )
+    {
+        // advance the sequencer as the audio thread would
+        samples += options.dt * JGH_SRATE;
+        while( samples >= Globals::samplesPerBeatDivisor )
+        {
+            samples -= Globals::samplesPerBeatDivisor;
+            jgh_sequencer_step( position );
+            position += Globals::samplesPerBeatDivisor;
+        }
+
+        // mark
+        double t0 = XGfx::getMonotonicTime();
+        // render
+        jgh_gfx_render();
+        // mark
+        double t1 = XGfx::getMonotonicTime();
+        // wait for GL to finish
+        glFinish();
+        // mark
+        double t2 = XGfx::getMonotonicTime();
+
+        // record
+        updateTimes.push_back( Globals::sim->getLastUpdateTime() );
+        drawTimes.push_back( Globals::sim->getLastDrawTime() );
+        finishTimes.push_back( t2 - t1 );
+        frameTimes.push_back( t2 - t0 );
+
+        // per frame
+        fprintf( stdout, "%u,%.4f,%.4f,%.4f,%.4f\n", i,
+                 1000 * updateTimes.back(), 1000 * drawTimes.back(),
+                 1000 * finishTimes.back(), 1000 * frameTimes.back() );
+
+        // dump
+        if( options.dumpPrefix != "" )
+        {
+            snprintf( filename, sizeof(filename), "%s%05u.ppm", options.dumpPrefix.c_str(), i );
+            if( !writePPM( filename, &pixels[0], options.width, options.height ) )
+                cerr << "[2Tokyo2Drift]: cannot write frame: " << filename << endl;
+        }
+    }
+
+    // summary
+    report( "update", updateTimes );
+    report( "draw", drawTimes );
+    report( "finish", finishTimes );
+    report( "frame", frameTimes );
+
+    // clean up
+    OSMesaDestroyContext( context );
+
+    return true;
+}
+#else
+//-----------------------------------------------------------------------------
+// name: jgh_headless_run()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+bool jgh_headless_run( const JGHHeadlessOptions & /* options */ )
+{
+    cerr << "[2Tokyo2Drift]: built without headless support (make HEADLESS=1)..." << endl;
+    return false;
+}
+#endif
@@ -0,0 +1,53 @@
+//-----------------------------------------------------------------------------
+// name: jgh-headless.h
+// desc: offscreen (windowless) rendering, for benchmarking the render path
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __JGH_HEADLESS_H__
+#define __JGH_HEADLESS_H__
+
+#include <string>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHHeadlessOptions
+// desc: options for an offscreen run
+//-----------------------------------------------------------------------------
+struct JGHHeadlessOptions
+{
+    // number of frames to render
+    unsigned int numFrames;
+    // fixed timestep per frame (seconds)
+    double dt;
+    // framebuffer size
+    unsigned int width;
+    unsigned int height;
+    // prefix for PPM frame dumps ("" for no dumps)
+    std::string dumpPrefix;
+    // pattern set to load ("" for none)
+    std::string setFile;
+    // MIDI file to import drum patterns from ("" for none)
+    std::string midiFile;
+    // MIDI file to export the patterns to ("" for none)
+    std::string exportFile;
+
+    // constructor
+    JGHHeadlessOptions() : numFrames(600), dt(1.0/60), width(1280), height(720) { }
+};
+
+
+
+
+// parse command line; returns true if --headless was given
+bool jgh_headless_parse( int argc, const char ** argv, JGHHeadlessOptions & options );
+// build the scene offscreen, render, and report timing
+bool jgh_headless_run( const JGHHeadlessOptions & options );
+
+
+
+
+#endif
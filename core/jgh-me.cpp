@@ -9,34 +9,46 @@
 #include "jgh-globals.h"
 #include "jgh-audio.h"
 #include <iostream>
+#include <string.h>
 using namespace std;
 
+//-----------------------------------------------------------------------------
+// copy a track (in no version yet)
+//-----------------------------------------------------------------------------
+Track::Track( const Track & rhs )
+	: beatLength( rhs.beatLength ), notes( rhs.notes ), refs( 0 )
+{
+}
+
 //-----------------------------------------------------------------------------
 // calculate nearest beat
 //-----------------------------------------------------------------------------
-double Track::nearestBeatDivision()
+double Track::nearestBeatDivision() const
 {
 	// double curr_beat =  get_g_currBeat();
 	return currentBeatIndex();
 }
 
-double Track::currentBeatIndex()
+double Track::currentBeatIndex() const
 {
 	return Globals::currentBeatDivisorIndex + getCurrentBeat() * Globals::beatDivisor;
 }
 
+double Track::audibleBeatIndex() const
+{
+	return Globals::audibleBeatDivisorIndex + (Globals::audibleBeat % beatLength) * Globals::beatDivisor;
+}
+
 void Track::clearTrack()
 {
-	notes.clear();
-	notes.resize( beatLength * Globals::beatDivisor);
+	notes.assign( beatLength * Globals::beatDivisor, NoteEvent() );
 }
 
 void Track::changeBeatLength(unsigned int b)
 {
-	notes.resize(b*Globals::beatDivisor);
+	notes.resize(b*Globals::beatDivisor, NoteEvent());
 	beatLength = b;
 }
-Track* getTrack(unsigned int trackNumber);
 
 
 //-----------------------------------------------------------------------------
@@ -56,16 +68,16 @@ void calculateBeat()
 //-----------------------------------------------------------------------------
 // grab the current beat we're on
 //-----------------------------------------------------------------------------
-unsigned int Track::getCurrentBeat()
+unsigned int Track::getCurrentBeat() const
 {
 	return Globals::currentBeat % beatLength;
 }
 
 
 //-----------------------------------------------------------------------------
-// Add some notes homie
+// Add some notes homie (replacing the one on that step)
 //-----------------------------------------------------------------------------
-void Track::addNote(JGHNoteEvent *note, unsigned int index)
+void Track::addNote(const NoteEvent & note, unsigned int index)
 {
 	assert(index < notes.size()); // let's make sure we can even enter this!
 	notes[index] = note;
@@ -74,10 +86,19 @@ void Track::addNote(JGHNoteEvent *note, unsigned int index)
 //-----------------------------------------------------------------------------
 // playTheNextNote
 //-----------------------------------------------------------------------------
-JGHNoteEvent* Track::getNextNote()
+const NoteEvent* Track::getNextNote() const
 {
+	const NoteEvent & note = notes[(int) currentBeatIndex()];
+	return note.velocity ? &note : NULL;
+}
 
-	return notes[(int) currentBeatIndex()];
+//-----------------------------------------------------------------------------
+// the note being heard right now
+//-----------------------------------------------------------------------------
+const NoteEvent* Track::getAudibleNote() const
+{
+	const NoteEvent & note = notes[(int) audibleBeatIndex() % notes.size()];
+	return note.velocity ? &note : NULL;
 }
 
 
@@ -108,9 +129,6 @@ JGHSynth::~JGHSynth()
 {
     // delete buffer
     SAFE_DELETE_ARRAY( m_buffer );
-    // delete previous
-    for( int i = 0; i < m_previous.size(); i++ )
-        SAFE_DELETE( m_previous[i] );
     // zero out
     m_srate = 0;
 }
@@ -129,12 +147,14 @@ void JGHSynth::init( int srate, int frameSize, int polyphony, int numChannels )
     // initialize
     m_synth.init( srate, polyphony );
     
-    // delete previous
-    for( int i = 0; i < m_previous.size(); i++ ) SAFE_DELETE( m_previous[i] );
     // allocate previous
     m_previous.resize( numChannels );
     // zero out
-    for( int i = 0; i < m_previous.size(); i++ ) m_previous[i] = NULL;
+    for( size_t i = 0; i < m_previous.size(); i++ )
+    {
+        m_previous[i].count = 0;
+        m_previous[i].stopTime = 0;
+    }
     
     // check
     if( m_buffer != NULL ) SAFE_DELETE_ARRAY( m_buffer );
@@ -218,37 +238,31 @@ void JGHSynth::clearAllChords()
 // name: playNotes()
 // desc: play one or more notes (simultaneous)
 //-----------------------------------------------------------------------------
-void JGHSynth::playNotes( JGHNoteEvent * e )
+void JGHSynth::playNotes( const NoteEvent * notes, unsigned int count )
 {
     // sanity check
-    if( e->channel < 0|| e->channel >= m_previous.size() )
+    if( count == 0 ) return;
+    if( notes[0].channel >= m_previous.size() )
     {
         // message
-        cerr << "[JGH-synth]: WARNING: invalid note channel: " << e->channel << endl;
+        cerr << "[JGH-synth]: WARNING: invalid note channel: " << (int)notes[0].channel << endl;
         return;
     }
     
     // clear
-    //clearChord( e->channel );
+    //clearChord( notes[0].channel );
     
-    // save it
-    if( e ) m_previous[e->channel] = new JGHNoteEvent( e );
-    
-    // pointer
-    JGHNoteEvent * curr = e ? m_previous[e->channel] : NULL;
+    // save it (stopped with its first note, if that one ends)
+    JGHChord & chord = m_previous[notes[0].channel];
+    chord.count = count < JGH_MAX_CHORD ? count : JGH_MAX_CHORD;
+    memcpy( chord.notes, notes, chord.count * sizeof(NoteEvent) );
+    chord.stopTime = notes[0].duration > 0 ? m_now + notes[0].duration : 0;
     
     // iterate
-    while( curr )
+    for( unsigned int i = 0; i < count; i++ )
     {
-        // set start time
-        curr->synthStartTime = m_now;
-        // if duration not zero set end time
-        if( curr->duration > 0 ) curr->synthStopTime = m_now + curr->duration*m_srate;
         // note on
-
-        m_synth.noteOn( curr->channel, curr->pitch, curr->velocity * 127 );
-        // next simultaneous
-        curr = curr->simultaneous;
+        m_synth.noteOn( notes[i].channel, notes[i].pitch, notes[i].velocity );
     }
     
     // reset envelope
@@ -276,22 +290,21 @@ void JGHSynth::rampDownChord()
 //-----------------------------------------------------------------------------
 void JGHSynth::clearChord( int channel )
 {
-    // pointer
-    JGHNoteEvent * curr = m_previous[channel];
+    // the chord
+    JGHChord & chord = m_previous[channel];
     
     // iterate
-    while( curr )
+    for( unsigned int i = 0; i < chord.count; i++ )
     {
         // note off
         // m_synth->noteOff( 0, m_prevChord[i] );
         // note off
-        m_synth.noteOn( curr->channel, curr->pitch, 0 );
-        // next
-        curr = curr->simultaneous;
+        m_synth.noteOn( chord.notes[i].channel, chord.notes[i].pitch, 0 );
     }
     
-    // delete it
-    SAFE_DELETE( m_previous[channel] );
+    // done with it
+    chord.count = 0;
+    chord.stopTime = 0;
 }
 
 
@@ -314,8 +327,8 @@ void JGHSynth::synthesize2( float * buffer, unsigned int numFrames )
     for( int i = 0; i < m_previous.size(); i++ )
     {
         // check end time
-        if( m_previous[i] && m_previous[i]->synthStopTime > 0
-           && m_previous[i]->synthStopTime < m_now )
+        if( m_previous[i].count && m_previous[i].stopTime > 0
+           && m_previous[i].stopTime < m_now )
         {
             // stop that channel
             clearChord( i );
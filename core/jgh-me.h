@@ -14,6 +14,7 @@
 #include "x-vector3d.h"
 #include "y-fluidsynth.h"
 #include "y-echo.h"
+#include "y-score-reader.h"
 #include <string>
 #include <vector>
 #include <map>
@@ -27,74 +28,22 @@ void calculateBeat();
 
 //setBPM
 void setBPM(unsigned int BPM);
+// set the tempo to a fractional BPM (e.g., following MIDI clock)
+void setTempo( double bpm );
+
+// notes a chord holds on to, per synth channel (to stop them)
+#define JGH_MAX_CHORD 32
 
 //-----------------------------------------------------------------------------
-// name: struct JGHNoteEvent
-// desc: a MIDI note event, parsed for start and end time, with simultaneous
-//       notes combined into the 'simultaneous' linked list
+// name: struct JGHChord
+// desc: the chord last played on a synth channel
 //-----------------------------------------------------------------------------
-struct JGHNoteEvent
+struct JGHChord
 {
-    // data
-    long type;
-    unsigned short channel;
-    unsigned short pitch;
-    float velocity;
-    float energy;
-    
-    // more data
-    double duration; // in seconds
-    double startTime; // in seconds
-    double endTime; // in second
-    long transition;
-    
-    // internal use (e.g., by synth)
-    double synthStartTime;
-    double synthStopTime;
-    
-    // link to simultaneous events
-    JGHNoteEvent * simultaneous;
-    // link to parent (could be self)
-    JGHNoteEvent * next;
-    
-    // constructor
-    JGHNoteEvent() : type(0), channel(0), pitch(0), velocity(0), energy(1),
-    simultaneous(NULL), next(NULL), duration(0), startTime(0),
-    endTime(0), synthStartTime(0), synthStopTime(0), transition(0) { }
-    
-    // copy constructor (does not copy next)
-    JGHNoteEvent( const JGHNoteEvent * rhs )
-    {
-        // shallow copy
-        *this = *rhs;
-        // set next to NULL (does not copy at all)
-        this->next = NULL;
-        // new simultaneous
-        if( this->simultaneous != NULL )
-        {
-            // allocate and copy
-            this->simultaneous = new JGHNoteEvent( rhs->simultaneous );
-        }
-    }
-    
-    // destructor
-    ~JGHNoteEvent()
-    {
-        // if simultaneous
-        if( this->simultaneous != NULL )
-        {
-            // delete child
-            SAFE_DELETE( this->simultaneous );
-        }
-        
-        // if next
-        // TODO: does this iteratively instead of recursively
-        if( this->next != NULL )
-        {
-            // delete next
-            SAFE_DELETE( this->next );
-        }
-    }
+    NoteEvent notes[JGH_MAX_CHORD];
+    unsigned int count;
+    // when to stop it (synth samples; 0 for never)
+    double stopTime;
 };
 
 
@@ -122,7 +71,7 @@ public:
     // reset (clear everything)
     void reset();
     // play one or more notes (simultaneous)
-    void playNotes( JGHNoteEvent * e );
+    void playNotes( const NoteEvent * notes, unsigned int count );
     // ramp down chord
     void rampDownChord();
     // clear a chord
@@ -155,8 +104,8 @@ protected:
     Vector3D m_envelope;
     // pause ramp
     Vector3D m_pauseRamp;
-    // prevous note event
-    std::vector<JGHNoteEvent *> m_previous;
+    // prevous chord, per channel
+    std::vector<JGHChord> m_previous;
     
 protected:
     // the buffer
@@ -169,31 +118,44 @@ protected:
     double m_now;
 };
 
+//-----------------------------------------------------------------------------
+// name: class Track
+// desc: one track of a pattern version (see jgh-pattern.h): a note per step
+//       (velocity 0 for none), not changed once published
+//-----------------------------------------------------------------------------
 class Track
 {
 public:
     unsigned int beatLength;
-    vector<JGHNoteEvent *> notes;
+    vector<NoteEvent> notes;
+    // published pattern versions sharing it
+    unsigned int refs;
 
-    Track( unsigned int b)
+    Track( unsigned int b )
     {
         notes.resize( b * Globals::beatDivisor);
         beatLength = b;
+        refs = 0;
     }
-    ~Track()
-    {
-    
-    }
+    // copy (in no version yet)
+    Track( const Track & rhs );
 public:
-    JGHNoteEvent * getNextNote();
-    void addNote(JGHNoteEvent *note, unsigned int index);
-    unsigned int getCurrentBeat();
+    // the note on a step (NULL for none)
+    const NoteEvent * getNextNote() const;
+    void addNote(const NoteEvent & note, unsigned int index);
+    unsigned int getCurrentBeat() const;
     //calculate nearest beatDivision
-    double nearestBeatDivision();
-    double currentBeatIndex();
+    double nearestBeatDivision() const;
+    double currentBeatIndex() const;
+    // the step being heard (latency compensated; see jgh_audible_update)
+    double audibleBeatIndex() const;
+    const NoteEvent * getAudibleNote() const;
     void clearTrack();
 
     void changeBeatLength(unsigned int b);
+
+private:
+    Track & operator=( const Track & );
 };
 
 
@@ -0,0 +1,286 @@
+//-----------------------------------------------------------------------------
+// name: jgh-pattern.cpp
+// desc: pattern versions: edits make a new version sharing the tracks they
+//       did not change, published to the audio thread by swapping a pointer;
+//       the versions before it are kept for undo/redo
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "jgh-pattern.h"
+#include "x-thread.h"
+using namespace std;
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHRetired
+// desc: a version out of the history, waiting for readers that may still
+//       have it: where each reader was when it went
+//-----------------------------------------------------------------------------
+struct JGHRetired
+{
+    JGHPattern * pattern;
+    unsigned long seq[JGH_NUM_READERS];
+};
+
+// the current version
+JGHPattern * volatile g_pattern;
+// the versions, oldest first, and which is current
+vector<JGHPattern *> g_patternHistory;
+size_t g_patternAt;
+// versions waiting to be deleted
+vector<JGHRetired> g_patternRetired;
+// editors take turns (readers never take it)
+XMutex g_patternMutex;
+
+// per reader: odd while reading (bumped on the way in and out), and
+// nesting (touched only by the reader)
+volatile unsigned long g_readerSeq[JGH_NUM_READERS];
+unsigned int g_readerDepth[JGH_NUM_READERS];
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_begin()
+// desc: read the current version (never waits)
+//-----------------------------------------------------------------------------
+const JGHPattern * jgh_pattern_begin( unsigned int reader )
+{
+    if( g_readerDepth[reader]++ == 0 )
+    {
+        g_readerSeq[reader] = g_readerSeq[reader] + 1;
+        // seen reading before the version is taken
+        __sync_synchronize();
+    }
+
+    return g_pattern;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_end()
+// desc: done reading
+//-----------------------------------------------------------------------------
+void jgh_pattern_end( unsigned int reader )
+{
+    if( --g_readerDepth[reader] == 0 )
+    {
+        // done with the version before seen done
+        __sync_synchronize();
+        g_readerSeq[reader] = g_readerSeq[reader] + 1;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setCurrent()
+// desc: publish a version (editor's turn)
+//-----------------------------------------------------------------------------
+static void setCurrent( JGHPattern * pattern )
+{
+    // all of it written before it is seen
+    __sync_synchronize();
+    g_pattern = pattern;
+    // seen before any reader is checked on (see retire())
+    __sync_synchronize();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: retire()
+// desc: a version no longer current nor in the history: deleted once no
+//       reader can still have it (editor's turn)
+//-----------------------------------------------------------------------------
+static void retire( JGHPattern * pattern )
+{
+    JGHRetired retired;
+    retired.pattern = pattern;
+    for( unsigned int i = 0; i < JGH_NUM_READERS; i++ )
+        retired.seq[i] = g_readerSeq[i];
+    g_patternRetired.push_back( retired );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: reclaim()
+// desc: delete retired versions, and tracks no version has any more, once
+//       every reader has been out of reading since (editor's turn)
+//-----------------------------------------------------------------------------
+static void reclaim()
+{
+    size_t kept = 0;
+    for( size_t i = 0; i < g_patternRetired.size(); i++ )
+    {
+        JGHRetired & retired = g_patternRetired[i];
+
+        // readers reading then, still at it
+        bool safe = true;
+        for( unsigned int j = 0; j < JGH_NUM_READERS && safe; j++ )
+            safe = ( retired.seq[j] & 1 ) == 0 || g_readerSeq[j] != retired.seq[j];
+        if( !safe )
+        {
+            g_patternRetired[kept++] = retired;
+            continue;
+        }
+
+        // gone
+        JGHPattern * pattern = retired.pattern;
+        for( size_t j = 0; j < pattern->tracks.size(); j++ )
+            if( --pattern->tracks[j]->refs == 0 ) SAFE_DELETE( pattern->tracks[j] );
+        SAFE_DELETE( pattern );
+    }
+    g_patternRetired.resize( kept );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_init()
+// desc: first version: numTracks empty tracks numBeats long
+//-----------------------------------------------------------------------------
+void jgh_pattern_init( unsigned int numTracks, unsigned int numBeats )
+{
+    JGHPattern * pattern = new JGHPattern();
+    for( unsigned int i = 0; i < numTracks; i++ )
+    {
+        pattern->tracks.push_back( new Track( numBeats ) );
+        pattern->tracks.back()->refs = 1;
+    }
+
+    g_patternMutex.acquire();
+    g_patternHistory.push_back( pattern );
+    g_patternAt = g_patternHistory.size() - 1;
+    setCurrent( pattern );
+    g_patternMutex.release();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_edit()
+// desc: a draft of the current version, sharing all of its tracks; the
+//       editor's turn lasts until it is published or discarded
+//-----------------------------------------------------------------------------
+JGHPattern * jgh_pattern_edit()
+{
+    g_patternMutex.acquire();
+
+    JGHPattern * draft = new JGHPattern();
+    draft->tracks = g_pattern->tracks;
+    draft->owned.assign( draft->tracks.size(), false );
+
+    return draft;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_change()
+// desc: a track of a draft, to change (copied the first time)
+//-----------------------------------------------------------------------------
+Track * jgh_pattern_change( JGHPattern * draft, unsigned int track )
+{
+    if( !draft->owned[track] )
+    {
+        draft->tracks[track] = new Track( *draft->tracks[track] );
+        draft->owned[track] = true;
+    }
+
+    return draft->tracks[track];
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_publish()
+// desc: make a draft the current version, after the current one (the ones
+//       undone go), or as the only one
+//-----------------------------------------------------------------------------
+void jgh_pattern_publish( JGHPattern * draft, bool undoable )
+{
+    // the draft's tracks: in one more version
+    for( size_t i = 0; i < draft->tracks.size(); i++ )
+        draft->tracks[i]->refs++;
+    draft->owned.clear();
+
+    // what goes: undone versions (or all), and the oldest if too many
+    vector<JGHPattern *> gone;
+    size_t keep = undoable ? g_patternAt + 1 : 0;
+    while( g_patternHistory.size() > keep )
+    {
+        gone.push_back( g_patternHistory.back() );
+        g_patternHistory.pop_back();
+    }
+    g_patternHistory.push_back( draft );
+    if( g_patternHistory.size() > JGH_UNDO_LEVELS )
+    {
+        gone.push_back( g_patternHistory.front() );
+        g_patternHistory.erase( g_patternHistory.begin() );
+    }
+    g_patternAt = g_patternHistory.size() - 1;
+
+    // swap it in, then let go of the old
+    setCurrent( draft );
+    for( size_t i = 0; i < gone.size(); i++ ) retire( gone[i] );
+    reclaim();
+
+    g_patternMutex.release();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_discard()
+// desc: drop a draft (and its copies)
+//-----------------------------------------------------------------------------
+void jgh_pattern_discard( JGHPattern * draft )
+{
+    for( size_t i = 0; i < draft->tracks.size(); i++ )
+        if( draft->owned[i] ) SAFE_DELETE( draft->tracks[i] );
+    SAFE_DELETE( draft );
+
+    g_patternMutex.release();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_pattern_undo() / jgh_pattern_redo()
+// desc: back/forward through the versions
+//-----------------------------------------------------------------------------
+bool jgh_pattern_undo()
+{
+    g_patternMutex.acquire();
+    bool moved = g_patternAt > 0;
+    if( moved ) setCurrent( g_patternHistory[--g_patternAt] );
+    reclaim();
+    g_patternMutex.release();
+
+    return moved;
+}
+
+bool jgh_pattern_redo()
+{
+    g_patternMutex.acquire();
+    bool moved = g_patternAt + 1 < g_patternHistory.size();
+    if( moved ) setCurrent( g_patternHistory[++g_patternAt] );
+    reclaim();
+    g_patternMutex.release();
+
+    return moved;
+}
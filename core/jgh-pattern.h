@@ -0,0 +1,80 @@
+//-----------------------------------------------------------------------------
+// name: jgh-pattern.h
+// desc: pattern versions: edits make a new version sharing the tracks they
+//       did not change, published to the audio thread by swapping a pointer;
+//       the versions before it are kept for undo/redo
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __JGH_PATTERN_H__
+#define __JGH_PATTERN_H__
+
+#include "jgh-me.h"
+#include <vector>
+
+// versions kept for undo (the current one included)
+#define JGH_UNDO_LEVELS 256
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: enum JGHPatternReaders
+// desc: who reads versions, one thread each (see jgh_pattern_begin())
+//-----------------------------------------------------------------------------
+enum JGHPatternReaders
+{
+    // the audio callback
+    JGH_READER_AUDIO = 0,
+    // the GL (and main) thread
+    JGH_READER_GFX,
+    // autosave
+    JGH_READER_SAVE,
+    // how many
+    JGH_NUM_READERS
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHPattern
+// desc: one version of the pattern, a Track per track
+//-----------------------------------------------------------------------------
+struct JGHPattern
+{
+    // the tracks (shared with other versions once published)
+    std::vector<Track *> tracks;
+    // the ones a draft has copied, and may change
+    std::vector<bool> owned;
+};
+
+
+
+
+// first version: numTracks empty tracks numBeats long
+void jgh_pattern_init( unsigned int numTracks, unsigned int numBeats );
+// read the current version; never waits, and it stays valid (and the same)
+// until jgh_pattern_end() (one thread per reader; may be nested)
+const JGHPattern * jgh_pattern_begin( unsigned int reader );
+void jgh_pattern_end( unsigned int reader );
+
+// a draft of the current version to change (editors take turns until it is
+// published or discarded)
+JGHPattern * jgh_pattern_edit();
+// a track of a draft, to change (copied the first time)
+Track * jgh_pattern_change( JGHPattern * draft, unsigned int track );
+// make a draft the current version (undoable, or starting the history over)
+void jgh_pattern_publish( JGHPattern * draft, bool undoable = true );
+// drop a draft
+void jgh_pattern_discard( JGHPattern * draft );
+
+// back/forward through the versions; false if there is nowhere to go
+bool jgh_pattern_undo();
+bool jgh_pattern_redo();
+
+
+
+
+#endif
@@ -0,0 +1,445 @@
+//-----------------------------------------------------------------------------
+// name: jgh-profiler.cpp
+// desc: per-frame CPU/GPU profiling (frame, update/draw, per entity type,
+//       draw calls, GL state changes, audio DSP load)
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "jgh-profiler.h"
+#include "jgh-globals.h"
+#include "jgh-sim.h"
+#include <string.h>
+#include <stdlib.h>
+#include <iostream>
+#if defined(__GNUC__)
+#include <cxxabi.h>
+#endif
+using namespace std;
+
+
+// GL_EXT_timer_query / GL_ARB_timer_query
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+// smoothing for display
+#define SMOOTH(avg, x) ( (avg) += .1 * ((x) - (avg)) )
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: JGHProfiler()
+// desc: constructor
+//-----------------------------------------------------------------------------
+JGHProfiler::JGHProfiler()
+{
+    m_showing = false;
+    m_enabled = false;
+    m_inFrame = false;
+    m_frameStart = 0;
+    m_prevFrameStart = 0;
+    m_audioLoad = 0;
+    m_gpuChecked = false;
+    m_gpuTimer = false;
+    m_queryIndex = 0;
+    m_dumpFile = NULL;
+    m_dumpHeader = false;
+    m_dumpFrame = 0;
+    m_dumpNumTypes = 0;
+
+    // zero out
+    memset( m_queries, 0, sizeof(m_queries) );
+    memset( m_queryPending, 0, sizeof(m_queryPending) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~JGHProfiler()
+// desc: destructor
+//-----------------------------------------------------------------------------
+JGHProfiler::~JGHProfiler()
+{
+    // stop dumping
+    stopDump();
+    // uninstall
+    if( YEntity::getMonitor() == this ) YEntity::setMonitor( NULL );
+    // (GPU queries go away with the context)
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setShowing()
+// desc: show/hide the overlay
+//-----------------------------------------------------------------------------
+void JGHProfiler::setShowing( bool showing )
+{
+    m_showing = showing;
+    updateEnabled();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: startDump()
+// desc: start writing one CSV line per frame
+//-----------------------------------------------------------------------------
+bool JGHProfiler::startDump( const string & filename )
+{
+    // stop any
+    stopDump();
+
+    // open
+    m_dumpFile = fopen( filename.c_str(), "w" );
+    // check
+    if( !m_dumpFile )
+    {
+        cerr << "[2Tokyo2Drift]: cannot open profile dump: " << filename << endl;
+        return false;
+    }
+
+    // header goes out with the first complete frame
+    m_dumpHeader = false;
+    m_dumpFrame = 0;
+    updateEnabled();
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: stopDump()
+// desc: stop writing CSV
+//-----------------------------------------------------------------------------
+void JGHProfiler::stopDump()
+{
+    // check
+    if( !m_dumpFile ) return;
+
+    // close
+    fclose( m_dumpFile );
+    m_dumpFile = NULL;
+    updateEnabled();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: updateEnabled()
+// desc: measure only when someone is looking
+//-----------------------------------------------------------------------------
+void JGHProfiler::updateEnabled()
+{
+    m_enabled = m_showing || m_dumpFile != NULL;
+    // (un)install entity monitor
+    YEntity::setMonitor( m_enabled ? this : NULL );
+    // any frame in progress is incomplete
+    m_inFrame = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: beginFrame()
+// desc: mark start of frame
+//-----------------------------------------------------------------------------
+void JGHProfiler::beginFrame()
+{
+    // check
+    if( !m_enabled ) return;
+
+    // first time with a context
+    if( !m_gpuChecked ) checkGPUTimer();
+
+    // mark
+    m_prevFrameStart = m_frameStart;
+    m_frameStart = XGfx::getMonotonicTime();
+
+    // reset accumulators (also drops anything the HUD drew last frame)
+    XGfx::resetCounters();
+    for( size_t i = 0; i < m_types.size(); i++ )
+    {
+        m_types[i].update = 0;
+        m_types[i].draw = 0;
+        m_types[i].count = 0;
+    }
+    m_stack.clear();
+
+    // GPU
+    if( m_gpuTimer )
+    {
+        // make sure this slot is free
+        if( m_queryPending[m_queryIndex] ) collectGPU( true );
+        // start
+        glBeginQuery( GL_TIME_ELAPSED, m_queries[m_queryIndex] );
+    }
+
+    m_inFrame = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: endFrame()
+// desc: mark end of frame; snapshot numbers
+//-----------------------------------------------------------------------------
+void JGHProfiler::endFrame()
+{
+    // check (frames that started while disabled don't count)
+    if( !m_enabled || !m_inFrame ) return;
+    m_inFrame = false;
+
+    // GPU
+    if( m_gpuTimer )
+    {
+        // end
+        glEndQuery( GL_TIME_ELAPSED );
+        m_queryPending[m_queryIndex] = true;
+        // next slot
+        m_queryIndex = (m_queryIndex + 1) % JGH_PROFILER_NUM_QUERIES;
+        // pick up the oldest, if ready
+        collectGPU( false );
+    }
+
+    // snapshot
+    m_last.cpu = XGfx::getMonotonicTime() - m_frameStart;
+    m_last.period = m_prevFrameStart > 0 ? m_frameStart - m_prevFrameStart : 0;
+    m_last.update = Globals::sim->getLastUpdateTime();
+    m_last.draw = Globals::sim->getLastDrawTime();
+    m_last.drawCalls = XGfx::ourNumDrawCalls;
+    m_last.stateChanges = XGfx::ourNumStateChanges;
+    m_last.audioLoad = m_audioLoad;
+
+    // smooth
+    SMOOTH( m_smoothed.period, m_last.period );
+    SMOOTH( m_smoothed.cpu, m_last.cpu );
+    SMOOTH( m_smoothed.update, m_last.update );
+    SMOOTH( m_smoothed.draw, m_last.draw );
+    SMOOTH( m_smoothed.drawCalls, m_last.drawCalls );
+    SMOOTH( m_smoothed.stateChanges, m_last.stateChanges );
+    m_smoothed.audioLoad = m_last.audioLoad;
+    if( m_last.gpu >= 0 )
+    {
+        if( m_smoothed.gpu < 0 ) m_smoothed.gpu = m_last.gpu;
+        SMOOTH( m_smoothed.gpu, m_last.gpu );
+    }
+
+    // per type
+    for( size_t i = 0; i < m_types.size(); i++ )
+    {
+        JGHProfileType & t = m_types[i];
+        t.lastUpdate = t.update;
+        t.lastDraw = t.draw;
+        t.lastCount = t.count;
+        SMOOTH( t.avgUpdate, t.update );
+        SMOOTH( t.avgDraw, t.draw );
+    }
+
+    // dump
+    if( m_dumpFile )
+    {
+        if( !m_dumpHeader ) writeHeader();
+        writeFrame();
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: reportAudio()
+// desc: report one audio callback (audio thread)
+//-----------------------------------------------------------------------------
+void JGHProfiler::reportAudio( double callbackTime, double bufferDuration )
+{
+    // sanity check
+    if( bufferDuration <= 0 ) return;
+
+    // smooth over a few callbacks (single writer)
+    float load = m_audioLoad;
+    m_audioLoad = load + .2f * ( (float)(callbackTime / bufferDuration) - load );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: begin()
+// desc: before one entity's own update/render
+//-----------------------------------------------------------------------------
+void JGHProfiler::begin( YEntity * e, bool /* isRender */ )
+{
+    Mark m;
+    m.index = typeIndex( e );
+    m.children = 0;
+    m.start = XGfx::getMonotonicTime();
+    m_stack.push_back( m );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: end()
+// desc: after one entity's own update/render
+//-----------------------------------------------------------------------------
+void JGHProfiler::end( YEntity * /* e */, bool isRender )
+{
+    // installed mid-pass
+    if( m_stack.empty() ) return;
+
+    // pop
+    Mark m = m_stack.back();
+    m_stack.pop_back();
+    // elapsed
+    double elapsed = XGfx::getMonotonicTime() - m.start;
+
+    // exclusive of nested entities (e.g., pools updating their members)
+    JGHProfileType & t = m_types[m.index];
+    if( isRender ) { t.draw += elapsed - m.children; t.count++; }
+    else t.update += elapsed - m.children;
+
+    // charge to the parent as nested time
+    if( !m_stack.empty() ) m_stack.back().children += elapsed;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: typeIndex()
+// desc: get index for the type of an entity
+//-----------------------------------------------------------------------------
+size_t JGHProfiler::typeIndex( YEntity * e )
+{
+    const type_info * info = &typeid( *e );
+    // look up
+    map<const type_info *, size_t>::iterator itr = m_typeIndex.find( info );
+    if( itr != m_typeIndex.end() ) return itr->second;
+
+    // new type
+    JGHProfileType t;
+    t.name = info->name();
+#if defined(__GNUC__)
+    // demangle
+    int status = 0;
+    char * demangled = abi::__cxa_demangle( info->name(), NULL, NULL, &status );
+    if( demangled && status == 0 ) t.name = demangled;
+    free( demangled );
+#endif
+
+    // add
+    m_types.push_back( t );
+    m_typeIndex[info] = m_types.size() - 1;
+
+    return m_types.size() - 1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: checkGPUTimer()
+// desc: see if GL_TIME_ELAPSED queries are supported; set them up
+//-----------------------------------------------------------------------------
+void JGHProfiler::checkGPUTimer()
+{
+    m_gpuChecked = true;
+
+    // extensions
+    const char * ext = (const char *)glGetString( GL_EXTENSIONS );
+    // check
+    m_gpuTimer = ext && ( strstr( ext, "GL_EXT_timer_query" ) ||
+                          strstr( ext, "GL_ARB_timer_query" ) );
+
+    // set up
+    if( m_gpuTimer ) glGenQueries( JGH_PROFILER_NUM_QUERIES, m_queries );
+
+    // log
+    fprintf( stderr, "[2Tokyo2Drift]: profiler: GPU timer %s\n",
+             m_gpuTimer ? "available" : "not available" );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: collectGPU()
+// desc: read back the oldest pending query (optionally waiting for it)
+//-----------------------------------------------------------------------------
+void JGHProfiler::collectGPU( bool wait )
+{
+    // oldest is the one we would overwrite next
+    unsigned int index = m_queryIndex;
+    // check
+    if( !m_queryPending[index] ) return;
+
+    // ready?
+    GLint available = 0;
+    if( !wait )
+    {
+        glGetQueryObjectiv( m_queries[index], GL_QUERY_RESULT_AVAILABLE, &available );
+        if( !available ) return;
+    }
+
+    // nanoseconds (32 bits covers 4 seconds)
+    GLuint ns = 0;
+    glGetQueryObjectuiv( m_queries[index], GL_QUERY_RESULT, &ns );
+    m_queryPending[index] = false;
+
+    // this is from JGH_PROFILER_NUM_QUERIES-1 frames ago
+    m_last.gpu = ns / 1000000000.0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: writeHeader()
+// desc: CSV header; entity types seen so far get columns
+//-----------------------------------------------------------------------------
+void JGHProfiler::writeHeader()
+{
+    fprintf( m_dumpFile, "frame,period_ms,cpu_ms,update_ms,draw_ms,gpu_ms,"
+             "draw_calls,state_changes,audio_load" );
+    // per type (types that show up later are not dumped)
+    m_dumpNumTypes = m_types.size();
+    for( size_t i = 0; i < m_dumpNumTypes; i++ )
+        fprintf( m_dumpFile, ",%s_update_ms,%s_draw_ms",
+                 m_types[i].name.c_str(), m_types[i].name.c_str() );
+    fprintf( m_dumpFile, "\n" );
+
+    m_dumpHeader = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: writeFrame()
+// desc: one CSV line for the last frame
+//-----------------------------------------------------------------------------
+void JGHProfiler::writeFrame()
+{
+    fprintf( m_dumpFile, "%lu,%.4f,%.4f,%.4f,%.4f,%.4f,%.0f,%.0f,%.4f",
+             m_dumpFrame++, 1000 * m_last.period, 1000 * m_last.cpu,
+             1000 * m_last.update, 1000 * m_last.draw,
+             m_last.gpu >= 0 ? 1000 * m_last.gpu : -1.0,
+             m_last.drawCalls, m_last.stateChanges, m_last.audioLoad );
+    // per type
+    for( size_t i = 0; i < m_dumpNumTypes; i++ )
+        fprintf( m_dumpFile, ",%.4f,%.4f",
+                 1000 * m_types[i].lastUpdate, 1000 * m_types[i].lastDraw );
+    fprintf( m_dumpFile, "\n" );
+}
@@ -0,0 +1,182 @@
+//-----------------------------------------------------------------------------
+// name: jgh-profiler.h
+// desc: per-frame CPU/GPU profiling (frame, update/draw, per entity type,
+//       draw calls, GL state changes, audio DSP load)
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __JGH_PROFILER_H__
+#define __JGH_PROFILER_H__
+
+#include "y-entity.h"
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <typeinfo>
+
+// number of GPU timer queries in flight (results lag by this many frames)
+#define JGH_PROFILER_NUM_QUERIES 4
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHProfileFrame
+// desc: one frame worth of numbers (times in seconds)
+//-----------------------------------------------------------------------------
+struct JGHProfileFrame
+{
+    // start of this frame to start of the previous one
+    double period;
+    // CPU time inside the frame (update + draw + everything else)
+    double cpu;
+    // simulation update / draw
+    double update;
+    double draw;
+    // GPU time (-1 if not available)
+    double gpu;
+    // counters
+    double drawCalls;
+    double stateChanges;
+    // audio callback time / buffer duration
+    double audioLoad;
+
+    // constructor
+    JGHProfileFrame() : period(0), cpu(0), update(0), draw(0), gpu(-1),
+        drawCalls(0), stateChanges(0), audioLoad(0) { }
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHProfileType
+// desc: CPU time for one entity type (exclusive of children)
+//-----------------------------------------------------------------------------
+struct JGHProfileType
+{
+    // type name
+    std::string name;
+    // accumulating (this frame)
+    double update;
+    double draw;
+    unsigned long count;
+    // last frame
+    double lastUpdate;
+    double lastDraw;
+    unsigned long lastCount;
+    // smoothed (for display)
+    double avgUpdate;
+    double avgDraw;
+
+    // constructor
+    JGHProfileType() : update(0), draw(0), count(0), lastUpdate(0),
+        lastDraw(0), lastCount(0), avgUpdate(0), avgDraw(0) { }
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class JGHProfiler
+// desc: collects timing around jgh_gfx_render(); measures only while the
+//       overlay is showing or a CSV dump is running
+//-----------------------------------------------------------------------------
+class JGHProfiler : public YEntityMonitor
+{
+public:
+    JGHProfiler();
+    virtual ~JGHProfiler();
+
+public:
+    // show/hide the overlay
+    void setShowing( bool showing );
+    // get it
+    bool isShowing() const { return m_showing; }
+    // start writing one CSV line per frame
+    bool startDump( const std::string & filename );
+    // stop it
+    void stopDump();
+    // get it
+    bool isDumping() const { return m_dumpFile != NULL; }
+    // measuring at all?
+    bool isEnabled() const { return m_enabled; }
+
+public:
+    // mark start of frame (GL thread)
+    void beginFrame();
+    // mark end of frame, before any HUD drawing (GL thread)
+    void endFrame();
+    // report one audio callback (audio thread)
+    void reportAudio( double callbackTime, double bufferDuration );
+
+public:
+    // last frame
+    const JGHProfileFrame & last() const { return m_last; }
+    // smoothed
+    const JGHProfileFrame & smoothed() const { return m_smoothed; }
+    // per entity type
+    const std::vector<JGHProfileType> & types() const { return m_types; }
+    // GPU timing available?
+    bool hasGPUTimer() const { return m_gpuTimer; }
+
+public: // YEntityMonitor
+    virtual void begin( YEntity * e, bool isRender );
+    virtual void end( YEntity * e, bool isRender );
+
+protected:
+    // update m_enabled from showing/dumping
+    void updateEnabled();
+    // get index for the type of an entity
+    size_t typeIndex( YEntity * e );
+    // GPU timer setup/readback
+    void checkGPUTimer();
+    void collectGPU( bool wait );
+    // write CSV
+    void writeHeader();
+    void writeFrame();
+
+protected:
+    // nested entity timing
+    struct Mark { double start; double children; size_t index; };
+    std::vector<Mark> m_stack;
+    // types
+    std::vector<JGHProfileType> m_types;
+    std::map<const std::type_info *, size_t> m_typeIndex;
+
+protected:
+    // state
+    bool m_showing;
+    bool m_enabled;
+    bool m_inFrame;
+    // frame marks
+    double m_frameStart;
+    double m_prevFrameStart;
+    // results
+    JGHProfileFrame m_last;
+    JGHProfileFrame m_smoothed;
+    // audio (written by the audio thread)
+    volatile float m_audioLoad;
+
+protected:
+    // GPU timer queries (ring)
+    bool m_gpuChecked;
+    bool m_gpuTimer;
+    GLuint m_queries[JGH_PROFILER_NUM_QUERIES];
+    bool m_queryPending[JGH_PROFILER_NUM_QUERIES];
+    unsigned int m_queryIndex;
+
+protected:
+    // CSV
+    FILE * m_dumpFile;
+    bool m_dumpHeader;
+    unsigned long m_dumpFrame;
+    size_t m_dumpNumTypes;
+};
+
+
+
+
+#endif
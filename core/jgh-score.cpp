@@ -0,0 +1,359 @@
+//-----------------------------------------------------------------------------
+// name: jgh-score.cpp
+// desc: score playback: a MIDI file played through the synth along with the
+//       patterns; a feeder thread queues its notes ahead of the audio, each
+//       stamped with the sample to play it at
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "jgh-score.h"
+#include "jgh-globals.h"
+#include "x-audio.h"
+#include "x-buffer.h"
+#include "x-gfx.h"
+#include "x-thread.h"
+#include <stdlib.h>
+#include <vector>
+#include <deque>
+#include <queue>
+#include <algorithm>
+#include <iostream>
+using namespace std;
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHLater
+// desc: orders notes latest first (a heap of them has the soonest on top)
+//-----------------------------------------------------------------------------
+struct JGHLater
+{
+    bool operator()( const NoteEvent & a, const NoteEvent & b ) const
+    { return a.time > b.time; }
+};
+
+// the score (loaded only while the feeder is not running), and the end of
+// its last note (samples)
+YScoreReader g_score;
+bool g_scoreLoaded;
+double g_scoreLength;
+
+// notes, feeder to audio thread
+XLockFreeQueue<NoteEvent> g_scoreQueue( JGH_SCORE_QUEUE_SIZE );
+// stops asked for (feeder) and done with (audio thread), and the one being
+// done (audio thread); see jgh_score_flushing()
+volatile unsigned int g_scoreFlush;
+volatile unsigned int g_scoreFlushed;
+unsigned int g_scoreFlushing;
+
+// the feeder: the thread, its wake up, asked to stop, and still feeding
+XThread * g_scoreFeeder;
+XCondition g_scoreCond;
+XMutex g_scoreMutex;
+bool g_scoreQuit;
+volatile bool g_scorePlaying;
+
+// feeder state: how far ahead (samples), the sample position the score
+// starts at (-1 until the audio clock runs), the score position queued up to,
+// note offs to come, and notes waiting for room in the queue
+double g_scoreLookahead;
+double g_scoreStart;
+double g_scoreFed;
+priority_queue<NoteEvent, vector<NoteEvent>, JGHLater> g_scoreOffs;
+deque<NoteEvent> g_scoreOutbox;
+// notes found in a window, and the ones to queue from it
+vector<const NoteEvent *> g_scoreFound;
+vector<NoteEvent> g_scoreBatch;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: earlier()
+// desc: queue order: by time, note offs first
+//-----------------------------------------------------------------------------
+static bool earlier( const NoteEvent & a, const NoteEvent & b )
+{
+    if( a.time != b.time ) return a.time < b.time;
+    return a.velocity == 0 && b.velocity != 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: feed()
+// desc: queue the notes starting (or ending) up to the look-ahead from what
+//       is being computed now (feeder thread); returns false once all are in
+//-----------------------------------------------------------------------------
+static bool feed()
+{
+    // no audio clock yet: start once there is
+    if( !XAudioIO::isClockRunning() ) return true;
+    double now = XAudioIO::clockSample( XGfx::getMonotonicTime() );
+    if( g_scoreStart < 0 ) g_scoreStart = now + g_scoreLookahead;
+
+    // the score position to queue up to
+    double horizon = now + g_scoreLookahead - g_scoreStart;
+    if( horizon > g_scoreFed )
+    {
+        g_scoreBatch.clear();
+        for( long i = 0; i < g_score.getNumTracks(); i++ )
+        {
+            // notes starting in [fed, horizon) (the window opens a sample
+            // early, for notes that never end)
+            g_score.getEvents( i, g_scoreFed - 1, horizon, g_scoreFound, true );
+            for( size_t j = 0; j < g_scoreFound.size(); j++ )
+            {
+                const NoteEvent * e = g_scoreFound[j];
+                if( e->time < g_scoreFed || e->time >= horizon ) continue;
+                g_scoreBatch.push_back( *e );
+                // and when it lets go
+                if( e->duration == 0 ) continue;
+                NoteEvent off = *e;
+                off.time += e->duration;
+                off.velocity = 0;
+                g_scoreOffs.push( off );
+            }
+        }
+        // note offs due
+        while( g_scoreOffs.size() && g_scoreOffs.top().time < horizon )
+        {
+            g_scoreBatch.push_back( g_scoreOffs.top() );
+            g_scoreOffs.pop();
+        }
+
+        // in order, at sample positions
+        stable_sort( g_scoreBatch.begin(), g_scoreBatch.end(), earlier );
+        for( size_t i = 0; i < g_scoreBatch.size(); i++ )
+        {
+            g_scoreBatch[i].time += g_scoreStart;
+            g_scoreOutbox.push_back( g_scoreBatch[i] );
+        }
+        g_scoreFed = horizon;
+    }
+
+    // as many as fit
+    while( g_scoreOutbox.size() && g_scoreQueue.put( g_scoreOutbox.front() ) )
+        g_scoreOutbox.pop_front();
+
+    return g_scoreFed < g_scoreLength || g_scoreOffs.size() || g_scoreOutbox.size();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: letGo()
+// desc: stopped early: have the audio thread drop the notes queued, then let
+//       go of the ones that may be sounding (feeder thread)
+//-----------------------------------------------------------------------------
+static void letGo()
+{
+    // the notes queued so far are seen before the stop
+    __sync_synchronize();
+    g_scoreFlush = g_scoreFlush + 1;
+
+    // note offs not yet queued
+    vector<NoteEvent> offs;
+    for( size_t i = 0; i < g_scoreOutbox.size(); i++ )
+        if( g_scoreOutbox[i].velocity == 0 ) offs.push_back( g_scoreOutbox[i] );
+    for( ; g_scoreOffs.size(); g_scoreOffs.pop() )
+        offs.push_back( g_scoreOffs.top() );
+    g_scoreOutbox.clear();
+
+    // now (the audio thread makes room as it drops the rest)
+    for( size_t i = 0; i < offs.size(); i++ )
+    {
+        offs[i].time = 0;
+        for( int tries = 0; !g_scoreQueue.put( offs[i] ) && tries < 100; tries++ )
+            usleep( 1000 );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: score_loop()
+// desc: feeder thread: top the queue up every period until done or stopped
+//-----------------------------------------------------------------------------
+static THREAD_RETURN THREAD_TYPE score_loop( void * /* data */ )
+{
+    g_scoreMutex.acquire();
+    while( !g_scoreQuit && feed() )
+        g_scoreCond.wait( g_scoreMutex, JGH_SCORE_PERIOD );
+    bool stopped = g_scoreQuit;
+    g_scoreMutex.release();
+
+    // stopped before the end
+    if( stopped ) letGo();
+    g_scorePlaying = false;
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_score_load()
+// desc: load a MIDI score (stopping the one playing)
+//-----------------------------------------------------------------------------
+bool jgh_score_load( const char * path )
+{
+    jgh_score_stop();
+
+    // notes timed in samples
+    g_scoreLoaded = g_score.load( path, 0, JGH_SRATE );
+    if( !g_scoreLoaded )
+    {
+        cerr << "[2Tokyo2Drift]: cannot load score: " << path << endl;
+        return false;
+    }
+
+    // how long
+    unsigned long numNotes = 0;
+    g_scoreLength = 0;
+    for( long i = 0; i < g_score.getNumTracks(); i++ )
+    {
+        const vector<NoteEvent> & notes = g_score.getNotes( i );
+        for( size_t j = 0; j < notes.size(); j++ )
+            g_scoreLength = max( g_scoreLength, notes[j].time + notes[j].duration );
+        numNotes += notes.size();
+    }
+
+    // log
+    cerr << "[2Tokyo2Drift]: score: " << numNotes << " notes, " << g_scoreLength / JGH_SRATE
+         << " seconds from: " << path << endl;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_score_play()
+// desc: play the score from the start, lookahead seconds from now
+//-----------------------------------------------------------------------------
+bool jgh_score_play( double lookahead )
+{
+    // nothing to play
+    if( !g_scoreLoaded )
+    {
+        cerr << "[2Tokyo2Drift]: no score loaded..." << endl;
+        return false;
+    }
+    // already
+    if( g_scorePlaying ) return true;
+
+    // done with the last time
+    jgh_score_stop();
+    // the audio thread still dropping its notes: give it a moment
+    for( int tries = 0; g_scoreFlushed != g_scoreFlush && XAudioIO::isClockRunning() && tries < 100; tries++ )
+        usleep( 1000 );
+
+    // from the start
+    g_scoreLookahead = lookahead * JGH_SRATE;
+    g_scoreStart = -1;
+    g_scoreFed = 0;
+    while( g_scoreOffs.size() ) g_scoreOffs.pop();
+    g_scoreOutbox.clear();
+
+    g_scoreQuit = false;
+    g_scorePlaying = true;
+    g_scoreFeeder = new XThread();
+    if( !g_scoreFeeder->start( score_loop, NULL ) )
+    {
+        cerr << "[2Tokyo2Drift]: cannot start score playback..." << endl;
+        g_scorePlaying = false;
+        SAFE_DELETE( g_scoreFeeder );
+        return false;
+    }
+    // stopped on the way out
+    static bool once = false;
+    if( !once ) atexit( jgh_score_stop );
+    once = true;
+
+    // log
+    cerr << "[2Tokyo2Drift]: score:PLAY" << endl;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_score_stop()
+// desc: stop playing (the notes sounding are let go)
+//-----------------------------------------------------------------------------
+void jgh_score_stop()
+{
+    // not running
+    if( !g_scoreFeeder ) return;
+
+    // log (not if it had played to the end)
+    if( g_scorePlaying ) cerr << "[2Tokyo2Drift]: score:STOP" << endl;
+
+    // wake it for the last time
+    g_scoreMutex.acquire();
+    g_scoreQuit = true;
+    g_scoreCond.signal();
+    g_scoreMutex.release();
+
+    // wait for it
+    g_scoreFeeder->join();
+    SAFE_DELETE( g_scoreFeeder );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_score_playing()
+// desc: is the score playing (its notes still being queued)
+//-----------------------------------------------------------------------------
+bool jgh_score_playing()
+{
+    return g_scorePlaying;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_score_next() / jgh_score_pop()
+// desc: the next note queued, and done with it (audio thread)
+//-----------------------------------------------------------------------------
+bool jgh_score_next( NoteEvent & note )
+{
+    return g_scoreQueue.peek( note );
+}
+
+void jgh_score_pop()
+{
+    g_scoreQueue.pop();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_score_flushing() / jgh_score_flushed()
+// desc: stopped since last asked? then all notes queued before the stop are
+//       there to drop, and it is done with once they are (audio thread)
+//-----------------------------------------------------------------------------
+bool jgh_score_flushing()
+{
+    g_scoreFlushing = g_scoreFlush;
+    // the notes queued before it, seen after it
+    __sync_synchronize();
+    return g_scoreFlushing != g_scoreFlushed;
+}
+
+void jgh_score_flushed()
+{
+    g_scoreFlushed = g_scoreFlushing;
+}
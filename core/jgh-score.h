@@ -0,0 +1,48 @@
+//-----------------------------------------------------------------------------
+// name: jgh-score.h
+// desc: score playback: a MIDI file played through the synth along with the
+//       patterns; a feeder thread queues its notes ahead of the audio, each
+//       stamped with the sample to play it at
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __JGH_SCORE_H__
+#define __JGH_SCORE_H__
+
+#include "y-score-reader.h"
+
+// how far ahead of the audio the feeder keeps notes queued (seconds)
+#define JGH_SCORE_LOOKAHEAD 0.2
+// how often the feeder tops the queue up (seconds)
+#define JGH_SCORE_PERIOD 0.02
+// notes (on and off) in flight, feeder to audio thread
+#define JGH_SCORE_QUEUE_SIZE 8192
+
+
+
+
+// load a MIDI score (stopping the one playing)
+bool jgh_score_load( const char * path );
+// play the score from the start, lookahead seconds from now (once the audio
+// is running)
+bool jgh_score_play( double lookahead = JGH_SCORE_LOOKAHEAD );
+// stop playing (the notes sounding are let go)
+void jgh_score_stop();
+// is the score playing
+bool jgh_score_playing();
+
+// audio thread: the next note queued (time: the sample position to play it
+// at; velocity 0 to let go of it); false if none
+bool jgh_score_next( NoteEvent & note );
+// audio thread: done with it
+void jgh_score_pop();
+// audio thread: stopped? then drop the notes queued (playing only the ones
+// letting go), and call jgh_score_flushed()
+bool jgh_score_flushing();
+void jgh_score_flushed();
+
+
+
+
+#endif
@@ -0,0 +1,534 @@
+//-----------------------------------------------------------------------------
+// name: jgh-set.cpp
+// desc: pattern sets: a versioned binary file of kits, tracks and patterns,
+//       loaded by mapping it into memory, and kept saved in the background
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "jgh-set.h"
+#include "jgh-audio.h"
+#include "jgh-globals.h"
+#include "x-mmap.h"
+#include "x-thread.h"
+#include "x-gfx.h"
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <vector>
+#include <string>
+using namespace std;
+
+
+// a pattern: velocity per step per track (as jgh_pattern_read() has it)
+typedef vector< vector<unsigned char> > JGHPatternSteps;
+
+// the set as loaded (NULL if none), and its tables
+XMappedFile * g_setFile;
+const JGHSetHeader * g_setHeader;
+const JGHSetKit * g_setKits;
+const JGHSetTrack * g_setTracks;
+const JGHSetLane * g_setLanes;
+const unsigned char * g_setSteps;
+// our track for each of its tracks (-1 for none)
+vector<int> g_setTrackMap;
+// changed or added since loading, one per pattern (NULL: as in the file)
+vector<JGHPatternSteps *> g_setPatterns;
+// the pattern playing
+unsigned int g_setCurrent;
+// loads and pattern changes so far
+unsigned long g_setChanges;
+// guards all of the above (never taken by the audio thread)
+XMutex g_setMutex;
+
+// autosave: the thread, its wake up, asked to stop, where to, what it has
+// saved (the pattern playing, changes), and whether the last save failed
+XThread * g_autosave;
+XCondition g_autosaveCond;
+bool g_autosaveQuit;
+string g_autosavePath;
+JGHPatternSteps g_autosaveLive;
+unsigned long g_autosaveChanges;
+bool g_autosaveFailed;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: copyName()
+// desc: copy a name into a fixed-size field (cut short, and terminated)
+//-----------------------------------------------------------------------------
+static void copyName( char * field, size_t size, const char * name )
+{
+    strncpy( field, name, size - 1 );
+    field[size - 1] = '\0';
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: checkTable()
+// desc: is a table of count records inside a file of size bytes
+//-----------------------------------------------------------------------------
+static bool checkTable( size_t size, uint32_t offset, uint64_t count, size_t recordSize )
+{
+    return offset % 4 == 0 && offset <= size && count * recordSize <= size - offset;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: checkSet()
+// desc: check a set file over without reading the steps; returns what is
+//       wrong with it, or NULL
+//-----------------------------------------------------------------------------
+static const char * checkSet( const unsigned char * data, size_t size )
+{
+    const JGHSetHeader * header = (const JGHSetHeader *)data;
+
+    // what it is
+    if( size < sizeof(JGHSetHeader) || memcmp( header->magic, JGH_SET_MAGIC, 4 ) != 0 )
+        return "not a pattern set";
+    if( header->version > JGH_SET_VERSION )
+        return "made by a newer version";
+    if( header->version == 0 || header->headerSize < sizeof(JGHSetHeader) || header->fileSize != size )
+        return "damaged or cut short";
+    if( header->beatDivisor != Globals::beatDivisor )
+        return "made with a different number of steps per beat";
+
+    // the tables
+    uint64_t numLanes = (uint64_t)header->numPatterns * header->numTracks;
+    if( !checkTable( size, header->kitOffset, header->numKits, sizeof(JGHSetKit) ) ||
+        !checkTable( size, header->trackOffset, header->numTracks, sizeof(JGHSetTrack) ) ||
+        !checkTable( size, header->laneOffset, numLanes, sizeof(JGHSetLane) ) ||
+        !checkTable( size, header->stepOffset, header->numSteps, 1 ) )
+        return "damaged";
+
+    // what they point to
+    const JGHSetTrack * tracks = (const JGHSetTrack *)( data + header->trackOffset );
+    for( uint32_t i = 0; i < header->numTracks; i++ )
+        if( tracks[i].kit >= header->numKits ) return "damaged";
+    const JGHSetLane * lanes = (const JGHSetLane *)( data + header->laneOffset );
+    for( uint64_t i = 0; i < numLanes; i++ )
+        if( (uint64_t)lanes[i].firstStep + lanes[i].numSteps > header->numSteps ) return "damaged";
+
+    return NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: readPattern()
+// desc: a pattern as changed, as in the file, or empty (g_setMutex held)
+//-----------------------------------------------------------------------------
+static void readPattern( unsigned int which, JGHPatternSteps & steps )
+{
+    // changed since loading
+    if( which < g_setPatterns.size() && g_setPatterns[which] )
+    {
+        steps = *g_setPatterns[which];
+        return;
+    }
+
+    // a measure of nothing
+    steps.assign( Globals::numberOfTracks,
+                  vector<unsigned char>( Globals::beatsPerMeasure * Globals::beatDivisor, 0 ) );
+
+    // as in the file
+    if( !g_setHeader || which >= g_setHeader->numPatterns ) return;
+    const JGHSetLane * lanes = g_setLanes + (size_t)which * g_setHeader->numTracks;
+    for( uint32_t i = 0; i < g_setHeader->numTracks; i++ )
+    {
+        int track = g_setTrackMap[i];
+        if( track < 0 || track >= (int)steps.size() ) continue;
+        const unsigned char * first = g_setSteps + lanes[i].firstStep;
+        steps[track].assign( first, first + lanes[i].numSteps );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: encodeSet()
+// desc: lay out the whole set as a file, with live as the pattern playing
+//       (g_setMutex held)
+//-----------------------------------------------------------------------------
+static void encodeSet( const JGHPatternSteps & live, vector<unsigned char> & out )
+{
+    uint32_t numTracks = Globals::numberOfTracks;
+    uint32_t numPatterns = (uint32_t)max( g_setPatterns.size(), (size_t)1 );
+
+    // the steps, pattern by pattern
+    vector<JGHSetLane> lanes( (size_t)numPatterns * numTracks );
+    vector<unsigned char> table;
+    JGHPatternSteps steps;
+    for( uint32_t i = 0; i < numPatterns; i++ )
+    {
+        if( i != g_setCurrent ) readPattern( i, steps );
+        const JGHPatternSteps & pattern = i == g_setCurrent ? live : steps;
+        for( uint32_t j = 0; j < numTracks; j++ )
+        {
+            JGHSetLane & lane = lanes[(size_t)i * numTracks + j];
+            lane.firstStep = (uint32_t)table.size();
+            lane.numSteps = j < pattern.size() ? (uint32_t)pattern[j].size() : 0;
+            if( lane.numSteps ) table.insert( table.end(), pattern[j].begin(), pattern[j].end() );
+        }
+    }
+
+    // the header
+    JGHSetHeader header;
+    memset( &header, 0, sizeof(header) );
+    memcpy( header.magic, JGH_SET_MAGIC, 4 );
+    header.version = JGH_SET_VERSION;
+    header.headerSize = sizeof(JGHSetHeader);
+    header.numKits = 1;
+    header.numTracks = numTracks;
+    header.numPatterns = numPatterns;
+    header.numSteps = (uint32_t)table.size();
+    header.kitOffset = sizeof(JGHSetHeader);
+    header.trackOffset = header.kitOffset + header.numKits * sizeof(JGHSetKit);
+    header.laneOffset = header.trackOffset + numTracks * sizeof(JGHSetTrack);
+    header.stepOffset = header.laneOffset + (uint32_t)( lanes.size() * sizeof(JGHSetLane) );
+    header.fileSize = ( header.stepOffset + header.numSteps + 3 ) & ~3u;
+    header.bpm = (float)( Globals::samplesPerMinute / ( Globals::samplesPerBeatDivisor * Globals::beatDivisor ) );
+    header.beatDivisor = (uint16_t)Globals::beatDivisor;
+    header.beatsPerMeasure = (uint16_t)Globals::beatsPerMeasure;
+    header.currentPattern = g_setCurrent;
+
+    // the kit
+    JGHSetKit kit;
+    memset( &kit, 0, sizeof(kit) );
+    copyName( kit.name, sizeof(kit.name), JGH_KIT_NAME );
+    copyName( kit.font, sizeof(kit.font), JGH_KIT_FONT );
+
+    // lay it out
+    out.assign( header.fileSize, 0 );
+    memcpy( &out[0], &header, sizeof(header) );
+    memcpy( &out[header.kitOffset], &kit, sizeof(kit) );
+    for( uint32_t i = 0; i < numTracks; i++ )
+    {
+        JGHSetTrack track;
+        memset( &track, 0, sizeof(track) );
+        copyName( track.name, sizeof(track.name), getDrumNameForTrack( i ) );
+        track.pitch = (uint8_t)getDrumForTrack( i );
+        track.channel = 9;
+        memcpy( &out[header.trackOffset + i * sizeof(JGHSetTrack)], &track, sizeof(track) );
+    }
+    if( lanes.size() ) memcpy( &out[header.laneOffset], &lanes[0], lanes.size() * sizeof(JGHSetLane) );
+    if( table.size() ) memcpy( &out[header.stepOffset], &table[0], table.size() );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: writeSet()
+// desc: write a set file next to path, then move it into place (a crash
+//       part way leaves the old one whole)
+//-----------------------------------------------------------------------------
+static bool writeSet( const string & path, const vector<unsigned char> & data )
+{
+    string temp = path + ".tmp";
+    FILE * fp = fopen( temp.c_str(), "wb" );
+    // check
+    if( !fp ) return false;
+
+    bool ok = fwrite( &data[0], 1, data.size(), fp ) == data.size();
+    ok = fflush( fp ) == 0 && ok;
+#ifndef __PLATFORM_WIN32__
+    // on disk before it replaces the old one
+    ok = ok && fsync( fileno( fp ) ) == 0;
+#endif
+    ok = fclose( fp ) == 0 && ok;
+
+#ifdef __PLATFORM_WIN32__
+    // rename does not replace there
+    if( ok ) remove( path.c_str() );
+#endif
+    if( ok ) ok = rename( temp.c_str(), path.c_str() ) == 0;
+    if( !ok ) remove( temp.c_str() );
+
+    return ok;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_set_load()
+// desc: map a set and play its current pattern; only the header, tracks and
+//       lanes are looked at, steps are read as their patterns are played
+//-----------------------------------------------------------------------------
+bool jgh_set_load( const char * path )
+{
+    double start = XGfx::getMonotonicTime();
+
+    // map it
+    XMappedFile * file = new XMappedFile();
+    if( !file->open( path ) )
+    {
+        cerr << "[2Tokyo2Drift]: no pattern set at: " << path << endl;
+        SAFE_DELETE( file );
+        return false;
+    }
+    // check it over
+    const char * problem = checkSet( file->data(), file->size() );
+    if( problem )
+    {
+        cerr << "[2Tokyo2Drift]: cannot load pattern set (" << problem << "): " << path << endl;
+        SAFE_DELETE( file );
+        return false;
+    }
+
+    g_setMutex.acquire();
+
+    // out with the old
+    for( size_t i = 0; i < g_setPatterns.size(); i++ )
+        SAFE_DELETE( g_setPatterns[i] );
+    SAFE_DELETE( g_setFile );
+
+    // in with the new
+    const unsigned char * data = file->data();
+    g_setFile = file;
+    g_setHeader = (const JGHSetHeader *)data;
+    g_setKits = (const JGHSetKit *)( data + g_setHeader->kitOffset );
+    g_setTracks = (const JGHSetTrack *)( data + g_setHeader->trackOffset );
+    g_setLanes = (const JGHSetLane *)( data + g_setHeader->laneOffset );
+    g_setSteps = data + g_setHeader->stepOffset;
+    g_setPatterns.assign( max( g_setHeader->numPatterns, (uint32_t)1 ), (JGHPatternSteps *)NULL );
+    g_setCurrent = g_setHeader->currentPattern < g_setHeader->numPatterns ? g_setHeader->currentPattern : 0;
+
+    // its tracks: ours playing the same drum (or the nearest)
+    g_setTrackMap.assign( g_setHeader->numTracks, -1 );
+    for( uint32_t i = 0; i < g_setHeader->numTracks; i++ )
+    {
+        for( unsigned int j = 0; j < Globals::numberOfTracks && g_setTrackMap[i] < 0; j++ )
+            if( getDrumForTrack( j ) == g_setTracks[i].pitch ) g_setTrackMap[i] = j;
+        if( g_setTrackMap[i] < 0 ) g_setTrackMap[i] = getTrackForDrum( g_setTracks[i].pitch );
+        if( g_setTrackMap[i] < 0 )
+            cerr << "[2Tokyo2Drift]: no track for: " << g_setTracks[i].name << " (skipped)" << endl;
+    }
+    // its kits: one soundfont in this build
+    for( uint32_t i = 0; i < g_setHeader->numKits; i++ )
+        if( strncmp( g_setKits[i].font, JGH_KIT_FONT, sizeof(g_setKits[i].font) ) != 0 )
+            cerr << "[2Tokyo2Drift]: kit " << g_setKits[i].name << " plays as " << JGH_KIT_NAME << endl;
+
+    // tempo and measure
+    if( g_setHeader->bpm > 0 ) setTempo( g_setHeader->bpm );
+    if( g_setHeader->beatsPerMeasure > 0 ) Globals::beatsPerMeasure = g_setHeader->beatsPerMeasure;
+
+    // play it
+    JGHPatternSteps steps;
+    readPattern( g_setCurrent, steps );
+    jgh_pattern_write( steps, false );
+    g_setChanges++;
+
+    // this is what is on disk
+    jgh_pattern_read( g_autosaveLive );
+    g_autosaveChanges = g_setChanges;
+
+    unsigned int numPatterns = g_setHeader->numPatterns;
+    g_setMutex.release();
+
+    // log
+    fprintf( stderr, "[2Tokyo2Drift]: loaded %u patterns in %.3f ms from: %s\n",
+             numPatterns, 1000 * ( XGfx::getMonotonicTime() - start ), path );
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_set_save()
+// desc: write the set now
+//-----------------------------------------------------------------------------
+bool jgh_set_save( const char * path )
+{
+    JGHPatternSteps live;
+    vector<unsigned char> data;
+
+    // lay it out
+    g_setMutex.acquire();
+    jgh_pattern_read( live );
+    encodeSet( live, data );
+    unsigned int numPatterns = jgh_set_count();
+    g_setMutex.release();
+
+    // write it
+    if( !writeSet( path, data ) )
+    {
+        cerr << "[2Tokyo2Drift]: cannot save pattern set: " << path << endl;
+        return false;
+    }
+
+    // log
+    cerr << "[2Tokyo2Drift]: saved " << numPatterns << " patterns to: " << path << endl;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_set_select()
+// desc: play another pattern; this one is kept as it is now, and patterns
+//       past the end are new (empty)
+//-----------------------------------------------------------------------------
+void jgh_set_select( unsigned int pattern )
+{
+    g_setMutex.acquire();
+
+    // keep this one
+    if( g_setPatterns.size() == 0 ) g_setPatterns.push_back( NULL );
+    if( !g_setPatterns[g_setCurrent] ) g_setPatterns[g_setCurrent] = new JGHPatternSteps();
+    jgh_pattern_read( *g_setPatterns[g_setCurrent] );
+
+    // play that one
+    if( pattern >= g_setPatterns.size() ) g_setPatterns.resize( pattern + 1, NULL );
+    g_setCurrent = pattern;
+    JGHPatternSteps steps;
+    readPattern( pattern, steps );
+    jgh_pattern_write( steps, false );
+    g_setChanges++;
+
+    g_setMutex.release();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_set_current() / jgh_set_count()
+// desc: the pattern playing, and how many there are
+//-----------------------------------------------------------------------------
+unsigned int jgh_set_current()
+{
+    return g_setCurrent;
+}
+
+unsigned int jgh_set_count()
+{
+    return (unsigned int)max( g_setPatterns.size(), (size_t)1 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: autosave()
+// desc: write the set if anything changed since the last time (g_setMutex
+//       held, and released while writing)
+//-----------------------------------------------------------------------------
+static void autosave()
+{
+    // anything new
+    JGHPatternSteps live;
+    jgh_pattern_read( live, JGH_READER_SAVE );
+    if( g_setChanges == g_autosaveChanges && live == g_autosaveLive ) return;
+
+    // lay it out
+    vector<unsigned char> data;
+    encodeSet( live, data );
+    unsigned long changes = g_setChanges;
+    string path = g_autosavePath;
+
+    // write it (without keeping pattern changes waiting)
+    g_setMutex.release();
+    bool ok = writeSet( path, data );
+    g_setMutex.acquire();
+
+    // check (once per failure)
+    if( !ok )
+    {
+        if( !g_autosaveFailed )
+            cerr << "[2Tokyo2Drift]: cannot autosave pattern set: " << path << endl;
+        g_autosaveFailed = true;
+        return;
+    }
+
+    // saved
+    g_autosaveLive.swap( live );
+    g_autosaveChanges = changes;
+    g_autosaveFailed = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: autosave_loop()
+// desc: autosave thread: look for changes every so often, and once more on
+//       the way out
+//-----------------------------------------------------------------------------
+static THREAD_RETURN THREAD_TYPE autosave_loop( void * /* data */ )
+{
+    g_setMutex.acquire();
+    while( !g_autosaveQuit )
+    {
+        g_autosaveCond.wait( g_setMutex, JGH_AUTOSAVE_PERIOD );
+        autosave();
+    }
+    g_setMutex.release();
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_set_autosave()
+// desc: keep the set saved to path, on its own thread (and once more at
+//       exit, however we get there)
+//-----------------------------------------------------------------------------
+bool jgh_set_autosave( const char * path )
+{
+    // already
+    if( g_autosave ) return true;
+
+    g_autosavePath = path;
+    g_autosaveQuit = false;
+    g_autosave = new XThread();
+    if( !g_autosave->start( autosave_loop, NULL ) )
+    {
+        cerr << "[2Tokyo2Drift]: cannot start autosave..." << endl;
+        SAFE_DELETE( g_autosave );
+        return false;
+    }
+    atexit( jgh_set_stop );
+
+    // log
+    cerr << "[2Tokyo2Drift]: autosaving patterns to: " << path << endl;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: jgh_set_stop()
+// desc: save what changed and stop autosaving
+//-----------------------------------------------------------------------------
+void jgh_set_stop()
+{
+    // not running
+    if( !g_autosave ) return;
+
+    // wake it for the last time
+    g_setMutex.acquire();
+    g_autosaveQuit = true;
+    g_autosaveCond.signal();
+    g_setMutex.release();
+
+    // wait for it
+    g_autosave->join();
+    SAFE_DELETE( g_autosave );
+}
@@ -0,0 +1,125 @@
+//-----------------------------------------------------------------------------
+// name: jgh-set.h
+// desc: pattern sets: a versioned binary file of kits, tracks and patterns,
+//       loaded by mapping it into memory, and kept saved in the background
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __JGH_SET_H__
+#define __JGH_SET_H__
+
+#include <stdint.h>
+
+// set file magic, and the format version written (older ones are read)
+#define JGH_SET_MAGIC       "2T2D"
+#define JGH_SET_VERSION     1
+// the set saved to and loaded from when none is named
+#define JGH_SET_DEFAULT     "2tokyo2drift.jgh"
+// how often autosave looks for changes (seconds)
+#define JGH_AUTOSAVE_PERIOD 2.0
+
+
+
+
+//-----------------------------------------------------------------------------
+// file layout: header, kits, tracks, lanes, steps; fixed-size records in
+// native byte order, every table 4-byte aligned, so a mapped file is used
+// in place
+//-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// name: struct JGHSetHeader
+// desc: at the start of the file
+//-----------------------------------------------------------------------------
+struct JGHSetHeader
+{
+    // JGH_SET_MAGIC (not terminated)
+    char magic[4];
+    // format version
+    uint32_t version;
+    // size of this header and of the whole file (bytes)
+    uint32_t headerSize;
+    uint32_t fileSize;
+    // how many of each
+    uint32_t numKits;
+    uint32_t numTracks;
+    uint32_t numPatterns;
+    uint32_t numSteps;
+    // where each table starts (bytes from the start of the file)
+    uint32_t kitOffset;
+    uint32_t trackOffset;
+    uint32_t laneOffset;
+    uint32_t stepOffset;
+    // tempo
+    float bpm;
+    // steps per beat, beats per measure
+    uint16_t beatDivisor;
+    uint16_t beatsPerMeasure;
+    // the pattern playing when saved
+    uint32_t currentPattern;
+};
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHSetKit
+// desc: a sound set (soundfont)
+//-----------------------------------------------------------------------------
+struct JGHSetKit
+{
+    // names (terminated)
+    char name[32];
+    char font[96];
+};
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHSetTrack
+// desc: a track: which drum of which kit
+//-----------------------------------------------------------------------------
+struct JGHSetTrack
+{
+    // name (terminated)
+    char name[24];
+    // kit index
+    uint32_t kit;
+    // GM drum note and MIDI channel
+    uint8_t pitch;
+    uint8_t channel;
+    uint16_t reserved;
+};
+
+
+//-----------------------------------------------------------------------------
+// name: struct JGHSetLane
+// desc: one track of one pattern (numPatterns x numTracks of these, pattern
+//       by pattern): its run in the step table, one velocity byte (1-127;
+//       0 for none) per step
+//-----------------------------------------------------------------------------
+struct JGHSetLane
+{
+    uint32_t firstStep;
+    uint32_t numSteps;
+};
+
+
+
+
+// load a set and play its current pattern (edits not yet saved are dropped)
+bool jgh_set_load( const char * path );
+// write the set now
+bool jgh_set_save( const char * path );
+// play another pattern (edits to this one are kept); past the end, new ones
+void jgh_set_select( unsigned int pattern );
+// the pattern playing, and how many there are
+unsigned int jgh_set_current();
+unsigned int jgh_set_count();
+// keep the set saved to path, on its own thread (and once more at exit)
+bool jgh_set_autosave( const char * path );
+// save what changed and stop autosaving
+void jgh_set_stop();
+
+
+
+
+#endif
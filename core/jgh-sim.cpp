@@ -7,6 +7,7 @@
 //-----------------------------------------------------------------------------
 #include "jgh-sim.h"
 #include "jgh-globals.h"
+#include "x-slew.h"
 #include <iostream>
 using namespace std;
 
@@ -32,6 +33,8 @@ JGHSim::JGHSim()
     m_lastDelta = 0;
     m_first = true;
     m_isPaused = false;
+    m_lastUpdateTime = 0;
+    m_lastDrawTime = 0;
 }
 
 
@@ -60,6 +63,13 @@ void JGHSim::systemCascade()
     YTimeInterval timeElapsed = XGfx::getCurrentTime() - m_simTime;
     m_simTime += timeElapsed;
     
+    // fixed timestep (e.g., for offscreen benchmarking)
+    if( m_useFixedTimeStep )
+    {
+        // exactly one step
+        timeElapsed = STEPTIME;
+    }
+    
     // special case: first update
     if( m_first )
     {
@@ -73,16 +83,30 @@ void JGHSim::systemCascade()
     if( timeElapsed > SIM_SKIP_TIME )
         timeElapsed = SIM_SKIP_TIME;
 
+    // mark
+    double t0 = XGfx::getMonotonicTime();
+
     // update it
     // check paused
     if( !m_isPaused )
     {
+        // advance all entity slews (one pass)
+        XSlewBank::global()->advance( timeElapsed );
         // update the world with a fixed timestep
         m_gfxRoot.updateAll( timeElapsed );
     }
 
-    // redraw
+    // mark
+    double t1 = XGfx::getMonotonicTime();
+
+    // redraw (text in one shared batch)
+    YText::beginBatch();
     m_gfxRoot.drawAll();
+    YText::endBatch();
+
+    // record timing
+    m_lastUpdateTime = t1 - t0;
+    m_lastDrawTime = XGfx::getMonotonicTime() - t1;
 
     // set
     m_lastDelta = timeElapsed;
@@ -117,4 +141,8 @@ double JGHSim::getDesiredFrameRate() const { return m_desiredFrameRate; }
 //-------------------------------------------------------------------------------
 YTimeInterval JGHSim::delta() const
 { return m_lastDelta; }
+//-------------------------------------------------------------------------------
+// use a fixed timestep of 1/framerate instead of wall-clock
+//-------------------------------------------------------------------------------
+void JGHSim::setUseFixedTimeStep( bool fixed ) { m_useFixedTimeStep = fixed; }
 
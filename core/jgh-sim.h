@@ -42,6 +42,14 @@ public:
     double getDesiredFrameRate() const;
     // get the timestep in effect (fixed or dynamic)
     YTimeInterval delta() const;
+    // use a fixed timestep of 1/framerate instead of wall-clock
+    void setUseFixedTimeStep( bool fixed );
+    
+public:
+    // time (in seconds) spent in the last update pass
+    double getLastUpdateTime() const { return m_lastUpdateTime; }
+    // time (in seconds) spent in the last draw pass (CPU side)
+    double getLastDrawTime() const { return m_lastDrawTime; }
     
 public:
     // get the root
@@ -60,6 +68,10 @@ public:
     YTimeInterval m_lastDelta;
     bool m_first;
     bool m_isPaused;
+    
+public:
+    double m_lastUpdateTime;
+    double m_lastDrawTime;
 };
 
 
@@ -17,19 +17,81 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#endif
 #include "glm.h"
 
 
 #define T(x) (model->triangles[(x)])
 
 
-/* _GLMnode: general purpose node */
-typedef struct _GLMnode {
-    GLuint index;
-    GLboolean averaged;
-    struct _GLMnode* next;
-} GLMnode;
+/* split work over threads only above this many items */
+#define GLM_PARALLEL_MIN 65536
+/* most threads to split work over */
+#define GLM_MAX_THREADS  16
+
+
+/* glmNumThreads: number of threads to split work items over (1 for
+ * small jobs, where starting threads costs more than it saves)
+ */
+static GLuint
+glmNumThreads(GLuint work)
+{
+    long cores;
+
+    if (work < GLM_PARALLEL_MIN)
+        return 1;
+#ifndef _WIN32
+    cores = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+    cores = 1;
+#endif
+    if (cores < 1)
+        cores = 1;
+    if (cores > GLM_MAX_THREADS)
+        cores = GLM_MAX_THREADS;
+    return (GLuint)cores;
+}
 
+/* glmRunJobs: run task on each of numjobs jobs (an array of structs
+ * of size bytes), one thread each, and wait for all of them
+ */
+static GLvoid
+glmRunJobs(GLvoid* (*task)(GLvoid*), GLvoid* jobs, size_t size, GLuint numjobs)
+{
+#ifndef _WIN32
+    pthread_t threads[GLM_MAX_THREADS];
+    GLboolean started[GLM_MAX_THREADS];
+    GLuint i;
+
+    /* the others in the background... */
+    for (i = 1; i < numjobs; i++) {
+        started[i] = pthread_create(&threads[i], NULL, task,
+            (char*)jobs + i * size) == 0;
+        /* couldn't start one: do it here */
+        if (!started[i])
+            task((char*)jobs + i * size);
+    }
+    /* ...the first one here */
+    if (numjobs)
+        task(jobs);
+    for (i = 1; i < numjobs; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+#else
+    GLuint i;
+
+    for (i = 0; i < numjobs; i++)
+        task((char*)jobs + i * size);
+#endif
+}
 
 /* glmMax: returns the maximum of two floats */
 static GLfloat
@@ -114,49 +176,160 @@ glmEqual(GLfloat* u, GLfloat* v, GLfloat epsilon)
     return GL_FALSE;
 }
 
-/* glmWeldVectors: eliminate (weld) vectors that are within an
- * epsilon of each other.
- *
- * vectors     - array of GLfloat[3]'s to be welded
- * numvectors - number of GLfloat[3]'s in vectors
- * epsilon     - maximum difference between vectors
+/* glmWeldCell: cell of a coordinate in the weld hash (cells are two
+ * epsilons wide), and which neighbouring cells (-1 below, +1 above)
+ * can also hold vectors within an epsilon of it: only the one on the
+ * nearer side -- both when close to the middle, so rounding can't
+ * make us miss one.
+ */
+static long long
+glmWeldCell(GLfloat x, GLfloat epsilon, int* lo, int* hi)
+{
+    double position, cell, fraction;
+
+    position = (double)x / (2.0 * epsilon);
+    cell = floor(position);
+    fraction = position - cell;
+    *lo = fraction < 0.501 ? -1 : 0;
+    *hi = fraction > 0.499 ? 1 : 0;
+
+    /* keep neighbours (+/- 1) in range; NaN goes to cell 0 */
+    if (!(cell == cell))
+        cell = 0;
+    if (cell > 1e18)
+        cell = 1e18;
+    if (cell < -1e18)
+        cell = -1e18;
+    return (long long)cell;
+}
+
+/* glmWeldHash: hash a weld cell */
+static GLuint
+glmWeldHash(long long x, long long y, long long z)
+{
+    unsigned long long h;
+
+    h = ((unsigned long long)x * 73856093ULL) ^
+        ((unsigned long long)y * 19349663ULL) ^
+        ((unsigned long long)z * 83492791ULL);
+    return (GLuint)(h ^ (h >> 29));
+}
+
+/* glmWeldMap: weld vectors that are within an epsilon of each other
+ * using a spatial hash: any match lies in the same cell or in one of
+ * the (usually 7) neighbouring cells glmWeldCell() picks, and the
+ * first unique vector (lowest index) that matches wins, so this gives
+ * the same result as comparing against every unique vector so far,
+ * in linear time.  Returns the unique vectors (1-based, like the
+ * input); map[i] is set to the new index of vector i.
  *
+ * vectors    - array of GLfloat[3]'s to be welded (1-based)
+ * numvectors - number of GLfloat[3]'s in vectors (set to number of uniques)
+ * epsilon    - maximum difference between vectors
+ * map        - array of (numvectors + 1) GLuints
  */
-GLfloat*
-glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
+static GLfloat*
+glmWeldMap(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon, GLuint* map)
 {
     GLfloat* copies;
-    GLuint copied;
-    GLuint i, j;
+    GLfloat* vector;
+    GLuint* heads;
+    GLuint* next;
+    GLuint copied, tablesize, mask, best, b, h, i;
+    long long x, y, z;
+    int xlo, xhi, ylo, yhi, zlo, zhi;
+    int dx, dy, dz;
 
     copies = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (*numvectors + 1));
-    memcpy(copies, vectors, (sizeof(GLfloat) * 3 * (*numvectors + 1)));
+    copies[0] = copies[1] = copies[2] = 0;
+
+    /* nothing can be within a (non-positive) epsilon */
+    if (!(epsilon > 0)) {
+        memcpy(copies, vectors, sizeof(GLfloat) * 3 * (*numvectors + 1));
+        for (i = 1; i <= *numvectors; i++)
+            map[i] = i;
+        return copies;
+    }
+
+    /* at most half full: chains stay short */
+    tablesize = 1024;
+    while (tablesize < 2 * *numvectors)
+        tablesize *= 2;
+    mask = tablesize - 1;
+    heads = (GLuint*)calloc(tablesize, sizeof(GLuint));
+    next = (GLuint*)malloc(sizeof(GLuint) * (*numvectors + 1));
 
-    copied = 1;
+    copied = 0;
     for (i = 1; i <= *numvectors; i++) {
-        for (j = 1; j <= copied; j++) {
-            if (glmEqual(&vectors[3 * i], &copies[3 * j], epsilon)) {
-                goto duplicate;
+        vector = &vectors[3 * i];
+        x = glmWeldCell(vector[0], epsilon, &xlo, &xhi);
+        y = glmWeldCell(vector[1], epsilon, &ylo, &yhi);
+        z = glmWeldCell(vector[2], epsilon, &zlo, &zhi);
+
+        /* lowest numbered copy in this or a neighbouring cell */
+        best = 0;
+        for (dx = xlo; dx <= xhi; dx++) {
+            for (dy = ylo; dy <= yhi; dy++) {
+                for (dz = zlo; dz <= zhi; dz++) {
+                    b = heads[glmWeldHash(x + dx, y + dy, z + dz) & mask];
+                    while (b) {
+                        if ((!best || b < best) &&
+                            glmEqual(vector, &copies[3 * b], epsilon))
+                            best = b;
+                        b = next[b];
+                    }
+                }
             }
         }
 
         /* must not be any duplicates -- add to the copies array */
-        copies[3 * copied + 0] = vectors[3 * i + 0];
-        copies[3 * copied + 1] = vectors[3 * i + 1];
-        copies[3 * copied + 2] = vectors[3 * i + 2];
-        j = copied;             /* pass this along for below */
-        copied++;
+        if (!best) {
+            best = ++copied;
+            copies[3 * best + 0] = vector[0];
+            copies[3 * best + 1] = vector[1];
+            copies[3 * best + 2] = vector[2];
+            h = glmWeldHash(x, y, z) & mask;
+            next[best] = heads[h];
+            heads[h] = best;
+        }
 
-duplicate:
-        /* set the first component of this vector to point at the correct
-        index into the new copies array */
-        vectors[3 * i + 0] = (GLfloat)j;
+        map[i] = best;
     }
 
-    *numvectors = copied-1;
+    free(heads);
+    free(next);
+
+    *numvectors = copied;
     return copies;
 }
 
+/* glmWeldVectors: eliminate (weld) vectors that are within an
+ * epsilon of each other.
+ *
+ * vectors     - array of GLfloat[3]'s to be welded
+ * numvectors - number of GLfloat[3]'s in vectors
+ * epsilon     - maximum difference between vectors
+ *
+ */
+GLfloat*
+glmWeldVectors(GLfloat* vectors, GLuint* numvectors, GLfloat epsilon)
+{
+    GLfloat* copies;
+    GLuint* map;
+    GLuint i, n;
+
+    n = *numvectors;
+    map = (GLuint*)malloc(sizeof(GLuint) * (n + 1));
+    copies = glmWeldMap(vectors, numvectors, epsilon, map);
+
+    /* set the first component of each vector to point at the correct
+    index into the new copies array */
+    for (i = 1; i <= n; i++)
+        vectors[3 * i + 0] = (GLfloat)map[i];
+
+    free(map);
+    return copies;
+}
 /* glmFindGroup: Find a group in the model */
 GLMgroup*
 glmFindGroup(GLMmodel* model, char* name)
@@ -934,6 +1107,47 @@ glmReverseWinding(GLMmodel* model)
     }
 }
 
+/* _GLMfacetjob: one thread's share of glmFacetNormals() */
+typedef struct _GLMfacetjob {
+    GLMmodel* model;
+    GLuint first;               /* first triangle */
+    GLuint last;                /* one past the last triangle */
+} GLMfacetjob;
+
+/* glmFacetNormalsJob: facet normals for a range of triangles */
+static GLvoid*
+glmFacetNormalsJob(GLvoid* data)
+{
+    GLMfacetjob* job = (GLMfacetjob*)data;
+    GLMmodel* model = job->model;
+    GLuint  i;
+    GLfloat u[3];
+    GLfloat v[3];
+
+    for (i = job->first; i < job->last; i++) {
+        model->triangles[i].findex = i+1;
+
+        u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
+            model->vertices[3 * T(i).vindices[0] + 0];
+        u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
+            model->vertices[3 * T(i).vindices[0] + 1];
+        u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
+            model->vertices[3 * T(i).vindices[0] + 2];
+
+        v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
+            model->vertices[3 * T(i).vindices[0] + 0];
+        v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
+            model->vertices[3 * T(i).vindices[0] + 1];
+        v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
+            model->vertices[3 * T(i).vindices[0] + 2];
+
+        glmCross(u, v, &model->facetnorms[3 * (i+1)]);
+        glmNormalize(&model->facetnorms[3 * (i+1)]);
+    }
+
+    return NULL;
+}
+
 /* glmFacetNormals: Generates facet normals for a model (by taking the
  * cross product of the two vectors derived from the sides of each
  * triangle).  Assumes a counter-clockwise winding.
@@ -943,9 +1157,8 @@ glmReverseWinding(GLMmodel* model)
 GLvoid
 glmFacetNormals(GLMmodel* model)
 {
-    GLuint  i;
-    GLfloat u[3];
-    GLfloat v[3];
+    GLMfacetjob jobs[GLM_MAX_THREADS];
+    GLuint numjobs, j;
 
     assert(model);
     assert(model->vertices);
@@ -959,34 +1172,134 @@ glmFacetNormals(GLMmodel* model)
     model->facetnorms = (GLfloat*)malloc(sizeof(GLfloat) *
                        3 * (model->numfacetnorms + 1));
 
-    for (i = 0; i < model->numtriangles; i++) {
-        model->triangles[i].findex = i+1;
+    /* split the triangles over the threads */
+    numjobs = glmNumThreads(model->numtriangles);
+    for (j = 0; j < numjobs; j++) {
+        jobs[j].model = model;
+        jobs[j].first = (GLuint)((unsigned long long)model->numtriangles * j / numjobs);
+        jobs[j].last = (GLuint)((unsigned long long)model->numtriangles * (j + 1) / numjobs);
+    }
+    glmRunJobs(glmFacetNormalsJob, jobs, sizeof(GLMfacetjob), numjobs);
+}
 
-        u[0] = model->vertices[3 * T(i).vindices[1] + 0] -
-            model->vertices[3 * T(i).vindices[0] + 0];
-        u[1] = model->vertices[3 * T(i).vindices[1] + 1] -
-            model->vertices[3 * T(i).vindices[0] + 1];
-        u[2] = model->vertices[3 * T(i).vindices[1] + 2] -
-            model->vertices[3 * T(i).vindices[0] + 2];
+/* _GLMnormaljob: one thread's share of glmVertexNormals() */
+typedef struct _GLMnormaljob {
+    GLMmodel* model;
+    GLuint first;               /* first vertex (1-based) */
+    GLuint last;                /* one past the last vertex */
+    const GLuint* offsets;      /* vertex -> first entry in members */
+    const GLuint* members;      /* triangles each vertex is in */
+    GLubyte* averaged;          /* per member: facet normal averaged? */
+    GLfloat* averages;          /* per vertex: averaged normal */
+    GLuint* counts;             /* per vertex: normals it makes, then first one */
+    GLfloat cos_angle;
+    GLuint pass;                /* 0: average & count, 1: write */
+} GLMnormaljob;
+
+/* glmVertexNormalsJob: average (pass 0) or write out (pass 1) the
+ * normals for a range of vertices
+ */
+static GLvoid*
+glmVertexNormalsJob(GLvoid* data)
+{
+    GLMnormaljob* job = (GLMnormaljob*)data;
+    GLMmodel* model = job->model;
+    GLfloat* facet;
+    GLfloat* head = NULL;
+    GLfloat* average;
+    GLfloat* normal;
+    GLuint i, m, t, n, avg;
+
+    for (i = job->first; i < job->last; i++) {
+        average = &job->averages[3 * i];
+
+        if (job->pass == 0) {
+            /* calculate an average normal for this vertex by averaging the
+            facet normal of every triangle this vertex is in */
+            if (job->offsets[i] == job->offsets[i + 1])
+                fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
+            average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
+            avg = 0;
+            n = 0;
+            if (job->offsets[i] < job->offsets[i + 1])
+                head = &model->facetnorms[3 * T(job->members[job->offsets[i]]).findex];
+            for (m = job->offsets[i]; m < job->offsets[i + 1]; m++) {
+                /* only average if the angle between the two facet normals
+                is less than (or equal to) the threshold angle */
+                facet = &model->facetnorms[3 * T(job->members[m]).findex];
+                if (glmDot(facet, head) > job->cos_angle) {
+                    job->averaged[m] = GL_TRUE;
+                    average[0] += facet[0];
+                    average[1] += facet[1];
+                    average[2] += facet[2];
+                    avg = 1;            /* we averaged at least one normal! */
+                } else {
+                    job->averaged[m] = GL_FALSE;
+                    n++;                /* this one keeps its facet normal */
+                }
+            }
+            if (avg)
+                glmNormalize(average);
+            /* one normal for the average (if any) + one per outlier */
+            job->counts[i] = n + avg;
+            continue;
+        }
 
-        v[0] = model->vertices[3 * T(i).vindices[2] + 0] -
-            model->vertices[3 * T(i).vindices[0] + 0];
-        v[1] = model->vertices[3 * T(i).vindices[2] + 1] -
-            model->vertices[3 * T(i).vindices[0] + 1];
-        v[2] = model->vertices[3 * T(i).vindices[2] + 2] -
-            model->vertices[3 * T(i).vindices[0] + 2];
+        /* pass 1: counts[i] is now the index of this vertex's first
+        normal; the average (if any) comes first */
+        n = job->counts[i];
+        avg = 0;
+        for (m = job->offsets[i]; m < job->offsets[i + 1]; m++) {
+            if (job->averaged[m]) {
+                avg = n;
+                break;
+            }
+        }
+        if (avg) {
+            normal = &model->normals[3 * n++];
+            normal[0] = average[0];
+            normal[1] = average[1];
+            normal[2] = average[2];
+        }
 
-        glmCross(u, v, &model->facetnorms[3 * (i+1)]);
-        glmNormalize(&model->facetnorms[3 * (i+1)]);
+        /* set the normal of this vertex in each triangle it is in */
+        for (m = job->offsets[i]; m < job->offsets[i + 1]; m++) {
+            t = job->members[m];
+            if (job->averaged[m]) {
+                /* if this member was averaged, use the average normal */
+                if (T(t).vindices[0] == i)
+                    T(t).nindices[0] = avg;
+                else if (T(t).vindices[1] == i)
+                    T(t).nindices[1] = avg;
+                else if (T(t).vindices[2] == i)
+                    T(t).nindices[2] = avg;
+            } else {
+                /* if this member wasn't averaged, use the facet normal */
+                facet = &model->facetnorms[3 * T(t).findex];
+                normal = &model->normals[3 * n];
+                normal[0] = facet[0];
+                normal[1] = facet[1];
+                normal[2] = facet[2];
+                if (T(t).vindices[0] == i)
+                    T(t).nindices[0] = n;
+                else if (T(t).vindices[1] == i)
+                    T(t).nindices[1] = n;
+                else if (T(t).vindices[2] == i)
+                    T(t).nindices[2] = n;
+                n++;
+            }
+        }
     }
+
+    return NULL;
 }
 
 /* glmVertexNormals: Generates smooth vertex normals for a model.
- * First builds a list of all the triangles each vertex is in.   Then
+ * First builds a list of all the triangles each vertex is in.  Then
  * loops through each vertex in the the list averaging all the facet
- * normals of the triangles each vertex is in.   Finally, sets the
+ * normals of the triangles each vertex is in.  Finally, sets the
  * normal index in the triangle for the vertex to the generated smooth
- * normal.   If the dot product of a facet normal and the facet normal
+ * normal.  If the dot product of a facet normal and the facet normal
  * associated with the first triangle in the list of triangles the
  * current vertex is in is greater than the cosine of the angle
  * parameter to the function, that facet normal is not added into the
@@ -994,20 +1307,26 @@ glmFacetNormals(GLMmodel* model)
  * the facet normal.  This tends to preserve hard edges.  The angle to
  * use depends on the model, but 90 degrees is usually a good start.
  *
+ * The lists are flat arrays (allocated up front), and the vertices
+ * are split over several threads for big models: one pass averages
+ * and counts the normals each vertex makes, a running sum numbers
+ * them, and a second pass writes them out -- so the result is the
+ * same as doing it all in order.
+ *
  * model - initialized GLMmodel structure
  * angle - maximum angle (in degrees) to smooth across
  */
 GLvoid
 glmVertexNormals(GLMmodel* model, GLfloat angle)
 {
-    GLMnode* node;
-    GLMnode* tail;
-    GLMnode** members;
-    GLfloat* normals;
-    GLuint numnormals;
-    GLfloat average[3];
-    GLfloat dot, cos_angle;
-    GLuint i, avg;
+    GLMnormaljob jobs[GLM_MAX_THREADS];
+    GLuint* offsets;
+    GLuint* members;
+    GLubyte* averaged;
+    GLfloat* averages;
+    GLuint* counts;
+    GLfloat cos_angle;
+    GLuint numjobs, numnormals, count, v, i, j, k;
 
     assert(model);
     assert(model->facetnorms);
@@ -1018,135 +1337,72 @@ glmVertexNormals(GLMmodel* model, GLfloat angle)
     /* nuke any previous normals */
     if (model->normals)
         free(model->normals);
+    model->normals = NULL;
 
-    /* allocate space for new normals */
-    model->numnormals = model->numtriangles * 3; /* 3 normals per triangle */
-    model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-
-    /* allocate a structure that will hold a linked list of triangle
-    indices for each vertex */
-    members = (GLMnode**)malloc(sizeof(GLMnode*) * (model->numvertices + 1));
-    for (i = 1; i <= model->numvertices; i++)
-        members[i] = NULL;
+    /* allocate everything up front */
+    offsets = (GLuint*)calloc(model->numvertices + 2, sizeof(GLuint));
+    members = (GLuint*)malloc(sizeof(GLuint) * (3 * model->numtriangles + 1));
+    averaged = (GLubyte*)malloc(sizeof(GLubyte) * (3 * model->numtriangles + 1));
+    averages = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numvertices + 1));
+    counts = (GLuint*)malloc(sizeof(GLuint) * (model->numvertices + 1));
 
-    /* for every triangle, create a node for each vertex in it */
+    /* count the triangles each vertex is in... */
     for (i = 0; i < model->numtriangles; i++) {
-        node = (GLMnode*)malloc(sizeof(GLMnode));
-        node->index = i;
-        node->next  = members[T(i).vindices[0]];
-        members[T(i).vindices[0]] = node;
-
-        node = (GLMnode*)malloc(sizeof(GLMnode));
-        node->index = i;
-        node->next  = members[T(i).vindices[1]];
-        members[T(i).vindices[1]] = node;
-
-        node = (GLMnode*)malloc(sizeof(GLMnode));
-        node->index = i;
-        node->next  = members[T(i).vindices[2]];
-        members[T(i).vindices[2]] = node;
-    }
-
-    /* calculate the average normal for each vertex */
+        offsets[T(i).vindices[0] + 1]++;
+        offsets[T(i).vindices[1] + 1]++;
+        offsets[T(i).vindices[2] + 1]++;
+    }
+    for (v = 1; v <= model->numvertices + 1; v++)
+        offsets[v] += offsets[v - 1];
+
+    /* ...and list them, last triangle first (the order the linked
+    lists used to have, which decides which facet normal leads) */
+    memcpy(counts, offsets, sizeof(GLuint) * (model->numvertices + 1));
+    for (i = model->numtriangles; i-- > 0; ) {
+        for (k = 0; k < 3; k++)
+            members[counts[T(i).vindices[k]]++] = i;
+    }
+
+    /* split the vertices over the threads */
+    numjobs = glmNumThreads(model->numvertices);
+    for (j = 0; j < numjobs; j++) {
+        jobs[j].model = model;
+        jobs[j].first = 1 + (GLuint)((unsigned long long)model->numvertices * j / numjobs);
+        jobs[j].last = 1 + (GLuint)((unsigned long long)model->numvertices * (j + 1) / numjobs);
+        jobs[j].offsets = offsets;
+        jobs[j].members = members;
+        jobs[j].averaged = averaged;
+        jobs[j].averages = averages;
+        jobs[j].counts = counts;
+        jobs[j].cos_angle = cos_angle;
+        jobs[j].pass = 0;
+    }
+
+    /* pass 0: average & count */
+    glmRunJobs(glmVertexNormalsJob, jobs, sizeof(GLMnormaljob), numjobs);
+
+    /* number the normals */
     numnormals = 1;
-    for (i = 1; i <= model->numvertices; i++) {
-    /* calculate an average normal for this vertex by averaging the
-        facet normal of every triangle this vertex is in */
-        node = members[i];
-        if (!node)
-            fprintf(stderr, "glmVertexNormals(): vertex w/o a triangle\n");
-        average[0] = 0.0; average[1] = 0.0; average[2] = 0.0;
-        avg = 0;
-        while (node) {
-        /* only average if the dot product of the angle between the two
-        facet normals is greater than the cosine of the threshold
-        angle -- or, said another way, the angle between the two
-            facet normals is less than (or equal to) the threshold angle */
-            dot = glmDot(&model->facetnorms[3 * T(node->index).findex],
-                &model->facetnorms[3 * T(members[i]->index).findex]);
-            if (dot > cos_angle) {
-                node->averaged = GL_TRUE;
-                average[0] += model->facetnorms[3 * T(node->index).findex + 0];
-                average[1] += model->facetnorms[3 * T(node->index).findex + 1];
-                average[2] += model->facetnorms[3 * T(node->index).findex + 2];
-                avg = 1;            /* we averaged at least one normal! */
-            } else {
-                node->averaged = GL_FALSE;
-            }
-            node = node->next;
-        }
-
-        if (avg) {
-            /* normalize the averaged normal */
-            glmNormalize(average);
-
-            /* add the normal to the vertex normals list */
-            model->normals[3 * numnormals + 0] = average[0];
-            model->normals[3 * numnormals + 1] = average[1];
-            model->normals[3 * numnormals + 2] = average[2];
-            avg = numnormals;
-            numnormals++;
-        }
-
-        /* set the normal of this vertex in each triangle it is in */
-        node = members[i];
-        while (node) {
-            if (node->averaged) {
-                /* if this node was averaged, use the average normal */
-                if (T(node->index).vindices[0] == i)
-                    T(node->index).nindices[0] = avg;
-                else if (T(node->index).vindices[1] == i)
-                    T(node->index).nindices[1] = avg;
-                else if (T(node->index).vindices[2] == i)
-                    T(node->index).nindices[2] = avg;
-            } else {
-                /* if this node wasn't averaged, use the facet normal */
-                model->normals[3 * numnormals + 0] =
-                    model->facetnorms[3 * T(node->index).findex + 0];
-                model->normals[3 * numnormals + 1] =
-                    model->facetnorms[3 * T(node->index).findex + 1];
-                model->normals[3 * numnormals + 2] =
-                    model->facetnorms[3 * T(node->index).findex + 2];
-                if (T(node->index).vindices[0] == i)
-                    T(node->index).nindices[0] = numnormals;
-                else if (T(node->index).vindices[1] == i)
-                    T(node->index).nindices[1] = numnormals;
-                else if (T(node->index).vindices[2] == i)
-                    T(node->index).nindices[2] = numnormals;
-                numnormals++;
-            }
-            node = node->next;
-        }
+    for (v = 1; v <= model->numvertices; v++) {
+        count = counts[v];
+        counts[v] = numnormals;
+        numnormals += count;
     }
-
     model->numnormals = numnormals - 1;
+    model->normals = (GLfloat*)malloc(sizeof(GLfloat) * 3 * (model->numnormals + 1));
 
-    /* free the member information */
-    for (i = 1; i <= model->numvertices; i++) {
-        node = members[i];
-        while (node) {
-            tail = node;
-            node = node->next;
-            free(tail);
-        }
-    }
-    free(members);
+    /* pass 1: write */
+    for (j = 0; j < numjobs; j++)
+        jobs[j].pass = 1;
+    glmRunJobs(glmVertexNormalsJob, jobs, sizeof(GLMnormaljob), numjobs);
 
-    /* pack the normals array (we previously allocated the maximum
-    number of normals that could possibly be created (numtriangles *
-    3), so get rid of some of them (usually alot unless none of the
-    facet normals were averaged)) */
-    normals = model->normals;
-    model->normals = (GLfloat*)malloc(sizeof(GLfloat)* 3* (model->numnormals+1));
-    for (i = 1; i <= model->numnormals; i++) {
-        model->normals[3 * i + 0] = normals[3 * i + 0];
-        model->normals[3 * i + 1] = normals[3 * i + 1];
-        model->normals[3 * i + 2] = normals[3 * i + 2];
-    }
-    free(normals);
+    free(offsets);
+    free(members);
+    free(averaged);
+    free(averages);
+    free(counts);
 }
 
-
 /* glmLinearTexture: Generates texture coordinates according to a
  * linear projection of the texture map.  It generates these by
  * linearly mapping the vertices onto a square.
@@ -1719,43 +1975,37 @@ glmWeld(GLMmodel* model, GLfloat epsilon)
 {
     GLfloat* vectors;
     GLfloat* copies;
+    GLuint* map;
     GLuint numvectors;
     GLuint i;
 
     /* vertices */
     numvectors = model->numvertices;
     vectors  = model->vertices;
-    copies = glmWeldVectors(vectors, &numvectors, epsilon);
+    map = (GLuint*)malloc(sizeof(GLuint) * (numvectors + 1));
+    copies = glmWeldMap(vectors, &numvectors, epsilon, map);
 
 #if 0
     printf("glmWeld(): %d redundant vertices.\n",
-        model->numvertices - numvectors - 1);
+        model->numvertices - numvectors);
 #endif
 
     for (i = 0; i < model->numtriangles; i++) {
-        T(i).vindices[0] = (GLuint)vectors[3 * T(i).vindices[0] + 0];
-        T(i).vindices[1] = (GLuint)vectors[3 * T(i).vindices[1] + 0];
-        T(i).vindices[2] = (GLuint)vectors[3 * T(i).vindices[2] + 0];
+        T(i).vindices[0] = map[T(i).vindices[0]];
+        T(i).vindices[1] = map[T(i).vindices[1]];
+        T(i).vindices[2] = map[T(i).vindices[2]];
     }
 
+    free(map);
+
     /* free space for old vertices */
     free(vectors);
 
-    /* allocate space for the new vertices */
+    /* the welded vertices are the new vertex list */
     model->numvertices = numvectors;
-    model->vertices = (GLfloat*)malloc(sizeof(GLfloat) *
+    model->vertices = (GLfloat*)realloc(copies, sizeof(GLfloat) *
         3 * (model->numvertices + 1));
-
-    /* copy the optimized vertices into the actual vertex list */
-    for (i = 1; i <= model->numvertices; i++) {
-        model->vertices[3 * i + 0] = copies[3 * i + 0];
-        model->vertices[3 * i + 1] = copies[3 * i + 1];
-        model->vertices[3 * i + 2] = copies[3 * i + 2];
-    }
-
-    free(copies);
 }
-
 /* glmReadPPM: read a PPM raw (type P6) file.  The PPM file has a header
  * that should look something like:
  *
@@ -1830,6 +2080,1083 @@ glmReadPPM(char* filename, int* width, int* height)
     return image;
 }
 
+/* glmMeshReserve: grow a malloc'd array to hold at least needed elements */
+static GLvoid
+glmMeshReserve(GLvoid** data, GLuint* capacity, GLuint needed, size_t size)
+{
+    GLuint n;
+
+    if (needed <= *capacity)
+        return;
+
+    n = *capacity ? *capacity : 64;
+    while (n < needed)
+        n *= 2;
+    *data = realloc(*data, size * n);
+    *capacity = n;
+}
+
+/* glmFileInfo: get size & modification time of a file */
+static GLboolean
+glmFileInfo(const char* filename, unsigned long long* size,
+            unsigned long long* mtime)
+{
+    struct stat st;
+
+    if (stat(filename, &st) != 0)
+        return GL_FALSE;
+    *size = (unsigned long long)st.st_size;
+    *mtime = (unsigned long long)st.st_mtime;
+    return GL_TRUE;
+}
+
+/* glmMapFile: map a whole file into memory (private, copy on write).
+ * Returns NULL if the file can't be opened or is empty.
+ */
+static GLvoid*
+glmMapFile(const char* filename, size_t* size)
+{
+#ifndef _WIN32
+    struct stat st;
+    GLvoid* data;
+    int fd;
+
+    fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return NULL;
+
+    /* we read it front to back, once */
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    *size = (size_t)st.st_size;
+    return data;
+#else
+    FILE* file;
+    GLvoid* data;
+    long length;
+
+    /* no mmap() here: read it in one fell swoop instead */
+    file = fopen(filename, "rb");
+    if (!file)
+        return NULL;
+    fseek(file, 0, SEEK_END);
+    length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (length <= 0) {
+        fclose(file);
+        return NULL;
+    }
+    data = malloc(length);
+    if (fread(data, 1, length, file) != (size_t)length) {
+        free(data);
+        fclose(file);
+        return NULL;
+    }
+    fclose(file);
+
+    *size = (size_t)length;
+    return data;
+#endif
+}
+
+/* glmUnmapFile: release a mapping made by glmMapFile() */
+static GLvoid
+glmUnmapFile(GLvoid* data, size_t size)
+{
+#ifndef _WIN32
+    munmap(data, size);
+#else
+    free(data);
+#endif
+}
+
+/* glmParseFloat: parse a float from [*p, end), advancing *p past it.
+ * Plain decimals with up to 19 significant digits and a small
+ * exponent (everything an exporter writes) are converted exactly;
+ * anything else goes through strtod().
+ */
+static GLfloat
+glmParseFloat(const char** p, const char* end)
+{
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* s;
+    const char* start;
+    unsigned long long mantissa;
+    GLboolean negative;
+    int digits, exponent, e, esign;
+    double value;
+    char buf[64];
+    size_t length;
+
+    s = *p;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    start = s;
+
+    negative = GL_FALSE;
+    if (s < end && (*s == '-' || *s == '+')) {
+        negative = (*s == '-');
+        s++;
+    }
+
+    mantissa = 0;
+    digits = 0;
+    exponent = 0;
+    while (s < end && *s >= '0' && *s <= '9') {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*s - '0');
+            if (mantissa)
+                digits++;
+        } else {
+            exponent++;
+        }
+        s++;
+    }
+    if (s < end && *s == '.') {
+        s++;
+        while (s < end && *s >= '0' && *s <= '9') {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if (mantissa)
+                    digits++;
+                exponent--;
+            }
+            s++;
+        }
+    }
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        s++;
+        e = 0;
+        esign = 1;
+        if (s < end && (*s == '-' || *s == '+')) {
+            esign = (*s == '-') ? -1 : 1;
+            s++;
+        }
+        while (s < end && *s >= '0' && *s <= '9') {
+            if (e < 10000)
+                e = e * 10 + (*s - '0');
+            s++;
+        }
+        exponent += esign * e;
+    }
+
+    /* no digits (nan, inf, garbage): let strtod() sort it out */
+    if (s == start || (s == start + 1 && (*start == '-' || *start == '+'))) {
+        while (s < end && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r')
+            s++;
+        goto slow;
+    }
+
+    /* exact: both operands are representable, so one rounding */
+    if (mantissa < (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        value = (double)mantissa;
+        value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+        *p = s;
+        return (GLfloat)(negative ? -value : value);
+    }
+
+slow:
+    length = (size_t)(s - start);
+    if (length >= sizeof(buf))
+        length = sizeof(buf) - 1;
+    memcpy(buf, start, length);
+    buf[length] = '\0';
+    *p = s;
+    return (GLfloat)strtod(buf, NULL);
+}
+
+/* glmParseIndex: parse a (possibly negative) integer from [*p, end),
+ * advancing *p past it.  Returns GL_FALSE if there is no number.
+ */
+static GLboolean
+glmParseIndex(const char** p, const char* end, long* index)
+{
+    const char* s;
+    long value;
+    GLboolean negative;
+
+    s = *p;
+    negative = GL_FALSE;
+    if (s < end && *s == '-') {
+        negative = GL_TRUE;
+        s++;
+    }
+    if (s >= end || *s < '0' || *s > '9')
+        return GL_FALSE;
+
+    value = 0;
+    while (s < end && *s >= '0' && *s <= '9') {
+        if (value < 0x7fffffffL)
+            value = value * 10 + (*s - '0');
+        s++;
+    }
+
+    *index = negative ? -value : value;
+    *p = s;
+    return GL_TRUE;
+}
+
+/* glmParseName: copy the next whitespace delimited word of [*p, end)
+ * into name (at most size-1 characters, always terminated)
+ */
+static GLvoid
+glmParseName(const char** p, const char* end, char* name, size_t size)
+{
+    const char* s;
+    size_t length;
+
+    s = *p;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    length = 0;
+    while (s < end && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r') {
+        if (length < size - 1)
+            name[length++] = *s;
+        s++;
+    }
+    name[length] = '\0';
+    *p = s;
+}
+
+/* glmResolveIndex: turn a 1-based (or negative, relative to the end)
+ * OBJ index into a 1-based index, or 0 if it is out of range
+ */
+static GLuint
+glmResolveIndex(long index, GLuint count)
+{
+    if (index < 0)
+        index += (long)count + 1;
+    if (index < 1 || index > (long)count)
+        return 0;
+    return (GLuint)index;
+}
+
+/* glmHashVertex: hash a (position, texcoord, normal) index triple */
+static GLuint
+glmHashVertex(GLuint v, GLuint t, GLuint n)
+{
+    GLuint h;
+
+    h = (v * 73856093u) ^ (t * 19349663u) ^ (n * 83492791u);
+    return h ^ (h >> 16);
+}
+
+/* _GLMbucket: triangle indices for one material, while parsing */
+typedef struct _GLMbucket {
+    GLuint* indices;
+    GLuint numindices;
+    GLuint capacity;
+} GLMbucket;
+
+/* glmParseMesh: parse a memory mapped .OBJ file in one pass.
+ *
+ * model - scratch model (pathname set), used for the material library
+ */
+static GLMmesh*
+glmParseMesh(GLMmodel* model, const char* data, size_t size)
+{
+    GLMmesh* mesh;
+    const char* p;
+    const char* end;
+    char name[128];
+
+    GLfloat* positions = NULL;  GLuint numpositions = 0, poscapacity = 0;
+    GLfloat* normals = NULL;    GLuint numnormals = 0, normcapacity = 0;
+    GLfloat* texcoords = NULL;  GLuint numtexcoords = 0, texcapacity = 0;
+
+    /* unique vertices: (v, t, n) 1-based, 0 if absent */
+    GLuint* keys = NULL;        GLuint numkeys = 0, keycapacity = 0;
+    /* open addressing: key index + 1 (0 is empty) */
+    GLuint* table = NULL;       GLuint tablesize = 0;
+
+    GLMbucket* buckets = NULL;  GLuint numbuckets = 0;
+    GLuint material = 0;
+
+    GLuint first, prev, vertex, corners, h, i, j, k;
+    long v, t, n;
+    GLboolean missing, warned;
+    GLfloat* accum = NULL;
+    GLfloat* dst;
+    GLfloat* a; GLfloat* b; GLfloat* c;
+    GLfloat u[3], w[3], cross[3];
+
+    p = data;
+    end = data + size;
+    warned = GL_FALSE;
+
+    /* one bucket for the default material */
+    numbuckets = 1;
+    buckets = (GLMbucket*)calloc(numbuckets, sizeof(GLMbucket));
+    tablesize = 1024;
+    table = (GLuint*)calloc(tablesize, sizeof(GLuint));
+
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (p >= end)
+            break;
+
+        if (*p == 'v' && p + 1 < end) {
+            p++;
+            if (*p == ' ' || *p == '\t') {
+                /* vertex */
+                glmMeshReserve((GLvoid**)&positions, &poscapacity,
+                    3 * (numpositions + 1), sizeof(GLfloat));
+                dst = &positions[3 * numpositions++];
+                dst[0] = glmParseFloat(&p, end);
+                dst[1] = glmParseFloat(&p, end);
+                dst[2] = glmParseFloat(&p, end);
+            } else if (*p == 'n') {
+                /* normal */
+                p++;
+                glmMeshReserve((GLvoid**)&normals, &normcapacity,
+                    3 * (numnormals + 1), sizeof(GLfloat));
+                dst = &normals[3 * numnormals++];
+                dst[0] = glmParseFloat(&p, end);
+                dst[1] = glmParseFloat(&p, end);
+                dst[2] = glmParseFloat(&p, end);
+            } else if (*p == 't') {
+                /* texcoord */
+                p++;
+                glmMeshReserve((GLvoid**)&texcoords, &texcapacity,
+                    2 * (numtexcoords + 1), sizeof(GLfloat));
+                dst = &texcoords[2 * numtexcoords++];
+                dst[0] = glmParseFloat(&p, end);
+                dst[1] = glmParseFloat(&p, end);
+            }
+        } else if (*p == 'f' && p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+            /* face: fan triangulate */
+            p++;
+            corners = 0;
+            first = prev = 0;
+            for (;;) {
+                while (p < end && (*p == ' ' || *p == '\t'))
+                    p++;
+                if (!glmParseIndex(&p, end, &v))
+                    break;
+                t = n = 0;
+                if (p < end && *p == '/') {
+                    p++;
+                    if (p < end && *p != '/')
+                        glmParseIndex(&p, end, &t);
+                    if (p < end && *p == '/') {
+                        p++;
+                        glmParseIndex(&p, end, &n);
+                    }
+                }
+                /* skip anything else stuck to this corner */
+                while (p < end && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+                    p++;
+
+                v = glmResolveIndex(v, numpositions);
+                if (!v) {
+                    if (!warned)
+                        printf("glmReadMesh() warning: face refers to a "
+                            "vertex that doesn't exist (skipping).\n");
+                    warned = GL_TRUE;
+                    continue;
+                }
+                t = t ? glmResolveIndex(t, numtexcoords) : 0;
+                n = n ? glmResolveIndex(n, numnormals) : 0;
+
+                /* find (or add) the vertex */
+                h = glmHashVertex((GLuint)v, (GLuint)t, (GLuint)n) & (tablesize - 1);
+                while (table[h]) {
+                    k = 3 * (table[h] - 1);
+                    if (keys[k] == (GLuint)v && keys[k + 1] == (GLuint)t &&
+                        keys[k + 2] == (GLuint)n)
+                        break;
+                    h = (h + 1) & (tablesize - 1);
+                }
+                if (table[h]) {
+                    vertex = table[h] - 1;
+                } else {
+                    glmMeshReserve((GLvoid**)&keys, &keycapacity,
+                        3 * (numkeys + 1), sizeof(GLuint));
+                    keys[3 * numkeys + 0] = (GLuint)v;
+                    keys[3 * numkeys + 1] = (GLuint)t;
+                    keys[3 * numkeys + 2] = (GLuint)n;
+                    vertex = numkeys++;
+                    table[h] = numkeys;
+
+                    /* keep the table at most half full */
+                    if (2 * numkeys > tablesize) {
+                        free(table);
+                        tablesize *= 2;
+                        table = (GLuint*)calloc(tablesize, sizeof(GLuint));
+                        for (i = 0; i < numkeys; i++) {
+                            h = glmHashVertex(keys[3 * i], keys[3 * i + 1],
+                                keys[3 * i + 2]) & (tablesize - 1);
+                            while (table[h])
+                                h = (h + 1) & (tablesize - 1);
+                            table[h] = i + 1;
+                        }
+                    }
+                }
+
+                if (corners == 0)
+                    first = vertex;
+                if (corners >= 2) {
+                    GLMbucket* bucket = &buckets[material];
+                    glmMeshReserve((GLvoid**)&bucket->indices, &bucket->capacity,
+                        bucket->numindices + 3, sizeof(GLuint));
+                    bucket->indices[bucket->numindices++] = first;
+                    bucket->indices[bucket->numindices++] = prev;
+                    bucket->indices[bucket->numindices++] = vertex;
+                }
+                prev = vertex;
+                corners++;
+            }
+        } else if (end - p > 6 && strncmp(p, "usemtl", 6) == 0) {
+            p += 6;
+            glmParseName(&p, end, name, sizeof(name));
+            material = model->nummaterials ? glmFindMaterial(model, name) : 0;
+        } else if (end - p > 6 && strncmp(p, "mtllib", 6) == 0) {
+            p += 6;
+            glmParseName(&p, end, name, sizeof(name));
+            if (!model->mtllibname) {
+                model->mtllibname = strdup(name);
+                glmReadMTL(model, name);
+                if (model->nummaterials > numbuckets) {
+                    buckets = (GLMbucket*)realloc(buckets,
+                        sizeof(GLMbucket) * model->nummaterials);
+                    memset(&buckets[numbuckets], 0, sizeof(GLMbucket) *
+                        (model->nummaterials - numbuckets));
+                    numbuckets = model->nummaterials;
+                }
+            }
+        }
+
+        /* on to the next line */
+        while (p < end && *p != '\n')
+            p++;
+        p++;
+    }
+
+    /* allocate a new mesh */
+    mesh = (GLMmesh*)malloc(sizeof(GLMmesh));
+    memset(mesh, 0, sizeof(GLMmesh));
+    mesh->pathname = strdup(model->pathname);
+    mesh->flags = GLM_SMOOTH | (numtexcoords ? GLM_TEXTURE : 0);
+    mesh->stride = numtexcoords ? 8 : 6;
+    mesh->numvertices = numkeys;
+    mesh->nummaterials = model->nummaterials;
+    mesh->materials = model->materials;
+    model->nummaterials = 0;
+    model->materials = NULL;
+
+    /* concatenate the buckets into ranges */
+    for (i = 0; i < numbuckets; i++) {
+        mesh->numindices += buckets[i].numindices;
+        if (buckets[i].numindices)
+            mesh->numranges++;
+    }
+    mesh->indices = (GLuint*)malloc(sizeof(GLuint) * (mesh->numindices + 1));
+    mesh->ranges = (GLMrange*)malloc(sizeof(GLMrange) * (mesh->numranges + 1));
+    for (i = 0, j = 0, k = 0; i < numbuckets; i++) {
+        if (!buckets[i].numindices)
+            continue;
+        mesh->ranges[j].first = k;
+        mesh->ranges[j].count = buckets[i].numindices;
+        mesh->ranges[j].material = i;
+        memcpy(&mesh->indices[k], buckets[i].indices,
+            sizeof(GLuint) * buckets[i].numindices);
+        k += buckets[i].numindices;
+        j++;
+    }
+
+    /* any vertex without a normal gets the (area weighted) average of
+       the facet normals around its position */
+    missing = GL_FALSE;
+    for (i = 0; i < numkeys; i++) {
+        if (!keys[3 * i + 2]) {
+            missing = GL_TRUE;
+            break;
+        }
+    }
+    if (missing) {
+        accum = (GLfloat*)calloc(3 * (numpositions + 1), sizeof(GLfloat));
+        for (i = 0; i < mesh->numindices; i += 3) {
+            a = &positions[3 * (keys[3 * mesh->indices[i + 0]] - 1)];
+            b = &positions[3 * (keys[3 * mesh->indices[i + 1]] - 1)];
+            c = &positions[3 * (keys[3 * mesh->indices[i + 2]] - 1)];
+            u[0] = b[0] - a[0]; u[1] = b[1] - a[1]; u[2] = b[2] - a[2];
+            w[0] = c[0] - a[0]; w[1] = c[1] - a[1]; w[2] = c[2] - a[2];
+            glmCross(u, w, cross);
+            for (j = 0; j < 3; j++) {
+                dst = &accum[3 * (keys[3 * mesh->indices[i + j]] - 1)];
+                dst[0] += cross[0];
+                dst[1] += cross[1];
+                dst[2] += cross[2];
+            }
+        }
+        for (i = 0; i < numpositions; i++) {
+            if (accum[3 * i] || accum[3 * i + 1] || accum[3 * i + 2])
+                glmNormalize(&accum[3 * i]);
+        }
+    }
+
+    /* interleave */
+    mesh->vertices = (GLfloat*)malloc(sizeof(GLfloat) * mesh->stride *
+        (numkeys + 1));
+    for (i = 0; i < numkeys; i++) {
+        dst = &mesh->vertices[mesh->stride * i];
+        a = &positions[3 * (keys[3 * i] - 1)];
+        dst[0] = a[0]; dst[1] = a[1]; dst[2] = a[2];
+        if (keys[3 * i + 2])
+            a = &normals[3 * (keys[3 * i + 2] - 1)];
+        else
+            a = &accum[3 * (keys[3 * i] - 1)];
+        dst[3] = a[0]; dst[4] = a[1]; dst[5] = a[2];
+        if (mesh->flags & GLM_TEXTURE) {
+            if (keys[3 * i + 1]) {
+                dst[6] = texcoords[2 * (keys[3 * i + 1] - 1) + 0];
+                dst[7] = texcoords[2 * (keys[3 * i + 1] - 1) + 1];
+            } else {
+                dst[6] = dst[7] = 0;
+            }
+        }
+    }
+
+    /* clean up */
+    for (i = 0; i < numbuckets; i++)
+        free(buckets[i].indices);
+    free(buckets);
+    free(table);
+    free(keys);
+    free(accum);
+    free(positions);
+    free(normals);
+    free(texcoords);
+
+    return mesh;
+}
+
+/* mesh cache file (native byte order; only ever read back on the
+   machine that wrote it):
+
+     GLMcacheheader
+     GLMrange   ranges[numranges]
+     materials  (GLfloat[17], GLuint length, name + '\0', padded to 4)
+     GLfloat    vertices[numvertices * stride]
+     GLuint     indices[numindices]
+     char       mtllib[mtlnamebytes]     (name + '\0', if there is one)
+*/
+#define GLM_CACHE_MAGIC   0x434d4c47      /* "GLMC" */
+#define GLM_CACHE_VERSION 2
+
+/* _GLMcacheheader: header of a mesh cache file */
+typedef struct _GLMcacheheader {
+    GLuint magic;                   /* GLM_CACHE_MAGIC */
+    GLuint version;                 /* GLM_CACHE_VERSION */
+    GLuint flags;                   /* mesh flags */
+    GLuint stride;                  /* floats per vertex */
+    GLuint numvertices;
+    GLuint numindices;
+    GLuint numranges;
+    GLuint nummaterials;
+    unsigned long long sourcesize;  /* size of the .OBJ it came from */
+    unsigned long long sourcemtime; /* modification time of the .OBJ */
+    GLuint materialbytes;           /* size of the materials block */
+    GLuint mtlnamebytes;            /* size of the mtllib name (0 if none) */
+    unsigned long long mtlsize;     /* size of the mtllib it came from */
+    unsigned long long mtlmtime;    /* modification time of the mtllib */
+} GLMcacheheader;
+
+/* glmCacheName: name of the cache file for a .OBJ file
+ *
+ * NOTE: the return value should be free'd.
+ */
+static char*
+glmCacheName(const char* filename)
+{
+    char* name;
+
+    name = (char*)malloc(strlen(filename) + 6);
+    strcpy(name, filename);
+    strcat(name, ".glmc");
+    return name;
+}
+
+/* glmMTLName: path of a material library named in a .OBJ file (it is
+ * next to the .OBJ, as glmReadMTL() looks for it)
+ *
+ * NOTE: the return value should be free'd.
+ */
+static char*
+glmMTLName(const char* filename, const char* mtllibname)
+{
+    char* dir;
+    char* name;
+
+    dir = glmDirName((char*)filename);
+    name = (char*)malloc(strlen(dir) + strlen(mtllibname) + 1);
+    strcpy(name, dir);
+    strcat(name, mtllibname);
+    free(dir);
+    return name;
+}
+
+/* glmWriteMeshCache: write a mesh cache (to a temporary file, renamed
+ * into place so a reader never sees half of one).  Failure (say, a
+ * read-only directory) is not an error: the next load parses again.
+ */
+static GLvoid
+glmWriteMeshCache(GLMmesh* mesh, const char* filename, const char* cachename,
+                  const char* mtllibname, unsigned long long sourcesize,
+                  unsigned long long sourcemtime)
+{
+    GLMcacheheader header;
+    GLMmaterial* material;
+    FILE* file;
+    char* tmpname;
+    char* mtlname;
+    GLfloat values[17];
+    GLuint length, i;
+    static const char pad[4] = { 0, 0, 0, 0 };
+    GLboolean ok;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = GLM_CACHE_MAGIC;
+    header.version = GLM_CACHE_VERSION;
+    header.flags = mesh->flags;
+    header.stride = mesh->stride;
+    header.numvertices = mesh->numvertices;
+    header.numindices = mesh->numindices;
+    header.numranges = mesh->numranges;
+    header.nummaterials = mesh->nummaterials;
+    header.sourcesize = sourcesize;
+    header.sourcemtime = sourcemtime;
+    if (mtllibname) {
+        /* no cache if the materials can't be checked later */
+        mtlname = glmMTLName(filename, mtllibname);
+        ok = glmFileInfo(mtlname, &header.mtlsize, &header.mtlmtime);
+        free(mtlname);
+        if (!ok)
+            return;
+        header.mtlnamebytes = (GLuint)strlen(mtllibname) + 1;
+    }
+    for (i = 0; i < mesh->nummaterials; i++) {
+        length = (GLuint)strlen(mesh->materials[i].name) + 1;
+        header.materialbytes += sizeof(values) + sizeof(GLuint) +
+            ((length + 3) & ~3u);
+    }
+
+    tmpname = (char*)malloc(strlen(cachename) + 5);
+    strcpy(tmpname, cachename);
+    strcat(tmpname, ".tmp");
+
+    file = fopen(tmpname, "wb");
+    if (!file) {
+        free(tmpname);
+        return;
+    }
+
+    ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (mesh->numranges)
+        ok = ok && fwrite(mesh->ranges, sizeof(GLMrange), mesh->numranges,
+            file) == mesh->numranges;
+    for (i = 0; ok && i < mesh->nummaterials; i++) {
+        material = &mesh->materials[i];
+        memcpy(&values[0], material->diffuse, sizeof(GLfloat) * 4);
+        memcpy(&values[4], material->ambient, sizeof(GLfloat) * 4);
+        memcpy(&values[8], material->specular, sizeof(GLfloat) * 4);
+        memcpy(&values[12], material->emmissive, sizeof(GLfloat) * 4);
+        values[16] = material->shininess;
+        length = (GLuint)strlen(material->name) + 1;
+        ok = fwrite(values, sizeof(values), 1, file) == 1 &&
+            fwrite(&length, sizeof(length), 1, file) == 1 &&
+            fwrite(material->name, 1, length, file) == length &&
+            fwrite(pad, 1, ((length + 3) & ~3u) - length, file) ==
+                ((length + 3) & ~3u) - length;
+    }
+    if (mesh->numvertices)
+        ok = ok && fwrite(mesh->vertices, sizeof(GLfloat) * mesh->stride,
+            mesh->numvertices, file) == mesh->numvertices;
+    if (mesh->numindices)
+        ok = ok && fwrite(mesh->indices, sizeof(GLuint), mesh->numindices,
+            file) == mesh->numindices;
+    if (header.mtlnamebytes)
+        ok = ok && fwrite(mtllibname, 1, header.mtlnamebytes, file) ==
+            header.mtlnamebytes;
+    ok = (fclose(file) == 0) && ok;
+
+#ifdef _WIN32
+    /* rename() won't replace an existing file here */
+    if (ok)
+        remove(cachename);
+#endif
+    if (!ok || rename(tmpname, cachename) != 0)
+        remove(tmpname);
+    free(tmpname);
+}
+
+/* glmReadMeshCache: map a mesh cache, if there is one that matches
+ * the source file.  Returns NULL otherwise.
+ */
+static GLMmesh*
+glmReadMeshCache(const char* filename, const char* cachename,
+                 unsigned long long sourcesize, unsigned long long sourcemtime)
+{
+    GLMcacheheader header;
+    GLMmesh* mesh;
+    GLMmaterial* material;
+    GLfloat values[17];
+    GLvoid* data;
+    char* base;
+    char* mtlname;
+    size_t size, offset, expected;
+    unsigned long long mtlsize, mtlmtime;
+    GLuint length, i;
+    GLboolean found;
+
+    data = glmMapFile(cachename, &size);
+    if (!data)
+        return NULL;
+    base = (char*)data;
+
+    /* check the header */
+    if (size < sizeof(header))
+        goto stale;
+    memcpy(&header, base, sizeof(header));
+    if (header.magic != GLM_CACHE_MAGIC ||
+        header.version != GLM_CACHE_VERSION ||
+        header.sourcesize != sourcesize ||
+        header.sourcemtime != sourcemtime ||
+        (header.stride != 6 && header.stride != 8))
+        goto stale;
+    expected = sizeof(header) + sizeof(GLMrange) * (size_t)header.numranges +
+        header.materialbytes +
+        sizeof(GLfloat) * header.stride * (size_t)header.numvertices +
+        sizeof(GLuint) * (size_t)header.numindices + header.mtlnamebytes;
+    if (expected != size)
+        goto stale;
+
+    /* the material library must not have changed either */
+    if (header.mtlnamebytes) {
+        if (base[size - 1] != '\0')
+            goto stale;
+        mtlname = glmMTLName(filename, base + size - header.mtlnamebytes);
+        found = glmFileInfo(mtlname, &mtlsize, &mtlmtime);
+        free(mtlname);
+        if (!found || mtlsize != header.mtlsize || mtlmtime != header.mtlmtime)
+            goto stale;
+    }
+
+    mesh = (GLMmesh*)malloc(sizeof(GLMmesh));
+    memset(mesh, 0, sizeof(GLMmesh));
+    mesh->pathname = strdup(filename);
+    mesh->flags = header.flags;
+    mesh->stride = header.stride;
+    mesh->numvertices = header.numvertices;
+    mesh->numindices = header.numindices;
+    mesh->numranges = header.numranges;
+    mesh->mapping = data;
+    mesh->mapsize = size;
+
+    offset = sizeof(header);
+    mesh->ranges = (GLMrange*)(base + offset);
+    offset += sizeof(GLMrange) * header.numranges;
+
+    /* materials are copied out (they are tiny) */
+    if (header.nummaterials) {
+        mesh->materials = (GLMmaterial*)calloc(header.nummaterials,
+            sizeof(GLMmaterial));
+        mesh->nummaterials = header.nummaterials;
+    }
+    for (i = 0; i < header.nummaterials; i++) {
+        material = &mesh->materials[i];
+        if (offset + sizeof(values) + sizeof(GLuint) > size)
+            goto corrupt;
+        memcpy(values, base + offset, sizeof(values));
+        memcpy(&length, base + offset + sizeof(values), sizeof(GLuint));
+        offset += sizeof(values) + sizeof(GLuint);
+        if (length == 0 || offset + length > size ||
+            base[offset + length - 1] != '\0')
+            goto corrupt;
+        material->name = strdup(base + offset);
+        offset += (length + 3) & ~3u;
+        memcpy(material->diffuse, &values[0], sizeof(GLfloat) * 4);
+        memcpy(material->ambient, &values[4], sizeof(GLfloat) * 4);
+        memcpy(material->specular, &values[8], sizeof(GLfloat) * 4);
+        memcpy(material->emmissive, &values[12], sizeof(GLfloat) * 4);
+        material->shininess = values[16];
+    }
+    if (offset != sizeof(header) + sizeof(GLMrange) * header.numranges +
+        header.materialbytes)
+        goto corrupt;
+
+    mesh->vertices = (GLfloat*)(base + offset);
+    offset += sizeof(GLfloat) * header.stride * header.numvertices;
+    mesh->indices = (GLuint*)(base + offset);
+
+    /* ranges must stay inside the index list & material table */
+    for (i = 0; i < mesh->numranges; i++) {
+        if (mesh->ranges[i].first > mesh->numindices ||
+            mesh->ranges[i].count > mesh->numindices - mesh->ranges[i].first ||
+            (mesh->ranges[i].material && mesh->ranges[i].material >= mesh->nummaterials))
+            goto corrupt;
+    }
+
+    /* every index must name a vertex (else parse the .obj instead) */
+    for (i = 0; i < mesh->numindices; i++) {
+        if (mesh->indices[i] >= mesh->numvertices)
+            goto corrupt;
+    }
+
+    return mesh;
+
+corrupt:
+    glmMeshDelete(mesh);
+    return NULL;
+
+stale:
+    glmUnmapFile(data, size);
+    return NULL;
+}
+
+/* glmReadMesh: Reads a render-ready mesh from a Wavefront .OBJ file.
+ * Returns a pointer to the created mesh which should be free'd with
+ * glmMeshDelete(), or NULL if the file cannot be read.
+ *
+ * filename - name of the file containing the Wavefront .OBJ format data.
+ */
+GLMmesh*
+glmReadMesh(char* filename)
+{
+    GLMmodel model;
+    GLMmesh* mesh;
+    GLvoid* data;
+    char* cachename;
+    size_t size;
+    unsigned long long sourcesize, sourcemtime;
+
+    if (!glmFileInfo(filename, &sourcesize, &sourcemtime)) {
+        fprintf(stderr, "glmReadMesh() failed: can't open data file \"%s\".\n",
+            filename);
+        return NULL;
+    }
+
+    /* straight from the cache, if it's current */
+    cachename = glmCacheName(filename);
+    mesh = glmReadMeshCache(filename, cachename, sourcesize, sourcemtime);
+    if (mesh) {
+        free(cachename);
+        return mesh;
+    }
+
+    data = glmMapFile(filename, &size);
+    if (!data) {
+        fprintf(stderr, "glmReadMesh() failed: can't read data file \"%s\".\n",
+            filename);
+        free(cachename);
+        return NULL;
+    }
+
+    /* scratch model, for the material library */
+    memset(&model, 0, sizeof(model));
+    model.pathname = filename;
+
+    mesh = glmParseMesh(&model, (const char*)data, size);
+    glmUnmapFile(data, size);
+
+    glmWriteMeshCache(mesh, filename, cachename, model.mtllibname,
+        sourcesize, sourcemtime);
+    free(model.mtllibname);
+    free(cachename);
+
+    return mesh;
+}
+
+/* glmMeshUpload: Uploads a mesh to a vertex buffer (interleaved
+ * vertices) and an index buffer.
+ *
+ * mesh - initialized GLMmesh structure
+ */
+GLboolean
+glmMeshUpload(GLMmesh* mesh)
+{
+    const char* version;
+    const char* extensions;
+    int major, minor;
+
+    assert(mesh);
+
+    if (mesh->vbo)
+        return GL_TRUE;
+
+    /* buffer objects are core since 1.5 */
+    version = (const char*)glGetString(GL_VERSION);
+    extensions = (const char*)glGetString(GL_EXTENSIONS);
+    major = minor = 0;
+    if (version)
+        sscanf(version, "%d.%d", &major, &minor);
+    if (major < 1 || (major == 1 && minor < 5)) {
+        if (!extensions || !strstr(extensions, "GL_ARB_vertex_buffer_object")) {
+            printf("glmMeshUpload() warning: no vertex buffer objects "
+                "(drawing from client memory).\n");
+            return GL_FALSE;
+        }
+    }
+
+    glGenBuffers(1, &mesh->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * mesh->stride *
+        mesh->numvertices, mesh->vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &mesh->ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * mesh->numindices,
+        mesh->indices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    return GL_TRUE;
+}
+
+/* glmMeshDraw: Renders the mesh to the current OpenGL context using
+ * the mode specified.
+ *
+ * mesh  - initialized GLMmesh structure
+ * mode  - a bitwise OR of values describing what is to be rendered.
+ *             GLM_NONE     -  render with only vertices
+ *             GLM_SMOOTH   -  render with vertex normals
+ *             GLM_TEXTURE  -  render with texture coords
+ *             GLM_COLOR    -  render with colors (color material)
+ *             GLM_MATERIAL -  render with materials
+ *             GLM_COLOR and GLM_MATERIAL should not both be specified.
+ */
+GLvoid
+glmMeshDraw(GLMmesh* mesh, GLuint mode)
+{
+    GLMmaterial* material;
+    const char* vertices;
+    const GLuint* indices;
+    GLsizei stride;
+    GLuint i;
+
+    assert(mesh);
+
+    /* do a bit of warning */
+    if (mode & GLM_FLAT) {
+        printf("glmMeshDraw() warning: flat render mode requested "
+            "(meshes only have vertex normals).\n");
+        mode &= ~GLM_FLAT;
+    }
+    if (mode & GLM_TEXTURE && !(mesh->flags & GLM_TEXTURE)) {
+        printf("glmMeshDraw() warning: texture render mode requested "
+            "with no texture coordinates defined.\n");
+        mode &= ~GLM_TEXTURE;
+    }
+    if (mode & GLM_COLOR && !mesh->materials) {
+        printf("glmMeshDraw() warning: color render mode requested "
+            "with no materials defined.\n");
+        mode &= ~GLM_COLOR;
+    }
+    if (mode & GLM_MATERIAL && !mesh->materials) {
+        printf("glmMeshDraw() warning: material render mode requested "
+            "with no materials defined.\n");
+        mode &= ~GLM_MATERIAL;
+    }
+    if (mode & GLM_COLOR && mode & GLM_MATERIAL) {
+        printf("glmMeshDraw() warning: color and material render mode requested "
+            "using only material mode.\n");
+        mode &= ~GLM_COLOR;
+    }
+    if (mode & GLM_COLOR)
+        glEnable(GL_COLOR_MATERIAL);
+    else if (mode & GLM_MATERIAL)
+        glDisable(GL_COLOR_MATERIAL);
+
+    /* offsets into the buffers, or pointers into client memory */
+    vertices = mesh->vbo ? NULL : (const char*)mesh->vertices;
+    indices = mesh->ibo ? NULL : mesh->indices;
+    stride = sizeof(GLfloat) * mesh->stride;
+
+    glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+    if (mesh->vbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, mesh->vbo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->ibo);
+    }
+
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glVertexPointer(3, GL_FLOAT, stride, vertices);
+    if (mode & GLM_SMOOTH) {
+        glEnableClientState(GL_NORMAL_ARRAY);
+        glNormalPointer(GL_FLOAT, stride, vertices + 3 * sizeof(GLfloat));
+    }
+    if (mode & GLM_TEXTURE) {
+        glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+        glTexCoordPointer(2, GL_FLOAT, stride, vertices + 6 * sizeof(GLfloat));
+    }
+
+    for (i = 0; i < mesh->numranges; i++) {
+        if (mode & (GLM_MATERIAL | GLM_COLOR)) {
+            material = &mesh->materials[mesh->ranges[i].material];
+            if (mode & GLM_MATERIAL) {
+                glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, material->ambient);
+                glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, material->diffuse);
+                glMaterialfv(GL_FRONT_AND_BACK, GL_SPECULAR, material->specular);
+                glMaterialf(GL_FRONT_AND_BACK, GL_SHININESS, material->shininess);
+            } else {
+                glColor3fv(material->diffuse);
+            }
+        }
+
+        glDrawElements(GL_TRIANGLES, mesh->ranges[i].count, GL_UNSIGNED_INT,
+            indices + mesh->ranges[i].first);
+    }
+
+    if (mesh->vbo) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    glPopClientAttrib();
+}
+
+/* glmMeshDelete: Deletes a GLMmesh structure.
+ *
+ * mesh - initialized GLMmesh structure
+ */
+GLvoid
+glmMeshDelete(GLMmesh* mesh)
+{
+    GLuint i;
+
+    assert(mesh);
+
+    if (mesh->vbo) glDeleteBuffers(1, &mesh->vbo);
+    if (mesh->ibo) glDeleteBuffers(1, &mesh->ibo);
+
+    if (mesh->mapping) {
+        glmUnmapFile(mesh->mapping, mesh->mapsize);
+    } else {
+        free(mesh->vertices);
+        free(mesh->indices);
+        free(mesh->ranges);
+    }
+    if (mesh->materials) {
+        for (i = 0; i < mesh->nummaterials; i++)
+            free(mesh->materials[i].name);
+    }
+    free(mesh->materials);
+    free(mesh->pathname);
+
+    free(mesh);
+}
+
 #if 0
 /* normals */
 if (model->numnormals) {
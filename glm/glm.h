@@ -15,8 +15,12 @@
 #if defined(__APPLE__) || defined(MACOSX)
 #include <GLUT/glut.h>
 #else
+#ifndef GL_GLEXT_PROTOTYPES
+#define GL_GLEXT_PROTOTYPES     /* glGenBuffers() & friends */
+#endif
 #include <GL/glut.h>
 #endif
+#include <stddef.h>
 
 
 #ifndef M_PI
@@ -93,6 +97,45 @@ typedef struct _GLMmodel {
 
 } GLMmodel;
 
+/* GLMrange: Structure that defines a run of triangles in a mesh that
+ * share one material.
+ */
+typedef struct _GLMrange {
+  GLuint first;                 /* first index (into mesh indices) */
+  GLuint count;                 /* number of indices (3 per triangle) */
+  GLuint material;              /* index to material for range */
+} GLMrange;
+
+/* GLMmesh: Structure that defines a render-ready mesh: one vertex per
+ * unique position/texcoord/normal combination, interleaved, plus an
+ * index list.  Vertices, indices & ranges point into the cache file
+ * mapping when the mesh was loaded from its cache.
+ */
+typedef struct _GLMmesh {
+  char*    pathname;            /* path to this mesh */
+
+  GLuint   flags;               /* GLM_SMOOTH and/or GLM_TEXTURE if present */
+  GLuint   stride;              /* floats per vertex: 3 [+ 3 normal] [+ 2 texcoord] */
+
+  GLuint   numvertices;         /* number of (interleaved) vertices */
+  GLfloat* vertices;            /* position [normal] [texcoord] per vertex */
+
+  GLuint   numindices;          /* number of indices (3 per triangle) */
+  GLuint*  indices;             /* array of vertex indices */
+
+  GLuint     numranges;         /* number of ranges in mesh */
+  GLMrange*  ranges;            /* array of ranges (one per material used) */
+
+  GLuint       nummaterials;    /* number of materials in mesh */
+  GLMmaterial* materials;       /* array of materials */
+
+  GLuint   vbo;                 /* vertex buffer (0 if not uploaded) */
+  GLuint   ibo;                 /* index buffer (0 if not uploaded) */
+
+  GLvoid*  mapping;             /* cache file mapping (NULL if parsed) */
+  size_t   mapsize;             /* size of mapping */
+} GLMmesh;
+
 
 /* glmUnitize: "unitize" a model by translating it to the origin and
  * scaling it to fit in a unit cube around the origin.  Returns the
@@ -150,6 +193,7 @@ glmFacetNormals(GLMmodel* model);
  * average normal calculation and the corresponding vertex is given
  * the facet normal.  This tends to preserve hard edges.  The angle to
  * use depends on the model, but 90 degrees is usually a good start.
+ * Big models are split over several threads (same result).
  *
  * model - initialized GLMmodel structure
  * angle - maximum angle (in degrees) to smooth across
@@ -240,7 +284,7 @@ GLuint
 glmList(GLMmodel* model, GLuint mode);
 
 /* glmWeld: eliminate (weld) vectors that are within an epsilon of
- * each other.
+ * each other.  Uses a spatial hash, so it runs in linear time.
  *
  * model      - initialized GLMmodel structure
  * epsilon    - maximum difference between vertices
@@ -280,3 +324,52 @@ glmWeld(GLMmodel* model, GLfloat epsilon);
  */
 GLubyte* 
 glmReadPPM(char* filename, int* width, int* height);
+
+/* glmReadMesh: Reads a render-ready mesh from a Wavefront .OBJ file.
+ * The file is memory mapped and parsed in a single pass; faces are
+ * fan triangulated, vertices are shared between faces that use the
+ * same position/texcoord/normal, and triangles are sorted into one
+ * range per material.  If the file has no normals, smooth normals are
+ * generated (averaged over each position).  A binary cache of the
+ * result is written next to the source ("<filename>.glmc") so the
+ * next load of an unchanged file is a straight memory map.  Returns a
+ * pointer to the created mesh which should be free'd with
+ * glmMeshDelete(), or NULL if the file cannot be read.
+ *
+ * filename - name of the file containing the Wavefront .OBJ format data.
+ */
+GLMmesh*
+glmReadMesh(char* filename);
+
+/* glmMeshUpload: Uploads a mesh to a vertex buffer (interleaved
+ * vertices) and an index buffer.  Needs a current OpenGL context.
+ * Returns GL_FALSE if vertex buffers are not available (glmMeshDraw()
+ * then draws from client memory).
+ *
+ * mesh - initialized GLMmesh structure
+ */
+GLboolean
+glmMeshUpload(GLMmesh* mesh);
+
+/* glmMeshDraw: Renders the mesh to the current OpenGL context using
+ * the mode specified, one glDrawElements() per range.
+ *
+ * mesh     - initialized GLMmesh structure
+ * mode     - a bitwise OR of values describing what is to be rendered.
+ *            GLM_NONE     -  render with only vertices
+ *            GLM_SMOOTH   -  render with vertex normals
+ *            GLM_TEXTURE  -  render with texture coords
+ *            GLM_COLOR    -  render with colors (color material)
+ *            GLM_MATERIAL -  render with materials
+ *            GLM_COLOR and GLM_MATERIAL should not both be specified.
+ */
+GLvoid
+glmMeshDraw(GLMmesh* mesh, GLuint mode);
+
+/* glmMeshDelete: Deletes a GLMmesh structure (and its buffers, if
+ * uploaded; needs a current OpenGL context in that case).
+ *
+ * mesh - initialized GLMmesh structure
+ */
+GLvoid
+glmMeshDelete(GLMmesh* mesh);
@@ -3,7 +3,10 @@
     \brief A standard MIDI file reading/parsing class.
 
     This class can be used to read events from a standard MIDI file.
-    Event bytes are copied to a C++ vector and must be subsequently
+    The file is memory-mapped and decoded in place: readEvent() returns
+    each event as a span into the mapping, with no copying or
+    allocation.  getNextEvent() copies the event bytes into a C++
+    vector instead.  Either way, the bytes must be subsequently
     interpreted by the user.  The function getNextMidiEvent() skips
     meta and sysex events, returning only MIDI channel messages.
     Event delta-times are returned in the form of "ticks" and a
@@ -17,158 +20,259 @@
 
 #include "MidiFileIn.h"
 #include <cstring>
+#include <cstdio>
 #include <iostream>
+#include <sys/types.h>
+#include <sys/stat.h>
+#if !defined(_WIN32)
+  #include <fcntl.h>
+  #include <unistd.h>
+  #include <sys/mman.h>
+#endif
 
 namespace stk {
 
+MidiTempoMap :: MidiTempoMap()
+{
+  reset( 0.5 / 480 );
+}
+
+void MidiTempoMap :: reset( double tickSeconds )
+{
+  Segment segment;
+  segment.tick = 0;
+  segment.seconds = 0.0;
+  segment.tickSeconds = tickSeconds;
+  segments_.assign( 1, segment );
+}
+
+void MidiTempoMap :: addTempo( unsigned long tick, double tickSeconds )
+{
+  Segment &last = segments_.back();
+  if ( tick < last.tick ) return;
+
+  // A change at the same tick replaces the last one.
+  if ( tick == last.tick ) {
+    last.tickSeconds = tickSeconds;
+    return;
+  }
+
+  Segment segment;
+  segment.tick = tick;
+  segment.seconds = last.seconds + ( tick - last.tick ) * last.tickSeconds;
+  segment.tickSeconds = tickSeconds;
+  segments_.push_back( segment );
+}
+
+unsigned int MidiTempoMap :: getSegment( double tick ) const
+{
+  // Last segment starting at or before the tick.
+  unsigned int lo = 0, hi = segments_.size();
+  while ( hi - lo > 1 ) {
+    unsigned int mid = ( lo + hi ) / 2;
+    if ( segments_[mid].tick <= tick ) lo = mid;
+    else hi = mid;
+  }
+  return lo;
+}
+
+double MidiTempoMap :: getTickSeconds( double tick ) const
+{
+  return segments_[ getSegment( tick ) ].tickSeconds;
+}
+
+double MidiTempoMap :: getSeconds( double tick ) const
+{
+  const Segment &segment = segments_[ getSegment( tick ) ];
+  return segment.seconds + ( tick - segment.tick ) * segment.tickSeconds;
+}
+
+double MidiTempoMap :: getTicks( double seconds ) const
+{
+  // Last segment starting at or before the time.
+  unsigned int lo = 0, hi = segments_.size();
+  while ( hi - lo > 1 ) {
+    unsigned int mid = ( lo + hi ) / 2;
+    if ( segments_[mid].seconds <= seconds ) lo = mid;
+    else hi = mid;
+  }
+  const Segment &segment = segments_[lo];
+  return segment.tick + ( seconds - segment.seconds ) / segment.tickSeconds;
+}
+
+// Big-endian values in the file.
+static inline unsigned long read32( const unsigned char *p )
+{
+  return ( (unsigned long) p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+static inline unsigned int read16( const unsigned char *p )
+{
+  return ( p[0] << 8 ) | p[1];
+}
+
 MidiFileIn :: MidiFileIn( std::string fileName )
+  : data_( 0 ), size_( 0 ), mapped_( false )
 {
   // ge: initialize
   bpm_ = 0;
 
-  // Attempt to open the file.
-  file_.open( fileName.c_str(), std::ios::in | std::ios::binary );
-  if ( !file_ ) {
+  // Attempt to map the file (read it in one go where there is no mmap).
+#if !defined(_WIN32)
+  int fd = open( fileName.c_str(), O_RDONLY );
+  if ( fd < 0 ) {
     errorString_ << "MidiFileIn: error opening or finding file (" <<  fileName << ").";
     handleError( StkError::FILE_NOT_FOUND );
   }
+  struct stat st;
+  if ( fstat( fd, &st ) == 0 && st.st_size > 0 ) {
+    void *p = mmap( 0, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( p != MAP_FAILED ) {
+      data_ = (const unsigned char *) p;
+      size_ = (unsigned long) st.st_size;
+      mapped_ = true;
+    }
+  }
+  ::close( fd );
+#else
+  FILE *fp = fopen( fileName.c_str(), "rb" );
+  if ( !fp ) {
+    errorString_ << "MidiFileIn: error opening or finding file (" <<  fileName << ").";
+    handleError( StkError::FILE_NOT_FOUND );
+  }
+  struct stat st;
+  if ( fstat( fileno( fp ), &st ) == 0 && st.st_size > 0 ) {
+    unsigned char *buffer = new unsigned char[st.st_size];
+    if ( fread( buffer, 1, st.st_size, fp ) == (size_t) st.st_size ) {
+      data_ = buffer;
+      size_ = (unsigned long) st.st_size;
+    }
+    else delete [] buffer;
+  }
+  fclose( fp );
+#endif
+  if ( !data_ ) {
+    errorString_ << "MidiFileIn: error reading from file (" <<  fileName << ").";
+    handleError( StkError::FILE_ERROR );
+  }
 
   // Parse header info.
-  char chunkType[4];
-  char buffer[4];
-  SINT32 *length;
-  if ( !file_.read( chunkType, 4 ) ) goto error;
-  if ( !file_.read( buffer, 4 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap32((unsigned char *)&buffer);
-#endif
-  length = (SINT32 *) &buffer;
-  if ( strncmp( chunkType, "MThd", 4 ) || ( *length != 6 ) ) {
+  if ( size_ < 14 || strncmp( (const char *) data_, "MThd", 4 ) || read32( data_ + 4 ) != 6 ) {
+    close();
     errorString_ << "MidiFileIn: file (" <<  fileName << ") does not appear to be a MIDI file!";
     handleError( StkError::FILE_UNKNOWN_FORMAT );
   }
 
   // Read the MIDI file format.
-  SINT16 *data;
-  if ( !file_.read( buffer, 2 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap16((unsigned char *)&buffer);
-#endif
-  data = (SINT16 *) &buffer;
-  if ( *data < 0 || *data > 2 ) {
+  format_ = read16( data_ + 8 );
+  if ( format_ > 2 ) {
+    close();
     errorString_ << "MidiFileIn: the file (" <<  fileName << ") format is invalid!";
     handleError( StkError::FILE_ERROR );
   }
-  format_ = *data;
 
   // Read the number of tracks.
-  if ( !file_.read( buffer, 2 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap16((unsigned char *)&buffer);
-#endif
-  if ( format_ == 0 && *data != 1 ) {
+  nTracks_ = read16( data_ + 10 );
+  if ( format_ == 0 && nTracks_ != 1 ) {
+    close();
     errorString_ << "MidiFileIn: invalid number of tracks (>1) for a file format = 0!";
     handleError( StkError::FILE_ERROR );
   }
-  nTracks_ = *data;
 
   // Read the beat division.
-  if ( !file_.read( buffer, 2 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap16((unsigned char *)&buffer);
-#endif
-  division_ = (int) *data;
+  division_ = (int) (SINT16) read16( data_ + 12 );
   double tickrate;
   usingTimeCode_ = false;
-  if ( *data & 0x8000 ) {
-    // Determine ticks per second from time-code formats.
-    tickrate = (double) -(*data & 0x7F00);
+  if ( division_ & 0x8000 ) {
+    // Determine ticks per second from time-code formats: the upper
+    // byte is the negative frames per second, the lower the ticks
+    // per frame.
+    tickrate = (double) -(signed char) ( ( division_ >> 8 ) & 0xFF );
     // If frames per second value is 29, it really should be 29.97.
     if ( tickrate == 29.0 ) tickrate = 29.97;
-    tickrate *= (*data & 0x00FF);
+    tickrate *= ( division_ & 0x00FF );
     usingTimeCode_ = true;
   }
   else {
-    tickrate = (double) (*data & 0x7FFF); // ticks per quarter note
+    tickrate = (double) ( division_ & 0x7FFF ); // ticks per quarter note
   }
 
   // Now locate the track offsets and lengths.  If not using time
   // code, we can initialize the "tick time" using a default tempo of
   // 120 beats per minute.  We will then check for tempo meta-events
-  // afterward.
-  unsigned int i;
-  for ( i=0; i<nTracks_; i++ ) {
-    if ( !file_.read( chunkType, 4 ) ) goto error;
-    if ( strncmp( chunkType, "MTrk", 4 ) ) goto error;
-    if ( !file_.read( buffer, 4 ) ) goto error;
-#ifdef __LITTLE_ENDIAN__
-  swap32((unsigned char *)&buffer);
-#endif
-    length = (SINT32 *) &buffer;
-    trackLengths_.push_back( *length );
-    trackOffsets_.push_back( (long) file_.tellg() );
-    trackPointers_.push_back( (long) file_.tellg() );
+  // afterward.  A truncated last track is cut short at the end of
+  // the file.
+  unsigned long position = 14;
+  for ( unsigned int i=0; i<nTracks_; i++ ) {
+    if ( position + 8 > size_ || strncmp( (const char *) data_ + position, "MTrk", 4 ) ) {
+      close();
+      errorString_ << "MidiFileIn: error reading from file (" <<  fileName << ").";
+      handleError( StkError::FILE_ERROR );
+    }
+    unsigned long length = read32( data_ + position + 4 );
+    position += 8;
+    if ( length > size_ - position ) length = size_ - position;
+    trackLengths_.push_back( length );
+    trackOffsets_.push_back( position );
+    trackPointers_.push_back( position );
     trackStatus_.push_back( 0 );
-    file_.seekg( *length, std::ios_base::cur );
+    position += length;
     if ( usingTimeCode_ ) tickSeconds_.push_back( (double) (1.0 / tickrate) );
     else tickSeconds_.push_back( (double) (0.5 / tickrate) );
   }
 
   // Save the initial tickSeconds parameter.
-  TempoChange tempoEvent;
-  tempoEvent.count = 0;
-  tempoEvent.tickSeconds = tickSeconds_[0];
-  tempoEvents_.push_back( tempoEvent );
+  tempoMap_.reset( nTracks_ ? tickSeconds_[0] : 0.5 / tickrate );
+  trackCounters_.assign( nTracks_, 0 );
+  trackTempoIndex_.assign( nTracks_, 0 );
 
-  // If format 1 and not using time code, parse and save the tempo map
-  // on track 0.
-  if ( format_ == 1 && !usingTimeCode_ ) {
-    std::vector<unsigned char> event;
-    unsigned long value, count;
+  // If format 0 or 1 and not using time code, parse and save the
+  // tempo map on track 0.
+  if ( format_ != 2 && !usingTimeCode_ && nTracks_ > 0 ) {
+    Event event;
+    unsigned long value, count = 0;
 
     // We need to temporarily change the usingTimeCode_ value here so
-    // that the getNextEvent() function doesn't try to check the tempo
+    // that the readEvent() function doesn't try to check the tempo
     // map (which we're creating here).
     usingTimeCode_ = true;
-    count = getNextEvent( &event, 0 );
-    while ( event.size() ) {
-      if ( ( event.size() == 6 ) && ( event[0] == 0xff ) &&
-           ( event[1] == 0x51 ) && ( event[2] == 0x03 ) ) {
-        tempoEvent.count = count;
-        value = ( event[3] << 16 ) + ( event[4] << 8 ) + event[5];
-        tempoEvent.tickSeconds = (double) (0.000001 * value / tickrate);
-//      // ge: check
-//      std::cerr << "tick: " << 60000000 / value << std::endl;
-        // ge: set BPM
-        bpm_ = 60000000.0 / value;
-        if ( count > tempoEvents_.back().count )
-          tempoEvents_.push_back( tempoEvent );
-        else
-          tempoEvents_.back() = tempoEvent;
+    try {
+      while ( readEvent( event, 0 ) ) {
+        count += event.ticks;
+        if ( event.status == 0xff && event.meta == 0x51 && event.length == 3 ) {
+          value = ( event.data[0] << 16 ) + ( event.data[1] << 8 ) + event.data[2];
+          tempoMap_.addTempo( count, (double) (0.000001 * value / tickrate) );
+          // ge: set BPM
+          bpm_ = 60000000.0 / value;
+        }
       }
-      count += getNextEvent( &event, 0 );
     }
-    rewindTrack( 0 );
-    for ( unsigned int i=0; i<nTracks_; i++ ) {
-      trackCounters_.push_back( 0 );
-      trackTempoIndex_.push_back( 0 );
+    catch ( StkError & ) {
+      close();
+      throw;
     }
+    rewindTrack( 0 );
     // Change the time code flag back!
     usingTimeCode_ = false;
   }
-
-  return;
-
- error:
-  errorString_ << "MidiFileIn: error reading from file (" <<  fileName << ").";
-  handleError( StkError::FILE_ERROR );
 }
 
 MidiFileIn :: ~MidiFileIn()
 {
-  // An ifstream object implicitly closes itself during destruction
-  // but we'll make an explicit call to "close" anyway.
-  file_.close(); 
+  close();
+}
+
+void MidiFileIn :: close()
+{
+  if ( !data_ ) return;
+#if !defined(_WIN32)
+  if ( mapped_ ) munmap( (void *) data_, size_ );
+#else
+  delete [] data_;
+#endif
+  data_ = 0;
+  size_ = 0;
+  mapped_ = false;
 }
 
 int MidiFileIn :: getFileFormat() const
@@ -195,7 +299,9 @@ void MidiFileIn :: rewindTrack( unsigned int track )
 
   trackPointers_[track] = trackOffsets_[track];
   trackStatus_[track] = 0;
-  tickSeconds_[track] = tempoEvents_[0].tickSeconds;
+  trackCounters_[track] = 0;
+  trackTempoIndex_[track] = 0;
+  tickSeconds_[track] = tempoMap_.getSegmentTickSeconds( 0 );
 }
 
 double MidiFileIn :: getTickSeconds( unsigned int track )
@@ -215,13 +321,12 @@ double MidiFileIn :: getBPM()
     return bpm_;
 }
 
-unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, unsigned int track )
+bool MidiFileIn :: readEvent( Event &event, unsigned int track )
 {
-  // Fill the user-provided vector with the next event in the
-  // specified track (default = 0) and return the event delta time in
-  // ticks.  This function assumes that the stored track pointer is
-  // positioned at the start of a track event.  If the track has
-  // reached its end, the event vector size will be zero.
+  // Point the event at the next event in the specified track and
+  // advance past it.  This function assumes that the stored track
+  // pointer is positioned at the start of a track event.  If the
+  // track has reached its end, the event size will be zero.
   //
   // If we have a format 0 or 2 file and we're not using timecode, we
   // should check every meta-event for tempo changes and make
@@ -236,103 +341,137 @@ unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, uns
     handleError( StkError::FUNCTION_ARGUMENT );
   }
 
-  event->clear();
-  // Check for the end of the track.
-  if ( (trackPointers_[track] - trackOffsets_[track]) >= trackLengths_[track] )
-    return 0;
+  event.ticks = 0;
+  event.size = 0;
+  event.meta = 0;
+  event.data = 0;
+  event.length = 0;
 
+  unsigned long position = trackPointers_[track];
+  unsigned long end = trackOffsets_[track] + trackLengths_[track];
   unsigned long ticks = 0, bytes = 0;
+  unsigned char c;
   bool isTempoEvent = false;
 
+  // Check for the end of the track.
+  if ( position >= end ) return false;
+
   // Read the event delta time.
-  file_.seekg( trackPointers_[track], std::ios_base::beg );
-  if ( !readVariableLength( &ticks ) ) goto error;
+  if ( !readVariableLength( &ticks, position, end ) ) goto error;
 
   // Parse the event stream to determine the event length.
-  unsigned char c;
-  if ( !file_.read( (char *)&c, 1 ) ) goto error;
+  if ( position >= end ) goto error;
+  c = data_[position++];
   switch ( c ) {
 
   case 0xFF: // A Meta-Event
-    unsigned long position;
     trackStatus_[track] = 0;
-    event->push_back( c );
-    if ( !file_.read( (char *)&c, 1 ) ) goto error;
-    event->push_back( c );
-    if ( format_ != 1 && ( c == 0x51 ) ) isTempoEvent = true;
-    position = file_.tellg();
-    if ( !readVariableLength( &bytes ) ) goto error;
-    bytes += ( (unsigned long)file_.tellg() - position );
-    file_.seekg( position, std::ios_base::beg );
+    if ( position >= end ) goto error;
+    event.bytes = data_ + position;
+    event.meta = data_[position++];
+    if ( format_ != 1 && ( event.meta == 0x51 ) ) isTempoEvent = true;
+    if ( !readVariableLength( &event.length, position, end ) ) goto error;
+    if ( event.length > end - position ) goto error;
+    event.data = data_ + position;
+    position += event.length;
     break;
 
   case 0xF0:
   case 0xF7: // The start or continuation of a Sysex event
     trackStatus_[track] = 0;
-    event->push_back( c );
-    position = file_.tellg();
-    if ( !readVariableLength( &bytes ) ) goto error;
-    bytes += ( (unsigned long)file_.tellg() - position );
-    file_.seekg( position, std::ios_base::beg );
+    event.bytes = data_ + position;
+    if ( !readVariableLength( &event.length, position, end ) ) goto error;
+    if ( event.length > end - position ) goto error;
+    event.data = data_ + position;
+    position += event.length;
     break;
 
   default: // Should be a MIDI channel event
     if ( c & 0x80 ) { // MIDI status byte
       if ( c > 0xF0 ) goto error;
       trackStatus_[track] = c;
-      event->push_back( c );
-      c &= 0xF0;
-      if ( (c == 0xC0) || (c == 0xD0) ) bytes = 1;
-      else bytes = 2;
+      event.bytes = data_ + position;
     }
     else if ( trackStatus_[track] & 0x80 ) { // Running status
-      event->push_back( trackStatus_[track] );
-      event->push_back( c );
-      c = trackStatus_[track] & 0xF0;
-      if ( (c != 0xC0) && (c != 0xD0) ) bytes = 1;
+      event.bytes = data_ + position - 1;
+      position--;
+      c = trackStatus_[track];
     }
     else goto error;
-
+    bytes = ( ( c & 0xF0 ) == 0xC0 || ( c & 0xF0 ) == 0xD0 ) ? 1 : 2;
+    if ( bytes > end - position ) goto error;
+    position += bytes;
   }
 
-  // Read the rest of the event into the event vector.
-  unsigned long i;
-  for ( i=0; i<bytes; i++ ) {
-    if ( !file_.read( (char *)&c, 1 ) ) goto error;
-    event->push_back( c );
-  }
+  event.status = c;
+  event.size = (unsigned long) ( data_ + position - event.bytes ) + 1;
+  event.ticks = ticks;
 
   if ( !usingTimeCode_ ) {
-    if ( isTempoEvent ) {
+    if ( isTempoEvent && event.length == 3 ) {
       // Parse the tempo event and update tickSeconds_[track].
       double tickrate = (double) (division_ & 0x7FFF);
-      unsigned long value = ( event->at(3) << 16 ) + ( event->at(4) << 8 ) + event->at(5);
+      unsigned long value = ( event.data[0] << 16 ) + ( event.data[1] << 8 ) + event.data[2];
       tickSeconds_[track] = (double) (0.000001 * value / tickrate);
-        
+
       // ge: set BPM
       bpm_ = 60000000.0 / value;
     }
 
     if ( format_ == 1 ) {
-      // Update track counter and check the tempo map.
+      // Update track counter and follow the tempo map.
       trackCounters_[track] += ticks;
-      TempoChange tempoEvent = tempoEvents_[ trackTempoIndex_[track] ];
-      if ( trackCounters_[track] >= tempoEvent.count && trackTempoIndex_[track] < tempoEvents_.size() - 1 ) {
-        trackTempoIndex_[track]++;
-        tickSeconds_[track] = tempoEvent.tickSeconds;
-      }
+      unsigned int &segment = trackTempoIndex_[track];
+      while ( segment + 1 < tempoMap_.getSize() &&
+              tempoMap_.getSegmentTick( segment + 1 ) <= trackCounters_[track] )
+        segment++;
+      tickSeconds_[track] = tempoMap_.getSegmentTickSeconds( segment );
     }
   }
 
   // Save the current track pointer value.
-  trackPointers_[track] = file_.tellg();
+  trackPointers_[track] = position;
 
-  return ticks;
+  return true;
 
  error:
+  event.size = 0;
   errorString_ << "MidiFileIn::getNextEvent: file read error!";
   handleError( StkError::FILE_ERROR );
-  return 0;
+  return false;
+}
+
+bool MidiFileIn :: readMidiEvent( Event &event, unsigned int track )
+{
+  // Point the event at the next MIDI event in the specified track.
+  // Meta-Events preceeding this event are skipped, though their
+  // delta times are added to the one returned.
+  unsigned long ticks = 0;
+  while ( readEvent( event, track ) ) {
+    ticks += event.ticks;
+    if ( event.status < 0xF0 ) {
+      event.ticks = ticks;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+unsigned long MidiFileIn :: getNextEvent( std::vector<unsigned char> *event, unsigned int track )
+{
+  // Fill the user-provided vector with the next event in the
+  // specified track (default = 0) and return the event delta time in
+  // ticks.  If the track has reached its end, the event vector size
+  // will be zero.
+  Event e;
+  event->clear();
+  if ( !readEvent( e, track ) ) return 0;
+
+  event->push_back( e.status );
+  event->insert( event->end(), e.bytes, e.bytes + e.size - 1 );
+
+  return e.ticks;
 }
 
 unsigned long MidiFileIn :: getNextMidiEvent( std::vector<unsigned char> *midiEvent, unsigned int track )
@@ -340,44 +479,31 @@ unsigned long MidiFileIn :: getNextMidiEvent( std::vector<unsigned char> *midiEv
   // Fill the user-provided vector with the next MIDI event in the
   // specified track (default = 0) and return the event delta time in
   // ticks.  Meta-Events preceeding this event are skipped and ignored.
-  if ( track >= nTracks_ ) {
-    errorString_ << "MidiFileIn::getNextMidiEvent: invalid track argument (" <<  track << ").";
-    handleError( StkError::FUNCTION_ARGUMENT );
-  }
+  Event e;
+  midiEvent->clear();
+  if ( !readMidiEvent( e, track ) ) return 0;
 
-  unsigned long ticks = getNextEvent( midiEvent, track );
-  while ( midiEvent->size() && ( midiEvent->at(0) >= 0xF0 ) ) {
-    //for ( unsigned int i=0; i<midiEvent->size(); i++ )
-      //std::cout << "event byte = " << i << ", value = " << (int)midiEvent->at(i) << std::endl;
-    ticks = getNextEvent( midiEvent, track );
-  }
+  midiEvent->push_back( e.status );
+  midiEvent->insert( midiEvent->end(), e.bytes, e.bytes + e.size - 1 );
 
-  //for ( unsigned int i=0; i<midiEvent->size(); i++ )
-    //std::cout << "event byte = " << i << ", value = " << (int)midiEvent->at(i) << std::endl;
-
-  return ticks;
+  return e.ticks;
 }
 
-bool MidiFileIn :: readVariableLength( unsigned long *value )
+bool MidiFileIn :: readVariableLength( unsigned long *value, unsigned long &position, unsigned long end )
 {
-  // It is assumed that this function is called with the file read
-  // pointer positioned at the start of a variable-length value.  The
+  // It is assumed that this function is called with the position at
+  // the start of a variable-length value (at most four bytes).  The
   // function returns "true" if the value is successfully parsed and
   // "false" otherwise.
   *value = 0;
-  char c;
-
-  if ( !file_.read( &c, 1 ) ) return false;
-  *value = (unsigned long) c;
-  if ( *value & 0x80 ) {
-    *value &= 0x7f;
-    do {
-      if ( !file_.read( &c, 1 ) ) return false;
-      *value = ( *value << 7 ) + ( c & 0x7f );
-    } while ( c & 0x80 );
+  for ( int i=0; i<4; i++ ) {
+    if ( position >= end ) return false;
+    unsigned char c = data_[position++];
+    *value = ( *value << 7 ) + ( c & 0x7f );
+    if ( !( c & 0x80 ) ) return true;
   }
 
-  return true;
+  return false;
 } 
 
 } // stk namespace
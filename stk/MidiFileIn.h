@@ -4,17 +4,72 @@
 #include "Stk.h"
 #include <string>
 #include <vector>
-#include <fstream>
 #include <sstream>
 
 namespace stk {
 
+/**********************************************************************/
+/*! \class MidiTempoMap
+    \brief A MIDI file tempo map: ticks to seconds and back.
+
+    The map is a list of tempo segments, in tick order, each with the
+    seconds elapsed at its start.  Conversions in either direction
+    binary search for the segment, so any position can be mapped in
+    O(log n) without replaying the file.
+*/
+/**********************************************************************/
+
+class MidiTempoMap
+{
+ public:
+  //! Default constructor (one segment at 120 BPM, 480 ticks per quarter note).
+  MidiTempoMap();
+
+  //! Remove all segments and start again with the given seconds per tick.
+  void reset( double tickSeconds );
+
+  //! Set the seconds per tick from the given tick on (ticks must not decrease).
+  void addTempo( unsigned long tick, double tickSeconds );
+
+  //! Return the number of tempo segments.
+  unsigned int getSize() const { return segments_.size(); }
+
+  //! Return the index of the segment holding the given tick.
+  unsigned int getSegment( double tick ) const;
+
+  //! Return the tick at which a segment starts.
+  unsigned long getSegmentTick( unsigned int segment ) const { return segments_[segment].tick; }
+
+  //! Return the seconds per tick in a segment.
+  double getSegmentTickSeconds( unsigned int segment ) const { return segments_[segment].tickSeconds; }
+
+  //! Return the seconds per tick at the given tick.
+  double getTickSeconds( double tick ) const;
+
+  //! Return the time in seconds of the given (possibly fractional) tick.
+  double getSeconds( double tick ) const;
+
+  //! Return the (fractional) tick at the given time in seconds.
+  double getTicks( double seconds ) const;
+
+ protected:
+  struct Segment {
+    unsigned long tick;
+    double seconds;
+    double tickSeconds;
+  };
+  std::vector<Segment> segments_;
+};
+
 /**********************************************************************/
 /*! \class MidiFileIn
     \brief A standard MIDI file reading/parsing class.
 
     This class can be used to read events from a standard MIDI file.
-    Event bytes are copied to a C++ vector and must be subsequently
+    The file is memory-mapped and decoded in place: readEvent() returns
+    each event as a span into the mapping, with no copying or
+    allocation.  getNextEvent() copies the event bytes into a C++
+    vector instead.  Either way, the bytes must be subsequently
     interpreted by the user.  The function getNextMidiEvent() skips
     meta and sysex events, returning only MIDI channel messages.
     Event delta-times are returned in the form of "ticks" and a
@@ -29,6 +84,27 @@ namespace stk {
 class MidiFileIn : public Stk
 {
  public:
+  //! One event, as a span into the file mapping (valid while the object lives).
+  /*!
+      Byte 0 of an event is its status byte (also when running status
+      is used in the file) and bytes 1 to size - 1 follow it in the
+      mapping: event[i] is laid out like the vector filled by
+      getNextEvent().  For meta-events and sysex, data and length
+      give the payload.  At the end of a track, size is zero.
+  */
+  struct Event {
+    unsigned long ticks;        // delta time in ticks
+    unsigned char status;       // status byte
+    const unsigned char *bytes; // bytes after the status byte
+    unsigned long size;         // number of bytes, including status
+    unsigned char meta;         // meta-event type (if status is 0xFF)
+    const unsigned char *data;  // meta/sysex payload
+    unsigned long length;       // payload length
+
+    Event() : ticks(0), status(0), bytes(0), size(0), meta(0), data(0), length(0) {}
+    unsigned char operator[]( unsigned long i ) const { return i ? bytes[i-1] : status; }
+  };
+
   //! Default constructor.
   /*!
       If an error occurs while opening or parsing the file header, an
@@ -70,6 +146,15 @@ class MidiFileIn : public Stk
   */   
   double getTickSeconds( unsigned int track = 0 );
     
+  //! Return the tempo map (read from track 0 when the file is opened).
+  /*!
+      For format 0 and 1 files, this converts any tick position to
+      seconds and back.  Format 2 tracks are independent sequences
+      which may carry their own tempo changes; the map is that of
+      track 0.
+  */
+  const MidiTempoMap &getTempoMap() const { return tempoMap_; }
+
   //! ge: get the current BPM (I think)
   /*!
       This value can change as events are read... hmm pretty much
@@ -105,36 +190,48 @@ class MidiFileIn : public Stk
   */
   unsigned long getNextMidiEvent( std::vector<unsigned char> *midiEvent, unsigned int track = 0 );
 
+  //! Point the user-provided event at the next event in the specified track, without copying.
+  /*!
+      Returns false (and a zero event size) if the track has reached
+      its end.  Tempo changes are tracked as for getNextEvent().  If
+      an invalid track number is specified or the track data is
+      corrupt, an StkError exception will be thrown.
+  */
+  bool readEvent( Event &event, unsigned int track = 0 );
+
+  //! Point the user-provided event at the next MIDI channel event in the specified track, skipping meta and sysex events.
+  bool readMidiEvent( Event &event, unsigned int track = 0 );
+
  protected:
 
   // This protected class function is used for reading variable-length
-  // MIDI file values. It is assumed that this function is called with
-  // the file read pointer positioned at the start of a
-  // variable-length value.  The function returns true if the value is
-  // successfully parsed.  Otherwise, it returns false.
-  bool readVariableLength( unsigned long *value );
+  // MIDI file values at a position in the mapping, which is advanced.
+  // The function returns true if the value is successfully parsed
+  // before the end position.  Otherwise, it returns false.
+  bool readVariableLength( unsigned long *value, unsigned long &position, unsigned long end );
+
+  // Release the mapping (or buffer).
+  void close();
 
-  std::ifstream file_;
+  const unsigned char *data_;
+  unsigned long size_;
+  bool mapped_;
   unsigned int nTracks_;
   int format_;
   int division_;
   bool usingTimeCode_;
   std::vector<double> tickSeconds_;
-  std::vector<long> trackPointers_;
-  std::vector<long> trackOffsets_;
-  std::vector<long> trackLengths_;
-  std::vector<char> trackStatus_;
+  std::vector<unsigned long> trackPointers_;
+  std::vector<unsigned long> trackOffsets_;
+  std::vector<unsigned long> trackLengths_;
+  std::vector<unsigned char> trackStatus_;
   // ge:
   double bpm_;
 
-  // This structure and the following variables are used to save and
-  // keep track of a format 1 tempo map (and the initial tickSeconds
-  // parameter for formats 0 and 2).
-  struct TempoChange { 
-    unsigned long count;
-    double tickSeconds;
-  };
-  std::vector<TempoChange> tempoEvents_;
+  // The tempo map (and the initial tickSeconds parameter for all
+  // formats), with the tick count and current tempo segment of each
+  // track for following it while reading a format 1 file.
+  MidiTempoMap tempoMap_;
   std::vector<unsigned long> trackCounters_;
   std::vector<unsigned int> trackTempoIndex_;
 };
@@ -0,0 +1,218 @@
+/**********************************************************************/
+/*! \class MidiFileOut
+    \brief A standard MIDI file writing class.
+
+    This class writes a standard MIDI file, one track at a time, in
+    the order the events are given.  Bytes go through a fixed-size
+    buffer straight to the file, so nothing is allocated per event and
+    a track of any length streams out in one pass.  Channel events use
+    running status.  Each track's length, and the number of tracks in
+    the header, are filled in as the track (or the file) is closed.
+
+    Event times are delta-times in ticks, as returned by MidiFileIn.
+*/
+/**********************************************************************/
+
+#include "MidiFileOut.h"
+
+namespace stk {
+
+MidiFileOut :: MidiFileOut( std::string fileName, int division, int format )
+  : file_(0), fileName_(fileName), format_(format), division_(division), nTracks_(0),
+    inTrack_(false), position_(0), trackOffset_(0), status_(0), bufferCount_(0)
+{
+  if ( format < 0 || format > 2 || division <= 0 || division > 0x7fff ) {
+    errorString_ << "MidiFileOut: invalid format (" << format << ") or division (" << division << ").";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  file_ = fopen( fileName.c_str(), "wb" );
+  if ( !file_ ) {
+    errorString_ << "MidiFileOut: error opening or creating file (" <<  fileName << ").";
+    handleError( StkError::FILE_ERROR );
+  }
+
+  // Header: the number of tracks is patched in by close().
+  put( 'M' ); put( 'T' ); put( 'h' ); put( 'd' );
+  put32( 6 );
+  put( 0 ); put( (unsigned char) format_ );
+  put( 0 ); put( 0 );
+  put( (unsigned char) ( division_ >> 8 ) ); put( (unsigned char) division_ );
+}
+
+MidiFileOut :: ~MidiFileOut()
+{
+  try {
+    close();
+  }
+  catch ( StkError & ) {
+  }
+}
+
+void MidiFileOut :: close()
+{
+  if ( !file_ ) return;
+
+  FILE *file = file_;
+  try {
+    if ( inTrack_ ) endTrack();
+    patch32( 8, ( ( format_ & 0xffff ) << 16 ) | ( nTracks_ & 0xffff ) );
+  }
+  catch ( StkError & ) {
+    fclose( file );
+    file_ = 0;
+    throw;
+  }
+
+  file_ = 0;
+  if ( fclose( file ) != 0 ) {
+    errorString_ << "MidiFileOut: error writing file (" <<  fileName_ << ").";
+    handleError( StkError::FILE_ERROR );
+  }
+}
+
+void MidiFileOut :: startTrack()
+{
+  if ( inTrack_ ) endTrack();
+  if ( format_ == 0 && nTracks_ > 0 ) {
+    errorString_ << "MidiFileOut::startTrack: a format 0 file has only one track.";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  // The length is patched in by endTrack().
+  put( 'M' ); put( 'T' ); put( 'r' ); put( 'k' );
+  put32( 0 );
+  trackOffset_ = position_ + bufferCount_;
+  status_ = 0;
+  inTrack_ = true;
+  nTracks_++;
+}
+
+void MidiFileOut :: endTrack( unsigned long ticks )
+{
+  if ( !inTrack_ ) return;
+
+  writeMeta( ticks, 0x2F, 0, 0 );
+  inTrack_ = false;
+  patch32( trackOffset_ - 4, position_ + bufferCount_ - trackOffset_ );
+}
+
+void MidiFileOut :: writeEvent( unsigned long ticks, unsigned char status,
+                                unsigned char data1, unsigned char data2 )
+{
+  if ( !inTrack_ || status < 0x80 || status >= 0xF0 ) {
+    errorString_ << "MidiFileOut::writeEvent: no open track or invalid status byte (" << (int) status << ").";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  putVariableLength( ticks );
+  if ( status != status_ ) put( status );
+  status_ = status;
+  put( data1 & 0x7F );
+  // Program change and channel pressure have a single data byte.
+  unsigned char type = status & 0xF0;
+  if ( type != 0xC0 && type != 0xD0 ) put( data2 & 0x7F );
+}
+
+void MidiFileOut :: writeMeta( unsigned long ticks, unsigned char type,
+                               const unsigned char *data, unsigned long length )
+{
+  if ( !inTrack_ ) {
+    errorString_ << "MidiFileOut::writeMeta: no open track.";
+    handleError( StkError::FUNCTION_ARGUMENT );
+  }
+
+  putVariableLength( ticks );
+  put( 0xFF );
+  put( type & 0x7F );
+  putVariableLength( length );
+  for ( unsigned long i=0; i<length; i++ ) put( data[i] );
+  // Meta-events cancel running status.
+  status_ = 0;
+}
+
+void MidiFileOut :: writeText( unsigned long ticks, unsigned char type, const std::string &text )
+{
+  writeMeta( ticks, type, (const unsigned char *) text.data(), text.size() );
+}
+
+void MidiFileOut :: writeTempo( unsigned long ticks, double bpm )
+{
+  if ( bpm <= 0.0 ) bpm = 120.0;
+  unsigned long value = (unsigned long) ( 60000000.0 / bpm + 0.5 );
+  if ( value > 0xFFFFFF ) value = 0xFFFFFF;
+
+  unsigned char data[3];
+  data[0] = (unsigned char) ( value >> 16 );
+  data[1] = (unsigned char) ( value >> 8 );
+  data[2] = (unsigned char) value;
+  writeMeta( ticks, 0x51, data, 3 );
+}
+
+void MidiFileOut :: writeTimeSignature( unsigned long ticks, unsigned char numerator,
+                                        unsigned char denominator )
+{
+  // The denominator is stored as a power of two.
+  unsigned char power = 0;
+  while ( ( 1 << ( power + 1 ) ) <= denominator ) power++;
+
+  unsigned char data[4];
+  data[0] = numerator;
+  data[1] = power;
+  data[2] = 24; // MIDI clocks per metronome click
+  data[3] = 8;  // 32nd notes per quarter note
+  writeMeta( ticks, 0x58, data, 4 );
+}
+
+void MidiFileOut :: putVariableLength( unsigned long value )
+{
+  // Seven bits per byte, most significant first, at most 4 bytes.
+  if ( value > 0x0FFFFFFF ) value = 0x0FFFFFFF;
+  unsigned char bytes[4];
+  int count = 0;
+  do {
+    bytes[count++] = value & 0x7F;
+    value >>= 7;
+  } while ( value );
+
+  while ( --count > 0 ) put( bytes[count] | 0x80 );
+  put( bytes[0] );
+}
+
+void MidiFileOut :: put32( unsigned long value )
+{
+  put( (unsigned char) ( value >> 24 ) );
+  put( (unsigned char) ( value >> 16 ) );
+  put( (unsigned char) ( value >> 8 ) );
+  put( (unsigned char) value );
+}
+
+void MidiFileOut :: flush()
+{
+  if ( bufferCount_ == 0 ) return;
+  if ( fwrite( buffer_, 1, bufferCount_, file_ ) != bufferCount_ ) {
+    errorString_ << "MidiFileOut: error writing file (" <<  fileName_ << ").";
+    handleError( StkError::FILE_ERROR );
+  }
+  position_ += bufferCount_;
+  bufferCount_ = 0;
+}
+
+void MidiFileOut :: patch32( long offset, unsigned long value )
+{
+  unsigned char bytes[4];
+  bytes[0] = (unsigned char) ( value >> 24 );
+  bytes[1] = (unsigned char) ( value >> 16 );
+  bytes[2] = (unsigned char) ( value >> 8 );
+  bytes[3] = (unsigned char) value;
+
+  flush();
+  if ( fseek( file_, offset, SEEK_SET ) != 0 ||
+       fwrite( bytes, 1, 4, file_ ) != 4 ||
+       fseek( file_, 0, SEEK_END ) != 0 ) {
+    errorString_ << "MidiFileOut: error writing file (" <<  fileName_ << ").";
+    handleError( StkError::FILE_ERROR );
+  }
+}
+
+} // stk namespace
@@ -0,0 +1,114 @@
+#ifndef STK_MIDIFILEOUT_H
+#define STK_MIDIFILEOUT_H
+
+#include "Stk.h"
+#include <string>
+#include <cstdio>
+
+namespace stk {
+
+/**********************************************************************/
+/*! \class MidiFileOut
+    \brief A standard MIDI file writing class.
+
+    This class writes a standard MIDI file, one track at a time, in
+    the order the events are given.  Bytes go through a fixed-size
+    buffer straight to the file, so nothing is allocated per event and
+    a track of any length streams out in one pass.  Channel events use
+    running status.  Each track's length, and the number of tracks in
+    the header, are filled in as the track (or the file) is closed.
+
+    Event times are delta-times in ticks, as returned by MidiFileIn.
+*/
+/**********************************************************************/
+
+class MidiFileOut : public Stk
+{
+ public:
+  //! Default constructor.
+  /*!
+      Creates the file and writes its header.  The division is the
+      number of ticks per quarter note.  If the file cannot be
+      created, an StkError exception will be thrown.
+  */
+  MidiFileOut( std::string fileName, int division = 480, int format = 1 );
+
+  //! Class destructor (closes the file).
+  ~MidiFileOut();
+
+  //! Finish the open track (if any) and the header, and close the file.
+  /*!
+      If an error occurs while writing, an StkError exception will be
+      thrown.
+  */
+  void close();
+
+  //! Return the MIDI file format (0, 1, or 2).
+  int getFileFormat() const { return format_; }
+
+  //! Return the number of tracks written (or started) so far.
+  unsigned int getNumberOfTracks() const { return nTracks_; }
+
+  //! Return the division (ticks per quarter note).
+  int getDivision() const { return division_; }
+
+  //! Start a new track (any open track is ended first).
+  void startTrack();
+
+  //! Write an End of Track meta-event after the given delta-time and patch the track length.
+  void endTrack( unsigned long ticks = 0 );
+
+  //! Write a MIDI channel event after the given delta-time.
+  /*!
+      Program change and channel pressure events take only data1.
+      The status byte is left out when it repeats (running status).
+  */
+  void writeEvent( unsigned long ticks, unsigned char status,
+                   unsigned char data1, unsigned char data2 = 0 );
+
+  //! Write a meta-event after the given delta-time.
+  void writeMeta( unsigned long ticks, unsigned char type,
+                  const unsigned char *data, unsigned long length );
+
+  //! Write a text meta-event (track name, marker, etc.) after the given delta-time.
+  void writeText( unsigned long ticks, unsigned char type, const std::string &text );
+
+  //! Write a "Set Tempo" meta-event after the given delta-time.
+  void writeTempo( unsigned long ticks, double bpm );
+
+  //! Write a "Time Signature" meta-event after the given delta-time.
+  /*!
+      The denominator is the note value of a beat (4 for quarter
+      notes) and must be a power of two.
+  */
+  void writeTimeSignature( unsigned long ticks, unsigned char numerator,
+                           unsigned char denominator );
+
+ protected:
+  enum { BUFFER_SIZE = 4096 };
+
+  void put( unsigned char byte ) {
+    if ( bufferCount_ == BUFFER_SIZE ) flush();
+    buffer_[bufferCount_++] = byte;
+  }
+  void putVariableLength( unsigned long value );
+  void put32( unsigned long value );
+  void flush();
+  void patch32( long offset, unsigned long value );
+
+  FILE *file_;
+  std::string fileName_;
+  int format_;
+  int division_;
+  unsigned int nTracks_;
+  bool inTrack_;
+  long position_;            // bytes flushed to the file so far
+  long trackOffset_;         // file offset of the open track's data
+  unsigned char status_;     // running status (0 for none)
+  unsigned char buffer_[BUFFER_SIZE];
+  unsigned int bufferCount_;
+};
+
+} // stk namespace
+
+#endif
@@ -36,11 +36,20 @@
 //   date: 2013
 //-----------------------------------------------------------------------------
 #include "x-audio.h"
+#include "x-gfx.h"
 #include "RtAudio.h"
 #include <iostream>
 using namespace std;
 
 
+// full memory barrier (for the clock seqlock)
+#define X_AUDIO_BARRIER() __sync_synchronize()
+// clock offset smoothing (per callback) when it drifts later
+#define X_AUDIO_CLOCK_SMOOTH 0.01
+// callback lateness (in buffers) past which the clock is reset
+#define X_AUDIO_CLOCK_RESET 4
+
+
 
 
 // static instantiation
@@ -51,6 +60,11 @@ SAMPLE * XAudioIO::o_output_buffer;
 unsigned int XAudioIO::o_num_frames;
 unsigned int XAudioIO::o_num_channels;
 unsigned int XAudioIO::o_srate;
+volatile unsigned int XAudioIO::o_clock_seq;
+volatile double XAudioIO::o_clock_offset;
+volatile double XAudioIO::o_clock_latency;
+double XAudioIO::o_buffer_sample;
+long XAudioIO::o_latency_frames;
 
 
 
@@ -95,6 +109,25 @@ int XAudioIO::cb( SAMPLE * outputBuffer, SAMPLE * inputBuffer,
         return 0;
     }
     
+    // sample position of this buffer (stream time counts frames handed out)
+    o_buffer_sample = streamTime * o_srate;
+    // this buffer will be heard after one buffer plus the device latency
+    double latency = (double)(numFrames + o_latency_frames) / o_srate;
+    // offset from stream time to monotonic time, as seen in this callback
+    double offset = XGfx::getMonotonicTime() - streamTime;
+    // callbacks only ever wake up late; track the earliest, creep to follow drift
+    double current = o_clock_offset;
+    if( o_clock_seq != 0 && offset > current &&
+        offset - current < X_AUDIO_CLOCK_RESET * (double)numFrames / o_srate )
+        offset = current + (offset - current) * X_AUDIO_CLOCK_SMOOTH;
+    // publish (odd sequence while writing)
+    o_clock_seq = o_clock_seq + 1;
+    X_AUDIO_BARRIER();
+    o_clock_offset = offset;
+    o_clock_latency = latency;
+    X_AUDIO_BARRIER();
+    o_clock_seq = o_clock_seq + 1;
+
     // copy
     memcpy( o_input_buffer, inputBuffer, sizeof(SAMPLE)*numFrames*o_num_channels );
     // call back
@@ -216,6 +249,8 @@ bool XAudioIO::start()
     try {
         // try to start the stream
         o_audio->startStream();
+        // device latency, in frames (0 if the API doesn't know)
+        o_latency_frames = o_audio->getStreamLatency();
     } catch ( RtError& e ) {
         // error message
         cerr << "[x-audio]: cannot start real-time audio I/O..." << endl;
@@ -252,3 +287,94 @@ void XAudioIO::stop()
         cerr << "[x-audio]: | - " << e.getMessage() << endl;
     }
 }
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: readClock()
+// desc: read the clock (any thread); returns false if not running yet
+//-----------------------------------------------------------------------------
+bool XAudioIO::readClock( double & offset, double & latency )
+{
+    unsigned int seq;
+
+    do {
+        // wait out a write in progress
+        while( (seq = o_clock_seq) & 1 ) { }
+        X_AUDIO_BARRIER();
+        // copy
+        offset = o_clock_offset;
+        latency = o_clock_latency;
+        X_AUDIO_BARRIER();
+    } while( seq != o_clock_seq );
+
+    return seq != 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: clockSample()
+// desc: sample position being computed at a monotonic time
+//-----------------------------------------------------------------------------
+double XAudioIO::clockSample( double when )
+{
+    double offset, latency;
+    // not running
+    if( !readClock( offset, latency ) ) return 0;
+
+    // map
+    return (when - offset) * o_srate;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: audibleSample()
+// desc: sample position audible at a monotonic time
+//-----------------------------------------------------------------------------
+double XAudioIO::audibleSample( double when )
+{
+    double offset, latency;
+    // not running: nothing audible yet
+    if( !readClock( offset, latency ) ) return 0;
+
+    // map
+    return (when - offset - latency) * o_srate;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: audibleTime()
+// desc: monotonic time at which a sample position is audible
+//-----------------------------------------------------------------------------
+double XAudioIO::audibleTime( double sample )
+{
+    double offset, latency;
+    // not running
+    if( !readClock( offset, latency ) ) return 0;
+
+    // map
+    return sample / o_srate + offset + latency;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: latency()
+// desc: output latency in seconds (device + one buffer)
+//-----------------------------------------------------------------------------
+double XAudioIO::latency()
+{
+    double offset, latency;
+    // read
+    readClock( offset, latency );
+
+    return latency;
+}
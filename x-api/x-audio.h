@@ -81,6 +81,20 @@ public:
     static unsigned int numChannels() { return o_num_channels; }
     // get framesize
     static unsigned int framesize() { return o_num_frames; }
+
+public:
+    // has the audio clock been set by a callback yet?
+    static bool isClockRunning() { return o_clock_seq != 0; }
+    // sample position of the buffer being computed (audio thread only)
+    static double bufferSample() { return o_buffer_sample; }
+    // sample position being computed at a monotonic time (e.g., of an input event)
+    static double clockSample( double when );
+    // sample position audible at a monotonic time (see XGfx::getMonotonicTime())
+    static double audibleSample( double when );
+    // monotonic time at which a sample position is audible
+    static double audibleTime( double sample );
+    // output latency in seconds (device + one buffer)
+    static double latency();
     
 public:
     // internal callback (should not be used by client)
@@ -95,6 +109,18 @@ protected:
     static unsigned int o_num_frames;
     static unsigned int o_num_channels;
     static unsigned int o_srate;
+
+protected:
+    // read the clock (any thread); returns false if not running yet
+    static bool readClock( double & offset, double & latency );
+
+protected:
+    // audio clock: monotonic time = sample / srate + offset (seqlock)
+    static volatile unsigned int o_clock_seq;
+    static volatile double o_clock_offset;
+    static volatile double o_clock_latency;
+    static double o_buffer_sample;
+    static long o_latency_frames;
 };
 
 
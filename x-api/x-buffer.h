@@ -39,8 +39,12 @@
 #ifndef __MCD_X_BUFFER_H__
 #define __MCD_X_BUFFER_H__
 
+#include "x-def.h"
 #include <iostream>
 
+// full memory barrier (for XLockFreeQueue)
+#define X_BUFFER_BARRIER() __sync_synchronize()
+
 
 
 
@@ -383,5 +387,175 @@ long XCircleBuffer<T>::pop( long numItems )
 
 
 
+//-----------------------------------------------------------------------------
+// name: class XLockFreeQueue
+// desc: single producer / single consumer queue; put() on one thread and
+//       peek()/pop() on another, with no locks (e.g., into the audio thread)
+//-----------------------------------------------------------------------------
+template <typename T>
+class XLockFreeQueue
+{
+public:
+    XLockFreeQueue( long length = 0 );
+    ~XLockFreeQueue();
+
+public:
+    // reset capacity (rounded up to a power of two; not while in use)
+    void init( long length );
+    // get capacity
+    long length() const { return m_length; }
+
+public:
+    // producer: copy an item in; returns false (and drops it) if full
+    bool put( const T & item );
+    // consumer: copy the oldest item out without removing it
+    bool peek( T & item ) const;
+    // consumer: remove the oldest item
+    bool pop();
+    // number of elements (exact only on the consumer or producer side)
+    long numElements() const { return (long)(m_writeIndex - m_readIndex); }
+    // are there more elements?
+    bool more() const { return m_writeIndex != m_readIndex; }
+
+protected:
+    // the buffer
+    T * m_buffer;
+    // the buffer length (capacity, power of two)
+    long m_length;
+    // ever-increasing indices (written by the producer / consumer only)
+    volatile unsigned long m_writeIndex;
+    volatile unsigned long m_readIndex;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XLockFreeQueue()
+// desc: constructor
+//-----------------------------------------------------------------------------
+template <typename T>
+XLockFreeQueue<T>::XLockFreeQueue( long length )
+{
+    // zero out first
+    m_buffer = NULL;
+    m_length = 0;
+    m_writeIndex = m_readIndex = 0;
+
+    // call init
+    this->init( length );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~XLockFreeQueue()
+// desc: destructor
+//-----------------------------------------------------------------------------
+template <typename T>
+XLockFreeQueue<T>::~XLockFreeQueue()
+{
+    SAFE_DELETE_ARRAY( m_buffer );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: init()
+// desc: reset capacity (rounded up to a power of two; not while in use)
+//-----------------------------------------------------------------------------
+template <typename T>
+void XLockFreeQueue<T>::init( long length )
+{
+    // clean up
+    SAFE_DELETE_ARRAY( m_buffer );
+    m_length = 0;
+    m_writeIndex = m_readIndex = 0;
+
+    // sanity check
+    if( length <= 0 ) return;
+
+    // round up (so indices can wrap with a mask)
+    long size = 1;
+    while( size < length ) size <<= 1;
+
+    // allocate
+    m_buffer = new T[size];
+    m_length = size;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: put()
+// desc: producer: copy an item in; returns false (and drops it) if full
+//-----------------------------------------------------------------------------
+template <typename T>
+bool XLockFreeQueue<T>::put( const T & item )
+{
+    // sanity check
+    if( m_buffer == NULL ) return false;
+
+    // full?
+    unsigned long write = m_writeIndex;
+    if( write - m_readIndex >= (unsigned long)m_length ) return false;
+
+    // copy it
+    m_buffer[write & (m_length - 1)] = item;
+    // publish (item before index)
+    X_BUFFER_BARRIER();
+    m_writeIndex = write + 1;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: peek()
+// desc: consumer: copy the oldest item out without removing it
+//-----------------------------------------------------------------------------
+template <typename T>
+bool XLockFreeQueue<T>::peek( T & item ) const
+{
+    // empty?
+    unsigned long read = m_readIndex;
+    if( read == m_writeIndex ) return false;
+    // index before item
+    X_BUFFER_BARRIER();
+
+    // copy it
+    item = m_buffer[read & (m_length - 1)];
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: pop()
+// desc: consumer: remove the oldest item
+//-----------------------------------------------------------------------------
+template <typename T>
+bool XLockFreeQueue<T>::pop()
+{
+    // empty?
+    unsigned long read = m_readIndex;
+    if( read == m_writeIndex ) return false;
+
+    // done reading the slot before handing it back
+    X_BUFFER_BARRIER();
+    m_readIndex = read + 1;
+
+    return true;
+}
+
+
+
 
 #endif
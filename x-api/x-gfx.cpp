@@ -38,7 +38,11 @@
 //-----------------------------------------------------------------------------
 #include "x-gfx.h"
 #include <math.h>
+#include <time.h>
 #include <iostream>
+#if defined(__APPLE__)
+#include <mach/mach_time.h>
+#endif
 using namespace std;
 
 
@@ -53,20 +57,20 @@ void XGfx::drawTexture( const XTexture * tex )
     // sanity check
     if( !tex ) return;
 
-    glEnable( GL_TEXTURE_2D );
-    glEnable( GL_BLEND );
-    glBlendFunc( tex->sfactor, tex->dfactor );
+    enable( GL_TEXTURE_2D );
+    enable( GL_BLEND );
+    blendFunc( tex->sfactor, tex->dfactor );
 
     // check
     if( tex->enableDepth ) glDepthMask( GL_TRUE ); // glEnable( GL_DEPTH_TEST );
     else glDepthMask( GL_FALSE ); // glDisable( GL_DEPTH_TEST );
-    if( tex->enableLighting ) glEnable( GL_LIGHTING );
-    else glDisable( GL_LIGHTING );
+    if( tex->enableLighting ) enable( GL_LIGHTING );
+    else disable( GL_LIGHTING );
 
     // set color
     glColor4fv( tex->color );
     // bind to texture
-    glBindTexture( GL_TEXTURE_2D, tex->name );
+    bindTexture( GL_TEXTURE_2D, tex->name );
     
     // centering
     GLfloat val = tex->diameter / 2;
@@ -92,15 +96,17 @@ void XGfx::drawTexture( const XTexture * tex )
     glTexCoord2f( 0, 1 );
     glVertex3f( -w, h, 0 );
     glEnd();
+    // count it
+    countDrawCalls();
     
-    glDisable( GL_TEXTURE_2D );
-    glDisable( GL_BLEND );
+    disable( GL_TEXTURE_2D );
+    disable( GL_BLEND );
     
     // check
     if( tex->enableDepth == false ) // glDepthMask( GL_FALSE ); // glDisable( GL_DEPTH_TEST );
         glDepthMask( GL_TRUE ); // glEnable( GL_DEPTH_TEST );
-    if( tex->enableLighting ) glDisable( GL_LIGHTING );
-    else glEnable( GL_LIGHTING );
+    if( tex->enableLighting ) disable( GL_LIGHTING );
+    else enable( GL_LIGHTING );
 }
 
 
@@ -198,6 +204,9 @@ void XGfx::resetCurrentTime()
 //-----------------------------------------------------------------------------
 GLfloat XGfx::delta()
 {
+    // fixed
+    if( ourFixedDelta > 0 ) return ourFixedDelta * ourDeltaFactor;
+
     double prev = ourPrevTime.tv_sec + (double)ourPrevTime.tv_usec / 1000000;
     double curr = ourCurrTime.tv_sec + (double)ourCurrTime.tv_usec / 1000000;
     // first 0
@@ -219,7 +228,44 @@ void XGfx::setDeltaFactor( GLfloat factor )
 
 
 
+//-----------------------------------------------------------------------------
+// name: setFixedDelta()
+// desc: use a fixed time delta for simulation (0 to go back to wall-clock)
+//-----------------------------------------------------------------------------
+void XGfx::setFixedDelta( GLfloat delta )
+{
+    ourFixedDelta = delta;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getMonotonicTime()
+// desc: get monotonic time in seconds, for measuring intervals
+//-----------------------------------------------------------------------------
+double XGfx::getMonotonicTime()
+{
+#if defined(__APPLE__)
+    static mach_timebase_info_data_t info = { 0, 0 };
+    // first time
+    if( info.denom == 0 ) mach_timebase_info( &info );
+    // convert to seconds
+    return (double)mach_absolute_time() * info.numer / info.denom / 1000000000.0;
+#else
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec + (double)ts.tv_nsec / 1000000000.0;
+#endif
+}
+
+
+
+
 // static instantiation
 struct timeval XGfx::ourCurrTime;
 struct timeval XGfx::ourPrevTime;
 GLfloat XGfx::ourDeltaFactor = 1.0f;
+GLfloat XGfx::ourFixedDelta = 0.0f;
+unsigned long XGfx::ourNumDrawCalls = 0;
+unsigned long XGfx::ourNumStateChanges = 0;
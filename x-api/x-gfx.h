@@ -113,9 +113,13 @@ public:
     static GLfloat delta();
     // set delta factor
     static void setDeltaFactor( GLfloat factor );
-    // set desired framerate
+    // use a fixed delta instead of wall-clock (0 to disable)
+    static void setFixedDelta( GLfloat delta );
+    // get monotonic time in seconds (for profiling; not tied to simulation)
+    static double getMonotonicTime();
     
 
+
 public:
     // point in triangle test (2D)
     static bool isPointInTriangle2D( const Vector3D & pt, const Vector3D & a, 
@@ -135,11 +139,29 @@ public:
     // draw texture
     static void drawTextureUV( GLfloat x1, GLfloat y1, GLfloat x2, GLfloat y2,
                                GLfloat u1, GLfloat v1, GLfloat u2, GLfloat v2 );
+
+public:
+    // counting wrappers for the render path (draw calls / state changes)
+    static void enable( GLenum cap ) { glEnable( cap ); ourNumStateChanges++; }
+    static void disable( GLenum cap ) { glDisable( cap ); ourNumStateChanges++; }
+    static void blendFunc( GLenum sfactor, GLenum dfactor )
+    { glBlendFunc( sfactor, dfactor ); ourNumStateChanges++; }
+    static void bindTexture( GLenum target, GLuint texture )
+    { glBindTexture( target, texture ); ourNumStateChanges++; }
+    static void drawArrays( GLenum mode, GLint first, GLsizei count )
+    { glDrawArrays( mode, first, count ); ourNumDrawCalls++; }
+    // count draw calls not made through drawArrays (glBegin/glEnd, glut shapes)
+    static void countDrawCalls( unsigned long n = 1 ) { ourNumDrawCalls += n; }
+    // reset counters (once per frame)
+    static void resetCounters() { ourNumDrawCalls = ourNumStateChanges = 0; }
     
 public:
     static struct timeval ourPrevTime;
     static struct timeval ourCurrTime;
     static GLfloat ourDeltaFactor;
+    static GLfloat ourFixedDelta;
+    static unsigned long ourNumDrawCalls;
+    static unsigned long ourNumStateChanges;
 };
 
 
@@ -39,11 +39,13 @@
 #define __MCD_X_LOADLUM_H__
 
 
+// numThreads == 0: one per core (small images always use one)
 extern unsigned char * loadLuminance(
     const char * name,
     int * width,
     int * height,
-    int * components
+    int * components,
+    unsigned int numThreads = 0
 );
 
 
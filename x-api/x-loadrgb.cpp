@@ -39,256 +39,38 @@
 #include <stdlib.h>
 #include <memory.h>
 #include "x-loadrgb.h"
+#include "x-sgi.h"
 
 
 
 
 //-----------------------------------------------------------------------------
-/* texture loading - by David Blythe, SGI */
-/* a simplistic routine for reading an SGI .rgb image file. */
+// Name: ge_read_rgb( )
+// Desc: reads an SGI image as RGBA (ge: 2014 -- from a memory mapping,
+//       rows in parallel for large images; see x-sgi)
 //-----------------------------------------------------------------------------
-
-void
-bwtorgba(unsigned char *b,unsigned char *l,int n) {
-    while(n--) {
-        l[0] = *b;
-        l[1] = *b;
-        l[2] = *b;
-        l[3] = 0xff;
-        l += 4; b++;
-    }
-}
-
-void
-rgbtorgba(unsigned char *r,unsigned char *g,unsigned char *b,
-          unsigned char *l,int n) {
-    while(n--) {
-        l[0] = r[0];
-        l[1] = g[0];
-        l[2] = b[0];
-        l[3] = 0xff;
-        l += 4; r++; g++; b++;
-    }
-}
-
-void
-rgbatorgba(unsigned char *r,unsigned char *g,unsigned char *b,
-           unsigned char *a,unsigned char *l,int n) {
-    while(n--) {
-        l[0] = r[0];
-        l[1] = g[0];
-        l[2] = b[0];
-        l[3] = a[0];
-        l += 4; r++; g++; b++; a++;
-    }
-}
-
-typedef struct _ImageRec {
-    unsigned short imagic;
-    unsigned short type;
-    unsigned short dim;
-    unsigned short xsize, ysize, zsize;
-    unsigned int min, max;
-    unsigned int wasteBytes;
-    char name[80];
-    unsigned long colorMap;
-    FILE *file;
-    unsigned char *tmp, *tmpR, *tmpG, *tmpB;
-    unsigned long rleEnd;
-    unsigned int *rowStart;
-    int *rowSize;
-} ImageRec;
-
-static void
-ConvertShort(unsigned short *array, unsigned int length) {
-    unsigned short b1, b2;
-    unsigned char *ptr;
-    
-    ptr = (unsigned char *)array;
-    while (length--) {
-        b1 = *ptr++;
-        b2 = *ptr++;
-        *array++ = (b1 << 8) | (b2);
-    }
-}
-
-static void
-ConvertUint(unsigned *array, unsigned int length) {
-    unsigned int b1, b2, b3, b4;
-    unsigned char *ptr;
-    
-    ptr = (unsigned char *)array;
-    while (length--) {
-        b1 = *ptr++;
-        b2 = *ptr++;
-        b3 = *ptr++;
-        b4 = *ptr++;
-        *array++ = (b1 << 24) | (b2 << 16) | (b3 << 8) | (b4);
-    }
-}
-
-static ImageRec *ImageOpen(const char *fileName)
+unsigned * ge_read_rgb( const char * name, int * width, int * height,
+                        int * components, unsigned int numThreads )
 {
-    union {
-        int testWord;
-        char testByte[4];
-    } endianTest;
-    ImageRec *image;
-    int swapFlag;
-    int x;
-    
-    endianTest.testWord = 1;
-    if (endianTest.testByte[0] == 1) {
-        swapFlag = 1;
-    } else {
-        swapFlag = 0;
-    }
+    XSGIImage image;
+    unsigned * base;
     
-    image = (ImageRec *)malloc(sizeof(ImageRec));
-    if (image == NULL) {
-        fprintf(stderr, "Out of memory!\n");
-        exit(1);
-    }
-    if ((image->file = fopen(fileName, "rb")) == NULL) {
-        perror(fileName);
-        //exit(1);
+    if( !xsgi_open( name, &image ) )
         return NULL;
-    }
-    
-    fread(image, 1, 12, image->file);
+    (*width) = image.width;
+    (*height) = image.height;
+    (*components) = image.depth;
     
-    if (swapFlag) {
-        ConvertShort(&image->imagic, 6);
-    }
-    
-    image->tmp = (unsigned char *)malloc(image->xsize*256);
-    image->tmpR = (unsigned char *)malloc(image->xsize*256);
-    image->tmpG = (unsigned char *)malloc(image->xsize*256);
-    image->tmpB = (unsigned char *)malloc(image->xsize*256);
-    if (image->tmp == NULL || image->tmpR == NULL || image->tmpG == NULL ||
-        image->tmpB == NULL) {
-        fprintf(stderr, "Out of memory!\n");
-        exit(1);
-    }
-    
-    if ((image->type & 0xFF00) == 0x0100) {
-        x = image->ysize * image->zsize * (int) sizeof(unsigned);
-        image->rowStart = (unsigned *)malloc(x);
-        image->rowSize = (int *)malloc(x);
-        if (image->rowStart == NULL || image->rowSize == NULL) {
-            fprintf(stderr, "Out of memory!\n");
-            exit(1);
-        }
-        image->rleEnd = 512 + (2 * x);
-        fseek(image->file, 512, SEEK_SET);
-        fread(image->rowStart, 1, x, image->file);
-        fread(image->rowSize, 1, x, image->file);
-        if (swapFlag) {
-            ConvertUint(image->rowStart, x/(int) sizeof(unsigned));
-            ConvertUint((unsigned *)image->rowSize, x/(int) sizeof(int));
-        }
-    }
-    return image;
-}
-
-static void
-ImageClose(ImageRec *image) {
-    fclose(image->file);
-    free(image->tmp);
-    free(image->tmpR);
-    free(image->tmpG);
-    free(image->tmpB);
-    free(image);
-}
-
-static void
-ImageGetRow(ImageRec *image, unsigned char *buf, int y, int z) {
-    unsigned char *iPtr, *oPtr, pixel;
-    int count;
-    
-    if ((image->type & 0xFF00) == 0x0100) {
-        fseek(image->file, (long) image->rowStart[y+z*image->ysize], 
-              SEEK_SET);
-        fread(image->tmp, 1, (unsigned int)image->rowSize[y+z*image->ysize],
-              image->file);
-        
-        iPtr = image->tmp;
-        oPtr = buf;
-        for (;;) {
-            pixel = *iPtr++;
-            count = (int)(pixel & 0x7F);
-            if (!count) {
-                return;
-            }
-            if (pixel & 0x80) {
-                while (count--) {
-                    *oPtr++ = *iPtr++;
-                }
-            } else {
-                pixel = *iPtr++;
-                while (count--) {
-                    *oPtr++ = pixel;
-                }
-            }
-        }
-    } else {
-        fseek(image->file, 
-              512+(y*image->xsize)+(z*image->xsize*image->ysize),
-              SEEK_SET);
-        fread(buf, 1, image->xsize, image->file);
-    }
-}
-
-unsigned * ge_read_rgb( const char * name, int * width, int * height, int * components)
-{
-    unsigned *base, *lptr;
-    unsigned char *rbuf, *gbuf, *bbuf, *abuf;
-    ImageRec *image;
-    int y;
-    
-    image = ImageOpen(name);
-    
-    if(!image)
-        return NULL;
-    (*width)=image->xsize;
-    (*height)=image->ysize;
-    (*components)=image->zsize;
-    base = (unsigned *)malloc(image->xsize*image->ysize*sizeof(unsigned));
-    rbuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    gbuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    bbuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    abuf = (unsigned char *)malloc(image->xsize*sizeof(unsigned char));
-    if(!base || !rbuf || !gbuf || !bbuf)
-        return NULL;
-    lptr = base;
-    for(y=0; y<image->ysize; y++) {
-        if(image->zsize>=4) {
-            ImageGetRow(image,rbuf,y,0);
-            ImageGetRow(image,gbuf,y,1);
-            ImageGetRow(image,bbuf,y,2);
-            ImageGetRow(image,abuf,y,3);
-            rgbatorgba(rbuf,gbuf,bbuf,abuf,
-                       (unsigned char *)lptr,image->xsize);
-            lptr += image->xsize;
-        } else if(image->zsize==3) {
-            ImageGetRow(image,rbuf,y,0);
-            ImageGetRow(image,gbuf,y,1);
-            ImageGetRow(image,bbuf,y,2);
-            rgbtorgba(rbuf,gbuf,bbuf,(unsigned char *)lptr,image->xsize);
-            lptr += image->xsize;
-        } else {
-            ImageGetRow(image,rbuf,y,0);
-            bwtorgba(rbuf,(unsigned char *)lptr,image->xsize);
-            lptr += image->xsize;
-        }
+    base = (unsigned *)malloc( image.width * image.height * sizeof(unsigned) );
+    if( base && !xsgi_decode( &image, (unsigned char *)base, 4, numThreads ) )
+    {
+        fprintf( stderr, "[x-loadrgb]: '%s' is corrupt...\n", name );
+        free( base );
+        base = NULL;
     }
-    ImageClose(image);
-    free(rbuf);
-    free(gbuf);
-    free(bbuf);
-    free(abuf);
     
-    return (unsigned *) base;
+    xsgi_close( &image );
+    return base;
 }
 
 
@@ -298,7 +80,8 @@ unsigned * ge_read_rgb( const char * name, int * width, int * height, int * comp
 // Name: ge_read_image( )
 // Desc: reads an RGB file into pImgData
 //-----------------------------------------------------------------------------
-bool ge_read_image( const char * filename, GeImageData * pImgData )
+bool ge_read_image( const char * filename, GeImageData * pImgData,
+                    unsigned int numThreads )
 {
     int c;
     if( !filename || !pImgData )
@@ -308,7 +91,7 @@ bool ge_read_image( const char * filename, GeImageData * pImgData )
     memset( pImgData, 0, sizeof( GeImageData ) );
     
     pImgData->bits = ge_read_rgb( filename, &pImgData->width, 
-                                 &pImgData->height, &c );
+                                 &pImgData->height, &c, numThreads );
     
     return ( pImgData->bits != 0 );
 }
\ No newline at end of file
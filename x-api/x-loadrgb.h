@@ -56,7 +56,9 @@ struct GeImageData
     { }
 };
 
-bool ge_read_image( const char * filename, GeImageData * pImgData );
+// numThreads == 0: one per core (small images always use one)
+bool ge_read_image( const char * filename, GeImageData * pImgData,
+                    unsigned int numThreads = 0 );
 
 
 
@@ -0,0 +1,506 @@
+//-----------------------------------------------------------------------------
+// name: x-midi.cpp
+// desc: MIDI input/output abstraction (ALSA sequencer virtual ports)
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "x-midi.h"
+#include "x-gfx.h"
+#include <iostream>
+#if defined(__LINUX_ALSA__)
+#include <alsa/asoundlib.h>
+#include <poll.h>
+#include <semaphore.h>
+#include <time.h>
+#endif
+using namespace std;
+
+
+// how often the MIDI threads check for close() (milliseconds)
+#define X_MIDI_POLL_MS 50
+
+
+
+
+// static instantiation
+XThread * XMidiIn::o_thread;
+volatile bool XMidiIn::o_quit;
+XMidiCallback XMidiIn::o_callback;
+void * XMidiIn::o_user_data;
+int XMidiIn::o_client = -1;
+int XMidiIn::o_port = -1;
+XThread * XMidiOut::o_thread;
+volatile bool XMidiOut::o_quit;
+XLockFreeQueue<XMidiMessage> XMidiOut::o_queue( X_MIDI_OUT_QUEUE_SIZE );
+int XMidiOut::o_client = -1;
+int XMidiOut::o_port = -1;
+
+#if defined(__LINUX_ALSA__)
+// the sequencer handles (one client each way)
+static snd_seq_t * g_seq = NULL;
+static snd_seq_t * g_seqOut = NULL;
+// posted by send() (audio thread: no locks) and close()
+static sem_t g_outReady;
+#endif
+
+
+
+
+#if defined(__LINUX_ALSA__)
+//-----------------------------------------------------------------------------
+// name: open()
+// desc: open a virtual input port and start reading it
+//-----------------------------------------------------------------------------
+bool XMidiIn::open( const char * name, XMidiCallback cb, void * userData )
+{
+    // check if already open
+    if( o_thread != NULL )
+    {
+        // error message
+        cerr << "[x-midi]: already open..." << endl;
+        return false;
+    }
+
+    // open the sequencer (non-blocking; the thread polls)
+    int result = snd_seq_open( &g_seq, "default", SND_SEQ_OPEN_INPUT, SND_SEQ_NONBLOCK );
+    if( result < 0 )
+    {
+        // error message
+        cerr << "[x-midi]: cannot open ALSA sequencer: " << snd_strerror( result ) << endl;
+        g_seq = NULL;
+        return false;
+    }
+    snd_seq_set_client_name( g_seq, name );
+
+    // the port other clients write to
+    o_port = snd_seq_create_simple_port( g_seq, name,
+        SND_SEQ_PORT_CAP_WRITE | SND_SEQ_PORT_CAP_SUBS_WRITE,
+        SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION );
+    if( o_port < 0 )
+    {
+        // error message
+        cerr << "[x-midi]: cannot create MIDI port: " << snd_strerror( o_port ) << endl;
+        snd_seq_close( g_seq );
+        g_seq = NULL;
+        o_port = -1;
+        return false;
+    }
+    o_client = snd_seq_client_id( g_seq );
+
+    // save
+    o_callback = cb;
+    o_user_data = userData;
+    o_quit = false;
+
+    // start reading
+    o_thread = new XThread();
+    if( !o_thread->start( loop, NULL ) )
+    {
+        // error message
+        cerr << "[x-midi]: cannot start MIDI thread..." << endl;
+        SAFE_DELETE( o_thread );
+        snd_seq_close( g_seq );
+        g_seq = NULL;
+        o_client = o_port = -1;
+        return false;
+    }
+
+    // log
+    cerr << "[x-midi]: MIDI input on " << o_client << ":" << o_port << endl;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: close()
+// desc: stop reading and close the port
+//-----------------------------------------------------------------------------
+void XMidiIn::close()
+{
+    // not open
+    if( o_thread == NULL ) return;
+
+    // stop the thread (within one poll)
+    o_quit = true;
+    o_thread->join();
+    SAFE_DELETE( o_thread );
+
+    // close
+    snd_seq_close( g_seq );
+    g_seq = NULL;
+    o_client = o_port = -1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: loop()
+// desc: the MIDI thread: wait for events, stamp and hand each one on
+//-----------------------------------------------------------------------------
+THREAD_RETURN THREAD_TYPE XMidiIn::loop( void * /* data */ )
+{
+    // what to wait on
+    int count = snd_seq_poll_descriptors_count( g_seq, POLLIN );
+    struct pollfd * fds = new struct pollfd[count];
+    snd_seq_poll_descriptors( g_seq, fds, count, POLLIN );
+
+    while( !o_quit )
+    {
+        // wait for input (or time to check for close)
+        if( poll( fds, count, X_MIDI_POLL_MS ) <= 0 ) continue;
+
+        // everything that is there
+        snd_seq_event_t * ev = NULL;
+        int result;
+        while( (result = snd_seq_event_input( g_seq, &ev )) >= 0 || result == -ENOSPC )
+        {
+            // overrun: some were dropped, keep going
+            if( result == -ENOSPC || ev == NULL ) continue;
+
+            // to MIDI bytes
+            XMidiMessage message;
+            message.when = XGfx::getMonotonicTime();
+            message.data1 = message.data2 = 0;
+            switch( ev->type )
+            {
+                case SND_SEQ_EVENT_NOTEON:
+                    message.status = 0x90 | (ev->data.note.channel & 0x0f);
+                    message.data1 = ev->data.note.note & 0x7f;
+                    message.data2 = ev->data.note.velocity & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_NOTEOFF:
+                    message.status = 0x80 | (ev->data.note.channel & 0x0f);
+                    message.data1 = ev->data.note.note & 0x7f;
+                    message.data2 = ev->data.note.velocity & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_KEYPRESS:
+                    message.status = 0xa0 | (ev->data.note.channel & 0x0f);
+                    message.data1 = ev->data.note.note & 0x7f;
+                    message.data2 = ev->data.note.velocity & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_CONTROLLER:
+                    message.status = 0xb0 | (ev->data.control.channel & 0x0f);
+                    message.data1 = ev->data.control.param & 0x7f;
+                    message.data2 = ev->data.control.value & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_PGMCHANGE:
+                    message.status = 0xc0 | (ev->data.control.channel & 0x0f);
+                    message.data1 = ev->data.control.value & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_CHANPRESS:
+                    message.status = 0xd0 | (ev->data.control.channel & 0x0f);
+                    message.data1 = ev->data.control.value & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_PITCHBEND:
+                    message.status = 0xe0 | (ev->data.control.channel & 0x0f);
+                    message.data1 = (ev->data.control.value + 8192) & 0x7f;
+                    message.data2 = ((ev->data.control.value + 8192) >> 7) & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_SONGPOS:
+                    message.status = 0xf2;
+                    message.data1 = ev->data.control.value & 0x7f;
+                    message.data2 = (ev->data.control.value >> 7) & 0x7f;
+                    break;
+                case SND_SEQ_EVENT_CLOCK:
+                    message.status = 0xf8;
+                    break;
+                case SND_SEQ_EVENT_START:
+                    message.status = 0xfa;
+                    break;
+                case SND_SEQ_EVENT_CONTINUE:
+                    message.status = 0xfb;
+                    break;
+                case SND_SEQ_EVENT_STOP:
+                    message.status = 0xfc;
+                    break;
+                default:
+                    // sysex, or nothing MIDI
+                    continue;
+            }
+
+            // hand it on
+            if( o_callback ) o_callback( message, o_user_data );
+        }
+    }
+
+    // clean up
+    delete [] fds;
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: open()
+// desc: open a virtual output port and start the sending thread
+//-----------------------------------------------------------------------------
+bool XMidiOut::open( const char * name )
+{
+    // check if already open
+    if( o_thread != NULL )
+    {
+        // error message
+        cerr << "[x-midi]: output already open..." << endl;
+        return false;
+    }
+
+    // open the sequencer
+    int result = snd_seq_open( &g_seqOut, "default", SND_SEQ_OPEN_OUTPUT, 0 );
+    if( result < 0 )
+    {
+        // error message
+        cerr << "[x-midi]: cannot open ALSA sequencer: " << snd_strerror( result ) << endl;
+        g_seqOut = NULL;
+        return false;
+    }
+    snd_seq_set_client_name( g_seqOut, name );
+
+    // the port other clients read from
+    o_port = snd_seq_create_simple_port( g_seqOut, name,
+        SND_SEQ_PORT_CAP_READ | SND_SEQ_PORT_CAP_SUBS_READ,
+        SND_SEQ_PORT_TYPE_MIDI_GENERIC | SND_SEQ_PORT_TYPE_APPLICATION );
+    if( o_port < 0 )
+    {
+        // error message
+        cerr << "[x-midi]: cannot create MIDI port: " << snd_strerror( o_port ) << endl;
+        snd_seq_close( g_seqOut );
+        g_seqOut = NULL;
+        o_port = -1;
+        return false;
+    }
+    o_client = snd_seq_client_id( g_seqOut );
+
+    // start sending
+    o_quit = false;
+    sem_init( &g_outReady, 0, 0 );
+    o_thread = new XThread();
+    if( !o_thread->start( loop, NULL ) )
+    {
+        // error message
+        cerr << "[x-midi]: cannot start MIDI output thread..." << endl;
+        SAFE_DELETE( o_thread );
+        sem_destroy( &g_outReady );
+        snd_seq_close( g_seqOut );
+        g_seqOut = NULL;
+        o_client = o_port = -1;
+        return false;
+    }
+
+    // log
+    cerr << "[x-midi]: MIDI output on " << o_client << ":" << o_port << endl;
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: close()
+// desc: stop sending and close the port
+//-----------------------------------------------------------------------------
+void XMidiOut::close()
+{
+    // not open
+    if( o_thread == NULL ) return;
+
+    // stop the thread (wake it if idle; else within one wait)
+    o_quit = true;
+    sem_post( &g_outReady );
+    o_thread->join();
+    SAFE_DELETE( o_thread );
+    sem_destroy( &g_outReady );
+
+    // close
+    snd_seq_close( g_seqOut );
+    g_seqOut = NULL;
+    o_client = o_port = -1;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: send()
+// desc: queue a message to go out at message.when
+//-----------------------------------------------------------------------------
+bool XMidiOut::send( const XMidiMessage & message )
+{
+    // not open: nowhere to go
+    if( o_thread == NULL ) return false;
+
+    if( !o_queue.put( message ) ) return false;
+    // wake the sender
+    sem_post( &g_outReady );
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: loop()
+// desc: the sending thread: wait for each message's time, then send it
+//-----------------------------------------------------------------------------
+THREAD_RETURN THREAD_TYPE XMidiOut::loop( void * /* data */ )
+{
+    XMidiMessage message;
+    struct timespec until;
+
+    while( !o_quit )
+    {
+        // nothing to send: wait for send() (or close())
+        if( !o_queue.peek( message ) )
+        {
+            sem_wait( &g_outReady );
+            continue;
+        }
+
+        // not yet: sleep until it is due (a little at a time, for close())
+        double now = XGfx::getMonotonicTime();
+        if( message.when > now )
+        {
+            double wake = message.when < now + X_MIDI_POLL_MS / 1000.0 ?
+                message.when : now + X_MIDI_POLL_MS / 1000.0;
+            until.tv_sec = (time_t)wake;
+            until.tv_nsec = (long)( (wake - until.tv_sec) * 1000000000.0 );
+            clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL );
+            continue;
+        }
+
+        // to a sequencer event
+        snd_seq_event_t ev;
+        snd_seq_ev_clear( &ev );
+        snd_seq_ev_set_source( &ev, o_port );
+        snd_seq_ev_set_subs( &ev );
+        snd_seq_ev_set_direct( &ev );
+        bool ok = true;
+        switch( message.status & 0xf0 )
+        {
+            case 0x80:
+            case 0x90:
+                ev.type = (message.status & 0xf0) == 0x90 ? SND_SEQ_EVENT_NOTEON : SND_SEQ_EVENT_NOTEOFF;
+                ev.data.note.channel = message.status & 0x0f;
+                ev.data.note.note = message.data1;
+                ev.data.note.velocity = message.data2;
+                break;
+            case 0xb0:
+                ev.type = SND_SEQ_EVENT_CONTROLLER;
+                ev.data.control.channel = message.status & 0x0f;
+                ev.data.control.param = message.data1;
+                ev.data.control.value = message.data2;
+                break;
+            case 0xf0:
+                switch( message.status )
+                {
+                    case 0xf2:
+                        ev.type = SND_SEQ_EVENT_SONGPOS;
+                        ev.data.control.value = message.data1 | (message.data2 << 7);
+                        break;
+                    case 0xf8: ev.type = SND_SEQ_EVENT_CLOCK; break;
+                    case 0xfa: ev.type = SND_SEQ_EVENT_START; break;
+                    case 0xfb: ev.type = SND_SEQ_EVENT_CONTINUE; break;
+                    case 0xfc: ev.type = SND_SEQ_EVENT_STOP; break;
+                    default: ok = false;
+                }
+                break;
+            default:
+                ok = false;
+        }
+
+        // out (straight to the subscribers)
+        if( ok ) snd_seq_event_output_direct( g_seqOut, &ev );
+        o_queue.pop();
+    }
+
+    return 0;
+}
+#else
+//-----------------------------------------------------------------------------
+// name: open()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+bool XMidiIn::open( const char * /* name */, XMidiCallback /* cb */, void * /* userData */ )
+{
+    cerr << "[x-midi]: built without MIDI input (make ALSA=1)..." << endl;
+    return false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: close()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+void XMidiIn::close()
+{
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: loop()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+THREAD_RETURN THREAD_TYPE XMidiIn::loop( void * /* data */ )
+{
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: open()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+bool XMidiOut::open( const char * /* name */ )
+{
+    return false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: close()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+void XMidiOut::close()
+{
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: send()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+bool XMidiOut::send( const XMidiMessage & /* message */ )
+{
+    return false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: loop()
+// desc: not available in this build
+//-----------------------------------------------------------------------------
+THREAD_RETURN THREAD_TYPE XMidiOut::loop( void * /* data */ )
+{
+    return 0;
+}
+#endif
@@ -0,0 +1,117 @@
+//-----------------------------------------------------------------------------
+// name: x-midi.h
+// desc: MIDI input/output abstraction (ALSA sequencer virtual ports)
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_X_MIDI_H__
+#define __MCD_X_MIDI_H__
+
+#include "x-def.h"
+#include "x-thread.h"
+#include "x-buffer.h"
+
+// MIDI messages waiting to go out
+#define X_MIDI_OUT_QUEUE_SIZE 1024
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XMidiMessage
+// desc: one MIDI channel, system common or real-time message (no sysex)
+//-----------------------------------------------------------------------------
+struct XMidiMessage
+{
+    // arrival, or when to send (monotonic time, see XGfx::getMonotonicTime())
+    double when;
+    // status byte and data bytes
+    unsigned char status;
+    unsigned char data1;
+    unsigned char data2;
+};
+
+// typedef for MIDI input callback function (called on the MIDI thread)
+typedef void (* XMidiCallback)( const XMidiMessage & message, void * userData );
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XMidiIn
+// desc: static MIDI input; a virtual port other clients connect to, read
+//       on its own thread
+//-----------------------------------------------------------------------------
+class XMidiIn
+{
+public:
+    // open a virtual input port and start reading it
+    static bool open( const char * name, XMidiCallback cb, void * userData );
+    // stop reading and close the port
+    static void close();
+    // is it open?
+    static bool isOpen() { return o_thread != NULL; }
+
+public:
+    // address of the port (e.g., for aconnect), -1 if not open
+    static int client() { return o_client; }
+    static int port() { return o_port; }
+
+protected:
+    // the MIDI thread
+    static THREAD_RETURN THREAD_TYPE loop( void * data );
+
+protected:
+    static XThread * o_thread;
+    static volatile bool o_quit;
+    static XMidiCallback o_callback;
+    static void * o_user_data;
+    static int o_client;
+    static int o_port;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XMidiOut
+// desc: static MIDI output; a virtual port other clients connect to, written
+//       on its own thread, each message at its time
+//-----------------------------------------------------------------------------
+class XMidiOut
+{
+public:
+    // open a virtual output port and start the sending thread
+    static bool open( const char * name );
+    // stop sending and close the port (unsent messages are dropped)
+    static void close();
+    // is it open?
+    static bool isOpen() { return o_thread != NULL; }
+
+public:
+    // queue a message to go out at message.when (now, if already past);
+    // lock-free, for a single calling thread (e.g., the audio thread)
+    static bool send( const XMidiMessage & message );
+
+public:
+    // address of the port (e.g., for aconnect), -1 if not open
+    static int client() { return o_client; }
+    static int port() { return o_port; }
+
+protected:
+    // the sending thread
+    static THREAD_RETURN THREAD_TYPE loop( void * data );
+
+protected:
+    static XThread * o_thread;
+    static volatile bool o_quit;
+    static XLockFreeQueue<XMidiMessage> o_queue;
+    static int o_client;
+    static int o_port;
+};
+
+
+
+
+#endif
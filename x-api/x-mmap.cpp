@@ -0,0 +1,130 @@
+//-----------------------------------------------------------------------------
+// name: x-mmap.cpp
+// desc: read-only memory-mapped files
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "x-mmap.h"
+#include <stdio.h>
+#ifndef __PLATFORM_WIN32__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XMappedFile()
+// desc: constructor
+//-----------------------------------------------------------------------------
+XMappedFile::XMappedFile()
+{
+    m_data = NULL;
+    m_size = 0;
+    m_copied = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~XMappedFile()
+// desc: destructor
+//-----------------------------------------------------------------------------
+XMappedFile::~XMappedFile()
+{
+    close();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: open()
+// desc: map a file (any file already mapped is unmapped first); an empty
+//       file cannot be mapped
+//-----------------------------------------------------------------------------
+bool XMappedFile::open( const char * path )
+{
+    // out with the old
+    close();
+
+#ifndef __PLATFORM_WIN32__
+    int fd = ::open( path, O_RDONLY );
+    // check
+    if( fd < 0 ) return false;
+
+    // how big
+    struct stat info;
+    if( fstat( fd, &info ) != 0 || info.st_size <= 0 )
+    {
+        ::close( fd );
+        return false;
+    }
+
+    // map it (stays valid after the descriptor is closed, and after the
+    // file is replaced or removed)
+    void * data = mmap( NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    ::close( fd );
+    // check
+    if( data == MAP_FAILED ) return false;
+
+    m_data = (const unsigned char *)data;
+    m_size = (size_t)info.st_size;
+#else
+    FILE * fp = fopen( path, "rb" );
+    // check
+    if( !fp ) return false;
+
+    // how big
+    fseek( fp, 0, SEEK_END );
+    long size = ftell( fp );
+    fseek( fp, 0, SEEK_SET );
+    if( size <= 0 )
+    {
+        fclose( fp );
+        return false;
+    }
+
+    // read it in
+    unsigned char * data = new unsigned char[size];
+    if( fread( data, 1, size, fp ) != (size_t)size )
+    {
+        delete [] data;
+        fclose( fp );
+        return false;
+    }
+    fclose( fp );
+
+    m_data = data;
+    m_size = (size_t)size;
+    m_copied = true;
+#endif
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: close()
+// desc: unmap
+//-----------------------------------------------------------------------------
+void XMappedFile::close()
+{
+    // check
+    if( m_data == NULL ) return;
+
+    if( m_copied ) delete [] m_data;
+#ifndef __PLATFORM_WIN32__
+    else munmap( (void *)m_data, m_size );
+#endif
+
+    m_data = NULL;
+    m_size = 0;
+    m_copied = false;
+}
@@ -0,0 +1,59 @@
+//-----------------------------------------------------------------------------
+// name: x-mmap.h
+// desc: read-only memory-mapped files
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_X_MMAP_H__
+#define __MCD_X_MMAP_H__
+
+#include "x-def.h"
+#include <stddef.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class XMappedFile
+// desc: a whole file mapped read-only into memory (pages are read in as
+//       they are touched); where mapping is not available, it is read in
+//-----------------------------------------------------------------------------
+class XMappedFile
+{
+public:
+    XMappedFile();
+    ~XMappedFile();
+
+public:
+    // map a file (any file already mapped is unmapped first)
+    bool open( const char * path );
+    // unmap
+    void close();
+
+public:
+    // is a file mapped
+    bool isOpen() const { return m_data != NULL; }
+    // the contents
+    const unsigned char * data() const { return m_data; }
+    // size in bytes
+    size_t size() const { return m_size; }
+
+protected:
+    // the contents
+    const unsigned char * m_data;
+    // size in bytes
+    size_t m_size;
+    // read in (not mapped)
+    bool m_copied;
+
+private:
+    // not copyable (owns the mapping)
+    XMappedFile( const XMappedFile & );
+    XMappedFile & operator=( const XMappedFile & );
+};
+
+
+
+
+#endif
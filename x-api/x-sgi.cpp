@@ -0,0 +1,368 @@
+//-----------------------------------------------------------------------------
+// name: x-sgi.cpp
+// desc: SGI image (.bw/.rgb/.rgba) decoder; memory-maps the file and decodes
+//       rows straight from the mapping, optionally in parallel
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "x-sgi.h"
+#include "x-thread.h"
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#if defined(__PLATFORM_WIN32__)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+// SGI magic number
+#define XSGI_MAGIC 474
+// header size (RLE tables follow it)
+#define XSGI_HEADER_SIZE 512
+// below this many bytes of output, decode on the calling thread
+#define XSGI_PARALLEL_THRESHOLD (1 << 18)
+// most threads per image
+#define XSGI_MAX_THREADS 16
+// shorter runs are cheaper as plain loops than as memcpy/memset calls
+#define XSGI_MEMCPY_RUN 32
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: be16() / be32()
+// desc: big-endian reads from the mapping
+//-----------------------------------------------------------------------------
+static inline unsigned int be16( const unsigned char * p )
+{ return ( p[0] << 8 ) | p[1]; }
+static inline unsigned long be32( const unsigned char * p )
+{ return ( (unsigned long)p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3]; }
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: xsgi_open()
+// desc: map and check the header
+//-----------------------------------------------------------------------------
+bool xsgi_open( const char * path, XSGIImage * image )
+{
+    // reset
+    *image = XSGIImage();
+
+#if defined(__PLATFORM_WIN32__)
+    HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+    if( file == INVALID_HANDLE_VALUE )
+    {
+        fprintf( stderr, "[x-sgi]: cannot open '%s'...\n", path );
+        return false;
+    }
+    image->size = GetFileSize( file, NULL );
+    HANDLE mapping = CreateFileMapping( file, NULL, PAGE_READONLY, 0, 0, NULL );
+    CloseHandle( file );
+    if( !mapping )
+    {
+        fprintf( stderr, "[x-sgi]: cannot map '%s'...\n", path );
+        return false;
+    }
+    image->data = (const unsigned char *)MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    image->handle = mapping;
+#else
+    int fd = open( path, O_RDONLY );
+    if( fd < 0 )
+    {
+        fprintf( stderr, "[x-sgi]: cannot open '%s'...\n", path );
+        return false;
+    }
+    struct stat info;
+    if( fstat( fd, &info ) == 0 && info.st_size > 0 )
+    {
+        image->size = info.st_size;
+        void * data = mmap( NULL, image->size, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( data != MAP_FAILED )
+        {
+            image->data = (const unsigned char *)data;
+            // we read all of it, soon
+            madvise( data, image->size, MADV_WILLNEED );
+        }
+    }
+    // the mapping stays valid
+    close( fd );
+#endif
+
+    // check
+    if( !image->data )
+    {
+        fprintf( stderr, "[x-sgi]: cannot map '%s'...\n", path );
+        xsgi_close( image );
+        return false;
+    }
+
+    // header
+    const unsigned char * p = image->data;
+    if( image->size < XSGI_HEADER_SIZE || be16( p ) != XSGI_MAGIC || p[3] != 1 )
+    {
+        fprintf( stderr, "[x-sgi]: '%s' is not an 8-bit SGI image...\n", path );
+        xsgi_close( image );
+        return false;
+    }
+    image->rle = p[2] == 1;
+    image->width = be16( p + 6 );
+    image->height = be16( p + 8 );
+    image->depth = be16( p + 10 );
+    // 1 and 2 dimensional images have no z
+    if( be16( p + 4 ) < 3 || image->depth == 0 ) image->depth = 1;
+
+    // RLE tables must fit
+    if( image->width == 0 || image->height == 0 || ( image->rle &&
+        image->size < XSGI_HEADER_SIZE + 8 * (size_t)image->height * image->depth ) )
+    {
+        fprintf( stderr, "[x-sgi]: '%s' is truncated...\n", path );
+        xsgi_close( image );
+        return false;
+    }
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: xsgi_close()
+// desc: unmap
+//-----------------------------------------------------------------------------
+void xsgi_close( XSGIImage * image )
+{
+#if defined(__PLATFORM_WIN32__)
+    if( image->data ) UnmapViewOfFile( image->data );
+    if( image->handle ) CloseHandle( (HANDLE)image->handle );
+#else
+    if( image->data ) munmap( (void *)image->data, image->size );
+#endif
+    *image = XSGIImage();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: decodeRow()
+// desc: decode row y of channel z, writing every stride-th byte of out
+//-----------------------------------------------------------------------------
+static bool decodeRow( const XSGIImage * image, int y, int z,
+                       unsigned char * out, int stride )
+{
+    int width = image->width;
+
+    // uncompressed
+    if( !image->rle )
+    {
+        size_t offset = XSGI_HEADER_SIZE + (size_t)width * ( y + (size_t)z * image->height );
+        // check
+        if( offset + width > image->size ) return false;
+        const unsigned char * in = image->data + offset;
+        if( stride == 1 ) memcpy( out, in, width );
+        else for( int x = 0; x < width; x++ ) out[x*stride] = in[x];
+        return true;
+    }
+
+    // row start and length (big-endian tables after the header)
+    size_t index = y + (size_t)z * image->height;
+    const unsigned char * table = image->data + XSGI_HEADER_SIZE;
+    size_t start = be32( table + 4 * index );
+    size_t length = be32( table + 4 * ( index + (size_t)image->height * image->depth ) );
+    // check
+    if( start > image->size || length > image->size - start ) return false;
+
+    const unsigned char * in = image->data + start;
+    const unsigned char * end = in + length;
+    // pixels left in the row
+    int left = width;
+
+    // runs
+    while( in < end )
+    {
+        unsigned char pixel = *in++;
+        int count = pixel & 0x7F;
+        // end of row
+        if( !count ) break;
+        // check
+        if( count > left ) return false;
+        left -= count;
+
+        if( pixel & 0x80 )
+        {
+            // literal
+            if( in + count > end ) return false;
+            if( stride == 1 && count >= XSGI_MEMCPY_RUN ) { memcpy( out, in, count ); out += count; in += count; }
+            else while( count-- ) { *out = *in++; out += stride; }
+        }
+        else
+        {
+            // repeat
+            if( in >= end ) return false;
+            pixel = *in++;
+            if( stride == 1 && count >= XSGI_MEMCPY_RUN ) { memset( out, pixel, count ); out += count; }
+            else while( count-- ) { *out = pixel; out += stride; }
+        }
+    }
+
+    // short row: zero the rest
+    while( left-- ) { *out = 0; out += stride; }
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: decodeRows()
+// desc: decode rows [begin, end) into dest
+//-----------------------------------------------------------------------------
+static bool decodeRows( const XSGIImage * image, unsigned char * dest,
+                        int components, int begin, int end )
+{
+    int width = image->width;
+
+    for( int y = begin; y < end; y++ )
+    {
+        // luminance (first channel)
+        if( components == 1 )
+        {
+            if( !decodeRow( image, y, 0, dest + (size_t)y * width, 1 ) ) return false;
+            continue;
+        }
+
+        // RGBA
+        unsigned char * row = dest + (size_t)y * width * 4;
+        if( image->depth >= 3 )
+        {
+            // channels straight into place
+            int channels = image->depth >= 4 ? 4 : 3;
+            for( int c = 0; c < channels; c++ )
+                if( !decodeRow( image, y, c, row + c, 4 ) ) return false;
+            // opaque
+            if( channels == 3 ) for( int x = 0; x < width; x++ ) row[x*4+3] = 0xff;
+        }
+        else
+        {
+            // gray
+            if( !decodeRow( image, y, 0, row, 4 ) ) return false;
+            for( int x = 0; x < width; x++ )
+            {
+                row[x*4+1] = row[x*4+2] = row[x*4];
+                row[x*4+3] = 0xff;
+            }
+        }
+    }
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XSGITask
+// desc: one thread's share of rows
+//-----------------------------------------------------------------------------
+struct XSGITask
+{
+    const XSGIImage * image;
+    unsigned char * dest;
+    int components;
+    int begin;
+    int end;
+    bool result;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: decodeTask()
+// desc: thread routine
+//-----------------------------------------------------------------------------
+static THREAD_RETURN THREAD_TYPE decodeTask( void * data )
+{
+    XSGITask * task = (XSGITask *)data;
+    task->result = decodeRows( task->image, task->dest, task->components,
+                               task->begin, task->end );
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: xsgi_decode()
+// desc: decode the whole image into dest (bottom row first)
+//-----------------------------------------------------------------------------
+bool xsgi_decode( const XSGIImage * image, unsigned char * dest,
+                  int components, unsigned int numThreads )
+{
+    // check
+    if( !image->data || ( components != 1 && components != 4 ) ) return false;
+
+    // how many threads
+    if( (size_t)image->width * image->height * components < XSGI_PARALLEL_THRESHOLD )
+        numThreads = 1;
+    else if( numThreads == 0 )
+    {
+#if defined(__PLATFORM_WIN32__)
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        numThreads = info.dwNumberOfProcessors;
+#else
+        long cores = sysconf( _SC_NPROCESSORS_ONLN );
+        numThreads = cores > 0 ? cores : 1;
+#endif
+    }
+    if( numThreads > XSGI_MAX_THREADS ) numThreads = XSGI_MAX_THREADS;
+    if( numThreads > (unsigned int)image->height ) numThreads = image->height;
+
+    // one thread: right here
+    if( numThreads <= 1 )
+        return decodeRows( image, dest, components, 0, image->height );
+
+    // split rows evenly
+    vector<XSGITask> tasks( numThreads );
+    vector<XThread> threads( numThreads - 1 );
+    for( unsigned int i = 0; i < numThreads; i++ )
+    {
+        tasks[i].image = image;
+        tasks[i].dest = dest;
+        tasks[i].components = components;
+        tasks[i].begin = (int)( (size_t)image->height * i / numThreads );
+        tasks[i].end = (int)( (size_t)image->height * ( i + 1 ) / numThreads );
+        tasks[i].result = false;
+    }
+
+    // others on threads (run inline if a thread can't start)
+    vector<bool> started( numThreads, false );
+    for( unsigned int i = 1; i < numThreads; i++ )
+    {
+        started[i] = threads[i-1].start( decodeTask, &tasks[i] );
+        if( !started[i] ) { threads[i-1].clear(); decodeTask( &tasks[i] ); }
+    }
+    // first on this one
+    decodeTask( &tasks[0] );
+    // wait
+    for( unsigned int i = 1; i < numThreads; i++ )
+        if( started[i] ) threads[i-1].join();
+
+    // all good?
+    for( unsigned int i = 0; i < numThreads; i++ )
+        if( !tasks[i].result ) return false;
+
+    return true;
+}
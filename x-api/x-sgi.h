@@ -0,0 +1,57 @@
+//-----------------------------------------------------------------------------
+// name: x-sgi.h
+// desc: SGI image (.bw/.rgb/.rgba) decoder; memory-maps the file and decodes
+//       rows straight from the mapping, optionally in parallel
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_X_SGI_H__
+#define __MCD_X_SGI_H__
+
+#include <stddef.h>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XSGIImage
+// desc: a mapped SGI image
+//-----------------------------------------------------------------------------
+struct XSGIImage
+{
+    // the mapping
+    const unsigned char * data;
+    size_t size;
+    // header
+    int width;
+    int height;
+    int depth;
+    bool rle;
+    // platform mapping handle
+    void * handle;
+
+    // constructor
+    XSGIImage() : data(NULL), size(0), width(0), height(0), depth(0),
+        rle(false), handle(NULL) { }
+};
+
+
+
+
+// map and check the header; errors go to the console
+bool xsgi_open( const char * path, XSGIImage * image );
+// unmap
+void xsgi_close( XSGIImage * image );
+// decode the whole image into dest (bottom row first); components is
+//   1: first channel only (width*height bytes)
+//   4: RGBA, gray replicated and alpha 0xff as needed (width*height*4 bytes)
+// numThreads == 0 picks one per core (small images always use one);
+// returns false on corrupt data
+bool xsgi_decode( const XSGIImage * image, unsigned char * dest,
+                  int components, unsigned int numThreads = 0 );
+
+
+
+
+#endif
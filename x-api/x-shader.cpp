@@ -0,0 +1,133 @@
+//-----------------------------------------------------------------------------
+// name: x-shader.cpp
+// desc: GLSL shader helpers
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "x-shader.h"
+#include <stdlib.h>
+#include <iostream>
+using namespace std;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: isSupported()
+// desc: are shaders available in the current context?
+//-----------------------------------------------------------------------------
+bool XShader::isSupported()
+{
+    // version string starts with major.minor
+    const char * version = (const char *)glGetString( GL_VERSION );
+    // check
+    if( !version ) return false;
+
+    return atoi( version ) >= 2;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: compile()
+// desc: compile one shader stage; returns 0 on error
+//-----------------------------------------------------------------------------
+GLuint XShader::compile( GLenum type, const char * source )
+{
+    // create
+    GLuint shader = glCreateShader( type );
+    // check
+    if( !shader ) return 0;
+
+    // compile
+    glShaderSource( shader, 1, &source, NULL );
+    glCompileShader( shader );
+
+    // check
+    GLint ok = 0;
+    glGetShaderiv( shader, GL_COMPILE_STATUS, &ok );
+    if( !ok )
+    {
+        char log[1024];
+        glGetShaderInfoLog( shader, sizeof(log), NULL, log );
+        cerr << "[x-shader]: cannot compile "
+             << (type == GL_VERTEX_SHADER ? "vertex" : "fragment")
+             << " shader: " << log << endl;
+        glDeleteShader( shader );
+        return 0;
+    }
+
+    return shader;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: link()
+// desc: compile and link a program; returns 0 on error
+//-----------------------------------------------------------------------------
+GLuint XShader::link( const char * vertexSource, const char * fragmentSource )
+{
+    // check
+    if( !isSupported() ) return 0;
+
+    // compile
+    GLuint vs = compile( GL_VERTEX_SHADER, vertexSource );
+    GLuint fs = compile( GL_FRAGMENT_SHADER, fragmentSource );
+    // check
+    if( !vs || !fs )
+    {
+        if( vs ) glDeleteShader( vs );
+        if( fs ) glDeleteShader( fs );
+        return 0;
+    }
+
+    // link
+    GLuint program = glCreateProgram();
+    glAttachShader( program, vs );
+    glAttachShader( program, fs );
+    glLinkProgram( program );
+
+    // check
+    GLint ok = 0;
+    glGetProgramiv( program, GL_LINK_STATUS, &ok );
+    if( !ok )
+    {
+        char log[1024];
+        glGetProgramInfoLog( program, sizeof(log), NULL, log );
+        cerr << "[x-shader]: cannot link program: " << log << endl;
+        destroy( program );
+        return 0;
+    }
+
+    return program;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: destroy()
+// desc: delete a program and its shaders
+//-----------------------------------------------------------------------------
+void XShader::destroy( GLuint program )
+{
+    // check
+    if( !program ) return;
+
+    // shaders
+    GLuint shaders[2];
+    GLsizei count = 0;
+    glGetAttachedShaders( program, 2, &count, shaders );
+    for( GLsizei i = 0; i < count; i++ )
+    {
+        glDetachShader( program, shaders[i] );
+        glDeleteShader( shaders[i] );
+    }
+
+    // program
+    glDeleteProgram( program );
+}
@@ -0,0 +1,36 @@
+//-----------------------------------------------------------------------------
+// name: x-shader.h
+// desc: GLSL shader helpers
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_X_SHADER_H__
+#define __MCD_X_SHADER_H__
+
+#include "x-gfx.h"
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class XShader
+// desc: compile/link GLSL programs (GL 2.0+); errors go to the console
+//-----------------------------------------------------------------------------
+class XShader
+{
+public:
+    // are shaders available in the current context?
+    static bool isSupported();
+    // compile one shader stage; returns 0 on error
+    static GLuint compile( GLenum type, const char * source );
+    // compile and link a program; returns 0 on error
+    static GLuint link( const char * vertexSource, const char * fragmentSource );
+    // delete a program and its shaders
+    static void destroy( GLuint program );
+};
+
+
+
+
+#endif
@@ -0,0 +1,335 @@
+//-----------------------------------------------------------------------------
+// name: x-slew.cpp
+// desc: batched slews: every live value/goal/slew kept in contiguous arrays
+//       and advanced in one (SIMD) pass per frame, looked up by handle
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "x-slew.h"
+#include <math.h>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define __XSLEW_SSE__
+#endif
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XSlewBank()
+// desc: constructor
+//-----------------------------------------------------------------------------
+XSlewBank::XSlewBank()
+{
+    // handle 0 is never valid
+    m_indices.push_back( 0 );
+    // no coefficients yet
+    m_delta = 0;
+    m_numTimeInvariant = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~XSlewBank()
+// desc: destructor
+//-----------------------------------------------------------------------------
+XSlewBank::~XSlewBank()
+{
+    // nothing to do (vectors clean up)
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: global()
+// desc: bank for entity slews, advanced once per simulation step
+//-----------------------------------------------------------------------------
+XSlewBank * XSlewBank::global()
+{
+    // created on first use (safe from static constructors)
+    static XSlewBank theBank;
+    return &theBank;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: add()
+// desc: add a slew; returns its handle
+//-----------------------------------------------------------------------------
+XSlewHandle XSlewBank::add( GLfloat value, GLfloat goal, GLfloat slew,
+                            XSlewMode mode )
+{
+    // handle
+    XSlewHandle handle;
+    // reuse one if we can
+    if( m_freeHandles.size() )
+    {
+        handle = m_freeHandles.back();
+        m_freeHandles.pop_back();
+    }
+    else
+    {
+        handle = (XSlewHandle)m_indices.size();
+        m_indices.push_back( 0 );
+    }
+
+    // append
+    m_indices[handle] = (unsigned int)m_values.size();
+    m_values.push_back( value );
+    m_goals.push_back( goal );
+    m_slews.push_back( slew );
+    m_modes.push_back( (unsigned char)mode );
+    m_handles.push_back( handle );
+    m_coefficients.push_back( 0 );
+    m_coefficients.back() = coefficient( m_values.size() - 1 );
+    // count
+    if( mode == XSLEW_TIME_INVARIANT ) m_numTimeInvariant++;
+
+    return handle;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: remove()
+// desc: remove a slew (the last one moves into its place)
+//-----------------------------------------------------------------------------
+void XSlewBank::remove( XSlewHandle handle )
+{
+    // sanity check
+    if( handle == 0 || handle >= m_indices.size() ) return;
+
+    // where it is
+    unsigned int index = m_indices[handle];
+    unsigned int last = (unsigned int)m_values.size() - 1;
+    // count
+    if( m_modes[index] == XSLEW_TIME_INVARIANT ) m_numTimeInvariant--;
+
+    // move the last one here
+    if( index != last )
+    {
+        m_values[index] = m_values[last];
+        m_goals[index] = m_goals[last];
+        m_slews[index] = m_slews[last];
+        m_coefficients[index] = m_coefficients[last];
+        m_modes[index] = m_modes[last];
+        m_handles[index] = m_handles[last];
+        m_indices[m_handles[index]] = index;
+    }
+
+    // shrink
+    m_values.pop_back();
+    m_goals.pop_back();
+    m_slews.pop_back();
+    m_coefficients.pop_back();
+    m_modes.pop_back();
+    m_handles.pop_back();
+
+    // recycle
+    m_indices[handle] = 0;
+    m_freeHandles.push_back( handle );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setSlew()
+// desc: set slew (coefficient updated for the current delta)
+//-----------------------------------------------------------------------------
+void XSlewBank::setSlew( XSlewHandle handle, GLfloat slew )
+{
+    unsigned int index = m_indices[handle];
+    m_slews[index] = slew;
+    m_coefficients[index] = coefficient( index );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setMode()
+// desc: set mode (coefficient updated for the current delta)
+//-----------------------------------------------------------------------------
+void XSlewBank::setMode( XSlewHandle handle, XSlewMode mode )
+{
+    unsigned int index = m_indices[handle];
+    // count
+    if( m_modes[index] == XSLEW_TIME_INVARIANT ) m_numTimeInvariant--;
+    if( mode == XSLEW_TIME_INVARIANT ) m_numTimeInvariant++;
+    // set
+    m_modes[index] = (unsigned char)mode;
+    m_coefficients[index] = coefficient( index );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: coefficient()
+// desc: coefficient for one slew at the current delta
+//-----------------------------------------------------------------------------
+GLfloat XSlewBank::coefficient( size_t index ) const
+{
+    if( m_modes[index] == XSLEW_TIME_INVARIANT )
+        return 1.0f - ::powf( 1.0f - m_slews[index], m_delta );
+    return m_slews[index] * m_delta;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: computeCoefficients()
+// desc: recompute all coefficients for a new delta
+//-----------------------------------------------------------------------------
+void XSlewBank::computeCoefficients( GLfloat delta )
+{
+    // set
+    m_delta = delta;
+
+    // the arrays
+    size_t count = m_slews.size();
+    const GLfloat * slews = count ? &m_slews[0] : NULL;
+    GLfloat * coefficients = count ? &m_coefficients[0] : NULL;
+    size_t i = 0;
+
+    // linear: slew * delta, for all of them
+#ifdef __XSLEW_SSE__
+    __m128 d = _mm_set1_ps( delta );
+    for( ; i + 4 <= count; i += 4 )
+        _mm_storeu_ps( coefficients + i, _mm_mul_ps( _mm_loadu_ps( slews + i ), d ) );
+#endif
+    for( ; i < count; i++ )
+        coefficients[i] = slews[i] * delta;
+
+    // fix up the time-invariant ones (if any)
+    if( m_numTimeInvariant == 0 ) return;
+    for( i = 0; i < count; i++ )
+    {
+        if( m_modes[i] == XSLEW_TIME_INVARIANT )
+            coefficients[i] = coefficient( i );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: advance()
+// desc: move every slew toward its goal by delta (seconds)
+//-----------------------------------------------------------------------------
+void XSlewBank::advance( GLfloat delta )
+{
+    // new delta: new coefficients (a fixed timestep never gets here again)
+    if( delta != m_delta ) computeCoefficients( delta );
+
+    // the arrays
+    size_t count = m_values.size();
+    if( count == 0 ) return;
+    GLfloat * values = &m_values[0];
+    const GLfloat * goals = &m_goals[0];
+    const GLfloat * coefficients = &m_coefficients[0];
+    size_t i = 0;
+
+    // value += (goal - value) * coefficient
+#ifdef __XSLEW_SSE__
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 v = _mm_loadu_ps( values + i );
+        __m128 g = _mm_loadu_ps( goals + i );
+        __m128 k = _mm_loadu_ps( coefficients + i );
+        _mm_storeu_ps( values + i, _mm_add_ps( v, _mm_mul_ps( _mm_sub_ps( g, v ), k ) ) );
+    }
+#endif
+    for( ; i < count; i++ )
+        values[i] += (goals[i] - values[i]) * coefficients[i];
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XSlew()
+// desc: constructor
+//-----------------------------------------------------------------------------
+XSlew::XSlew( GLfloat value, GLfloat goal, GLfloat slew, XSlewBank * bank,
+              XSlewMode mode )
+{
+    m_bank = bank ? bank : XSlewBank::global();
+    m_handle = m_bank->add( value, goal, slew, mode );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XSlew()
+// desc: copy constructor (same bank, new slot)
+//-----------------------------------------------------------------------------
+XSlew::XSlew( const XSlew & other )
+{
+    m_bank = other.m_bank;
+    m_handle = m_bank->add( other.value(), other.goal(), other.slew(),
+                            other.m_bank->mode( other.m_handle ) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~XSlew()
+// desc: destructor
+//-----------------------------------------------------------------------------
+XSlew::~XSlew()
+{
+    m_bank->remove( m_handle );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: operator =()
+// desc: copies state (stays in its own bank)
+//-----------------------------------------------------------------------------
+const XSlew & XSlew::operator =( const XSlew & rhs )
+{
+    // check
+    if( &rhs == this ) return *this;
+    // copy
+    m_bank->setValue( m_handle, rhs.value() );
+    m_bank->setGoal( m_handle, rhs.goal() );
+    m_bank->setMode( m_handle, rhs.m_bank->mode( rhs.m_handle ) );
+    m_bank->setSlew( m_handle, rhs.slew() );
+    return *this;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XSlew3D()
+// desc: constructor (all zero)
+//-----------------------------------------------------------------------------
+XSlew3D::XSlew3D( GLfloat slew, XSlewBank * bank )
+: m_x( 0, 0, slew, bank ), m_y( 0, 0, slew, bank ), m_z( 0, 0, slew, bank )
+{ }
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XSlew3D()
+// desc: constructor (value and goal)
+//-----------------------------------------------------------------------------
+XSlew3D::XSlew3D( const Vector3D & v, GLfloat slew, XSlewBank * bank )
+: m_x( v.x, v.x, slew, bank ), m_y( v.y, v.y, slew, bank ), m_z( v.z, v.z, slew, bank )
+{ }
@@ -0,0 +1,187 @@
+//-----------------------------------------------------------------------------
+// name: x-slew.h
+// desc: batched slews: every live value/goal/slew kept in contiguous arrays
+//       and advanced in one (SIMD) pass per frame, looked up by handle
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_X_SLEW_H__
+#define __MCD_X_SLEW_H__
+
+#include "x-vector3d.h"
+#include <vector>
+
+
+// handle to a slew in a bank (0 is never a valid handle)
+typedef unsigned int XSlewHandle;
+
+
+//-----------------------------------------------------------------------------
+// name: enum XSlewMode
+// desc: how a slew moves toward its goal
+//-----------------------------------------------------------------------------
+enum XSlewMode
+{
+    // value += (goal-value) * slew * delta, like Vector3D::interp( delta )
+    XSLEW_LINEAR = 0,
+    // value += (goal-value) * (1 - (1-slew)^delta), like Vector3D::interp2()
+    XSLEW_TIME_INVARIANT
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class XSlewBank
+// desc: owns a set of slews (structure of arrays); advance() moves all of
+//       them; coefficients are only recomputed when delta changes
+//       (not thread safe: use from one thread)
+//-----------------------------------------------------------------------------
+class XSlewBank
+{
+public:
+    XSlewBank();
+    ~XSlewBank();
+
+public:
+    // add a slew; returns its handle
+    XSlewHandle add( GLfloat value, GLfloat goal, GLfloat slew,
+                     XSlewMode mode = XSLEW_LINEAR );
+    // remove a slew (handle becomes invalid)
+    void remove( XSlewHandle handle );
+    // number of live slews
+    size_t size() const { return m_values.size(); }
+
+public:
+    // get
+    GLfloat value( XSlewHandle handle ) const { return m_values[m_indices[handle]]; }
+    GLfloat goal( XSlewHandle handle ) const { return m_goals[m_indices[handle]]; }
+    GLfloat slew( XSlewHandle handle ) const { return m_slews[m_indices[handle]]; }
+    XSlewMode mode( XSlewHandle handle ) const { return (XSlewMode)m_modes[m_indices[handle]]; }
+    // set
+    void setValue( XSlewHandle handle, GLfloat value ) { m_values[m_indices[handle]] = value; }
+    void setGoal( XSlewHandle handle, GLfloat goal ) { m_goals[m_indices[handle]] = goal; }
+    void setSlew( XSlewHandle handle, GLfloat slew );
+    void setMode( XSlewHandle handle, XSlewMode mode );
+
+public:
+    // move every slew toward its goal by delta (seconds)
+    void advance( GLfloat delta );
+
+public:
+    // bank for entity slews, advanced once per simulation step
+    static XSlewBank * global();
+
+protected:
+    // coefficient for one slew at the current delta
+    GLfloat coefficient( size_t index ) const;
+    // recompute all coefficients for a new delta
+    void computeCoefficients( GLfloat delta );
+
+protected:
+    // per slew (by index)
+    std::vector<GLfloat> m_values;
+    std::vector<GLfloat> m_goals;
+    std::vector<GLfloat> m_slews;
+    std::vector<GLfloat> m_coefficients;
+    std::vector<unsigned char> m_modes;
+    std::vector<XSlewHandle> m_handles;
+    // handle -> index
+    std::vector<unsigned int> m_indices;
+    // recycled handles
+    std::vector<XSlewHandle> m_freeHandles;
+    // delta the coefficients are for
+    GLfloat m_delta;
+    // number of time-invariant slews
+    size_t m_numTimeInvariant;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class XSlew
+// desc: one slew living in a bank (value/goal/slew like Vector3D::interp)
+//-----------------------------------------------------------------------------
+class XSlew
+{
+public:
+    // value, goal, slew (like Vector3D); bank NULL for the global bank
+    XSlew( GLfloat value = 0, GLfloat goal = 0, GLfloat slew = 0,
+           XSlewBank * bank = NULL, XSlewMode mode = XSLEW_LINEAR );
+    XSlew( const XSlew & other );
+    ~XSlew();
+
+public:
+    // copies state (stays in its own bank)
+    const XSlew & operator =( const XSlew & rhs );
+
+public:
+    // get
+    GLfloat value() const { return m_bank->value( m_handle ); }
+    GLfloat goal() const { return m_bank->goal( m_handle ); }
+    GLfloat slew() const { return m_bank->slew( m_handle ); }
+    // set
+    void setValue( GLfloat value ) { m_bank->setValue( m_handle, value ); }
+    void setSlew( GLfloat slew ) { m_bank->setSlew( m_handle, slew ); }
+    void update( GLfloat goal ) { m_bank->setGoal( m_handle, goal ); }
+    void update( GLfloat goal, GLfloat slew ) { update( goal ); setSlew( slew ); }
+    void updateSet( GLfloat goalAndValue ) { update( goalAndValue ); setValue( goalAndValue ); }
+    void updateSet( GLfloat goalAndValue, GLfloat slew ) { updateSet( goalAndValue ); setSlew( slew ); }
+
+public:
+    XSlewBank * bank() const { return m_bank; }
+    XSlewHandle handle() const { return m_handle; }
+
+protected:
+    XSlewBank * m_bank;
+    XSlewHandle m_handle;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class XSlew3D
+// desc: three slews (like iSlew3D), in a bank
+//-----------------------------------------------------------------------------
+class XSlew3D
+{
+public:
+    XSlew3D( GLfloat slew = 0.5f, XSlewBank * bank = NULL );
+    XSlew3D( const Vector3D & v, GLfloat slew = 1, XSlewBank * bank = NULL );
+
+public:
+    // get
+    Vector3D actual() const { return Vector3D( m_x.value(), m_y.value(), m_z.value() ); }
+    Vector3D goal() const { return Vector3D( m_x.goal(), m_y.goal(), m_z.goal() ); }
+    // set
+    void set( const Vector3D & v )
+    { m_x.setValue( v.x ); m_y.setValue( v.y ); m_z.setValue( v.z ); }
+    void setSlew( GLfloat slew )
+    { m_x.setSlew( slew ); m_y.setSlew( slew ); m_z.setSlew( slew ); }
+    void update( const Vector3D & goal )
+    { m_x.update( goal.x ); m_y.update( goal.y ); m_z.update( goal.z ); }
+    void update( const Vector3D & goal, GLfloat slew )
+    { update( goal ); setSlew( slew ); }
+    void updateSet( const Vector3D & goalAndValue )
+    { m_x.updateSet( goalAndValue.x ); m_y.updateSet( goalAndValue.y ); m_z.updateSet( goalAndValue.z ); }
+    void updateSet( const Vector3D & goalAndValue, GLfloat slew )
+    { updateSet( goalAndValue ); setSlew( slew ); }
+
+public:
+    const XSlew & slewX() const { return m_x; }
+    const XSlew & slewY() const { return m_y; }
+    const XSlew & slewZ() const { return m_z; }
+
+protected:
+    XSlew m_x;
+    XSlew m_y;
+    XSlew m_z;
+};
+
+
+
+
+#endif
@@ -0,0 +1,686 @@
+//-----------------------------------------------------------------------------
+// name: x-texture.cpp
+// desc: texture manager: decodes image files on worker threads, uploads
+//       them on the GL thread within a per-frame budget
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "x-texture.h"
+#include "x-loadlum.h"
+#include "x-loadrgb.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(__PLATFORM_WIN32__)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+using namespace std;
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XTextureManager()
+// desc: constructor
+//-----------------------------------------------------------------------------
+XTextureManager::XTextureManager()
+{
+    m_numPending = 0;
+    m_budget = XTEXTURE_DEFAULT_BUDGET;
+    m_placeholder = 0;
+    m_startTime = 0;
+    m_quit = false;
+    m_pboChecked = false;
+    m_pboSupported = false;
+    m_pbo = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~XTextureManager()
+// desc: destructor
+//-----------------------------------------------------------------------------
+XTextureManager::~XTextureManager()
+{
+    cleanup();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: init()
+// desc: start decoder threads
+//-----------------------------------------------------------------------------
+bool XTextureManager::init( unsigned int numThreads )
+{
+    // already
+    if( m_threads.size() ) return true;
+
+    // how many
+    if( numThreads == 0 )
+    {
+#if defined(__PLATFORM_WIN32__)
+        SYSTEM_INFO info;
+        GetSystemInfo( &info );
+        long cores = info.dwNumberOfProcessors;
+#else
+        long cores = sysconf( _SC_NPROCESSORS_ONLN );
+#endif
+        // leave one for the GL thread
+        numThreads = cores > 1 ? cores - 1 : 1;
+    }
+
+    m_quit = false;
+    // start
+    for( unsigned int i = 0; i < numThreads; i++ )
+    {
+        XThread * thread = new XThread();
+        if( !thread->start( worker, this ) )
+        {
+            fprintf( stderr, "[x-texture]: cannot start decoder thread...\n" );
+            SAFE_DELETE( thread );
+            break;
+        }
+        m_threads.push_back( thread );
+    }
+
+    return m_threads.size() > 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cleanup()
+// desc: stop threads, delete all textures (GL thread)
+//-----------------------------------------------------------------------------
+void XTextureManager::cleanup()
+{
+    // stop workers (they finish the file they are on)
+    m_mutex.acquire();
+    m_quit = true;
+    m_queue.clear();
+    m_queueCond.broadcast();
+    m_mutex.release();
+    for( size_t i = 0; i < m_threads.size(); i++ )
+    {
+        m_threads[i]->join();
+        SAFE_DELETE( m_threads[i] );
+    }
+    m_threads.clear();
+    m_decoded.clear();
+
+    // textures
+    for( size_t i = 0; i < m_jobs.size(); i++ )
+    {
+        glDeleteTextures( 1, &m_jobs[i]->texture );
+        if( m_jobs[i]->pixels ) free( m_jobs[i]->pixels );
+        SAFE_DELETE( m_jobs[i]->atlas );
+        SAFE_DELETE( m_jobs[i] );
+    }
+    m_jobs.clear();
+    m_byPath.clear();
+    m_byTexture.clear();
+    m_numPending = 0;
+
+    // buffer
+    if( m_pbo ) glDeleteBuffers( 1, &m_pbo );
+    m_pbo = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: load()
+// desc: request a texture by path; same path returns the same texture
+//-----------------------------------------------------------------------------
+GLuint XTextureManager::load( const string & path, GLenum minFilter,
+                              GLenum magFilter, bool mipmaps )
+{
+    // already requested?
+    map<string, XTextureJob *>::iterator it = m_byPath.find( path );
+    if( it != m_byPath.end() ) return it->second->texture;
+
+    // new
+    XTextureJob * job = new XTextureJob();
+    job->path = path;
+    job->minFilter = minFilter;
+    job->magFilter = magFilter;
+    job->mipmaps = mipmaps;
+    request( job );
+
+    return job->texture;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: loadAtlas()
+// desc: request an atlas of several images; same list returns the same atlas
+//-----------------------------------------------------------------------------
+XTextureAtlas * XTextureManager::loadAtlas( const vector<string> & paths,
+                                            GLenum minFilter, GLenum magFilter )
+{
+    // key (not a file name)
+    string key = "atlas:";
+    for( size_t i = 0; i < paths.size(); i++ ) key += paths[i] + "|";
+
+    // already requested?
+    map<string, XTextureJob *>::iterator it = m_byPath.find( key );
+    if( it != m_byPath.end() ) return it->second->atlas;
+
+    // new
+    XTextureJob * job = new XTextureJob();
+    job->path = key;
+    job->minFilter = minFilter;
+    job->magFilter = magFilter;
+    job->atlasPaths = paths;
+    job->atlas = new XTextureAtlas();
+    // whole texture per region until ready
+    job->atlas->regions.resize( paths.size() );
+    request( job );
+    job->atlas->texture = job->texture;
+
+    return job->atlas;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: request()
+// desc: create texture with placeholder, remember, and queue (or decode
+//       here if no worker could be started) (GL thread)
+//-----------------------------------------------------------------------------
+void XTextureManager::request( XTextureJob * job )
+{
+    // no threads yet
+    if( m_threads.size() == 0 ) init();
+
+    // the texture, with a placeholder until the real one is uploaded
+    glGenTextures( 1, &job->texture );
+    glBindTexture( GL_TEXTURE_2D, job->texture );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, job->minFilter );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, job->magFilter );
+    // (complete with one level, whatever the filter)
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0 );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_LUMINANCE, 1, 1, 0,
+                  GL_LUMINANCE, GL_UNSIGNED_BYTE, &m_placeholder );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+
+    // remember
+    m_jobs.push_back( job );
+    m_byPath[job->path] = job;
+    m_byTexture[job->texture] = job;
+    if( m_numPending == 0 ) m_startTime = XGfx::getMonotonicTime();
+    m_numPending++;
+
+    // no workers (none would start): decode here, ready for update()
+    if( m_threads.size() == 0 )
+    {
+        if( job->atlas ) bake( job );
+        else decode( job );
+        m_mutex.acquire();
+        m_decoded.push_back( job );
+        m_mutex.release();
+        return;
+    }
+
+    // hand to workers
+    m_mutex.acquire();
+    m_queue.push_back( job );
+    m_queueCond.signal();
+    m_mutex.release();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: update()
+// desc: upload decoded textures, up to the budget, at least one; returns
+//       number of textures uploaded (GL thread)
+//-----------------------------------------------------------------------------
+unsigned int XTextureManager::update()
+{
+    // nothing outstanding
+    if( m_numPending == 0 ) return 0;
+
+    unsigned int count = 0;
+    size_t bytes = 0;
+
+    while( count == 0 || bytes < m_budget )
+    {
+        // next
+        m_mutex.acquire();
+        XTextureJob * job = NULL;
+        if( m_decoded.size() )
+        {
+            job = m_decoded.front();
+            m_decoded.pop_front();
+        }
+        m_mutex.release();
+        // check
+        if( !job ) break;
+
+        // upload
+        bytes += job->bytes();
+        upload( job );
+        count++;
+    }
+
+    // log
+    if( count && m_numPending == 0 )
+        fprintf( stderr, "[x-texture]: all textures ready (%.1f ms)\n",
+                 1000 * ( XGfx::getMonotonicTime() - m_startTime ) );
+
+    return count;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: finish()
+// desc: block until everything requested so far is uploaded (GL thread)
+//-----------------------------------------------------------------------------
+void XTextureManager::finish()
+{
+    size_t budget = m_budget;
+    // no limit
+    m_budget = (size_t)-1;
+
+    while( m_numPending )
+    {
+        // wait for at least one
+        m_mutex.acquire();
+        while( m_decoded.size() == 0 ) m_decodedCond.wait( m_mutex );
+        m_mutex.release();
+        // upload
+        update();
+    }
+
+    m_budget = budget;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: isReady()
+// desc: is the texture uploaded?
+//-----------------------------------------------------------------------------
+bool XTextureManager::isReady( GLuint texture ) const
+{
+    map<GLuint, XTextureJob *>::const_iterator it = m_byTexture.find( texture );
+    return it != m_byTexture.end() && it->second->ready;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: isFailed()
+// desc: did it fail to load?
+//-----------------------------------------------------------------------------
+bool XTextureManager::isFailed( GLuint texture ) const
+{
+    map<GLuint, XTextureJob *>::const_iterator it = m_byTexture.find( texture );
+    return it != m_byTexture.end() && it->second->failed;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: worker()
+// desc: decoder thread
+//-----------------------------------------------------------------------------
+THREAD_RETURN THREAD_TYPE XTextureManager::worker( void * data )
+{
+    XTextureManager * self = (XTextureManager *)data;
+
+    for( ;; )
+    {
+        // next job
+        self->m_mutex.acquire();
+        while( !self->m_quit && self->m_queue.size() == 0 )
+            self->m_queueCond.wait( self->m_mutex );
+        // done
+        if( self->m_quit )
+        {
+            self->m_mutex.release();
+            break;
+        }
+        XTextureJob * job = self->m_queue.front();
+        self->m_queue.pop_front();
+        self->m_mutex.release();
+
+        // decode (no lock held)
+        if( job->atlas ) bake( job );
+        else decode( job );
+
+        // hand back
+        self->m_mutex.acquire();
+        self->m_decoded.push_back( job );
+        self->m_decodedCond.signal();
+        self->m_mutex.release();
+    }
+
+    return 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: decodeFile()
+// desc: decode one image file by extension (.bw luminance, else RGBA)
+//-----------------------------------------------------------------------------
+static unsigned char * decodeFile( const string & path, int * width,
+                                   int * height, int * components )
+{
+    // extension
+    string::size_type dot = path.rfind( '.' );
+    string ext = dot == string::npos ? "" : path.substr( dot + 1 );
+
+    if( ext == "bw" )
+    {
+        // luminance (one thread per file; workers already run in parallel)
+        return loadLuminance( path.c_str(), width, height, components, 1 );
+    }
+
+    // rgb(a), expanded to RGBA
+    GeImageData image;
+    if( !ge_read_image( path.c_str(), &image, 1 ) ) return NULL;
+    *width = image.width;
+    *height = image.height;
+    *components = 4;
+    return (unsigned char *)image.bits;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: decode()
+// desc: decode one file (worker thread)
+//-----------------------------------------------------------------------------
+void XTextureManager::decode( XTextureJob * job )
+{
+    job->pixels = decodeFile( job->path, &job->width, &job->height, &job->components );
+
+    // check
+    if( !job->pixels )
+    {
+        fprintf( stderr, "[x-texture]: cannot decode '%s'...\n", job->path.c_str() );
+        job->failed = true;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: nextPow2()
+// desc: smallest power of 2 >= n
+//-----------------------------------------------------------------------------
+static int nextPow2( int n )
+{
+    int p = 1;
+    while( p < n ) p <<= 1;
+    return p;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: bake()
+// desc: decode images, pack them into one texture, build mipmaps (worker
+//       thread). each image gets a power-of-2 square cell; cells are placed
+//       largest first on shelves, so every cell sits on a multiple of its
+//       own size and a 2x2 box filter never mixes two images until the
+//       smallest cell is down to one texel -- the chain stops there.
+//-----------------------------------------------------------------------------
+void XTextureManager::bake( XTextureJob * job )
+{
+    size_t n = job->atlasPaths.size();
+    // check
+    if( n == 0 ) { job->failed = true; return; }
+
+    // decode all
+    vector<unsigned char *> images( n, (unsigned char *)NULL );
+    vector<int> widths( n ), heights( n ), comps( n ), cells( n );
+    job->components = 1;
+    for( size_t i = 0; i < n; i++ )
+    {
+        images[i] = decodeFile( job->atlasPaths[i], &widths[i], &heights[i], &comps[i] );
+        if( !images[i] )
+        {
+            fprintf( stderr, "[x-texture]: cannot decode '%s'...\n", job->atlasPaths[i].c_str() );
+            job->failed = true;
+            break;
+        }
+        // RGBA if any is
+        if( comps[i] > 1 ) job->components = 4;
+        cells[i] = nextPow2( widths[i] > heights[i] ? widths[i] : heights[i] );
+    }
+
+    // cell order: largest first (stable)
+    vector<size_t> order;
+    for( size_t i = 0; i < n && !job->failed; i++ )
+    {
+        vector<size_t>::iterator it = order.begin();
+        while( it != order.end() && cells[*it] >= cells[i] ) it++;
+        order.insert( it, i );
+    }
+
+    // pack on shelves, widening until it is no taller than wide
+    vector<int> xs( n ), ys( n );
+    int width = job->failed ? 0 : cells[order[0]], height = 0;
+    while( !job->failed )
+    {
+        int x = 0, y = 0, shelf = 0;
+        for( size_t k = 0; k < order.size(); k++ )
+        {
+            size_t i = order[k];
+            // next shelf
+            if( x + cells[i] > width ) { y += shelf; x = 0; shelf = 0; }
+            // first on a shelf is the tallest
+            if( shelf == 0 ) shelf = cells[i];
+            xs[i] = x; ys[i] = y;
+            x += cells[i];
+        }
+        height = nextPow2( y + shelf );
+        if( height <= width ) break;
+        width *= 2;
+    }
+
+    if( !job->failed )
+    {
+        int c = job->components;
+        // levels down to the smallest cell at 1x1
+        int smallest = cells[order.back()];
+        job->levels = 1;
+        while( ( 1 << ( job->levels - 1 ) ) < smallest ) job->levels++;
+        job->width = width;
+        job->height = height;
+
+        // all levels, empty space black
+        job->pixels = (unsigned char *)calloc( job->bytes(), 1 );
+        if( !job->pixels ) job->failed = true;
+
+        // level 0: copy in images (rows are bottom-up, like GL)
+        for( size_t i = 0; i < n && !job->failed; i++ )
+        {
+            for( int y = 0; y < heights[i]; y++ )
+            {
+                unsigned char * dest = job->pixels + ( (size_t)( ys[i] + y ) * width + xs[i] ) * c;
+                const unsigned char * src = images[i] + (size_t)y * widths[i] * comps[i];
+                if( comps[i] == c ) memcpy( dest, src, (size_t)widths[i] * c );
+                else for( int x = 0; x < widths[i]; x++ )
+                {
+                    // gray to RGBA
+                    dest[x*4] = dest[x*4+1] = dest[x*4+2] = src[x];
+                    dest[x*4+3] = 0xff;
+                }
+            }
+
+            // lookup table (half-texel inset at level 0)
+            XTextureRegion r;
+            r.u0 = ( xs[i] + .5f ) / width;
+            r.v0 = ( ys[i] + .5f ) / height;
+            r.u1 = ( xs[i] + widths[i] - .5f ) / width;
+            r.v1 = ( ys[i] + heights[i] - .5f ) / height;
+            job->regions.push_back( r );
+        }
+
+        // mip levels: 2x2 box filter of the previous one
+        unsigned char * prev = job->pixels;
+        for( int level = 1; level < job->levels && !job->failed; level++ )
+        {
+            int pw = width >> ( level - 1 ), w = width >> level, h = height >> level;
+            unsigned char * dest = prev + (size_t)pw * ( height >> ( level - 1 ) ) * c;
+            for( int y = 0; y < h; y++ )
+            {
+                const unsigned char * r0 = prev + (size_t)( 2 * y ) * pw * c;
+                const unsigned char * r1 = r0 + (size_t)pw * c;
+                unsigned char * out = dest + (size_t)y * w * c;
+                for( int x = 0; x < w * c; x++ )
+                {
+                    // x is (pixel, channel); neighbors are c apart
+                    int p = ( x / c ) * 2 * c + x % c;
+                    out[x] = ( r0[p] + r0[p+c] + r1[p] + r1[p+c] + 2 ) >> 2;
+                }
+            }
+            prev = dest;
+        }
+    }
+
+    // done with sources
+    for( size_t i = 0; i < n; i++ ) if( images[i] ) free( images[i] );
+
+    // log
+    if( !job->failed )
+        fprintf( stderr, "[x-texture]: baked %d images into %dx%d atlas (%d levels)\n",
+                 (int)n, job->width, job->height, job->levels );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: upload()
+// desc: upload one decoded texture (GL thread)
+//-----------------------------------------------------------------------------
+void XTextureManager::upload( XTextureJob * job )
+{
+    // no longer pending either way
+    m_numPending--;
+    // check
+    if( job->failed ) return;
+
+    // first time
+    if( !m_pboChecked ) checkPBO();
+
+    // format
+    GLenum format = job->components == 1 ? GL_LUMINANCE :
+                    job->components == 3 ? GL_RGB : GL_RGBA;
+    size_t size = job->bytes();
+    // where the pixels come from
+    const unsigned char * source = job->pixels;
+
+    XGfx::bindTexture( GL_TEXTURE_2D, job->texture );
+    glPushClientAttrib( GL_CLIENT_PIXEL_STORE_BIT );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+    if( job->mipmaps )
+    {
+        // GLU builds the chain on the CPU anyway
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000 );
+        gluBuild2DMipmaps( GL_TEXTURE_2D, format, job->width, job->height,
+                           format, GL_UNSIGNED_BYTE, job->pixels );
+    }
+    else
+    {
+        if( m_pboSupported )
+        {
+            // stream through the buffer (orphaned each time, so no stall)
+            glBindBuffer( GL_PIXEL_UNPACK_BUFFER, m_pbo );
+            glBufferData( GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW );
+            void * dest = glMapBuffer( GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY );
+            if( dest )
+            {
+                memcpy( dest, job->pixels, size );
+                glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+                // offsets into the buffer from here
+                source = NULL;
+            }
+            else
+            {
+                // fall back
+                glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+            }
+        }
+
+        // every level we have
+        size_t offset = 0;
+        for( int i = 0; i < job->levels; i++ )
+        {
+            int w = job->width >> i, h = job->height >> i;
+            glTexImage2D( GL_TEXTURE_2D, i, format, w, h, 0,
+                          format, GL_UNSIGNED_BYTE, source + offset );
+            offset += (size_t)w * h * job->components;
+        }
+        glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, job->levels - 1 );
+
+        if( !source ) glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+    }
+
+    glPopClientAttrib();
+    XGfx::bindTexture( GL_TEXTURE_2D, 0 );
+
+    // atlas lookup table
+    if( job->atlas )
+    {
+        job->atlas->regions = job->regions;
+        job->atlas->ready = true;
+    }
+
+    // done with pixels
+    free( job->pixels );
+    job->pixels = NULL;
+    job->ready = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: checkPBO()
+// desc: see if pixel buffer objects are supported; set one up
+//-----------------------------------------------------------------------------
+void XTextureManager::checkPBO()
+{
+    m_pboChecked = true;
+
+    // core since 2.1
+    const char * version = (const char *)glGetString( GL_VERSION );
+    const char * ext = (const char *)glGetString( GL_EXTENSIONS );
+    // check
+    m_pboSupported = ( version && atof( version ) >= 2.1 ) ||
+                     ( ext && strstr( ext, "GL_ARB_pixel_buffer_object" ) );
+
+    // set up
+    if( m_pboSupported ) glGenBuffers( 1, &m_pbo );
+}
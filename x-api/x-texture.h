@@ -0,0 +1,210 @@
+//-----------------------------------------------------------------------------
+// name: x-texture.h
+// desc: texture manager: decodes image files on worker threads, uploads
+//       them on the GL thread within a per-frame budget
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_X_TEXTURE_H__
+#define __MCD_X_TEXTURE_H__
+
+#include "x-gfx.h"
+#include "x-thread.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+
+// default upload budget per frame (bytes)
+#define XTEXTURE_DEFAULT_BUDGET (1 << 20)
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XTextureRegion
+// desc: where one image lives in an atlas (texture coordinates)
+//-----------------------------------------------------------------------------
+struct XTextureRegion
+{
+    GLfloat u0, v0;
+    GLfloat u1, v1;
+
+    // constructor (whole texture)
+    XTextureRegion() : u0(0), v0(0), u1(1), v1(1) { }
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XTextureAtlas
+// desc: several images packed into one mipmapped texture; regions are in the
+//       order the images were given (whole texture until ready)
+//-----------------------------------------------------------------------------
+struct XTextureAtlas
+{
+    // GL texture name (valid from request on)
+    GLuint texture;
+    // lookup table
+    std::vector<XTextureRegion> regions;
+    // uploaded?
+    bool ready;
+
+    // constructor
+    XTextureAtlas() : texture(0), ready(false) { }
+
+    // number of regions
+    long numRegions() const { return (long)regions.size(); }
+    // get a region (whole texture if out of range)
+    XTextureRegion region( long index ) const
+    { return index >= 0 && (size_t)index < regions.size() ? regions[index] : XTextureRegion(); }
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XTextureJob
+// desc: one texture, from request to upload
+//-----------------------------------------------------------------------------
+struct XTextureJob
+{
+    // file
+    std::string path;
+    // GL texture name (valid from request on)
+    GLuint texture;
+    // filtering
+    GLenum minFilter;
+    GLenum magFilter;
+    bool mipmaps;
+    // decoded pixels (malloc'ed; worker to GL thread), all mip levels
+    unsigned char * pixels;
+    int width;
+    int height;
+    int components;
+    int levels;
+    // state
+    bool ready;
+    bool failed;
+
+    // atlas: source images, and where they went
+    std::vector<std::string> atlasPaths;
+    XTextureAtlas * atlas;
+    std::vector<XTextureRegion> regions;
+
+    // constructor
+    XTextureJob() : texture(0), minFilter(GL_LINEAR), magFilter(GL_LINEAR),
+        mipmaps(false), pixels(NULL), width(0), height(0), components(0),
+        levels(1), ready(false), failed(false), atlas(NULL) { }
+
+    // bytes in pixels
+    size_t bytes() const
+    {
+        size_t total = 0;
+        for( int i = 0; i < levels; i++ )
+            total += (size_t)( width >> i ) * ( height >> i ) * components;
+        return total;
+    }
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class XTextureManager
+// desc: load() hands back a texture right away (showing a 1x1 placeholder);
+//       worker threads decode the file (.bw, .rgb, .rgba, .sgi); update()
+//       uploads finished images through a pixel buffer object if available
+//-----------------------------------------------------------------------------
+class XTextureManager
+{
+public:
+    XTextureManager();
+    ~XTextureManager();
+
+public:
+    // start decoder threads (0 == one per core, minus one, at least one)
+    bool init( unsigned int numThreads = 0 );
+    // stop threads, delete all textures (GL thread)
+    void cleanup();
+
+public:
+    // request a texture by path; same path returns the same texture (GL thread)
+    GLuint load( const std::string & path, GLenum minFilter = GL_LINEAR,
+                 GLenum magFilter = GL_LINEAR, bool mipmaps = false );
+    // request an atlas of several images (bakes mipmaps on a worker);
+    // same list returns the same atlas (GL thread)
+    XTextureAtlas * loadAtlas( const std::vector<std::string> & paths,
+                               GLenum minFilter = GL_LINEAR_MIPMAP_LINEAR,
+                               GLenum magFilter = GL_LINEAR );
+    // upload decoded textures, up to the budget, at least one (GL thread)
+    unsigned int update();
+    // block until everything requested so far is uploaded (GL thread)
+    void finish();
+
+public:
+    // is the texture uploaded?
+    bool isReady( GLuint texture ) const;
+    // did it fail to load?
+    bool isFailed( GLuint texture ) const;
+    // number of requested textures not yet uploaded
+    unsigned int numPending() const { return m_numPending; }
+    // set upload budget per update() (bytes)
+    void setUploadBudget( size_t bytes ) { m_budget = bytes; }
+    // get it
+    size_t getUploadBudget() const { return m_budget; }
+    // set placeholder luminance (0-255; applies to later requests)
+    void setPlaceholder( unsigned char value ) { m_placeholder = value; }
+
+protected:
+    // worker thread
+    static THREAD_RETURN THREAD_TYPE worker( void * data );
+    // decode one file (worker thread)
+    static void decode( XTextureJob * job );
+    // decode and pack an atlas (worker thread)
+    static void bake( XTextureJob * job );
+    // create texture with placeholder, remember, and queue (GL thread)
+    void request( XTextureJob * job );
+    // upload one decoded texture (GL thread)
+    void upload( XTextureJob * job );
+    // check for pixel buffer objects (GL thread)
+    void checkPBO();
+
+protected:
+    // all textures, by path and by name (GL thread)
+    std::vector<XTextureJob *> m_jobs;
+    std::map<std::string, XTextureJob *> m_byPath;
+    std::map<GLuint, XTextureJob *> m_byTexture;
+    unsigned int m_numPending;
+    size_t m_budget;
+    unsigned char m_placeholder;
+    // when the first pending request came in
+    double m_startTime;
+
+protected:
+    // threads
+    std::vector<XThread *> m_threads;
+    // guards the queues and m_quit
+    XMutex m_mutex;
+    // to decode
+    std::deque<XTextureJob *> m_queue;
+    XCondition m_queueCond;
+    // to upload
+    std::deque<XTextureJob *> m_decoded;
+    XCondition m_decodedCond;
+    // stop
+    bool m_quit;
+
+protected:
+    // pixel buffer object
+    bool m_pboChecked;
+    bool m_pboSupported;
+    GLuint m_pbo;
+};
+
+
+
+
+#endif
@@ -39,6 +39,10 @@
 //    date: Fall 2010
 //-----------------------------------------------------------------------------
 #include "x-thread.h"
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+#include <sys/time.h>
+#include <errno.h>
+#endif
 
 
 
@@ -126,6 +130,30 @@ bool XThread::wait( long milliseconds )
 
 
 
+//-----------------------------------------------------------------------------
+// name: join()
+// desc: wait for the thread routine to return on its own (no cancel)
+//-----------------------------------------------------------------------------
+bool XThread::join( )
+{
+    // check
+    if( thread == 0 ) return false;
+
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    if( pthread_join( thread, NULL ) != 0 ) return false;
+#elif defined(__PLATFORM_WIN32__)
+    if( WaitForSingleObject( (HANDLE)thread, INFINITE ) != WAIT_OBJECT_0 ) return false;
+    CloseHandle( (HANDLE)thread );
+#endif
+
+    // done
+    thread = 0;
+    return true;
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: test()
 // desc: ...
@@ -200,3 +228,106 @@ void XMutex::release( )
     LeaveCriticalSection(&mutex);
 #endif 
 }
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: XCondition()
+// desc: ...
+//-----------------------------------------------------------------------------
+XCondition::XCondition( )
+{
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    pthread_cond_init( &cond, NULL );
+#elif defined(__PLATFORM_WIN32__)
+    InitializeConditionVariable( &cond );
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~XCondition()
+// desc: ...
+//-----------------------------------------------------------------------------
+XCondition::~XCondition( )
+{
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    pthread_cond_destroy( &cond );
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: wait()
+// desc: wait for a signal; mutex must be acquired, and is again on return
+//-----------------------------------------------------------------------------
+void XCondition::wait( XMutex & mutex )
+{
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    pthread_cond_wait( &cond, &mutex.mutex );
+#elif defined(__PLATFORM_WIN32__)
+    SleepConditionVariableCS( &cond, &mutex.mutex, INFINITE );
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: wait()
+// desc: wait for a signal or the given number of seconds; false if it timed
+//       out (the mutex is acquired again either way)
+//-----------------------------------------------------------------------------
+bool XCondition::wait( XMutex & mutex, double seconds )
+{
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    // absolute (wall clock) deadline
+    struct timeval now;
+    gettimeofday( &now, NULL );
+    double deadline = now.tv_sec + now.tv_usec / 1000000.0 + ( seconds > 0 ? seconds : 0 );
+    struct timespec until;
+    until.tv_sec = (time_t)deadline;
+    until.tv_nsec = (long)( ( deadline - until.tv_sec ) * 1000000000.0 );
+    if( until.tv_nsec >= 1000000000 ) until.tv_nsec = 999999999;
+    return pthread_cond_timedwait( &cond, &mutex.mutex, &until ) != ETIMEDOUT;
+#elif defined(__PLATFORM_WIN32__)
+    return SleepConditionVariableCS( &cond, &mutex.mutex, (DWORD)( seconds * 1000 ) ) != 0;
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: signal()
+// desc: wake one waiter
+//-----------------------------------------------------------------------------
+void XCondition::signal( )
+{
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    pthread_cond_signal( &cond );
+#elif defined(__PLATFORM_WIN32__)
+    WakeConditionVariable( &cond );
+#endif
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: broadcast()
+// desc: wake all waiters
+//-----------------------------------------------------------------------------
+void XCondition::broadcast( )
+{
+#if ( defined(__PLATFORM_MACOSX__) || defined(__PLATFORM_LINUX__) || defined(__WINDOWS_PTHREAD__) )
+    pthread_cond_broadcast( &cond );
+#elif defined(__PLATFORM_WIN32__)
+    WakeAllConditionVariable( &cond );
+#endif
+}
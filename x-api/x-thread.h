@@ -53,6 +53,7 @@
   typedef void * THREAD_RETURN;
   typedef void * (*THREAD_FUNCTION)(void *);
   typedef pthread_mutex_t MUTEX;
+  typedef pthread_cond_t CONDITION;
   #define CHUCK_THREAD pthread_t
 #elif defined(__PLATFORM_WIN32__)
   #include <windows.h>
@@ -62,6 +63,7 @@
   typedef unsigned THREAD_RETURN;
   typedef unsigned (__stdcall *THREAD_FUNCTION)(void *);
   typedef CRITICAL_SECTION MUTEX;
+  typedef CONDITION_VARIABLE CONDITION;
   #define CHUCK_THREAD HANDLE
 #endif
 
@@ -85,6 +87,8 @@ public:
 
     // wait the specified number of milliseconds for the thread to terminate
     bool wait( long milliseconds = -1 );
+    // wait for the thread routine to return on its own (no cancel)
+    bool join();
 
 public:
     // test for a thread cancellation request.
@@ -116,6 +120,36 @@ public:
 
 protected:
     MUTEX mutex;
+
+    // condition waits on the underlying mutex
+    friend struct XCondition;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: struct XCondition
+// desc: condition variable (used with an XMutex)
+//-----------------------------------------------------------------------------
+struct XCondition
+{
+public:
+    XCondition();
+    ~XCondition();
+
+public:
+    // wait for a signal; mutex must be acquired, and is again on return
+    void wait( XMutex & mutex );
+    // wait at most the given number of seconds; false if it timed out
+    bool wait( XMutex & mutex, double seconds );
+    // wake one waiter
+    void signal();
+    // wake all waiters
+    void broadcast();
+
+protected:
+    CONDITION cond;
 };
 
 
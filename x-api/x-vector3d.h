@@ -46,6 +46,10 @@
   #include <OpenGL/gl.h>
   #include <OpenGL/glu.h>
 #else
+  // declare GL 1.5+ entry points (queries, buffers, shaders)
+  #ifndef GL_GLEXT_PROTOTYPES
+  #define GL_GLEXT_PROTOTYPES
+  #endif
   #include <GL/glut.h>
   #include <GL/gl.h>
   #include <GL/glu.h>
@@ -35,6 +35,8 @@
 // date: spring 2013
 //-----------------------------------------------------------------------------
 #include "y-charting.h"
+#include <string.h>
+#include <math.h>
 
 
 
@@ -210,17 +212,12 @@ void YHistogram::render()
 // desc: constructor
 //-----------------------------------------------------------------------------
 YHistoBin::YHistoBin()
+// value defaults to 0 (slew 2); height and width grow to .25 (slew 5)
+: m_iValue( 0, 0, 2 ), m_iHeight( 0, .25, 5 ), m_iWidth( 0, .25, 5 ),
+  m_iColor( 4.0f )
 {
     // default
     m_maxValue = 1;
-    // default to 0 with slew of 1
-    m_iValue.set( 0, 0, 2 );
-    // height default
-    m_iHeight.set( 0, .25, 5 );
-    // width default
-    m_iWidth.set( 0, .25, 5 );
-    // set slew
-    m_iColor.setSlew( 4.0f );
     
     // set text
     m_textValue.setWidth(1.0);
@@ -271,7 +268,7 @@ void YHistoBin::setMaxValue( GLfloat max )
 //-----------------------------------------------------------------------------
 GLfloat YHistoBin::getValue() const
 {
-    return m_iValue.goal;
+    return m_iValue.goal();
 }
 
 
@@ -301,7 +298,7 @@ GLfloat YHistoBin::getPercentValue() const
     // sanity check
     if( m_maxValue == 0 ) return 0;
     // return as percentage
-    return m_iValue.goal / m_maxValue;
+    return m_iValue.goal() / m_maxValue;
 }
 
 
@@ -326,7 +323,7 @@ void YHistoBin::setPercentValue( GLfloat percentValue )
 //-----------------------------------------------------------------------------
 GLfloat YHistoBin::getValueSlew() const
 {
-    return m_iValue.slew;
+    return m_iValue.slew();
 }
 
 
@@ -337,7 +334,7 @@ GLfloat YHistoBin::getValueSlew() const
 //-----------------------------------------------------------------------------
 void YHistoBin::setValueSlew( GLfloat slew )
 {
-    m_iValue.slew = slew;
+    m_iValue.setSlew( slew );
 }
 
 
@@ -349,7 +346,7 @@ void YHistoBin::setValueSlew( GLfloat slew )
 //-----------------------------------------------------------------------------
 GLfloat YHistoBin::getHeight() const
 {
-    return m_iHeight.goal;
+    return m_iHeight.goal();
 }
 
 
@@ -373,7 +370,7 @@ void YHistoBin::setHeight( GLfloat height )
 //-----------------------------------------------------------------------------
 GLfloat YHistoBin::getWidth() const
 {
-    return m_iWidth.goal;
+    return m_iWidth.goal();
 }
 
 
@@ -435,12 +432,7 @@ void YHistoBin::setColor( const Vector3D & c )
 //-----------------------------------------------------------------------------
 void YHistoBin::update( YTimeInterval dt )
 {
-    // interpolate
-    m_iValue.interp( dt );
-    m_iWidth.interp( dt );
-    m_iHeight.interp( dt );
-    m_iColor.interp( dt );
-    
+    // (slews are advanced with the global bank)
     // set
     this->col = m_iColor.actual();
     
@@ -461,11 +453,11 @@ void YHistoBin::render()
     if( !active ) return;
 
     // disable lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
 
     // depth
-    if( useDepth ) glEnable( GL_DEPTH_TEST );
-    else glDisable( GL_DEPTH_TEST );
+    if( useDepth ) XGfx::enable( GL_DEPTH_TEST );
+    else XGfx::disable( GL_DEPTH_TEST );
 
     // disable writing
     glDepthMask( GL_FALSE );
@@ -474,14 +466,14 @@ void YHistoBin::render()
     if( texture )
     {
         // enable texture mapping
-        glEnable( GL_TEXTURE_2D );
+        XGfx::enable( GL_TEXTURE_2D );
         // enable blending
-        glEnable( GL_BLEND );
+        XGfx::enable( GL_BLEND );
         // blend function
         // glBlendFunc( GL_ONE, GL_ONE );
-        glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+        XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
         // bind the texture
-        glBindTexture( GL_TEXTURE_2D, texture );
+        XGfx::bindTexture( GL_TEXTURE_2D, texture );
     }
     
     // enable
@@ -499,7 +491,7 @@ void YHistoBin::render()
     }
 
     // triangle strip
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
     
     // if texture
     if( texture )
@@ -515,7 +507,7 @@ void YHistoBin::render()
     // outline
     glVertexPointer( 2, GL_FLOAT, 0, outline );
     // line strip
-    glDrawArrays( GL_LINE_LOOP, 0, 4 );
+    XGfx::drawArrays( GL_LINE_LOOP, 0, 4 );
 
     // disable
     glDisableClientState( GL_VERTEX_ARRAY );
@@ -524,8 +516,8 @@ void YHistoBin::render()
     if( texture )
     {
         // disable
-        glDisable( GL_TEXTURE_2D );
-        glDisable( GL_BLEND );
+        XGfx::disable( GL_TEXTURE_2D );
+        XGfx::disable( GL_BLEND );
     }
 
     // enable writing
@@ -542,20 +534,20 @@ void YHistoBin::render()
 void YHistoBin::computeVertices()
 {
     // compute half width
-    GLfloat half_width = m_iWidth.value / 2;
+    GLfloat half_width = m_iWidth.value() / 2;
     // compute height
-    GLfloat height = m_iHeight.value * m_iValue.value / m_maxValue;
+    GLfloat height = m_iHeight.value() * m_iValue.value() / m_maxValue;
 
     // compute text width
-    GLfloat text_width = m_iWidth.value * 3;
+    GLfloat text_width = m_iWidth.value() * 3;
     m_textValue.sca.set( text_width, text_width, text_width );
-    sprintf( m_strbuf, "%i", (int)(m_iValue.value + .9) );
+    sprintf( m_strbuf, "%i", (int)(m_iValue.value() + .9) );
     m_textValue.set( m_strbuf );
-    m_textValue.setCenterLocation( Vector3D( 0, height + m_iWidth.value * .3, 0 ) );
+    m_textValue.setCenterLocation( Vector3D( 0, height + m_iWidth.value() * .3, 0 ) );
     m_textLabel.sca.set( text_width, text_width, text_width );
     sprintf( m_strbuf, "%s", m_name.c_str() );
     m_textLabel.set( m_strbuf );
-    m_textLabel.setCenterLocation( Vector3D( 0, -.05 - .1*m_iWidth.value, 0 ) );
+    m_textLabel.setCenterLocation( Vector3D( 0, -.05 - .1*m_iWidth.value(), 0 ) );
 
     // generate vertices
     vertices[0] = -half_width;
@@ -581,6 +573,378 @@ void YHistoBin::computeVertices()
 
 
 
+// floats per bin (two triangles)
+#define YFAST_FLOATS_PER_BIN 12
+// close enough to the goal to stop moving (relative to max value)
+#define YFAST_EPSILON .0005f
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: YFastHistogram()
+// desc: constructor
+//-----------------------------------------------------------------------------
+YFastHistogram::YFastHistogram()
+{
+    // default
+    m_width = 0;
+    m_height = 0;
+    m_maxValue = 1;
+    m_slew = 2;
+    m_activeBegin = m_activeEnd = 0;
+    m_dirtyBegin = m_dirtyEnd = 0;
+    m_vbo = 0;
+    m_realloc = false;
+    m_showLabels = false;
+    m_labelsDirty = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~YFastHistogram()
+// desc: destructor
+//-----------------------------------------------------------------------------
+YFastHistogram::~YFastHistogram()
+{
+    cleanup();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: init()
+// desc: initialize
+//-----------------------------------------------------------------------------
+void YFastHistogram::init( GLfloat width, GLfloat height, unsigned int numBins )
+{
+    // clean up first
+    cleanup();
+
+    // set
+    m_width = width;
+    m_height = height;
+    m_values.assign( numBins, 0 );
+    m_goals.assign( numBins, 0 );
+    m_names.assign( numBins, "" );
+    m_vertices.assign( numBins * YFAST_FLOATS_PER_BIN, 0 );
+
+    // all vertices
+    computeVertices( 0, numBins );
+    m_realloc = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cleanup()
+// desc: ...
+//-----------------------------------------------------------------------------
+void YFastHistogram::cleanup()
+{
+    // GL
+    if( m_vbo ) glDeleteBuffers( 1, &m_vbo );
+    m_vbo = 0;
+
+    // clear
+    m_values.clear();
+    m_goals.clear();
+    m_names.clear();
+    m_vertices.clear();
+    m_labels.clear();
+    m_activeBegin = m_activeEnd = 0;
+    m_dirtyBegin = m_dirtyEnd = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setMaxValue()
+// desc: set max value
+//-----------------------------------------------------------------------------
+void YFastHistogram::setMaxValue( GLfloat value )
+{
+    // sanity check
+    if( value <= 0 ) return;
+
+    m_maxValue = value;
+    // every bar changes
+    touch( 0, m_values.size() );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setValue()
+// desc: set one bin's value
+//-----------------------------------------------------------------------------
+void YFastHistogram::setValue( unsigned int bin, GLfloat value )
+{
+    // sanity check
+    if( bin >= m_goals.size() ) return;
+
+    // set goal
+    m_goals[bin] = value;
+    // moving
+    if( m_activeBegin == m_activeEnd ) { m_activeBegin = bin; m_activeEnd = bin + 1; }
+    else
+    {
+        if( bin < m_activeBegin ) m_activeBegin = bin;
+        if( bin + 1 > m_activeEnd ) m_activeEnd = bin + 1;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setValues()
+// desc: set count bins' values, starting at first
+//-----------------------------------------------------------------------------
+void YFastHistogram::setValues( const GLfloat * values, unsigned int count, unsigned int first )
+{
+    // sanity check
+    if( first >= m_goals.size() ) return;
+    if( first + count > m_goals.size() ) count = m_goals.size() - first;
+    if( count == 0 ) return;
+
+    // copy goals
+    memcpy( &m_goals[first], values, count * sizeof(GLfloat) );
+    // moving
+    if( m_activeBegin == m_activeEnd ) { m_activeBegin = first; m_activeEnd = first + count; }
+    else
+    {
+        if( first < m_activeBegin ) m_activeBegin = first;
+        if( first + count > m_activeEnd ) m_activeEnd = first + count;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getValue()
+// desc: get one bin's value (goal)
+//-----------------------------------------------------------------------------
+GLfloat YFastHistogram::getValue( unsigned int bin ) const
+{
+    // sanity check
+    if( bin >= m_goals.size() ) return 0;
+    return m_goals[bin];
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setName()
+// desc: set one bin's name
+//-----------------------------------------------------------------------------
+void YFastHistogram::setName( unsigned int bin, const std::string & name )
+{
+    // sanity check
+    if( bin >= m_names.size() || m_names[bin] == name ) return;
+
+    m_names[bin] = name;
+    m_labelsDirty = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: touch()
+// desc: add bins to the dirty range
+//-----------------------------------------------------------------------------
+void YFastHistogram::touch( unsigned int begin, unsigned int end )
+{
+    // check
+    if( begin >= end ) return;
+
+    // merge
+    if( m_dirtyBegin == m_dirtyEnd ) { m_dirtyBegin = begin; m_dirtyEnd = end; }
+    else
+    {
+        if( begin < m_dirtyBegin ) m_dirtyBegin = begin;
+        if( end > m_dirtyEnd ) m_dirtyEnd = end;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: update()
+// desc: slew all moving bins in one pass
+//-----------------------------------------------------------------------------
+void YFastHistogram::update( YTimeInterval dt )
+{
+    // anything moving?
+    if( m_activeBegin == m_activeEnd ) return;
+
+    // same step as Vector3D::interp( dt ), clamped so it can't overshoot
+    GLfloat k = m_slew * dt;
+    if( k > 1 ) k = 1;
+    // snap threshold
+    GLfloat epsilon = YFAST_EPSILON * m_maxValue;
+
+    // flat arrays (no aliasing between them)
+    GLfloat * v = &m_values[0];
+    const GLfloat * g = &m_goals[0];
+    unsigned int begin = m_activeBegin, end = m_activeEnd;
+
+    // slew (vectorizes)
+    for( unsigned int i = begin; i < end; i++ )
+        v[i] += ( g[i] - v[i] ) * k;
+    // snap (vectorizes as a select)
+    for( unsigned int i = begin; i < end; i++ )
+        v[i] = fabsf( g[i] - v[i] ) < epsilon ? g[i] : v[i];
+
+    // these moved
+    touch( begin, end );
+
+    // shrink the moving range from both ends
+    while( begin < end && v[begin] == g[begin] ) begin++;
+    while( end > begin && v[end-1] == g[end-1] ) end--;
+    m_activeBegin = begin;
+    m_activeEnd = end;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: computeVertices()
+// desc: write vertices for bins [begin, end)
+//-----------------------------------------------------------------------------
+void YFastHistogram::computeVertices( unsigned int begin, unsigned int end )
+{
+    // bin geometry (as YHistogram)
+    GLfloat binWidth = m_values.size() ? m_width / m_values.size() : 0;
+    GLfloat half = binWidth * .985f / 2;
+    GLfloat scale = m_height / m_maxValue;
+
+    for( unsigned int i = begin; i < end; i++ )
+    {
+        GLfloat x = binWidth / 2 + i * binWidth;
+        GLfloat h = m_values[i] * scale;
+        GLfloat * p = &m_vertices[i * YFAST_FLOATS_PER_BIN];
+
+        // two triangles
+        p[0] = x - half; p[1] = 0;
+        p[2] = x + half; p[3] = 0;
+        p[4] = x - half; p[5] = h;
+        p[6] = x - half; p[7] = h;
+        p[8] = x + half; p[9] = 0;
+        p[10] = x + half; p[11] = h;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: buildLabels()
+// desc: rebuild label mesh (only when names change)
+//-----------------------------------------------------------------------------
+void YFastHistogram::buildLabels()
+{
+    m_labels.clear();
+
+    // bin geometry
+    GLfloat binWidth = m_names.size() ? m_width / m_names.size() : 0;
+    // text size relative to bin width (as YHistoBin)
+    GLfloat scale = binWidth * 3;
+
+    for( unsigned int i = 0; i < m_names.size(); i++ )
+    {
+        // check
+        if( m_names[i] == "" ) continue;
+        // centered under the bar
+        GLfloat length = .001f * scale * glutStrokeLength( GLUT_STROKE_ROMAN,
+                                    (const unsigned char *)m_names[i].c_str() );
+        m_labels.add( m_names[i], binWidth / 2 + i * binWidth - length / 2,
+                      -.05f - .1f * binWidth - .12f * scale, scale );
+    }
+
+    m_labelsDirty = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: render()
+// desc: one draw for all bars
+//-----------------------------------------------------------------------------
+void YFastHistogram::render()
+{
+    // check
+    if( m_values.size() == 0 ) return;
+
+    // first time
+    if( !m_vbo )
+    {
+        glGenBuffers( 1, &m_vbo );
+        m_realloc = true;
+    }
+    glBindBuffer( GL_ARRAY_BUFFER, m_vbo );
+
+    // upload
+    if( m_realloc )
+    {
+        // everything
+        computeVertices( 0, m_values.size() );
+        glBufferData( GL_ARRAY_BUFFER, m_vertices.size() * sizeof(GLfloat),
+                      &m_vertices[0], GL_DYNAMIC_DRAW );
+        m_realloc = false;
+        m_dirtyBegin = m_dirtyEnd = 0;
+    }
+    else if( m_dirtyBegin < m_dirtyEnd )
+    {
+        // only what changed
+        computeVertices( m_dirtyBegin, m_dirtyEnd );
+        glBufferSubData( GL_ARRAY_BUFFER,
+                         m_dirtyBegin * YFAST_FLOATS_PER_BIN * sizeof(GLfloat),
+                         (m_dirtyEnd - m_dirtyBegin) * YFAST_FLOATS_PER_BIN * sizeof(GLfloat),
+                         &m_vertices[m_dirtyBegin * YFAST_FLOATS_PER_BIN] );
+        m_dirtyBegin = m_dirtyEnd = 0;
+    }
+
+    // state (as YHistoBin)
+    XGfx::disable( GL_LIGHTING );
+    XGfx::disable( GL_DEPTH_TEST );
+    glDepthMask( GL_FALSE );
+
+    // bars
+    glColor4f( col.x, col.y, col.z, alpha );
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glVertexPointer( 2, GL_FLOAT, 0, 0 );
+    XGfx::drawArrays( GL_TRIANGLES, 0, m_values.size() * 6 );
+    glDisableClientState( GL_VERTEX_ARRAY );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    // labels
+    if( m_showLabels )
+    {
+        if( m_labelsDirty ) buildLabels();
+        glLineWidth( 1 );
+        m_labels.draw();
+    }
+
+    // enable writing
+    glDepthMask( GL_TRUE );
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: YLineChart()
 // desc: ...
@@ -39,6 +39,7 @@
 #define __MCD_Y_CHARTING_H__
 
 #include "y-entity.h"
+#include "x-slew.h"
 #include <vector>
 #include <string>
 
@@ -146,10 +147,11 @@ protected:
 
 protected:
     GLfloat m_maxValue;
-    Vector3D m_iValue;
-    Vector3D m_iHeight;
-    Vector3D m_iWidth;
-    iSlew3D m_iColor;
+    // slews (global bank)
+    XSlew m_iValue;
+    XSlew m_iHeight;
+    XSlew m_iWidth;
+    XSlew3D m_iColor;
     std::string m_name;
 
 protected:
@@ -171,6 +173,99 @@ protected:
 
 
 
+//-----------------------------------------------------------------------------
+// name: class YFastHistogram
+// desc: histogram for many bins (e.g., a live spectrum): values are slewed
+//       in one pass over flat arrays, all bars live in one vertex buffer,
+//       only the changed range is uploaded, and everything is one draw call
+//-----------------------------------------------------------------------------
+class YFastHistogram : public YEntity
+{
+public:
+    YFastHistogram();
+    ~YFastHistogram();
+
+public:
+    // initialize the histogram
+    void init( GLfloat width, GLfloat height, unsigned int numBins );
+    // clean up
+    void cleanup();
+    // set max value
+    void setMaxValue( GLfloat value );
+    // set value slew (default == 2, as YHistoBin)
+    void setValueSlew( GLfloat slew ) { m_slew = slew; }
+    // get number of bins
+    long numBins() const { return m_values.size(); }
+    // get width
+    GLfloat getWidth() const { return m_width; }
+    // get height
+    GLfloat getHeight() const { return m_height; }
+
+public:
+    // set one bin's value (slews there)
+    void setValue( unsigned int bin, GLfloat value );
+    // set count bins' values, starting at first
+    void setValues( const GLfloat * values, unsigned int count, unsigned int first = 0 );
+    // get one bin's value (goal)
+    GLfloat getValue( unsigned int bin ) const;
+
+public:
+    // show bin names under the bars (off by default)
+    void setShowLabels( bool show ) { m_showLabels = show; }
+    // set one bin's name
+    void setName( unsigned int bin, const std::string & name );
+
+public:
+    // update
+    void update( YTimeInterval dt );
+    // render
+    void render();
+
+protected:
+    // add bins to the dirty range
+    void touch( unsigned int begin, unsigned int end );
+    // write vertices for a range of bins
+    void computeVertices( unsigned int begin, unsigned int end );
+    // rebuild label mesh
+    void buildLabels();
+
+protected:
+    // width
+    GLfloat m_width;
+    // height
+    GLfloat m_height;
+    // max value
+    GLfloat m_maxValue;
+    // slew
+    GLfloat m_slew;
+
+    // current and goal values (one entry per bin)
+    std::vector<GLfloat> m_values;
+    std::vector<GLfloat> m_goals;
+    // bins still moving [begin, end)
+    unsigned int m_activeBegin;
+    unsigned int m_activeEnd;
+    // bins whose vertices need upload [begin, end)
+    unsigned int m_dirtyBegin;
+    unsigned int m_dirtyEnd;
+
+    // vertices: 6 (two triangles) x 2 floats per bin
+    std::vector<GLfloat> m_vertices;
+    // vertex buffer
+    GLuint m_vbo;
+    // needs full upload
+    bool m_realloc;
+
+    // labels
+    bool m_showLabels;
+    bool m_labelsDirty;
+    std::vector<std::string> m_names;
+    YTextMesh m_labels;
+};
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: class YLineChart
 // desc: basic line chart
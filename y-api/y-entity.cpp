@@ -36,11 +36,18 @@
 // date: spring 2011
 //-----------------------------------------------------------------------------
 #include "y-entity.h"
+#include "x-texture.h"
 #include "x-fun.h"
 #include <iostream>
 using namespace std;
 
 
+// static instantiation
+YEntityMonitor * YEntity::ourMonitor = NULL;
+bool YText::ourBatching = false;
+YTextBatch YText::ourBatch;
+
+
 
 
 //-----------------------------------------------------------------------------
@@ -53,7 +60,9 @@ void YEntity::updateAll( YTimeInterval dt )
     if( !active ) return;
 
     // update self
+    if( ourMonitor ) ourMonitor->begin( this, false );
     update( dt );
+    if( ourMonitor ) ourMonitor->end( this, false );
     
     // update children
     for( vector<YEntity *>::iterator itr = children.begin(); 
@@ -137,7 +146,9 @@ void YEntity::drawAll()
     // render self if not hidden
     if( !hidden )
     {
+        if( ourMonitor ) ourMonitor->begin( this, true );
         render();
+        if( ourMonitor ) ourMonitor->end( this, true );
     }
     
     // draw children
@@ -306,6 +317,7 @@ YText::YText( GLfloat initialAlpha )
 {
     // initialize str
     m_text = "";
+    m_meshDirty = true;
     // line width
     m_width = 1;
     // length
@@ -327,8 +339,13 @@ YText::YText( GLfloat initialAlpha )
 //-----------------------------------------------------------------------------
 void YText::set( const string & text )
 {
+    // same as before (e.g., labels set every update)
+    if( !m_meshDirty && text == m_text ) return;
+
     // copy
     m_text = text;
+    // rebuild mesh at next render
+    m_meshDirty = true;
     
     // compute length
     m_length = .001 * glutStrokeLength( GLUT_STROKE_ROMAN,
@@ -422,11 +439,19 @@ void YText::update( YTimeInterval dt )
 //-----------------------------------------------------------------------------
 void YText::render()
 {
+    // shared batch
+    if( ourBatching )
+    {
+        build();
+        ourBatch.add( m_mesh, m_stretch, m_width );
+        return;
+    }
+
     // blend
-    glEnable( GL_BLEND );
-    glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    XGfx::enable( GL_BLEND );
+    XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
     // lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     
     // set the linewidth
     glLineWidth( m_width );
@@ -434,8 +459,10 @@ void YText::render()
     glPushMatrix();
     // stretch
     glScalef( m_stretch, 1, 1 );
+    // rebuild if changed
+    build();
     // draw the string
-    drawString( m_text );
+    m_mesh.draw();
     // pop
     glPopMatrix();
 }
@@ -443,26 +470,56 @@ void YText::render()
 
 
 
+//-----------------------------------------------------------------------------
+// name: build()
+// desc: rebuild the mesh if the text changed
+//-----------------------------------------------------------------------------
+void YText::build()
+{
+    // check
+    if( !m_meshDirty ) return;
+
+    m_mesh.clear();
+    m_mesh.add( m_text );
+    m_meshDirty = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: endBatch()
+// desc: draw the text batched since beginBatch()
+//-----------------------------------------------------------------------------
+void YText::endBatch()
+{
+    ourBatching = false;
+    ourBatch.draw();
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: drawString()
 // desc: string rendering method
 //-----------------------------------------------------------------------------
 void YText::drawString( const std::string & text )
 {
-    // get string length
-    GLint len = (GLint)text.length();
-    // get c string
-    const char * str = text.c_str();
+    // scratch space (reused)
+    static vector<GLfloat> lines;
     
-    // push
-    glPushMatrix();
-    // scale to be smaller
-    glScalef( .001f, .001f, .001f );
-    // draw each character
-    for( int i = 0; i < len; i++ )
-        glutStrokeCharacter( GLUT_STROKE_ROMAN, str[i] );
-    // pop
-    glPopMatrix();
+    // cached glyphs, scaled to be smaller
+    lines.clear();
+    YGlyphCache::append( lines, text, 0, 0, .001f );
+    // check
+    if( lines.size() == 0 ) return;
+
+    // one draw call for the whole string
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glVertexPointer( 2, GL_FLOAT, 0, &lines[0] );
+    XGfx::drawArrays( GL_LINES, 0, (GLsizei)(lines.size() / 2) );
+    glDisableClientState( GL_VERTEX_ARRAY );
 }
 
 
@@ -501,6 +558,66 @@ static const GLfloat g_texCoords2[] = {
 
 
 
+//-----------------------------------------------------------------------------
+// name: add()
+// desc: add a quad, placed like YEntity::applyTransforms() would
+//-----------------------------------------------------------------------------
+void YFlareBatch::add( const YEntity * e, const GLfloat * corners, GLfloat scale,
+                       const GLfloat * tex, GLfloat r, GLfloat g, GLfloat b, GLfloat a )
+{
+    // rotation (z, then y, then x, as glRotatef), skipped if none
+    bool rotate = e->ori.x != 0 || e->ori.y != 0 || e->ori.z != 0;
+    GLfloat cx = 1, sx = 0, cy = 1, sy = 0, cz = 1, sz = 0;
+    if( rotate )
+    {
+        cx = cos( e->ori.x * M_PI / 180 ); sx = sin( e->ori.x * M_PI / 180 );
+        cy = cos( e->ori.y * M_PI / 180 ); sy = sin( e->ori.y * M_PI / 180 );
+        cz = cos( e->ori.z * M_PI / 180 ); sz = sin( e->ori.z * M_PI / 180 );
+    }
+
+    // the 4 corners
+    GLfloat p[4][3];
+    for( int i = 0; i < 4; i++ )
+    {
+        // scale
+        GLfloat x = corners[i*2] * scale * e->sca.x;
+        GLfloat y = corners[i*2+1] * scale * e->sca.y;
+        GLfloat z = 0;
+        if( rotate )
+        {
+            // x axis
+            GLfloat y1 = y * cx - z * sx, z1 = y * sx + z * cx;
+            // y axis
+            GLfloat x2 = x * cy + z1 * sy, z2 = -x * sy + z1 * cy;
+            // z axis
+            x = x2 * cz - y1 * sz; y = x2 * sz + y1 * cz; z = z2;
+        }
+        // translate
+        p[i][0] = x + e->loc.x;
+        p[i][1] = y + e->loc.y;
+        p[i][2] = z + e->loc.z;
+    }
+
+    // two triangles from the strip
+    static const int order[6] = { 0, 1, 2, 2, 1, 3 };
+    for( int k = 0; k < 6; k++ )
+    {
+        int i = order[k];
+        vertices.push_back( p[i][0] );
+        vertices.push_back( p[i][1] );
+        vertices.push_back( p[i][2] );
+        texCoords.push_back( tex[i*2] );
+        texCoords.push_back( tex[i*2+1] );
+        colors.push_back( r );
+        colors.push_back( g );
+        colors.push_back( b );
+        colors.push_back( a );
+    }
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: YFlare()
 // desc: ...
@@ -529,6 +646,8 @@ YFlare::YFlare( GLfloat width )
     scale_factor = 1.0f;
     alpha_factor = 1.0f;
     texture = 0;
+    atlas = NULL;
+    region = 0;
 }
 
 
@@ -546,6 +665,47 @@ void YFlare::set( GLfloat _scale, GLfloat _alpha, GLfloat _scale_factor,
     this->scale_factor = _scale_factor;
     this->alpha_factor = _alpha_factor;
     this->texture = _texture;
+    this->atlas = NULL;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: currentTexture()
+// desc: texture to bind, and its coordinates (strip order)
+//-----------------------------------------------------------------------------
+GLuint YFlare::currentTexture( GLfloat * texCoords ) const
+{
+    // plain texture
+    if( !atlas )
+    {
+        memcpy( texCoords, g_texCoords, sizeof(g_texCoords) );
+        return texture;
+    }
+
+    // region of the atlas
+    XTextureRegion r = atlas->region( region );
+    texCoords[0] = r.u0; texCoords[1] = r.v0;
+    texCoords[2] = r.u1; texCoords[3] = r.v0;
+    texCoords[4] = r.u0; texCoords[5] = r.v1;
+    texCoords[6] = r.u1; texCoords[7] = r.v1;
+    return atlas->texture;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch()
+// desc: add to a batch instead of render()
+//-----------------------------------------------------------------------------
+void YFlare::batch( YFlareBatch & batch )
+{
+    GLfloat tex[8];
+    currentTexture( tex );
+    // as render(), with the color applyTransforms() would set
+    batch.add( this, vertices, scale, tex, col.x, col.y, col.z, alpha );
 }
 
 
@@ -594,22 +754,23 @@ void YFlare::update( YTimeInterval dt )
 void YFlare::render()
 {
     // disable lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     // depth
-    if( use_depth ) glEnable( GL_DEPTH_TEST );
-    else glDisable( GL_DEPTH_TEST );
+    if( use_depth ) XGfx::enable( GL_DEPTH_TEST );
+    else XGfx::disable( GL_DEPTH_TEST );
     // disable writing
     glDepthMask( GL_FALSE );
 
     // enable texture mapping
-    glEnable( GL_TEXTURE_2D );
+    XGfx::enable( GL_TEXTURE_2D );
     // enable blending
-    glEnable( GL_BLEND );
+    XGfx::enable( GL_BLEND );
     // blend function
     // glBlendFunc( GL_ONE, GL_ONE );
-    glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
-    // bind the texture
-    glBindTexture( GL_TEXTURE_2D, texture );
+    XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    // bind the texture (or atlas)
+    GLfloat texCoords[8];
+    XGfx::bindTexture( GL_TEXTURE_2D, currentTexture( texCoords ) );
 
     glPushMatrix();
 
@@ -623,12 +784,12 @@ void YFlare::render()
     // normal
     // glNormalPointer( GL_FLOAT, 0, g_normals );
     // texture coordinate
-    glTexCoordPointer( 2, GL_FLOAT, 0, g_texCoords );
+    glTexCoordPointer( 2, GL_FLOAT, 0, texCoords );
 
     // scale
     glScalef( scale, scale, scale );
     // triangle strip
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
 
     // disable
     glDisableClientState( GL_VERTEX_ARRAY );
@@ -638,8 +799,8 @@ void YFlare::render()
     glPopMatrix();
 
     // disable
-    glDisable( GL_TEXTURE_2D );
-    glDisable( GL_BLEND );
+    XGfx::disable( GL_TEXTURE_2D );
+    XGfx::disable( GL_BLEND );
     // enable writing
     glDepthMask( GL_TRUE );
 }
@@ -712,6 +873,55 @@ void YBokeh::update( YTimeInterval dt )
 
 
 
+//-----------------------------------------------------------------------------
+// name: advance()
+// desc: modulate scale/alpha, advance time (once per frame, when drawn)
+//-----------------------------------------------------------------------------
+void YBokeh::advance()
+{
+    // modulate the scale
+    scale_actual = scale * (.7 + .25*::cos( t*2*M_PI*f ));
+    // modulate the alpha
+    alpha_actual = alpha * (.7 + .3*::cos( t*2*M_PI*f*4));
+    // move time
+    t += t_step * XGfx::delta();
+
+    // alpha
+    alpha *= alpha_factor;
+    scale *= scale_factor;
+    
+    // stop scaling
+    if( scale < scale_lowerBound ) scale_factor = 1.0f;
+    
+    // active
+    if( alpha < .05f )
+	{
+		active = false;
+		// HACK:
+		oscillate = false;
+	}
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: batch()
+// desc: add to a batch instead of render()
+//-----------------------------------------------------------------------------
+void YBokeh::batch( YFlareBatch & batch )
+{
+    // modulate, move time
+    advance();
+
+    GLfloat tex[8];
+    currentTexture( tex );
+    batch.add( this, vertices, scale_actual, tex, col.x, col.y, col.z, alpha_actual );
+}
+
+
+
+
 #include <iostream>
 //-----------------------------------------------------------------------------
 // name: render()
@@ -720,20 +930,21 @@ void YBokeh::update( YTimeInterval dt )
 void YBokeh::render()
 {
     // disable lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     // depth
-    glEnable( GL_DEPTH_TEST );
+    XGfx::enable( GL_DEPTH_TEST );
     // disable writing
     glDepthMask( GL_FALSE );
     
     // enable blending
-    glEnable( GL_BLEND );
+    XGfx::enable( GL_BLEND );
     // blend function
-    glBlendFunc( GL_ONE, GL_ONE );
+    XGfx::blendFunc( GL_ONE, GL_ONE );
     // enable texture mapping
-    glEnable( GL_TEXTURE_2D );
-    // bind the texture
-    glBindTexture( GL_TEXTURE_2D, texture );
+    XGfx::enable( GL_TEXTURE_2D );
+    // bind the texture (or atlas)
+    GLfloat texCoords[8];
+    XGfx::bindTexture( GL_TEXTURE_2D, currentTexture( texCoords ) );
     
     glPushMatrix();
     
@@ -742,12 +953,8 @@ void YBokeh::render()
     glEnableClientState( GL_NORMAL_ARRAY );
     glEnableClientState( GL_TEXTURE_COORD_ARRAY );
     
-    // modulate the scale
-    scale_actual = scale * (.7 + .25*::cos( t*2*M_PI*f ));
-    // modulate the alpha
-    alpha_actual = alpha * (.7 + .3*::cos( t*2*M_PI*f*4));
-    // move time
-    t += t_step * XGfx::delta();
+    // modulate, move time
+    advance();
 
     // color
     glColor4f( col.x, col.y, col.z, alpha_actual );
@@ -756,26 +963,12 @@ void YBokeh::render()
     // normal
     glNormalPointer( GL_FLOAT, 0, g_normals );
     // texture coordinate
-    glTexCoordPointer( 2, GL_FLOAT, 0, g_texCoords );
+    glTexCoordPointer( 2, GL_FLOAT, 0, texCoords );
     
     // scale
     glScalef( scale_actual, scale_actual, scale_actual );
-    // alpha
-    alpha *= alpha_factor;
-    scale *= scale_factor;
     // triangle strip
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
-    
-    // stop scaling
-    if( scale < scale_lowerBound ) scale_factor = 1.0f;
-    
-    // active
-    if( alpha < .05f )
-	{
-		active = false;
-		// HACK:
-		oscillate = false;
-	}
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
     
     // disable
     glDisableClientState( GL_VERTEX_ARRAY );
@@ -785,8 +978,8 @@ void YBokeh::render()
     glPopMatrix();
     
     // disable
-    glDisable( GL_TEXTURE_2D );
-    glDisable( GL_BLEND );
+    XGfx::disable( GL_TEXTURE_2D );
+    XGfx::disable( GL_BLEND );
     // enable writing
     glDepthMask( GL_TRUE );
     
@@ -803,6 +996,8 @@ YFlarePool::YFlarePool( unsigned long capacity )
 {
     // zero out
     m_numActive = m_capacity = m_size = 0;
+    // batch flares with atlases
+    m_batching = true;
     
     // allocate
     m_pool = new YFlare *[capacity];
@@ -1002,12 +1197,96 @@ void YFlarePool::update( YTimeInterval dt )
 //-----------------------------------------------------------------------------
 void YFlarePool::render()
 {
+    // one at a time
+    if( !m_batching )
+    {
+        // loop over active
+        for( unsigned long i = 0; i < m_numActive; i++ )
+        {
+            // draw it
+            m_pool[i]->drawAll();
+        }
+        return;
+    }
+
+    // runs of flares in pool order that share an atlas and state, one draw
+    // each (draw order is the same as one at a time)
+    GLuint texture = 0;
+    int state = 0;
+    m_batch.clear();
+
     // loop over active
-    for( int i = 0; i < m_numActive; i++ )
+    for( unsigned long i = 0; i < m_numActive; i++ )
     {
-        // draw it
-        m_pool[i]->drawAll();
+        YFlare * f = m_pool[i];
+        // nothing to draw
+        if( !f->active ) continue;
+
+        // batch it, if it can be (no children, so hidden draws nothing)
+        if( f->canBatch() )
+        {
+            if( f->hidden ) continue;
+            int s = f->isAdditive() * 2 + f->usesDepth();
+            // a new run
+            if( f->atlas->texture != texture || s != state ) flush( texture, state );
+            texture = f->atlas->texture;
+            state = s;
+            f->batch( m_batch );
+        }
+        // draw it, after the run before it
+        else
+        {
+            flush( texture, state );
+            f->drawAll();
+        }
     }
+
+    // the last run
+    flush( texture, state );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: flush()
+// desc: draw the run batched so far
+//-----------------------------------------------------------------------------
+void YFlarePool::flush( GLuint texture, int state )
+{
+    // check
+    if( m_batch.size() == 0 ) return;
+
+    // state
+    XGfx::disable( GL_LIGHTING );
+    glDepthMask( GL_FALSE );
+    XGfx::enable( GL_TEXTURE_2D );
+    XGfx::enable( GL_BLEND );
+    XGfx::bindTexture( GL_TEXTURE_2D, texture );
+    if( state & 1 ) XGfx::enable( GL_DEPTH_TEST );
+    else XGfx::disable( GL_DEPTH_TEST );
+    if( state & 2 ) XGfx::blendFunc( GL_ONE, GL_ONE );
+    else XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+    glEnableClientState( GL_COLOR_ARRAY );
+
+    // draw
+    glVertexPointer( 3, GL_FLOAT, 0, &m_batch.vertices[0] );
+    glTexCoordPointer( 2, GL_FLOAT, 0, &m_batch.texCoords[0] );
+    glColorPointer( 4, GL_FLOAT, 0, &m_batch.colors[0] );
+    XGfx::drawArrays( GL_TRIANGLES, 0, m_batch.size() );
+
+    // restore
+    glDisableClientState( GL_VERTEX_ARRAY );
+    glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+    glDisableClientState( GL_COLOR_ARRAY );
+    XGfx::disable( GL_TEXTURE_2D );
+    XGfx::disable( GL_BLEND );
+    glDepthMask( GL_TRUE );
+
+    // done with these
+    m_batch.clear();
 }
 
 
@@ -1020,24 +1299,24 @@ void YFlarePool::render()
 void YColumn::render()
 {
     // disable lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     
     // disable depth
     // glDisable( GL_DEPTH_TEST );
     // enable depth
-    glEnable( GL_DEPTH_TEST );
+    XGfx::enable( GL_DEPTH_TEST );
     
     // disable writing
     glDepthMask( GL_FALSE );
     
     // enable blending
-    glEnable( GL_BLEND );
+    XGfx::enable( GL_BLEND );
     // blend function
-    glBlendFunc( GL_ONE, GL_ONE );
+    XGfx::blendFunc( GL_ONE, GL_ONE );
     // enable texture mapping
-    glEnable( GL_TEXTURE_2D );
+    XGfx::enable( GL_TEXTURE_2D );
     // bind the texture
-    glBindTexture( GL_TEXTURE_2D, texture );
+    XGfx::bindTexture( GL_TEXTURE_2D, texture );
     
     glPushMatrix();
     
@@ -1082,7 +1361,7 @@ void YColumn::render()
     for( int i = 0; i < numLayers; i++ )
     {
         // triangle strip
-        glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+        XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
         // rotate
         glRotatef( 180.0f / numLayers, 0, 1, 0 );
     }
@@ -1095,8 +1374,8 @@ void YColumn::render()
     glPopMatrix();
     
     // disable
-    glDisable( GL_TEXTURE_2D );
-    glDisable( GL_BLEND );
+    XGfx::disable( GL_TEXTURE_2D );
+    XGfx::disable( GL_BLEND );
     
     // enable writing
     glDepthMask( GL_TRUE );
@@ -1296,12 +1575,12 @@ void YCube::render()
     glScalef( size.value, size.value, size.value );
 
     // draw it
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 4, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 8, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 12, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 16, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 20, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 4, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 8, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 12, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 16, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 20, 4 );
     
     // pop
     glPopMatrix();
@@ -1348,17 +1627,18 @@ void YCubeOutline::render()
     glScalef( size.value, size.value, size.value );
     
     // draw it
-    glDrawArrays( GL_TRIANGLE_STRIP, 0, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 4, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 8, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 12, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 16, 4 );
-    glDrawArrays( GL_TRIANGLE_STRIP, 20, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 4, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 8, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 12, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 16, 4 );
+    XGfx::drawArrays( GL_TRIANGLE_STRIP, 20, 4 );
     
     // color
     glColor4f( outlineColor.x, outlineColor.y, outlineColor.z, 1.0f );
     // draw outline
     glutWireCube( 1.025f );
+    XGfx::countDrawCalls();
     
     // pop
     glPopMatrix();
@@ -1430,6 +1710,7 @@ void YSphere::render()
 {
     // render
     glutSolidSphere( size.value, slices, stacks );
+    XGfx::countDrawCalls();
 }
 
 
@@ -1457,6 +1738,7 @@ void YCone::render()
 {
     // render
     glutSolidCone( base.value * size.value, height.value * size.value, slices, stacks );
+    XGfx::countDrawCalls();
 }
 
 
@@ -1840,7 +2122,7 @@ void YIris::render()
     glPushMatrix();
     
     // enable
-    glEnable( GL_DEPTH_TEST );
+    XGfx::enable( GL_DEPTH_TEST );
     
     // enable
     glEnableClientState( GL_VERTEX_ARRAY );
@@ -1867,7 +2149,7 @@ void YIris::render()
     // color
     glColor4f( col.x, col.y, col.z, 1 );
     // enable lighting
-    glEnable( GL_LIGHTING );
+    XGfx::enable( GL_LIGHTING );
     // loop overs
     for( int i = 0; i < m_numBlades; i++ )
     {
@@ -1881,7 +2163,7 @@ void YIris::render()
         glRotatef( pos * 90, 0, 0, 1 );
 
         // triangle strip
-        glDrawArrays( GL_TRIANGLE_STRIP, 0, 3 );
+        XGfx::drawArrays( GL_TRIANGLE_STRIP, 0, 3 );
         // pop
         glPopMatrix();
     }
@@ -1893,7 +2175,7 @@ void YIris::render()
     // linewidth
     glLineWidth( m_outlineWidth );
     // no lighting
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     // no normal
     glDisableClientState( GL_NORMAL_ARRAY );
     // second pass for outline
@@ -1909,7 +2191,7 @@ void YIris::render()
         glRotatef( pos * 90, 0, 0, 1 );
 
         // triangle strip
-        glDrawArrays( GL_LINE_LOOP, 0, 3 );
+        XGfx::drawArrays( GL_LINE_LOOP, 0, 3 );
         // pop
         glPopMatrix();
     }
@@ -41,10 +41,12 @@
 #include <vector>
 #include <string>
 #include "x-gfx.h"
+#include "y-glyph.h"
 
 
 // forward references
 class YEntity;
+struct XTextureAtlas;
 
 // A block that does something with an entity and returns true if it succeeds
 typedef void (^EntityBlock)( YEntity * );
@@ -55,6 +57,26 @@ typedef double YTimeInterval;
 
 
 
+//-----------------------------------------------------------------------------
+// name: class YEntityMonitor
+// desc: observer called around each entity's own update/render (e.g., for
+//       profiling); children are reported separately
+//-----------------------------------------------------------------------------
+class YEntityMonitor
+{
+public:
+    virtual ~YEntityMonitor() { }
+
+public:
+    // before update() or render() of one entity
+    virtual void begin( YEntity * e, bool isRender ) = 0;
+    // after update() or render() of one entity
+    virtual void end( YEntity * e, bool isRender ) = 0;
+};
+
+
+
+
 
 //-----------------------------------------------------------------------------
 // name: class YEntity
@@ -104,6 +126,12 @@ public:
     // description
     virtual std::string desc() const;
 
+public:
+    // set the (global) monitor; NULL to disable
+    static void setMonitor( YEntityMonitor * monitor ) { ourMonitor = monitor; }
+    // get it
+    static YEntityMonitor * getMonitor() { return ourMonitor; }
+
 public:
     // location
     Vector3D loc;
@@ -141,6 +169,10 @@ protected: // never set these directly, always use addChild
     YEntity * parent;
     // child nodes in the scene graph
     std::vector<YEntity *> children;
+
+protected:
+    // the monitor, if any
+    static YEntityMonitor * ourMonitor;
     
 private:
     // make sure no subclasses are using the old
@@ -183,10 +215,26 @@ public:
 public:
     // static draw method
     static void drawString( const std::string & text );
+    // batch every YText rendered until endBatch() (shared across instances;
+    // drawn at endBatch(), with the same projection)
+    static void beginBatch() { ourBatching = true; }
+    static void endBatch();
+
+protected:
+    // rebuild the mesh if the text changed
+    void build();
+
+protected:
+    // batching, and the batch
+    static bool ourBatching;
+    static YTextBatch ourBatch;
 
 protected:
     // the text
     std::string m_text;
+    // cached mesh (rebuilt when the text changes)
+    YTextMesh m_mesh;
+    bool m_meshDirty;
     // the width
     GLfloat m_width;
     // the length
@@ -307,6 +355,30 @@ public:
 
 
 
+//-----------------------------------------------------------------------------
+// name: struct YFlareBatch
+// desc: quads from many flares (in the pool's space), drawn in one call
+//-----------------------------------------------------------------------------
+struct YFlareBatch
+{
+    // 6 vertices per quad (two triangles)
+    std::vector<GLfloat> vertices;  // xyz
+    std::vector<GLfloat> texCoords; // st
+    std::vector<GLfloat> colors;    // rgba
+
+    // clear
+    void clear() { vertices.clear(); texCoords.clear(); colors.clear(); }
+    // number of vertices
+    GLsizei size() const { return vertices.size() / 3; }
+    // add a quad: corners (strip order, 2D) scaled, then placed like
+    // YEntity::applyTransforms() would; tex is 4 corners (strip order)
+    void add( const YEntity * e, const GLfloat * corners, GLfloat scale,
+              const GLfloat * tex, GLfloat r, GLfloat g, GLfloat b, GLfloat a );
+};
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: class YFlare
 // desc: entity to represent a flare in the graphics
@@ -326,10 +398,27 @@ public:
     virtual bool isActive() const { return active; }
     // set alpha
     virtual void setAlpha( GLfloat _alpha ) { alpha = _alpha; }
-    
+    // use a region of an atlas instead of texture (set() clears it)
+    void setAtlas( const XTextureAtlas * _atlas, long _region )
+    { atlas = _atlas; region = _region; }
+
+public:
+    // can this flare go into a pool batch? (needs an atlas, no children)
+    virtual bool canBatch() const { return atlas != NULL && children.size() == 0; }
+    // additive blending? (else alpha blending)
+    virtual bool isAdditive() const { return false; }
+    // depth tested?
+    virtual bool usesDepth() const { return use_depth; }
+    // add to a batch instead of render()
+    virtual void batch( YFlareBatch & batch );
+
 public:
     virtual void update( YTimeInterval dt );
     virtual void render();
+
+protected:
+    // texture to bind, and its coordinates (strip order)
+    GLuint currentTexture( GLfloat * texCoords ) const;
     
 public:
     GLfloat scale;
@@ -338,6 +427,9 @@ public:
     GLfloat alpha_factor;
     GLuint texture;
     GLboolean use_depth;
+    // atlas (overrides texture)
+    const XTextureAtlas * atlas;
+    long region;
 
 public:
     GLfloat half_width;
@@ -375,10 +467,19 @@ public:
     virtual void setAlpha( GLfloat _alpha ) { alpha = alpha_actual = _alpha; }
     // virtual void setAlpha( GLfloat _alpha ) { iAlpha.update( _alpha ); alpha_actual = _alpha; }
 
+public:
+    virtual bool isAdditive() const { return true; }
+    virtual bool usesDepth() const { return true; }
+    virtual void batch( YFlareBatch & batch );
+
 public:
     virtual void update( YTimeInterval dt );
     virtual void render();
 
+protected:
+    // modulate scale/alpha, advance time (once per frame)
+    void advance();
+
     // slew
     iSlew3D iRGB;
     iSlew3D iLoc;
@@ -447,6 +548,10 @@ public:
     unsigned long getSize() const { return m_size; }
     // get actives
     unsigned long getActives() const { return m_numActive; }
+    // draw flares with atlases in batches (default: true)
+    void setBatching( bool batching ) { m_batching = batching; }
+    // get it
+    bool getBatching() const { return m_batching; }
 
 public:
     virtual void update( YTimeInterval dt );
@@ -463,6 +568,16 @@ public:
     YFlare ** m_pool;
     // vector of influences
     std::vector<YFlareInfluence *> influences;
+
+protected:
+    // draw the run batched so far (atlas, and additive * 2 + depth)
+    void flush( GLuint texture, int state );
+
+protected:
+    // batching
+    bool m_batching;
+    // the current run: flares in a row sharing atlas and state
+    YFlareBatch m_batch;
 };
 
 
@@ -531,6 +646,8 @@ public:
     }
     
 public:
+    // own geometry
+    virtual bool canBatch() const { return false; }
     virtual void update( YTimeInterval dt );
     virtual void render();
     virtual void activate();
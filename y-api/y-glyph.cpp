@@ -0,0 +1,382 @@
+//-----------------------------------------------------------------------------
+// name: y-glyph.cpp
+// desc: cached stroke-font glyphs and text meshes
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#include "y-glyph.h"
+#include <iostream>
+using namespace std;
+
+
+// feedback buffer size (floats; the busiest roman glyph is ~300)
+#define YGLYPH_FEEDBACK_SIZE 4096
+// capture space (glyphs span roughly -35..120 font units)
+#define YGLYPH_CAPTURE_SIZE 512
+#define YGLYPH_CAPTURE_OFFSET 256
+
+
+// static instantiation
+YGlyphCache::Glyph YGlyphCache::ourGlyphs[128];
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: append()
+// desc: append GL_LINES vertices for a string; returns the advance
+//-----------------------------------------------------------------------------
+GLfloat YGlyphCache::append( vector<GLfloat> & lines, const string & text,
+                             GLfloat x, GLfloat y, GLfloat scale )
+{
+    // pen position (font units)
+    GLfloat pen = 0;
+
+    // each character
+    for( size_t i = 0; i < text.length(); i++ )
+    {
+        unsigned char c = (unsigned char)text[i];
+        // stroke font is ASCII
+        if( c >= 128 ) continue;
+        // capture on first use
+        if( !ourGlyphs[c].captured ) capture( c );
+
+        const Glyph & g = ourGlyphs[c];
+        // copy segments, offset by pen
+        for( size_t j = 0; j < g.lines.size(); j += 2 )
+        {
+            lines.push_back( x + (pen + g.lines[j]) * scale );
+            lines.push_back( y + g.lines[j+1] * scale );
+        }
+        // advance
+        pen += g.advance;
+    }
+
+    return pen * scale;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: capture()
+// desc: record the line segments GLUT emits for one glyph
+//-----------------------------------------------------------------------------
+void YGlyphCache::capture( unsigned char c )
+{
+    Glyph & g = ourGlyphs[c];
+    // mark (even if capture fails, don't retry every frame)
+    g.captured = true;
+    g.advance = glutStrokeWidth( GLUT_STROKE_ROMAN, c );
+
+    // feedback buffer
+    static GLfloat buffer[YGLYPH_FEEDBACK_SIZE];
+
+    // save viewport
+    GLint viewport[4];
+    glGetIntegerv( GL_VIEWPORT, viewport );
+    // window coordinates == object coordinates (+offset)
+    glViewport( 0, 0, YGLYPH_CAPTURE_SIZE, YGLYPH_CAPTURE_SIZE );
+    glMatrixMode( GL_PROJECTION );
+    glPushMatrix();
+    glLoadIdentity();
+    glOrtho( 0, YGLYPH_CAPTURE_SIZE, 0, YGLYPH_CAPTURE_SIZE, -1, 1 );
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix();
+    glLoadIdentity();
+    glTranslatef( YGLYPH_CAPTURE_OFFSET, YGLYPH_CAPTURE_OFFSET, 0 );
+
+    // capture
+    glFeedbackBuffer( YGLYPH_FEEDBACK_SIZE, GL_2D, buffer );
+    glRenderMode( GL_FEEDBACK );
+    glutStrokeCharacter( GLUT_STROKE_ROMAN, c );
+    GLint n = glRenderMode( GL_RENDER );
+
+    // restore
+    glPopMatrix();
+    glMatrixMode( GL_PROJECTION );
+    glPopMatrix();
+    glMatrixMode( GL_MODELVIEW );
+    glViewport( viewport[0], viewport[1], viewport[2], viewport[3] );
+
+    // check
+    if( n < 0 )
+    {
+        cerr << "[y-glyph]: feedback overflow for glyph " << (int)c << endl;
+        return;
+    }
+
+    // parse (GL_2D: x, y per vertex)
+    GLint i = 0;
+    while( i < n )
+    {
+        GLint token = (GLint)buffer[i++];
+        switch( token )
+        {
+            case GL_LINE_TOKEN:
+            case GL_LINE_RESET_TOKEN:
+                for( int k = 0; k < 4; k++ )
+                    g.lines.push_back( buffer[i+k] - YGLYPH_CAPTURE_OFFSET );
+                i += 4;
+                break;
+            case GL_POINT_TOKEN:
+            case GL_BITMAP_TOKEN:
+            case GL_DRAW_PIXEL_TOKEN:
+            case GL_COPY_PIXEL_TOKEN:
+                i += 2;
+                break;
+            case GL_POLYGON_TOKEN:
+                i += 1 + 2 * (GLint)buffer[i];
+                break;
+            case GL_PASS_THROUGH_TOKEN:
+                i += 1;
+                break;
+            default:
+                // don't know; stop
+                i = n;
+                break;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: YTextMesh()
+// desc: constructor
+//-----------------------------------------------------------------------------
+YTextMesh::YTextMesh()
+{
+    m_vbo = 0;
+    m_capacity = 0;
+    m_dirty = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: YTextMesh()
+// desc: copy constructor (buffer object is not shared)
+//-----------------------------------------------------------------------------
+YTextMesh::YTextMesh( const YTextMesh & rhs )
+{
+    m_vertices = rhs.m_vertices;
+    m_vbo = 0;
+    m_capacity = 0;
+    m_dirty = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~YTextMesh()
+// desc: destructor
+//-----------------------------------------------------------------------------
+YTextMesh::~YTextMesh()
+{
+    if( m_vbo ) glDeleteBuffers( 1, &m_vbo );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: operator =()
+// desc: assignment (buffer object is not shared)
+//-----------------------------------------------------------------------------
+YTextMesh & YTextMesh::operator =( const YTextMesh & rhs )
+{
+    if( this != &rhs )
+    {
+        m_vertices = rhs.m_vertices;
+        m_dirty = true;
+    }
+
+    return *this;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: clear()
+// desc: remove all strings
+//-----------------------------------------------------------------------------
+void YTextMesh::clear()
+{
+    m_vertices.clear();
+    m_dirty = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: add()
+// desc: add a string at x/y
+//-----------------------------------------------------------------------------
+void YTextMesh::add( const string & text, GLfloat x, GLfloat y, GLfloat scale )
+{
+    // YText::drawString() units
+    YGlyphCache::append( m_vertices, text, x, y, .001f * scale );
+    m_dirty = true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: upload()
+// desc: copy vertices to the buffer object
+//-----------------------------------------------------------------------------
+void YTextMesh::upload()
+{
+    // first time
+    if( !m_vbo ) glGenBuffers( 1, &m_vbo );
+
+    GLsizeiptr size = m_vertices.size() * sizeof(GLfloat);
+    // bind
+    glBindBuffer( GL_ARRAY_BUFFER, m_vbo );
+    // grow, or reuse storage
+    if( size > m_capacity )
+    {
+        glBufferData( GL_ARRAY_BUFFER, size, &m_vertices[0], GL_DYNAMIC_DRAW );
+        m_capacity = size;
+    }
+    else
+    {
+        glBufferSubData( GL_ARRAY_BUFFER, 0, size, &m_vertices[0] );
+    }
+
+    m_dirty = false;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: draw()
+// desc: draw all strings with one call
+//-----------------------------------------------------------------------------
+void YTextMesh::draw()
+{
+    // check
+    if( m_vertices.size() == 0 ) return;
+
+    // upload (leaves buffer bound)
+    if( m_dirty ) upload();
+    else glBindBuffer( GL_ARRAY_BUFFER, m_vbo );
+
+    // draw from the buffer
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glVertexPointer( 2, GL_FLOAT, 0, 0 );
+    XGfx::drawArrays( GL_LINES, 0, (GLsizei)(m_vertices.size() / 2) );
+    glDisableClientState( GL_VERTEX_ARRAY );
+
+    // unbind
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: add()
+// desc: add a mesh, placed by the current modelview matrix, in the current
+//       colour
+//-----------------------------------------------------------------------------
+void YTextBatch::add( const YTextMesh & mesh, GLfloat stretch, GLfloat lineWidth )
+{
+    const vector<GLfloat> & v = mesh.vertices();
+    // check
+    if( v.size() == 0 ) return;
+
+    // the run for this width
+    Run * run = NULL;
+    for( size_t i = 0; i < m_runs.size() && !run; i++ )
+        if( m_runs[i].width == lineWidth ) run = &m_runs[i];
+    if( !run )
+    {
+        m_runs.push_back( Run() );
+        run = &m_runs.back();
+        run->width = lineWidth;
+    }
+
+    // where and in what colour
+    GLfloat m[16], c[4];
+    glGetFloatv( GL_MODELVIEW_MATRIX, m );
+    glGetFloatv( GL_CURRENT_COLOR, c );
+
+    // to eye space
+    for( size_t i = 0; i + 1 < v.size(); i += 2 )
+    {
+        GLfloat x = v[i] * stretch, y = v[i+1];
+        run->vertices.push_back( m[0] * x + m[4] * y + m[12] );
+        run->vertices.push_back( m[1] * x + m[5] * y + m[13] );
+        run->vertices.push_back( m[2] * x + m[6] * y + m[14] );
+        run->colors.insert( run->colors.end(), c, c + 4 );
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: draw()
+// desc: draw all, one call per line width, then clear
+//-----------------------------------------------------------------------------
+void YTextBatch::draw()
+{
+    // already in eye space
+    glMatrixMode( GL_MODELVIEW );
+    glPushMatrix();
+    glLoadIdentity();
+
+    // state
+    XGfx::enable( GL_BLEND );
+    XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    XGfx::disable( GL_LIGHTING );
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glEnableClientState( GL_COLOR_ARRAY );
+
+    for( size_t i = 0; i < m_runs.size(); i++ )
+    {
+        Run & run = m_runs[i];
+        // check
+        if( run.vertices.size() == 0 ) continue;
+
+        // draw
+        glLineWidth( run.width );
+        glVertexPointer( 3, GL_FLOAT, 0, &run.vertices[0] );
+        glColorPointer( 4, GL_FLOAT, 0, &run.colors[0] );
+        XGfx::drawArrays( GL_LINES, 0, (GLsizei)(run.vertices.size() / 3) );
+    }
+
+    // restore
+    glDisableClientState( GL_VERTEX_ARRAY );
+    glDisableClientState( GL_COLOR_ARRAY );
+    glPopMatrix();
+
+    // done with these
+    clear();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: clear()
+// desc: remove all (keeps storage)
+//-----------------------------------------------------------------------------
+void YTextBatch::clear()
+{
+    for( size_t i = 0; i < m_runs.size(); i++ )
+    {
+        m_runs[i].vertices.clear();
+        m_runs[i].colors.clear();
+    }
+}
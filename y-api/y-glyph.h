@@ -0,0 +1,129 @@
+//-----------------------------------------------------------------------------
+// name: y-glyph.h
+// desc: cached stroke-font glyphs and text meshes
+//
+// author: Joshua J Coronado (jjcorona@ccrma.stanford.edu)
+//   date: 2014
+//-----------------------------------------------------------------------------
+#ifndef __MCD_Y_GLYPH_H__
+#define __MCD_Y_GLYPH_H__
+
+#include "x-gfx.h"
+#include <vector>
+#include <string>
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class YGlyphCache
+// desc: GLUT stroke glyphs (roman), each captured once as 2D line segments
+//       through GL feedback; needs a current GL context
+//-----------------------------------------------------------------------------
+class YGlyphCache
+{
+public:
+    // append GL_LINES vertices (x,y pairs) for a string, starting at x/y;
+    // scale 1 is font units (YText uses .001); returns the advance
+    static GLfloat append( std::vector<GLfloat> & lines, const std::string & text,
+                           GLfloat x = 0, GLfloat y = 0, GLfloat scale = 1 );
+
+protected:
+    // capture one glyph
+    static void capture( unsigned char c );
+
+protected:
+    struct Glyph
+    {
+        // captured yet?
+        bool captured;
+        // horizontal advance (font units)
+        GLfloat advance;
+        // line segments (font units)
+        std::vector<GLfloat> lines;
+
+        Glyph() : captured(false), advance(0) { }
+    };
+
+    // ASCII only (that's what the stroke font has)
+    static Glyph ourGlyphs[128];
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class YTextMesh
+// desc: one or more strings as a single GL_LINES vertex buffer; rebuild only
+//       when the text changes, draw with one call
+//-----------------------------------------------------------------------------
+class YTextMesh
+{
+public:
+    YTextMesh();
+    YTextMesh( const YTextMesh & rhs );
+    ~YTextMesh();
+    YTextMesh & operator =( const YTextMesh & rhs );
+
+public:
+    // remove all strings
+    void clear();
+    // add a string at x/y (scale 1 matches YText::drawString())
+    void add( const std::string & text, GLfloat x = 0, GLfloat y = 0, GLfloat scale = 1 );
+    // draw (uploads first if changed)
+    void draw();
+    // is there anything?
+    bool empty() const { return m_vertices.size() == 0; }
+    // x,y pairs (GL_LINES)
+    const std::vector<GLfloat> & vertices() const { return m_vertices; }
+
+protected:
+    // upload to the vertex buffer
+    void upload();
+
+protected:
+    // x,y pairs
+    std::vector<GLfloat> m_vertices;
+    // vertex buffer
+    GLuint m_vbo;
+    // its size in bytes
+    GLsizeiptr m_capacity;
+    // needs upload?
+    bool m_dirty;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class YTextBatch
+// desc: text meshes from many places, in eye space with their colour, drawn
+//       with one call per line width
+//-----------------------------------------------------------------------------
+class YTextBatch
+{
+public:
+    // add a mesh (x stretched), placed by the current modelview matrix, in
+    // the current colour
+    void add( const YTextMesh & mesh, GLfloat stretch, GLfloat lineWidth );
+    // draw all (same projection as when added), then clear
+    void draw();
+    // remove all (keeps storage)
+    void clear();
+
+protected:
+    // lines of one width
+    struct Run
+    {
+        GLfloat width;
+        // xyz (eye space), rgba per vertex
+        std::vector<GLfloat> vertices;
+        std::vector<GLfloat> colors;
+    };
+    std::vector<Run> m_runs;
+};
+
+
+
+
+#endif
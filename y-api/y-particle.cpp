@@ -49,18 +49,12 @@ using namespace std;
 // desc: ...
 //-----------------------------------------------------------------------------
 YParticle::YParticle( GLfloat width )
-: YFlare(width), m_isFree(false)
+: YFlare(width), multiplier( 1, 1, 1 ), X( 0, 0, 1 ), Y( 0, 0, 1 ), Z( 0, 0, 1 ),
+  ALPHA( 1, 1, 1 ), oriX( 0, 0, 1 ), oriY( 0, 0, 1 ), oriZ( 0, 0, 1 ),
+  m_isFree(false)
 {
-    X.slew = 1;
-    Y.slew = 1;
-    Z.slew = 1;
-    ALPHA.set( 1, 1, 1 );
-    oriX.slew = 1;
-    oriY.slew = 1;
-    oriZ.slew = 1;
     origLoc.slew = 1;
     origOri.slew = 1;
-    multiplier.set( 1, 1, 1 );
 
 //    velX.slew = 1;
 //    velY.slew = 1;
@@ -81,10 +75,8 @@ void YParticle::setLocAsOrig( const Vector3D & v )
     // set ori
     origLoc = v;
     // set slew X
-    X.updateSet( v.x );
-    Y.updateSet( v.y );
-    X.slew = 1;
-    Y.slew = 1;
+    X.updateSet( v.x, 1 );
+    Y.updateSet( v.y, 1 );
 }
 
 
@@ -94,23 +86,12 @@ void YParticle::setLocAsOrig( const Vector3D & v )
 // name: update()
 // desc: update the quantities associated with the frag
 //-----------------------------------------------------------------------------
-void YParticle::update( YTimeInterval dt )
+void YParticle::update( YTimeInterval /* dt */ )
 {
     // update super
     // YFlare::update( dt );
     
-    // update
-    X.interp( dt );
-    Y.interp( dt );
-    Z.interp( dt );
-    dX.interp( dt );
-    dY.interp( dt );
-    dZ.interp( dt );
-    ALPHA.interp( dt );
-    oriX.interp( dt);
-    oriY.interp( dt );
-    oriZ.interp( dt );
-    multiplier.interp( dt );
+    // (slews are advanced with the global bank)
 
 //    velX.interp( dt );
 //    velY.interp( dt );
@@ -118,13 +99,13 @@ void YParticle::update( YTimeInterval dt )
 //    radius.interp( dt );
 
     // update
-    loc.x = X.value * multiplier.value + dX.value;
-    loc.y = Y.value * multiplier.value + dY.value;
-    loc.z = Z.value * multiplier.value + dZ.value;
-    alpha = ALPHA.value;
-    ori.x = oriX.value;
-    ori.y = oriY.value;
-    ori.z = oriZ.value;
+    loc.x = X.value() * multiplier.value() + dX.value();
+    loc.y = Y.value() * multiplier.value() + dY.value();
+    loc.z = Z.value() * multiplier.value() + dZ.value();
+    alpha = ALPHA.value();
+    ori.x = oriX.value();
+    ori.y = oriY.value();
+    ori.z = oriZ.value();
 
 //    velocity.x = velX.value;
 //    velocity.y = velY.value;
@@ -41,6 +41,7 @@
 
 #include <vector>
 #include "y-entity.h"
+#include "x-slew.h"
 
 
 // forward reference
@@ -70,25 +71,25 @@ public:
 
 public:
     // radius
-    // Vector3D radius;
+    // XSlew radius;
     // multiplier
-    Vector3D multiplier;
-
-public:
-    Vector3D X;
-    Vector3D Y;
-    Vector3D Z;
-    Vector3D dX;
-    Vector3D dY;
-    Vector3D dZ;
-    Vector3D ALPHA;
-    Vector3D oriX;
-    Vector3D oriY;
-    Vector3D oriZ;
-
-//    Vector3D velX;
-//    Vector3D velY;
-//    Vector3D velZ;
+    XSlew multiplier;
+
+public: // slews (global bank, advanced once per simulation step)
+    XSlew X;
+    XSlew Y;
+    XSlew Z;
+    XSlew dX;
+    XSlew dY;
+    XSlew dZ;
+    XSlew ALPHA;
+    XSlew oriX;
+    XSlew oriY;
+    XSlew oriZ;
+
+//    XSlew velX;
+//    XSlew velY;
+//    XSlew velZ;
 
     Vector3D origLoc;
     Vector3D origOri;
@@ -155,6 +156,8 @@ public:
     void converge( GLfloat slewLoc, GLfloat slewOri );
 
 public:
+    // draws its particles
+    virtual bool canBatch() const { return false; }
     virtual void update( YTimeInterval dt );
     virtual void render();
 
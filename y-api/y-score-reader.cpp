@@ -40,6 +40,8 @@
 #include <iostream>
 #include "y-score-reader.h"
 #include "MidiFileIn.h"
+#include <algorithm>
+#include <math.h>
 
 using namespace stk;
 using namespace std;
@@ -54,12 +56,12 @@ using namespace std;
 // name: isNoteOff()
 // desc: ...
 //-----------------------------------------------------------------------------
-static bool isNoteOff( std::vector<unsigned char> & shuttle )
+static bool isNoteOff( const MidiFileIn::Event & shuttle )
 {
-    if( shuttle.size() >= 1 && shuttle[0] >> 4 == 0x8 ) // note off event
+    if( shuttle.size >= 1 && shuttle[0] >> 4 == 0x8 ) // note off event
         return true;
     
-    if( shuttle.size() >= 3 && shuttle[0] >> 4 == 0x9 && shuttle[2] == 0 ) // note on event with velocity 0
+    if( shuttle.size >= 3 && shuttle[0] >> 4 == 0x9 && shuttle[2] == 0 ) // note on event with velocity 0
         return true;
     
     return false;
@@ -72,9 +74,9 @@ static bool isNoteOff( std::vector<unsigned char> & shuttle )
 // name: isControl()
 // desc: ...
 //-----------------------------------------------------------------------------
-static bool isControl( std::vector<unsigned char> & shuttle )
+static bool isControl( const MidiFileIn::Event & shuttle )
 {
-    if( shuttle.size() >= 1 && ( shuttle[0] & 0xf0 ) == 0xb0 )
+    if( shuttle.size >= 1 && ( shuttle[0] & 0xf0 ) == 0xb0 )
         return true;
     
     return false;
@@ -87,9 +89,9 @@ static bool isControl( std::vector<unsigned char> & shuttle )
 // name: isMeta()
 // desc: ...
 //-----------------------------------------------------------------------------
-static bool isMeta( std::vector<unsigned char> & shuttle )
+static bool isMeta( const MidiFileIn::Event & shuttle )
 {
-    if( shuttle.size() >= 1 && shuttle[0] == 0xff )
+    if( shuttle.size >= 1 && shuttle[0] == 0xff )
         return true;
     
     return false;
@@ -102,9 +104,9 @@ static bool isMeta( std::vector<unsigned char> & shuttle )
 // name: isProgram()
 // desc: ...
 //-----------------------------------------------------------------------------
-static bool isProgram( std::vector<unsigned char> & shuttle )
+static bool isProgram( const MidiFileIn::Event & shuttle )
 {
-    if( shuttle.size() >= 1 && ( shuttle[0] >= 0xC0 && shuttle[0] <= 0xCF ) )
+    if( shuttle.size >= 1 && ( shuttle[0] >= 0xC0 && shuttle[0] <= 0xCF ) )
         return true;
 
     return false;
@@ -113,12 +115,213 @@ static bool isProgram( std::vector<unsigned char> & shuttle )
 
 
 
+#pragma mark - YScoreIndex
+
+
+//-----------------------------------------------------------------------------
+// name: build()
+// desc: build from notes in start time order
+//-----------------------------------------------------------------------------
+void YScoreIndex::build( const std::vector<const NoteEvent *> & notes )
+{
+    // copy
+    m_notes = notes;
+    m_starts.resize( notes.size() );
+    for( size_t i = 0; i < notes.size(); i++ )
+        m_starts[i] = notes[i]->time;
+
+    // leaves: next power of two
+    m_leaves = 1;
+    while( m_leaves < (long)notes.size() ) m_leaves *= 2;
+    // leaves, then each parent is the max of its children
+    m_maxEnds.assign( 2 * m_leaves, -HUGE_VAL );
+    for( size_t i = 0; i < notes.size(); i++ )
+        m_maxEnds[m_leaves + i] = notes[i]->time + notes[i]->duration;
+    for( long i = m_leaves - 1; i >= 1; i-- )
+        m_maxEnds[i] = max( m_maxEnds[2*i], m_maxEnds[2*i+1] );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: clear()
+// desc: clear
+//-----------------------------------------------------------------------------
+void YScoreIndex::clear()
+{
+    m_notes.clear();
+    m_starts.clear();
+    m_maxEnds.clear();
+    m_leaves = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: lowerBound()
+// desc: index of the first note starting at or after a time
+//-----------------------------------------------------------------------------
+long YScoreIndex::lowerBound( double time ) const
+{
+    return lower_bound( m_starts.begin(), m_starts.end(), time ) - m_starts.begin();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: query()
+// desc: append notes sounding in [startTime, endTime]: those starting by
+//       endTime (binary search) that end after startTime (tree descent)
+//-----------------------------------------------------------------------------
+void YScoreIndex::query( double startTime, double endTime,
+                         std::vector<const NoteEvent *> & result ) const
+{
+    // notes starting after the window are out
+    long limit = upper_bound( m_starts.begin(), m_starts.end(), endTime ) - m_starts.begin();
+    // descend
+    if( limit > 0 ) collect( 1, 0, m_leaves, limit, startTime, result );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: collect()
+// desc: collect notes under a node (covering count leaves from first) that
+//       are before limit and end after startTime; skips whole subtrees
+//-----------------------------------------------------------------------------
+void YScoreIndex::collect( long node, long first, long count, long limit, double startTime,
+                           std::vector<const NoteEvent *> & result ) const
+{
+    // nothing here
+    if( first >= limit || m_maxEnds[node] <= startTime ) return;
+
+    // leaf
+    if( count == 1 )
+    {
+        result.push_back( m_notes[first] );
+        return;
+    }
+
+    // left, then right (keeps start time order)
+    collect( 2*node, first, count/2, limit, startTime, result );
+    collect( 2*node+1, first + count/2, count/2, limit, startTime, result );
+}
+
+
+
+
+#pragma mark - YScorePitchTable
+
+
+//-----------------------------------------------------------------------------
+// name: build()
+// desc: build (after phrasemarks are set)
+//-----------------------------------------------------------------------------
+void YScorePitchTable::build( const std::vector<const NoteEvent *> & events )
+{
+    long n = events.size();
+
+    // logs
+    m_log2.assign( n + 1, 0 );
+    for( long i = 2; i <= n; i++ ) m_log2[i] = m_log2[i/2] + 1;
+
+    // first row: the pitches
+    long rows = n > 0 ? m_log2[n] + 1 : 0;
+    m_lows.resize( rows );
+    m_highs.resize( rows );
+    if( rows )
+    {
+        m_lows[0].resize( n );
+        for( long i = 0; i < n; i++ ) m_lows[0][i] = min( events[i]->pitch, (unsigned char)127 );
+        m_highs[0] = m_lows[0];
+    }
+    // each row from two halves of the one before
+    for( long k = 1; k < rows; k++ )
+    {
+        long half = 1L << (k-1);
+        long count = n - (1L << k) + 1;
+        m_lows[k].resize( count );
+        m_highs[k].resize( count );
+        for( long i = 0; i < count; i++ )
+        {
+            m_lows[k][i] = min( m_lows[k-1][i], m_lows[k-1][i+half] );
+            m_highs[k][i] = max( m_highs[k-1][i], m_highs[k-1][i+half] );
+        }
+    }
+
+    // phrase ends, from the back
+    m_phraseEnds.resize( n );
+    for( long i = n - 1; i >= 0; i-- )
+        m_phraseEnds[i] = ( (events[i]->flags & Y_NOTE_PHRASE) || i == n - 1 ) ? i : m_phraseEnds[i+1];
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: clear()
+// desc: clear
+//-----------------------------------------------------------------------------
+void YScorePitchTable::clear()
+{
+    m_lows.clear();
+    m_highs.clear();
+    m_log2.clear();
+    m_phraseEnds.clear();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: lowest()
+// desc: lowest pitch over events [first, last]: two overlapping rows
+//-----------------------------------------------------------------------------
+long YScorePitchTable::lowest( long first, long last ) const
+{
+    // clamp
+    if( first < 0 ) first = 0;
+    if( last >= (long)m_phraseEnds.size() ) last = (long)m_phraseEnds.size() - 1;
+    if( first > last ) return -1;
+
+    long k = m_log2[last - first + 1];
+    return min( m_lows[k][first], m_lows[k][last - (1L << k) + 1] );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: highest()
+// desc: highest pitch over events [first, last]
+//-----------------------------------------------------------------------------
+long YScorePitchTable::highest( long first, long last ) const
+{
+    // clamp
+    if( first < 0 ) first = 0;
+    if( last >= (long)m_phraseEnds.size() ) last = (long)m_phraseEnds.size() - 1;
+    if( first > last ) return -1;
+
+    long k = m_log2[last - first + 1];
+    return max( m_highs[k][first], m_highs[k][last - (1L << k) + 1] );
+}
+
+
+
+
+#pragma mark - YScoreReader
+
+
 //-----------------------------------------------------------------------------
 // name: YScoreReader()
 // desc: constructor
 //-----------------------------------------------------------------------------
 YScoreReader::YScoreReader()
-    : m_midiFile(NULL), m_velocity_scale(0.0f), m_numNonZeroTracks(0)
+    : m_midiFile(NULL), m_velocity_scale(0.0f), m_srate(44100), m_numNonZeroTracks(0)
 {
 }
 
@@ -147,42 +350,18 @@ void YScoreReader::cleanup()
     // clean up
     if( m_midiFile )
     {
-        // pointer to event
-        NoteEvent * e = NULL;
-        NoteEvent * next = NULL;
-
-        // clean up the tracks
-        for( long i = 0; i < m_midiFile->getNumberOfTracks(); i++ )
-        {
-            // for each track
-            for( long j = 0; j < m_events[i].size(); j++ )
-            {
-                // get track
-                e = m_events[i][j];
-                // delete simultaneous events
-                while( e )
-                {
-                    // get next
-                    next = e->simultaneous;
-                    // delete current
-                    delete e;
-                    // advance
-                    e = next;
-                }
-            }
-            
-            // clear the vectors
-            m_events[i].clear();
-        }
-
         // delete midiFile
         delete m_midiFile;
         m_midiFile = NULL;
         
-        // clean the vector
+        // clean the vectors (the notes go with them)
         m_events.clear();
+        m_notes.clear();
         m_countMaps.clear();
         m_nonZeroTrackIndices.clear();
+        m_parentIndex.clear();
+        m_noteIndex.clear();
+        m_pitchTables.clear();
 
         // clear the queue
         while( m_queue.size() > 0 )
@@ -197,7 +376,7 @@ void YScoreReader::cleanup()
 // name: load()
 // desc: load a MIDI file
 //-----------------------------------------------------------------------------
-bool YScoreReader::load( const char * path, float velScale )
+bool YScoreReader::load( const char * path, float velScale, double srate )
 {
     // sanity check
     if( m_midiFile ) cleanup();
@@ -226,29 +405,48 @@ bool YScoreReader::load( const char * path, float velScale )
     
     // set velocity scale
     m_velocity_scale = velScale;
+    // set sample rate
+    m_srate = srate > 0 ? srate : 44100;
     // reset
     m_numNonZeroTracks = 0;
     // clear
     m_nonZeroTrackIndices.clear();
 
     // allocate element for vector
+    m_notes.resize( m_midiFile->getNumberOfTracks() );
     m_events.resize( m_midiFile->getNumberOfTracks() );
     m_lyricEvents.resize( m_midiFile->getNumberOfTracks() );
     m_indices.resize( m_midiFile->getNumberOfTracks() );
     m_countMaps.resize( m_midiFile->getNumberOfTracks() );
+    m_parentIndex.resize( m_midiFile->getNumberOfTracks() );
+    m_noteIndex.resize( m_midiFile->getNumberOfTracks() );
+    m_pitchTables.resize( m_midiFile->getNumberOfTracks() );
+    // for building the indices
+    vector<const NoteEvent *> notes;
     // iterate and set
     for( long i = 0; i < m_midiFile->getNumberOfTracks(); i++ )
     {
         // load up the arrays
-        loadTrack( i, m_events[i], m_lyricEvents[i] );
+        loadTrack( i, m_notes[i], m_lyricEvents[i] );
+        // the first note of each chord
+        m_events[i].clear();
+        for( size_t j = 0; j < m_notes[i].size(); j += m_notes[i][j].chord )
+            m_events[i].push_back( &m_notes[i][j] );
+        // pitch ranges
+        m_pitchTables[i].build( m_events[i] );
         // log
         string name = getTrackName( i );
         printf( "[score-reader]: track-%ld (%s): events: %lu low: %lu high: %lu\n",
                 i, name.c_str(), m_events[i].size(), getLowestNote( i, NULL ), getHighestNote( i, NULL ) );
         // set indice
         m_indices[i] = 0;
-        // add search pointer
-        m_searchIndices.push_back( 0 );
+        // window query index: top level events
+        m_parentIndex[i].build( m_events[i] );
+        // and with simultaneous events (same start as their chord)
+        notes.clear();
+        for( size_t j = 0; j < m_notes[i].size(); j++ )
+            notes.push_back( &m_notes[i][j] );
+        m_noteIndex[i].build( notes );
         // count non zero
         if( m_events[i].size() )
         {
@@ -265,6 +463,75 @@ bool YScoreReader::load( const char * path, float velScale )
 
 
 
+//-----------------------------------------------------------------------------
+// name: scan()
+// desc: read through a MIDI file, calling back on every note on, one track
+//       at a time; no events are kept
+//-----------------------------------------------------------------------------
+bool YScoreReader::scan( const char * path, YScoreNoteCallback callback, void * userData )
+{
+    MidiFileIn * midiFile = NULL;
+    // each event (points into the file)
+    MidiFileIn::Event shuttle;
+
+    try
+    {
+        // open midi file
+        midiFile = new MidiFileIn( path );
+
+        // ticks per quarter note (or SMPTE, in which case time is at 120 BPM)
+        int division = midiFile->getDivision();
+        bool timeCode = ( division & 0x8000 ) != 0;
+        double ticksPerBeat = division & 0x7fff;
+        if( ticksPerBeat == 0 ) ticksPerBeat = 1;
+
+        // each track
+        for( unsigned int track = 0; track < midiFile->getNumberOfTracks(); track++ )
+        {
+            // position
+            unsigned long tickAccum = 0;
+            double secondsAccum = 0;
+
+            while( true )
+            {
+                // get the next channel event
+                // done?
+                if( !midiFile->readMidiEvent( shuttle, track ) ) break;
+
+                // accumulate time
+                tickAccum += shuttle.ticks;
+                if( timeCode ) secondsAccum += shuttle.ticks * midiFile->getTickSeconds( track );
+
+                // note on (not a note off in disguise)
+                if( shuttle.size >= 3 && shuttle[0] >> 4 == 0x9 && shuttle[2] != 0 )
+                {
+                    double beats = timeCode ? secondsAccum * 2 : tickAccum / ticksPerBeat;
+                    // the rest of this track isn't wanted
+                    if( !callback( track, beats, shuttle[0] & 0x0f, shuttle[1], shuttle[2], userData ) )
+                        break;
+                }
+            }
+        }
+    }
+    catch ( StkError & e )
+    {
+        std::cerr << "[score-reader]: oh no, there was a problem scanning: "
+                  << path << std::endl;
+        // delete
+        delete midiFile;
+
+        return false;
+    }
+
+    // done
+    delete midiFile;
+
+    return true;
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: getNumTracks()
 // desc: get the number of tracks
@@ -316,37 +583,124 @@ double YScoreReader::getBPM() const
 
 
 
+//-----------------------------------------------------------------------------
+// name: getBPM()
+// desc: get BPM at a time (seconds) in the score
+//-----------------------------------------------------------------------------
+double YScoreReader::getBPM( double seconds ) const
+{
+    if( m_midiFile == NULL ) return 0;
+
+    // SMPTE time: no beats
+    int division = m_midiFile->getDivision();
+    if( division & 0x8000 ) return m_midiFile->getBPM();
+
+    // seconds per quarter note
+    double tick = m_midiFile->getTempoMap().getTicks( seconds );
+    return 60.0 / ( m_midiFile->getTempoMap().getTickSeconds( tick ) * ( division & 0x7fff ) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getSeconds()
+// desc: time in seconds of a (fractional) tick, through the tempo map
+//-----------------------------------------------------------------------------
+double YScoreReader::getSeconds( double tick ) const
+{
+    if( m_midiFile == NULL ) return 0;
+    return m_midiFile->getTempoMap().getSeconds( tick );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getTicks()
+// desc: (fractional) tick at a time in seconds, through the tempo map
+//-----------------------------------------------------------------------------
+double YScoreReader::getTicks( double seconds ) const
+{
+    if( m_midiFile == NULL ) return 0;
+    return m_midiFile->getTempoMap().getTicks( seconds );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getBeats()
+// desc: position in quarter notes at a time in seconds (for scrubbing)
+//-----------------------------------------------------------------------------
+double YScoreReader::getBeats( double seconds ) const
+{
+    if( m_midiFile == NULL ) return 0;
+
+    // SMPTE time: at 120 BPM
+    int division = m_midiFile->getDivision();
+    if( division & 0x8000 ) return seconds * 2;
+
+    return getTicks( seconds ) / ( division & 0x7fff );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: seekBeats()
+// desc: go to the first event at or after a position in quarter notes
+//-----------------------------------------------------------------------------
+void YScoreReader::seekBeats( double beats )
+{
+    if( m_midiFile == NULL ) return;
+
+    // SMPTE time: at 120 BPM
+    int division = m_midiFile->getDivision();
+    if( division & 0x8000 ) seek( beats / 2 );
+    else seek( getSeconds( beats * ( division & 0x7fff ) ) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: indexOf()
+// desc: where a top level event is in its track (-1 if not); top level
+//       events have increasing start times
+//-----------------------------------------------------------------------------
+long YScoreReader::indexOf( long track, const NoteEvent * e )
+{
+    // sanity check
+    if( e == NULL || track < 0 || track >= (long)m_events.size() ) return -1;
+
+    // binary search
+    long index = m_parentIndex[track].lowerBound( e->time );
+    // check it
+    if( index < (long)m_events[track].size() && m_events[track][index] == e ) return index;
+
+    return -1;
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: getLowestNote()
-// desc: get lowest note for a track
+// desc: get lowest note for a track, from after start to the end of its
+//       phrase (from the beginning if start is NULL)
 //-----------------------------------------------------------------------------
 long YScoreReader::getLowestNote( long track, const NoteEvent * start )
 {
-    int lowestNote = 128;
-    int startingPoint = 0;
+    // sanity check
+    if( track < 0 || track >= (long)m_pitchTables.size() ) return 0;
 
     // get the starting point
-    if( start != NULL )
-    {
-        for( int i = 0; i < m_events[track].size(); i++ )
-        {
-            if( m_events[track].at(i) == start )
-            {
-                startingPoint = i + 1;
-                break;
-            }
-        }
-    }
-    
-    for( int i = startingPoint; i < m_events[track].size(); i++ )
-    {
-        if( m_events[track].at(i)->data2 < lowestNote )
-            lowestNote = m_events[track].at(i)->data2;
-        
-        if( m_events[track].at(i)->phrasemark ) break;
-    }
-    
-    return lowestNote < 128 ? lowestNote : 0;
+    long first = indexOf( track, start ) + 1;
+    // nothing after it
+    if( first >= (long)m_events[track].size() ) return 0;
+
+    return getLowestNote( track, first, m_pitchTables[track].phraseEnd( first ) );
 }
 
 
@@ -354,35 +708,52 @@ long YScoreReader::getLowestNote( long track, const NoteEvent * start )
 
 //-----------------------------------------------------------------------------
 // name: getHighestNote()
-// desc: get highest note for a track
+// desc: get highest note for a track, from after start to the end of its
+//       phrase (from the beginning if start is NULL)
 //-----------------------------------------------------------------------------
 long YScoreReader::getHighestNote( long track, const NoteEvent *start )
 {
-    long highestNote = 0;
-    long startingPoint = 0;
+    // sanity check
+    if( track < 0 || track >= (long)m_pitchTables.size() ) return 0;
 
     // get the starting point
-    if( start != NULL )
-    {
-        for( long i = 0; i < m_events[track].size(); i++ )
-        {
-            if( m_events[track].at(i) == start )
-            {
-                startingPoint = i+1;
-                break;
-            }
-        }
-    }
-    
-    for( long i = startingPoint; i < m_events[track].size(); i++ )
-    {
-        if( m_events[track].at(i)->data2 > highestNote )
-            highestNote = m_events[track].at(i)->data2;
-        
-        if( m_events[track].at(i)->phrasemark ) break;
-    }
-    
-    return highestNote;
+    long first = indexOf( track, start ) + 1;
+    // nothing after it
+    if( first >= (long)m_events[track].size() ) return 0;
+
+    return getHighestNote( track, first, m_pitchTables[track].phraseEnd( first ) );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getLowestNote()
+// desc: get lowest note over top level events [first, last]
+//-----------------------------------------------------------------------------
+long YScoreReader::getLowestNote( long track, long first, long last )
+{
+    // sanity check
+    if( track < 0 || track >= (long)m_pitchTables.size() ) return 0;
+
+    long note = m_pitchTables[track].lowest( first, last );
+    return note < 0 ? 0 : note;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: getHighestNote()
+// desc: get highest note over top level events [first, last]
+//-----------------------------------------------------------------------------
+long YScoreReader::getHighestNote( long track, long first, long last )
+{
+    // sanity check
+    if( track < 0 || track >= (long)m_pitchTables.size() ) return 0;
+
+    long note = m_pitchTables[track].highest( first, last );
+    return note < 0 ? 0 : note;
 }
 
 
@@ -471,7 +842,7 @@ bool YScoreReader::nextNoteOn( long track )
         if( index >= m_events[track].size() ) break;
         // set the e
         e = m_events[track][index];
-    } while( (e->data1 >> 4 != 0x9) || (e->data3 == 0) );
+    } while( e->velocity == 0 );
 
     // return
     if( index >= m_events[track].size() ) return false;
@@ -495,16 +866,48 @@ void YScoreReader::rewind()
     {
         // clear
         m_indices[i] = 0;
-        m_searchIndices[i] = 0;
     }
 }
 
 
 
 
+//-----------------------------------------------------------------------------
+// name: seek()
+// desc: go to the first event at or after a time, on all tracks
+//-----------------------------------------------------------------------------
+void YScoreReader::seek( double time )
+{
+    // sanity check
+    if( !m_midiFile ) return;
+
+    // each track
+    for( long i = 0; i < (long)m_events.size(); i++ )
+        seek( i, time );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: seek()
+// desc: go to the first event at or after a time, on one track
+//-----------------------------------------------------------------------------
+void YScoreReader::seek( long track, double time )
+{
+    // sanity check
+    if( !m_midiFile || track < 0 || track >= (long)m_events.size() ) return;
+
+    // binary search
+    m_indices[track] = m_parentIndex[track].lowerBound( time );
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: getEvents()
-// desc: get notes in a time window
+// desc: get notes in a time window (any window, in any order; see YScoreIndex)
 //-----------------------------------------------------------------------------
 void YScoreReader::getEvents( long track, double startTime, double endTime,
                               vector<const NoteEvent *> & result,
@@ -514,58 +917,15 @@ void YScoreReader::getEvents( long track, double startTime, double endTime,
     result.clear();
 
     // sanity check
-    if( !m_midiFile || track >= m_events.size() )
+    if( !m_midiFile || track < 0 || track >= (long)m_events.size() )
     {
         std::cerr << "[score-reader]: cannot read track: " << track << "!" << std::endl;
         return;
     }
     
-    // get the event
-    const NoteEvent * searchPtr = current( track, m_searchIndices[track] );
-    
-    // advance the search pointer
-    while( searchPtr && searchPtr->endTime < startTime )
-    {
-        // TODO: this doesn't handle the case where simultaneous note ends later than parent
-
-        // increment index
-        m_searchIndices[track]++;
-        // get event
-        searchPtr = current( track, m_searchIndices[track] );
-    }
-    
-    // check
-    if( searchPtr == NULL )
-        return;
-    
-    // the index
-    unsigned long searchIndex = m_searchIndices[track];
-    
-    // scan for events within the window
-    while( searchPtr )
-    {
-        // within window - this is some sexy logic, thanks Jieun and Tom
-        // ge: added the <= for endTime
-        if( searchPtr->endTime > startTime && searchPtr->startTime <= endTime )
-        {
-            // add to vector
-            result.push_back( searchPtr );
-        }
-
-        // check
-        if( includeSimultaneous && searchPtr->simultaneous )
-        {
-            // move to simultaneous - could have different end time
-            searchPtr = searchPtr->simultaneous;
-        }
-        else // to the next parent (top level event)
-        {
-            // advance search index
-            searchIndex++;
-            // get event
-            searchPtr = current( track, searchIndex );
-        }
-    }
+    // within window: endTime > startTime and startTime <= endTime
+    if( includeSimultaneous ) m_noteIndex[track].query( startTime, endTime, result );
+    else m_parentIndex[track].query( startTime, endTime, result );
 }
 
 
@@ -587,7 +947,9 @@ bool YScoreReader::isDone( long track, double currTime )
     if( numEvents <= 0 )
         return true;
 
-    return m_events[track][numEvents-1]->endTime < currTime;
+    // its chord's notes all end together
+    const NoteEvent * e = m_events[track][numEvents-1];
+    return e->time + e->duration < currTime;
 }
 
 
@@ -610,17 +972,17 @@ bool YScoreReader::applyControl( long track, long data2, long data3, NoteEvent *
     if( data2 == 0x52 )
     {
         // gliss
-        e->shouldBend = true;
+        e->flags |= Y_NOTE_BEND;
         found = true;
         // increment
         incrementCount( track, "bend" );
-        e->bendAmount = (int)data3;
+        e->bend = (unsigned char)data3;
     }
     
     if( data2 == 0x53 )
     {
         // gliss
-        e->phrasemark = true;
+        e->flags |= Y_NOTE_PHRASE;
         found = true;
         // increment
         incrementCount( track, "phrasemark" );
@@ -632,11 +994,30 @@ bool YScoreReader::applyControl( long track, long data2, long data3, NoteEvent *
 
 
 
+//-----------------------------------------------------------------------------
+// name: countChords()
+// desc: set each note's chord count, from the back; while reading, the
+//       first note of a chord has 1 and the rest 0
+//-----------------------------------------------------------------------------
+static void countChords( std::vector<NoteEvent> & data )
+{
+    unsigned short count = 0;
+    for( size_t i = data.size(); i-- > 0; )
+    {
+        bool first = data[i].chord == 1;
+        data[i].chord = ++count;
+        if( first ) count = 0;
+    }
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: loadTrack()
 // desc: load a track from file
 //-----------------------------------------------------------------------------
-bool YScoreReader::loadTrack( long track, std::vector<NoteEvent *> & data, std::vector<LyricEvent *> & lyricData )
+bool YScoreReader::loadTrack( long track, std::vector<NoteEvent> & data, std::vector<LyricEvent *> & lyricData )
 {
     // sanity check
     if( !m_midiFile || track >= m_events.size() )
@@ -649,80 +1030,84 @@ bool YScoreReader::loadTrack( long track, std::vector<NoteEvent *> & data, std::
     data.clear();
     // clear out active MIDI notes
     m_activeNotes.clear();
-    // a vector to hold the return information
-    std::vector<unsigned char> shuttle;
-    // piano event pointers
-    NoteEvent * e = NULL;
+    // the return information (points into the file)
+    MidiFileIn::Event shuttle;
+    // piano event
+    NoteEvent e;
     LyricEvent * le = NULL;
-    // last event
-    NoteEvent * prev_e = NULL;
+    // last lyric event
     LyricEvent * prev_le = NULL;
-    // parent event
-    NoteEvent * parent = NULL;
+    // first note of the chord being read
+    long chord = 0;
     
     int currentProgram = 27; // program defaults to electric gutiar (27) in case it is not set in the score
+    // has the track set one
+    bool programSet = false;
     
     // load next on the track
     try {
-        // seconds accum
+        // ticks and seconds accum
+        unsigned long tickAccum = 0;
         double secondsAccum = 0;
+        // format 2 tracks keep their own tempo; otherwise the tempo map is exact
+        bool ownTempo = m_midiFile->getFileFormat() == 2;
         // loop
         while( true )
         {
-            // get the next MIDI event
-            unsigned long ticks = m_midiFile->getNextEvent( &shuttle, (unsigned int)track );
+            // get the next MIDI event (done?)
+            if( !m_midiFile->readEvent( shuttle, (unsigned int)track ) ) break;
             
             // accumulate time
-            secondsAccum += ticks * m_midiFile->getTickSeconds();
+            tickAccum += shuttle.ticks;
+            if( ownTempo ) secondsAccum += shuttle.ticks * m_midiFile->getTickSeconds( track );
+            else secondsAccum = m_midiFile->getTempoMap().getSeconds( tickAccum );
             
             // MIDI message spec: http://www.srm.com/qtma/davidsmidispec.html
-
-            // check size (done?)
-            if( shuttle.size() == 0 ) break;
             
             if( isNoteOff( shuttle ) )
             {
                 // do note off
-                handleNoteOff( shuttle[1], secondsAccum );
+                handleNoteOff( data, shuttle[1] & 0x7f, secondsAccum * m_srate );
                 continue;
             }
             else if( isControl( shuttle ) )
             {
-                // apply control to previous
-                applyControl( track, shuttle[1], shuttle[2], prev_e );
+                // apply control to the last chord (its first note, which
+                // the phrase index looks at)
+                applyControl( track, shuttle[1], shuttle[2], data.size() ? &data[chord] : NULL );
                 continue;
             }
             else if( isMeta( shuttle ) )
             {
                 // format: http://www.recordingblogs.com/sa/Wiki/tabid/88/Default.aspx?topic=MIDI+meta+messages
-                // shuttle[1]: message type
-                // shuttle[2]: number of bytes in custom data part
-                // shuttle[3]: start of custom data part
+                // shuttle.meta: message type
+                // shuttle.length: number of bytes in custom data part
+                // shuttle.data: start of custom data part
                 
-                switch( shuttle[1] )
+                switch( shuttle.meta )
                 {
                     case 1: // text
                     {
-                        string text = string( (char *)&shuttle[3] /* name */, shuttle[2] /* length */ );
+                        string text = string( (const char *)shuttle.data /* name */, shuttle.length /* length */ );
                         break;
                     }
                     case 3: // track name
                     {
-                        string name = string( (char *)&shuttle[3] /* name */, shuttle[2] /* length */ );
+                        string name = string( (const char *)shuttle.data /* name */, shuttle.length /* length */ );
                         setTrackName( track, name );
                         break;
                     }
                     case 5: // lyric
                     {
-                        string lyric = string( (char *)&shuttle[3] /* name */, shuttle[2] /* length */ );
+                        string lyric = string( (const char *)shuttle.data /* name */, shuttle.length /* length */ );
                         
                         le = new LyricEvent;
                         le->lyric = lyric;
-                        le->time = le->endTime = secondsAccum;
+                        le->time = le->endTime = secondsAccum * m_srate;
                         
                         if( prev_le )
                         {
-                            prev_le->endTime = secondsAccum;
+                            prev_le->endTime = le->time;
                         }
                         
                         lyricData.push_back( le );
@@ -740,59 +1125,50 @@ bool YScoreReader::loadTrack( long track, std::vector<NoteEvent *> & data, std::
             {
                 // if( shuttle[1] >= 0 ) // ge: commented out as this always true
                 currentProgram = shuttle[1];
+                programSet = true;
                 continue;
             }
 
             // continue if it's anything but a note on
             if( shuttle[0] >> 4 != 0x9 || shuttle[2] == 0 ) continue;
 
-            // instantiate
-            e = new NoteEvent();
             // fill
-            e->data1 = (unsigned short)shuttle[0];
-            e->data2 = (unsigned short)shuttle[1];
-            e->data3 = (unsigned short)shuttle[2];
+            e = NoteEvent();
+            e.channel = shuttle[0] & 0x0f;
+            e.pitch = shuttle[1] & 0x7f;
+            e.velocity = shuttle[2] & 0x7f;
             // check
-            if( (m_velocity_scale > 0) && e->data3 )
+            if( (m_velocity_scale > 0) && e.velocity )
             {
-                // scale
-                e->data3 = e->data3 + m_velocity_scale * (127 - e->data3);
-                // clamp
-                if( e->data3 > 127 ) e->data3 = 127;
+                // scale (and clamp)
+                float velocity = e.velocity + m_velocity_scale * (127 - e.velocity);
+                e.velocity = velocity > 127 ? 127 : (unsigned char)velocity;
             }
 
-            // fill the until next for prev
-            if( prev_e ) prev_e->untilNext = e->time - prev_e->startTime;
             // advance time
-            e->startTime = e->time = secondsAccum;
-            // simultaneous
-            e->simultaneous = NULL;
+            e.time = secondsAccum * m_srate;
             // store current program
-            e->programChange = currentProgram;
+            e.program = currentProgram & 0x7f;
+            if( programSet ) e.flags |= Y_NOTE_PROGRAM;
             
-            // simultaneous or in series?
-            if( prev_e != NULL && e->time == prev_e->time )
+            // simultaneous or in series? (see countChords())
+            if( data.size() && e.time == data.back().time && data.size() - chord < 0xffff )
             {
                 // sim
-                prev_e->simultaneous = e;
-                // point to parent
-                e->parent = parent;
+                e.chord = 0;
             }
             else
             {                
                 // increment
                 incrementCount( track, "note" );
                 // series
-                data.push_back( e );
-                // save as parent
-                parent = e->parent = e;
+                chord = data.size();
+                e.chord = 1;
             }
+            data.push_back( e );
             
             // add to lookup
-            handleNoteOn( e, e->data2 );
-            
-            // update
-            prev_e = e; 
+            handleNoteOn( data, data.size() - 1 );
         }
     }
     catch( StkError & )
@@ -802,12 +1178,16 @@ bool YScoreReader::loadTrack( long track, std::vector<NoteEvent *> & data, std::
         
         // clear out active MIDI notes
         m_activeNotes.clear();
+        // what was read
+        countChords( data );
         
         return false;
     }
     
     // clear out active MIDI notes
     m_activeNotes.clear();
+    // chord ranges
+    countChords( data );
     
     return true;
 }
@@ -883,8 +1263,8 @@ const NoteEvent * YScoreReader::getNextEvent( long track, bool & isNewSet )
     {
         // pop it
         dequeue();
-        // get simulaneous
-        e = e->simultaneous;
+        // get simulaneous (the next in its chord)
+        e = e->chord > 1 ? e + 1 : NULL;
     }
     // see if still NULL
     if( !e )
@@ -924,8 +1304,8 @@ long YScoreReader::getNumEvents( long track ) const
 // name: getNoteEvents()
 // desc: get an entire track's note events
 //-----------------------------------------------------------------------------
-static vector<NoteEvent *> s_nullNoteVector;
-const vector<NoteEvent *> & YScoreReader::getNoteEvents( long track )
+static vector<const NoteEvent *> s_nullNoteVector;
+const vector<const NoteEvent *> & YScoreReader::getNoteEvents( long track )
 {
     // sanity check
     if( track < 0 || track >= m_events.size() )
@@ -937,6 +1317,23 @@ const vector<NoteEvent *> & YScoreReader::getNoteEvents( long track )
 
 
 
+//-----------------------------------------------------------------------------
+// name: getNotes()
+// desc: get an entire track's notes
+//-----------------------------------------------------------------------------
+static vector<NoteEvent> s_nullNotes;
+const vector<NoteEvent> & YScoreReader::getNotes( long track )
+{
+    // sanity check
+    if( track < 0 || track >= (long)m_notes.size() )
+        return s_nullNotes;
+    
+    return m_notes[track];
+}
+
+
+
+
 //-----------------------------------------------------------------------------
 // name: getLyricEvents()
 // desc: get an entire track's lyric events
@@ -1004,21 +1401,18 @@ void YScoreReader::incrementCount( long track, const std::string & key )
 // name: handleNoteOn()
 // desc: insert a note on into table
 //-----------------------------------------------------------------------------
-void YScoreReader::handleNoteOn( NoteEvent * e, long note )
+void YScoreReader::handleNoteOn( std::vector<NoteEvent> & data, long index )
 {
     // sanity check
-    if( !e )
+    if( index < 0 || index >= (long)data.size() )
         return;
     
-    // check to see if occupied
-    if( m_activeNotes[note] != NULL )
-    {
-        // treat as a note-off for the same note
-        handleNoteOff( note, e->time );
-    }
+    // treat as a note-off for the same note (if occupied)
+    long note = data[index].pitch;
+    handleNoteOff( data, note, data[index].time );
     
     // insert
-    m_activeNotes[note] = e;
+    m_activeNotes[note] = index;
 }
 
 
@@ -1028,19 +1422,22 @@ void YScoreReader::handleNoteOn( NoteEvent * e, long note )
 // name: handleNoteOff()
 // desc: insert a note off into table
 //-----------------------------------------------------------------------------
-void YScoreReader::handleNoteOff( long note, double time )
+void YScoreReader::handleNoteOff( std::vector<NoteEvent> & data, long note, double time )
 {
     // get the piano event
-    NoteEvent * e = m_activeNotes[note];
+    std::map<long, long>::iterator iter = m_activeNotes.find( note );
     // check
-    if( !e )
+    if( iter == m_activeNotes.end() )
         return;
     
-    // set end time
-    e->endTime = time;
+    // set duration
+    NoteEvent & e = data[iter->second];
+    e.duration = time > e.time ? (unsigned int)( time - e.time + .5 ) : 0;
+    // (a note that ends is never 0 long)
+    if( e.duration == 0 ) e.duration = 1;
     
     // set
-    m_activeNotes[note] = NULL;
+    m_activeNotes.erase( iter );
 }
 
 
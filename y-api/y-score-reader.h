@@ -47,37 +47,36 @@
 
 
 
+// NoteEvent flags
+#define Y_NOTE_BEND   0x01
+#define Y_NOTE_PHRASE 0x02
+// its program was set in the file (not the default)
+#define Y_NOTE_PROGRAM 0x04
+
 //-----------------------------------------------------------------------------
 // name: struct NoteEvent
-// desc: a MIDI note event, parsed for start and end time, with simultaneous
-//       notes combined into the 'simultaneous' linked list
+// desc: a note (MIDI note on, and how long until its note off); fixed size
+//       and plain data, kept in flat arrays in start time order; notes
+//       starting together are a chord, the range [e, e + e->chord)
 //-----------------------------------------------------------------------------
 struct NoteEvent
 {
-    // data
-    unsigned short data1;
-    unsigned short data2;
-    unsigned short data3;
-    // time data
+    // start (samples)
     double time;
-    double untilNext;
-    // link to simultaneous events
-    NoteEvent * simultaneous;
-    // link to parent (could be self)
-    NoteEvent * parent;
-    
-    // more data
-    double startTime;
-    double endTime;
-    bool shouldBend;
-    int bendAmount;
-    int programChange;
-    bool phrasemark;
-
-    // constructor
-    NoteEvent() : data1(0), data2(0), data3(0), time(0.0), untilNext(0.0),
-        simultaneous(NULL), parent(NULL), startTime(0), endTime(0), shouldBend(false),
-        bendAmount(0), programChange(0), phrasemark(false) { }
+    // length (samples; 0 if it never ends)
+    unsigned int duration;
+    // notes from this one on (this one included) in its chord
+    unsigned short chord;
+    // MIDI channel (0-15), note, velocity (1-127; 0 for no note)
+    unsigned char channel;
+    unsigned char pitch;
+    unsigned char velocity;
+    // Y_NOTE_* flags
+    unsigned char flags;
+    // program playing it (the file's if Y_NOTE_PROGRAM), and bend amount
+    // (if Y_NOTE_BEND)
+    unsigned char program;
+    unsigned char bend;
 };
 
 
@@ -91,7 +90,7 @@ struct NoteEvent
 struct LyricEvent
 {
     std::string lyric;
-    // time data
+    // time data (samples)
     double time;
     double endTime;
     
@@ -102,9 +101,85 @@ struct LyricEvent
 
 
 
+//-----------------------------------------------------------------------------
+// name: class YScoreIndex
+// desc: interval index over a track's notes: sorted by start time, with a
+//       tree of max end times, for window queries in O(log n + k)
+//-----------------------------------------------------------------------------
+class YScoreIndex
+{
+public:
+    YScoreIndex() : m_leaves(0) { }
+
+public:
+    // build from notes in start time order
+    void build( const std::vector<const NoteEvent *> & notes );
+    // clear
+    void clear();
+    // append notes sounding in [startTime, endTime], in start time order
+    void query( double startTime, double endTime, std::vector<const NoteEvent *> & result ) const;
+    // index of the first note starting at or after a time
+    long lowerBound( double time ) const;
+    // number of notes
+    long size() const { return m_notes.size(); }
+
+protected:
+    // collect under a tree node
+    void collect( long node, long first, long count, long limit, double startTime,
+                  std::vector<const NoteEvent *> & result ) const;
+
+protected:
+    // notes, and their start times (for binary search)
+    std::vector<const NoteEvent *> m_notes;
+    std::vector<double> m_starts;
+    // max end time per tree node (node 1 is the root; leaves from m_leaves)
+    std::vector<double> m_maxEnds;
+    long m_leaves;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class YScorePitchTable
+// desc: sparse tables of lowest/highest pitch over a track's chords (their
+//       first notes), for any chord range in O(1)
+//-----------------------------------------------------------------------------
+class YScorePitchTable
+{
+public:
+    // build (after phrasemarks are set)
+    void build( const std::vector<const NoteEvent *> & events );
+    // clear
+    void clear();
+    // lowest/highest pitch over events [first, last] (-1 if empty)
+    long lowest( long first, long last ) const;
+    long highest( long first, long last ) const;
+    // last event of the phrase containing an event (next phrasemark, or end)
+    long phraseEnd( long index ) const { return m_phraseEnds[index]; }
+
+protected:
+    // row k: lowest/highest over [i, i + 2^k)
+    std::vector< std::vector<unsigned char> > m_lows;
+    std::vector< std::vector<unsigned char> > m_highs;
+    // floor(log2(n)) for each n
+    std::vector<unsigned char> m_log2;
+    // per event
+    std::vector<long> m_phraseEnds;
+};
+
+
+
+
 // forward referendes
 namespace stk { class MidiFileIn; }
 
+// called for each note on by YScoreReader::scan() (beats: quarter notes from
+// start); return false to skip the rest of the track
+typedef bool (* YScoreNoteCallback)( long track, double beats, unsigned short channel,
+                                     unsigned short pitch, unsigned short velocity,
+                                     void * userData );
+
 
 
 
@@ -119,9 +194,14 @@ public:
     ~YScoreReader();
 
 public:
-    bool load( const char * filename, float velScale = 0.0f );
+    // note times are in samples at srate
+    bool load( const char * filename, float velScale = 0.0f, double srate = 44100 );
     void cleanup();
 
+public: // streaming (nothing kept in memory)
+    // read through a MIDI file, calling back on every note on
+    static bool scan( const char * filename, YScoreNoteCallback callback, void * userData );
+
 public:
     // next advance to next note on
     bool nextNoteOn( long track );
@@ -129,10 +209,15 @@ public:
     const NoteEvent * current( long track, long offset = 0 );
     // rewind to beginning
     void rewind();
-    // get notes in a time window
+    // go to the first event at or after a time in samples (all tracks, or one)
+    void seek( double time );
+    void seek( long track, double time );
+    // go to the first event at or after a position in quarter notes
+    void seekBeats( double beats );
+    // get notes in a time window (samples)
     void getEvents( long track, double startTime, double endTime, std::vector<const NoteEvent *> & result,
                     bool includeSimultaneous = false );
-    // isDone
+    // isDone (samples)
     bool isDone( long track, double currTime );
     
 public: // TODO: figure out what we can consolidate with the previous set of functions
@@ -150,18 +235,31 @@ public:
     long getNumTracksNonZero() const;
     // get a vector of tracks indices that have more than 0 events
     const std::vector<long> & getTracksNonZero() const;
+    // get the sample rate note times are in
+    double getSampleRate() const { return m_srate; }
     // get BPM
     double getBPM() const;
-    // get an entire track's note events
-    const std::vector<NoteEvent *> & getNoteEvents( long track );
+    // get BPM at a time (seconds) in the score
+    double getBPM( double seconds ) const;
+    // tempo map: tick <-> seconds, and seconds -> quarter notes (O(log n))
+    double getSeconds( double tick ) const;
+    double getTicks( double seconds ) const;
+    double getBeats( double seconds ) const;
+    // get an entire track's note events (the first of each chord)
+    const std::vector<const NoteEvent *> & getNoteEvents( long track );
+    // get an entire track's notes (all of them, chords in place)
+    const std::vector<NoteEvent> & getNotes( long track );
     // get an entire track's lyric events
     const std::vector<LyricEvent *> & getLyricEvents( long track );
     // get count
     long getCount( long track, const std::string & key );
-    // get lowest note for a track
+    // get lowest note for a track (in the phrase after start)
     long getLowestNote( long track, const NoteEvent *start );
-    // get highest note for a track
+    // get highest note for a track (in the phrase after start)
     long getHighestNote( long track, const NoteEvent *start );
+    // get lowest/highest note over top level events [first, last] (0 if empty)
+    long getLowestNote( long track, long first, long last );
+    long getHighestNote( long track, long first, long last );
     
 public: // TODO: these may as well be a separate object
     // push a event to remember
@@ -183,20 +281,24 @@ public: // track naming
 
 protected: // for use while loading a track
     // load a track
-    bool loadTrack( long track, std::vector<NoteEvent *> & data, std::vector<LyricEvent *> & lyricData );
+    bool loadTrack( long track, std::vector<NoteEvent> & data, std::vector<LyricEvent *> & lyricData );
     // apply control to existing event
     bool applyControl( long track, long data2, long data3, NoteEvent * e );
     // increment count for the given key (used for counting the number of notes, glissandi, etc)
     void incrementCount( long track, const std::string & key );
-    // handle note events, managing m_activeNotes and setting the event's endTime
-    void handleNoteOn( NoteEvent * e, long note );
-    void handleNoteOff( long note, double time );
+    // where a top level event is in its track (-1 if not)
+    long indexOf( long track, const NoteEvent * e );
+    // handle note events, managing m_activeNotes and setting the event's duration
+    void handleNoteOn( std::vector<NoteEvent> & data, long index );
+    void handleNoteOff( std::vector<NoteEvent> & data, long note, double time );
 
 protected:
     // midi
     stk::MidiFileIn * m_midiFile;
-    // vector of tracks of events
-    std::vector< std::vector<NoteEvent *> > m_events;
+    // vector of tracks of notes
+    std::vector< std::vector<NoteEvent> > m_notes;
+    // vector of tracks of events (the first note of each chord)
+    std::vector< std::vector<const NoteEvent *> > m_events;
     // vector of tracks of events
     std::vector< std::vector<LyricEvent *> > m_lyricEvents;
     // vector of indices
@@ -205,12 +307,17 @@ protected:
     std::deque<const NoteEvent *> m_queue;
     // vector of event
     std::vector<const NoteEvent *> m_result;
-    // search pointer
-    std::vector<unsigned long> m_searchIndices;
+    // window query index per track (top level events / all events)
+    std::vector<YScoreIndex> m_parentIndex;
+    std::vector<YScoreIndex> m_noteIndex;
+    // pitch range per track
+    std::vector<YScorePitchTable> m_pitchTables;
     // count map
     std::vector< std::map< std::string, long > > m_countMaps;
     // HACK: scale the velocity (0-1)
     float m_velocity_scale;
+    // samples per second, for note times
+    double m_srate;
     // track names
     std::map<std::string, long> m_nameToTrack;
     std::map<long, std::string> m_trackToName;
@@ -220,8 +327,8 @@ protected:
     std::vector<long> m_nonZeroTrackIndices;
 
 private: // used during track loading
-    // active notes, map from MIDI note to event
-    std::map<long, NoteEvent *> m_activeNotes;
+    // active notes, map from MIDI note to its index in the track
+    std::map<long, long> m_activeNotes;
 };
 
 
@@ -36,6 +36,7 @@
 // date: spring 2013
 //-----------------------------------------------------------------------------
 #include "y-waveform.h"
+#include "x-shader.h"
 #include <iostream>
 using namespace std;
 
@@ -148,7 +149,7 @@ void YWaveform::set( const SAMPLE * monoBuffer, unsigned int numFrames )
     if( howmuch > m_numFrames ) howmuch = m_numFrames;
     
     // copy it
-    memcpy( m_buffer, monoBuffer, numFrames*sizeof(SAMPLE) );
+    memcpy( m_buffer, monoBuffer, howmuch*sizeof(SAMPLE) );
     
     // generate vertices
     generate();
@@ -182,11 +183,11 @@ void YWaveform::update( YTimeInterval dt )
 void YWaveform::render()
 {
     // disable light
-    glDisable( GL_LIGHTING );
+    XGfx::disable( GL_LIGHTING );
     // set blend function
-    glBlendFunc( GL_ONE, GL_ONE );
+    XGfx::blendFunc( GL_ONE, GL_ONE );
     // enable blend
-    glEnable( GL_BLEND );
+    XGfx::enable( GL_BLEND );
 	
     // enable
     glEnableClientState( GL_VERTEX_ARRAY );
@@ -196,12 +197,12 @@ void YWaveform::render()
     // set pointer
     glVertexPointer( 2, GL_FLOAT, 0, m_vertices );
     // draw it
-    glDrawArrays( GL_LINE_STRIP, 0, m_numFrames );
+    XGfx::drawArrays( GL_LINE_STRIP, 0, m_numFrames );
     
     // disable client state
     glDisableClientState( GL_VERTEX_ARRAY );
     // disable blend
-    glDisable( GL_BLEND );
+    XGfx::disable( GL_BLEND );
 }
 
 
@@ -228,3 +229,746 @@ void YWaveform::generate()
         m_vertices[i].y = m_buffer[i] * m_height;
     }
 }
+
+
+
+
+// ring position -> x (newest column at the right edge)
+static const char * g_streamVertexShader =
+    "#version 120\n"
+    "uniform float u_head;\n"      // next slot to be written
+    "uniform float u_columns;\n"
+    "uniform vec2 u_size;\n"       // width, height
+    "void main()\n"
+    "{\n"
+    "    float age = mod( gl_Vertex.x - u_head + u_columns, u_columns );\n"
+    "    vec4 v = vec4( ( age / max( u_columns - 1.0, 1.0 ) - 0.5 ) * u_size.x,\n"
+    "                   gl_Vertex.y * u_size.y, 0.0, 1.0 );\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * v;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "}\n";
+
+// pass through
+static const char * g_streamFragmentShader =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "    gl_FragColor = gl_Color;\n"
+    "}\n";
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: YWaveformStream()
+// desc: constructor
+//-----------------------------------------------------------------------------
+YWaveformStream::YWaveformStream()
+{
+    // zero out
+    m_numColumns = 0;
+    m_samplesPerColumn = 0;
+    m_count = 0;
+    m_min = m_max = 0;
+    m_head = 0;
+    m_filled = 0;
+    m_vbo = 0;
+    m_program = 0;
+    m_uHead = m_uColumns = m_uSize = -1;
+    m_setup = false;
+    // default width and height
+    m_width = 2;
+    m_height = 1;
+
+    // set slew
+    m_iAlpha.set( 1, 1, 1 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~YWaveformStream()
+// desc: destructor
+//-----------------------------------------------------------------------------
+YWaveformStream::~YWaveformStream()
+{
+    // clean up
+    cleanup();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: init()
+// desc: initialize
+//-----------------------------------------------------------------------------
+bool YWaveformStream::init( unsigned int numColumns, unsigned int samplesPerColumn )
+{
+    // clean up first
+    cleanup();
+
+    // sanity check
+    if( numColumns < 2 || samplesPerColumn == 0 )
+    {
+        // log
+        cerr << "[y-waveform]: invalid stream size..." << endl;
+        return false;
+    }
+
+    // set
+    m_numColumns = numColumns;
+    m_samplesPerColumn = samplesPerColumn;
+    m_count = 0;
+    // room for two rings of pending columns, so push() never allocates
+    m_pending.init( 2 * numColumns );
+
+    // GL side
+    m_staging.reserve( 2 * 2 * numColumns );
+    m_upload.reserve( 4 * numColumns );
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cleanup()
+// desc: clean up
+//-----------------------------------------------------------------------------
+void YWaveformStream::cleanup()
+{
+    // GL objects
+    if( m_vbo ) glDeleteBuffers( 1, &m_vbo );
+    if( m_program ) XShader::destroy( m_program );
+    m_vbo = 0;
+    m_program = 0;
+    m_setup = false;
+
+    // zero out (the queue stays until the next init)
+    m_numColumns = 0;
+    m_staging.clear();
+    m_head = 0;
+    m_filled = 0;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: push()
+// desc: decimate audio into min/max columns
+//-----------------------------------------------------------------------------
+void YWaveformStream::push( const SAMPLE * monoBuffer, unsigned int numFrames )
+{
+    // sanity check
+    if( m_numColumns == 0 ) return;
+
+    for( unsigned int i = 0; i < numFrames; i++ )
+    {
+        SAMPLE x = monoBuffer[i];
+        // start of column
+        if( m_count == 0 ) m_min = m_max = x;
+        else if( x < m_min ) m_min = x;
+        else if( x > m_max ) m_max = x;
+
+        // column done
+        if( ++m_count == m_samplesPerColumn )
+        {
+            // (dropped if nobody has taken the last two rings' worth)
+            YWaveformColumn column = { m_min, m_max };
+            m_pending.put( column );
+            m_count = 0;
+        }
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: update()
+// desc: update
+//-----------------------------------------------------------------------------
+void YWaveformStream::update( YTimeInterval dt )
+{
+    // interpolate
+    m_iAlpha.interp( dt );
+    // set
+    alpha = m_iAlpha.value;
+
+    // take new columns
+    YWaveformColumn column;
+    while( m_pending.peek( column ) )
+    {
+        m_staging.push_back( column.min );
+        m_staging.push_back( column.max );
+        m_pending.pop();
+    }
+
+    // not being rendered; keep only the newest ring's worth
+    if( m_staging.size() > 2 * 2 * m_numColumns )
+        m_staging.erase( m_staging.begin(), m_staging.end() - 2 * m_numColumns );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setupGL()
+// desc: create ring buffer and program
+//-----------------------------------------------------------------------------
+void YWaveformStream::setupGL()
+{
+    m_setup = true;
+
+    // ring: every slot carries its own index as x
+    vector<GLfloat> initial( 4 * m_numColumns, 0 );
+    for( unsigned int i = 0; i < m_numColumns; i++ )
+        initial[4*i] = initial[4*i+2] = (GLfloat)i;
+
+    glGenBuffers( 1, &m_vbo );
+    glBindBuffer( GL_ARRAY_BUFFER, m_vbo );
+    glBufferData( GL_ARRAY_BUFFER, initial.size() * sizeof(GLfloat),
+                  &initial[0], GL_STREAM_DRAW );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    // program (optional)
+    m_program = XShader::link( g_streamVertexShader, g_streamFragmentShader );
+    if( m_program )
+    {
+        m_uHead = glGetUniformLocation( m_program, "u_head" );
+        m_uColumns = glGetUniformLocation( m_program, "u_columns" );
+        m_uSize = glGetUniformLocation( m_program, "u_size" );
+    }
+    else
+    {
+        // log
+        cerr << "[y-waveform]: no shaders; drawing stream in two ranges..." << endl;
+    }
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: upload()
+// desc: copy new columns into the ring (at most two sub-data calls)
+//-----------------------------------------------------------------------------
+void YWaveformStream::upload()
+{
+    // number of new columns
+    unsigned int n = m_staging.size() / 2;
+    // check
+    if( n == 0 ) return;
+
+    // only the newest ring's worth matters
+    unsigned int skip = n > m_numColumns ? n - m_numColumns : 0;
+    // advance over skipped columns
+    m_head = (m_head + skip) % m_numColumns;
+    n -= skip;
+
+    glBindBuffer( GL_ARRAY_BUFFER, m_vbo );
+    // in (up to) two contiguous pieces
+    unsigned int done = 0;
+    while( done < n )
+    {
+        unsigned int count = n - done;
+        if( m_head + count > m_numColumns ) count = m_numColumns - m_head;
+
+        // vertices
+        m_upload.clear();
+        for( unsigned int i = 0; i < count; i++ )
+        {
+            GLfloat slot = (GLfloat)(m_head + i);
+            const GLfloat * mm = &m_staging[2 * (skip + done + i)];
+            m_upload.push_back( slot ); m_upload.push_back( mm[0] );
+            m_upload.push_back( slot ); m_upload.push_back( mm[1] );
+        }
+        glBufferSubData( GL_ARRAY_BUFFER, 4 * m_head * sizeof(GLfloat),
+                         m_upload.size() * sizeof(GLfloat), &m_upload[0] );
+
+        // advance
+        m_head = (m_head + count) % m_numColumns;
+        done += count;
+    }
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+
+    // count
+    m_filled += n;
+    if( m_filled > m_numColumns ) m_filled = m_numColumns;
+    // done with these
+    m_staging.clear();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: render()
+// desc: render
+//-----------------------------------------------------------------------------
+void YWaveformStream::render()
+{
+    // check
+    if( m_numColumns == 0 ) return;
+    // first time
+    if( !m_setup ) setupGL();
+    // new columns
+    upload();
+    // anything?
+    if( m_filled == 0 ) return;
+
+    // disable light
+    XGfx::disable( GL_LIGHTING );
+    // set blend function
+    XGfx::blendFunc( GL_ONE, GL_ONE );
+    // enable blend
+    XGfx::enable( GL_BLEND );
+
+    // set color
+    glColor4f( col.x, col.y, col.z, alpha );
+
+    // ring
+    glBindBuffer( GL_ARRAY_BUFFER, m_vbo );
+    glEnableClientState( GL_VERTEX_ARRAY );
+    glVertexPointer( 2, GL_FLOAT, 0, 0 );
+
+    // zig-zag through min/max of each column, as a strip (never degenerate);
+    // the strip is broken where the ring wraps: slots [head, N), then [0, head)
+    if( m_program )
+    {
+        // x from ring position
+        glUseProgram( m_program );
+        glUniform1f( m_uHead, (GLfloat)m_head );
+        glUniform1f( m_uColumns, (GLfloat)m_numColumns );
+        glUniform2f( m_uSize, m_width, m_height );
+        // oldest part (until the ring is full, the valid slots are [0, head))
+        if( m_filled == m_numColumns )
+            XGfx::drawArrays( GL_LINE_STRIP, 2 * m_head, 2 * (m_numColumns - m_head) );
+        // newest part
+        XGfx::drawArrays( GL_LINE_STRIP, 0, 2 * m_head );
+        glUseProgram( 0 );
+    }
+    else
+    {
+        // same mapping with the matrix
+        glPushMatrix();
+        glTranslatef( -m_width / 2, 0, 0 );
+        glScalef( m_width / (m_numColumns - 1), m_height, 1 );
+        // oldest part: age = slot - head
+        if( m_filled == m_numColumns )
+        {
+            glPushMatrix();
+            glTranslatef( -(GLfloat)m_head, 0, 0 );
+            XGfx::drawArrays( GL_LINE_STRIP, 2 * m_head, 2 * (m_numColumns - m_head) );
+            glPopMatrix();
+        }
+        // newest part: age = slot + N - head
+        glTranslatef( (GLfloat)(m_numColumns - m_head), 0, 0 );
+        XGfx::drawArrays( GL_LINE_STRIP, 0, 2 * m_head );
+        glPopMatrix();
+    }
+
+    // disable client state
+    glDisableClientState( GL_VERTEX_ARRAY );
+    glBindBuffer( GL_ARRAY_BUFFER, 0 );
+    // disable blend
+    XGfx::disable( GL_BLEND );
+}
+
+
+
+
+// spectrogram: look up colour from magnitude
+static const char * g_spectrogramFragmentShader =
+    "#version 120\n"
+    "uniform sampler2D u_spectrum;\n"
+    "uniform sampler1D u_colormap;\n"
+    "void main()\n"
+    "{\n"
+    "    float m = texture2D( u_spectrum, gl_TexCoord[0].st ).r;\n"
+    "    gl_FragColor = texture1D( u_colormap, m ) * gl_Color;\n"
+    "}\n";
+
+// spectrogram: pass through with texture coordinates
+static const char * g_spectrogramVertexShader =
+    "#version 120\n"
+    "void main()\n"
+    "{\n"
+    "    gl_Position = gl_ModelViewProjectionMatrix * gl_Vertex;\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "}\n";
+
+// colour map stops (dark to bright)
+static const GLfloat g_colormapStops[][3] = {
+    { 0, 0, 0 },
+    { .25f, 0, .45f },
+    { .75f, .1f, .35f },
+    { 1, .55f, 0 },
+    { 1, 1, .8f }
+};
+
+// colour map size
+#define YSPECTROGRAM_COLORMAP_SIZE 256
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: nextPowerOf2()
+// desc: ...
+//-----------------------------------------------------------------------------
+static unsigned int nextPowerOf2( unsigned int n )
+{
+    unsigned int p = 1;
+    while( p < n ) p <<= 1;
+    return p;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: YSpectrogram()
+// desc: constructor
+//-----------------------------------------------------------------------------
+YSpectrogram::YSpectrogram()
+{
+    // zero out
+    m_numBins = 0;
+    m_numColumns = 0;
+    m_texHeight = 0;
+    m_head = 0;
+    m_texture = 0;
+    m_colormap = 0;
+    m_program = 0;
+    m_setup = false;
+    // default range
+    m_minDB = -60;
+    m_maxDB = 0;
+    // default width and height
+    m_width = 2;
+    m_height = 1;
+
+    // set slew
+    m_iAlpha.set( 1, 1, 1 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: ~YSpectrogram()
+// desc: destructor
+//-----------------------------------------------------------------------------
+YSpectrogram::~YSpectrogram()
+{
+    // clean up
+    cleanup();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: init()
+// desc: initialize
+//-----------------------------------------------------------------------------
+bool YSpectrogram::init( unsigned int numBins, unsigned int numColumns )
+{
+    // clean up first
+    cleanup();
+
+    // sanity check
+    if( numBins == 0 || numColumns < 2 )
+    {
+        // log
+        cerr << "[y-waveform]: invalid spectrogram size..." << endl;
+        return false;
+    }
+
+    // set
+    m_numBins = numBins;
+    m_numColumns = nextPowerOf2( numColumns );
+    m_texHeight = nextPowerOf2( numBins );
+    m_column.assign( m_texHeight, 0 );
+    m_pending.reserve( m_texHeight * 4 );
+
+    return true;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: cleanup()
+// desc: clean up
+//-----------------------------------------------------------------------------
+void YSpectrogram::cleanup()
+{
+    // GL objects
+    if( m_texture ) glDeleteTextures( 1, &m_texture );
+    if( m_colormap ) glDeleteTextures( 1, &m_colormap );
+    if( m_program ) XShader::destroy( m_program );
+    m_texture = m_colormap = m_program = 0;
+    m_setup = false;
+
+    // zero out
+    m_numBins = 0;
+    m_numColumns = 0;
+    m_head = 0;
+    m_column.clear();
+    m_pending.clear();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: quantize()
+// desc: magnitude -> dB -> byte
+//-----------------------------------------------------------------------------
+inline void YSpectrogram::quantize( unsigned int bin, SAMPLE magnitude )
+{
+    // dB
+    GLfloat db = 20 * log10f( magnitude + 1e-9f );
+    // normalize to range
+    GLfloat v = (db - m_minDB) / (m_maxDB - m_minDB);
+    // clamp
+    if( v < 0 ) v = 0; else if( v > 1 ) v = 1;
+    // set
+    m_column[bin] = (unsigned char)(v * 255 + .5f);
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: set()
+// desc: add a frame from rfft() output
+//-----------------------------------------------------------------------------
+void YSpectrogram::set( const complex * spectrum, unsigned int numBins )
+{
+    // sanity check
+    if( m_numBins == 0 ) return;
+    if( numBins > m_numBins ) numBins = m_numBins;
+
+    // one column
+    for( unsigned int i = 0; i < numBins; i++ )
+        quantize( i, cmp_abs( spectrum[i] ) );
+    // the rest (if fewer bins given)
+    for( unsigned int i = numBins; i < m_numBins; i++ )
+        m_column[i] = 0;
+
+    // queue it
+    commit();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setMagnitudes()
+// desc: add a frame of magnitudes
+//-----------------------------------------------------------------------------
+void YSpectrogram::setMagnitudes( const SAMPLE * magnitudes, unsigned int numBins )
+{
+    // sanity check
+    if( m_numBins == 0 ) return;
+    if( numBins > m_numBins ) numBins = m_numBins;
+
+    // one column
+    for( unsigned int i = 0; i < numBins; i++ )
+        quantize( i, magnitudes[i] );
+    // the rest (if fewer bins given)
+    for( unsigned int i = numBins; i < m_numBins; i++ )
+        m_column[i] = 0;
+
+    // queue it
+    commit();
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: commit()
+// desc: queue the current column for upload
+//-----------------------------------------------------------------------------
+void YSpectrogram::commit()
+{
+    // more than a ring's worth waiting (not being rendered); start over
+    if( m_pending.size() >= m_column.size() * m_numColumns )
+        m_pending.clear();
+
+    // append
+    m_pending.insert( m_pending.end(), m_column.begin(), m_column.end() );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: update()
+// desc: update
+//-----------------------------------------------------------------------------
+void YSpectrogram::update( YTimeInterval dt )
+{
+    // interpolate
+    m_iAlpha.interp( dt );
+    // set
+    alpha = m_iAlpha.value;
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: setupGL()
+// desc: create textures and program
+//-----------------------------------------------------------------------------
+void YSpectrogram::setupGL()
+{
+    m_setup = true;
+
+    // one byte per texel
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+    // spectrum: numColumns x texHeight, wraps horizontally
+    vector<unsigned char> zeros( m_numColumns * m_texHeight, 0 );
+    glGenTextures( 1, &m_texture );
+    glBindTexture( GL_TEXTURE_2D, m_texture );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+    glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_LUMINANCE8, m_numColumns, m_texHeight, 0,
+                  GL_LUMINANCE, GL_UNSIGNED_BYTE, &zeros[0] );
+    glBindTexture( GL_TEXTURE_2D, 0 );
+
+    // program (optional)
+    m_program = XShader::link( g_spectrogramVertexShader, g_spectrogramFragmentShader );
+    if( !m_program )
+    {
+        // log
+        cerr << "[y-waveform]: no shaders; drawing spectrogram in grayscale..." << endl;
+        return;
+    }
+
+    // colour map
+    const int numStops = sizeof(g_colormapStops) / sizeof(g_colormapStops[0]);
+    unsigned char colors[YSPECTROGRAM_COLORMAP_SIZE * 3];
+    for( int i = 0; i < YSPECTROGRAM_COLORMAP_SIZE; i++ )
+    {
+        // position along the stops
+        GLfloat t = (GLfloat)i / (YSPECTROGRAM_COLORMAP_SIZE - 1) * (numStops - 1);
+        int a = (int)t; if( a >= numStops - 1 ) a = numStops - 2;
+        GLfloat f = t - a;
+        for( int c = 0; c < 3; c++ )
+            colors[i*3+c] = (unsigned char)( 255 * ( g_colormapStops[a][c] +
+                f * ( g_colormapStops[a+1][c] - g_colormapStops[a][c] ) ) + .5f );
+    }
+    glGenTextures( 1, &m_colormap );
+    glBindTexture( GL_TEXTURE_1D, m_colormap );
+    glTexParameteri( GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glTexParameteri( GL_TEXTURE_1D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+    glTexImage1D( GL_TEXTURE_1D, 0, GL_RGB8, YSPECTROGRAM_COLORMAP_SIZE, 0,
+                  GL_RGB, GL_UNSIGNED_BYTE, colors );
+    glBindTexture( GL_TEXTURE_1D, 0 );
+
+    // samplers
+    glUseProgram( m_program );
+    glUniform1i( glGetUniformLocation( m_program, "u_spectrum" ), 0 );
+    glUniform1i( glGetUniformLocation( m_program, "u_colormap" ), 1 );
+    glUseProgram( 0 );
+}
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: render()
+// desc: render
+//-----------------------------------------------------------------------------
+void YSpectrogram::render()
+{
+    // check
+    if( m_numBins == 0 ) return;
+    // first time
+    if( !m_setup ) setupGL();
+
+    // bind
+    XGfx::bindTexture( GL_TEXTURE_2D, m_texture );
+
+    // upload new columns (usually one), one texel wide each
+    unsigned int rows = m_column.size();
+    if( m_pending.size() )
+    {
+        glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+        for( size_t i = 0; i < m_pending.size(); i += rows )
+        {
+            glTexSubImage2D( GL_TEXTURE_2D, 0, m_head, 0, 1, m_numBins,
+                             GL_LUMINANCE, GL_UNSIGNED_BYTE, &m_pending[i] );
+            m_head = (m_head + 1) % m_numColumns;
+        }
+        m_pending.clear();
+    }
+
+    // oldest column at the left edge; the rest wraps around (GL_REPEAT).
+    // the ends sit on the oldest/newest texel centres, so GL_LINEAR never
+    // blends the newest column into the oldest across the seam
+    GLfloat s0 = ( m_head + .5f ) / m_numColumns;
+    GLfloat s1 = s0 + (GLfloat)( m_numColumns - 1 ) / m_numColumns;
+    // only the rows in use
+    GLfloat t1 = (GLfloat)m_numBins / m_texHeight;
+    // geometry
+    GLfloat w = m_width / 2, h = m_height;
+
+    // state
+    XGfx::disable( GL_LIGHTING );
+    XGfx::enable( GL_BLEND );
+    XGfx::blendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+    if( m_program )
+    {
+        // colour map on unit 1
+        glActiveTexture( GL_TEXTURE1 );
+        XGfx::bindTexture( GL_TEXTURE_1D, m_colormap );
+        glActiveTexture( GL_TEXTURE0 );
+        glUseProgram( m_program );
+    }
+    else
+    {
+        XGfx::enable( GL_TEXTURE_2D );
+    }
+
+    // color
+    glColor4f( col.x, col.y, col.z, alpha );
+    // one quad
+    glBegin( GL_QUADS );
+    glTexCoord2f( s0, 0 ); glVertex2f( -w, 0 );
+    glTexCoord2f( s1, 0 ); glVertex2f( w, 0 );
+    glTexCoord2f( s1, t1 ); glVertex2f( w, h );
+    glTexCoord2f( s0, t1 ); glVertex2f( -w, h );
+    glEnd();
+    XGfx::countDrawCalls();
+
+    // restore
+    if( m_program )
+    {
+        glUseProgram( 0 );
+        glActiveTexture( GL_TEXTURE1 );
+        XGfx::bindTexture( GL_TEXTURE_1D, 0 );
+        glActiveTexture( GL_TEXTURE0 );
+    }
+    else
+    {
+        XGfx::disable( GL_TEXTURE_2D );
+    }
+    XGfx::bindTexture( GL_TEXTURE_2D, 0 );
+    XGfx::disable( GL_BLEND );
+}
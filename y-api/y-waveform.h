@@ -40,7 +40,10 @@
 
 #include "x-audio.h"
 #include "x-gfx.h"
+#include "x-buffer.h"
 #include "y-entity.h"
+#include "y-fft.h"
+#include <vector>
 
 
 
@@ -109,4 +112,194 @@ protected:
 
 
 
+//-----------------------------------------------------------------------------
+// name: struct YWaveformColumn
+// desc: one decimated column of a waveform stream
+//-----------------------------------------------------------------------------
+struct YWaveformColumn
+{
+    GLfloat min;
+    GLfloat max;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class YWaveformStream
+// desc: scrolling waveform history; audio is decimated into min/max columns
+//       that stream into a ring vertex buffer, and x is computed from the
+//       ring position at draw time, so old columns are never touched again
+//-----------------------------------------------------------------------------
+class YWaveformStream : public YEntity
+{
+public:
+    // constructor
+    YWaveformStream();
+    // destructor
+    ~YWaveformStream();
+
+public:
+    // initialize (history is numColumns * samplesPerColumn samples; not
+    // while pushing)
+    bool init( unsigned int numColumns, unsigned int samplesPerColumn );
+    // clean up (not while pushing)
+    void cleanup();
+    // set width
+    void setWidth( GLfloat width ) { m_width = width; }
+    // set height
+    void setHeight( GLfloat height ) { m_height = height; }
+    // get width
+    GLfloat getWidth() const { return m_width; }
+    // get height
+    GLfloat getHeight() const { return m_height; }
+    // fade
+    void fade( GLfloat targetAlpha, GLfloat slew = 1 )
+    { if( slew <= 0 ) m_iAlpha.updateSet(targetAlpha);
+      else m_iAlpha.update( targetAlpha, slew ); }
+
+public:
+    // append audio (one thread, e.g., the audio callback; never locks or
+    // allocates)
+    void push( const SAMPLE * monoBuffer, unsigned int numFrames );
+
+public:
+    // update
+    void update( YTimeInterval dt );
+    // render
+    void render();
+
+protected:
+    // create buffer and program (GL thread)
+    void setupGL();
+    // copy new columns into the ring
+    void upload();
+
+protected:
+    // columns on screen
+    unsigned int m_numColumns;
+    // samples per column
+    unsigned int m_samplesPerColumn;
+
+    // decimation in progress (push side)
+    unsigned int m_count;
+    SAMPLE m_min;
+    SAMPLE m_max;
+    // finished columns not yet taken (push side to GL side; dropped if full)
+    XLockFreeQueue<YWaveformColumn> m_pending;
+
+    // columns taken for upload (GL side)
+    std::vector<GLfloat> m_staging;
+    // vertices for one upload
+    std::vector<GLfloat> m_upload;
+    // next ring slot to write
+    unsigned int m_head;
+    // number of valid columns
+    unsigned int m_filled;
+
+    // ring vertex buffer: (slot, min), (slot, max) per column
+    GLuint m_vbo;
+    // program (0 to draw without shaders)
+    GLuint m_program;
+    GLint m_uHead;
+    GLint m_uColumns;
+    GLint m_uSize;
+    bool m_setup;
+
+    // width of waveform
+    GLfloat m_width;
+    // height of waveform
+    GLfloat m_height;
+    // for fading
+    Vector3D m_iAlpha;
+};
+
+
+
+
+//-----------------------------------------------------------------------------
+// name: class YSpectrogram
+// desc: scrolling spectrogram (waterfall); each set() becomes one texture
+//       column in a ring (oldest at left, newest at right), colour-mapped
+//       through a lookup texture
+//-----------------------------------------------------------------------------
+class YSpectrogram : public YEntity
+{
+public:
+    // constructor
+    YSpectrogram();
+    // destructor
+    ~YSpectrogram();
+
+public:
+    // initialize (numBins from rfft of 2*numBins samples; numColumns of
+    // history, rounded up to a power of 2)
+    bool init( unsigned int numBins, unsigned int numColumns );
+    // clean up
+    void cleanup();
+    // set dB range mapped onto the colour map
+    void setRange( GLfloat minDB, GLfloat maxDB ) { m_minDB = minDB; m_maxDB = maxDB; }
+    // set width
+    void setWidth( GLfloat width ) { m_width = width; }
+    // set height
+    void setHeight( GLfloat height ) { m_height = height; }
+    // fade
+    void fade( GLfloat targetAlpha, GLfloat slew = 1 )
+    { if( slew <= 0 ) m_iAlpha.updateSet(targetAlpha);
+      else m_iAlpha.update( targetAlpha, slew ); }
+
+public:
+    // add a frame from rfft() output (GL thread)
+    void set( const complex * spectrum, unsigned int numBins );
+    // add a frame of magnitudes (GL thread)
+    void setMagnitudes( const SAMPLE * magnitudes, unsigned int numBins );
+
+public:
+    // update
+    void update( YTimeInterval dt );
+    // render
+    void render();
+
+protected:
+    // create textures and program
+    void setupGL();
+    // quantize one magnitude into the column
+    inline void quantize( unsigned int bin, SAMPLE magnitude );
+    // queue the current column
+    void commit();
+
+protected:
+    // frequency bins (texture rows)
+    unsigned int m_numBins;
+    // columns (texture width, power of 2)
+    unsigned int m_numColumns;
+    // texture height (power of 2)
+    unsigned int m_texHeight;
+    // column being built
+    std::vector<unsigned char> m_column;
+    // columns not yet uploaded
+    std::vector<unsigned char> m_pending;
+    // next column to write
+    unsigned int m_head;
+
+    // textures: spectrum (luminance) and colour map (1D RGB)
+    GLuint m_texture;
+    GLuint m_colormap;
+    // program (0 to draw in grayscale)
+    GLuint m_program;
+    bool m_setup;
+
+    // dB range
+    GLfloat m_minDB;
+    GLfloat m_maxDB;
+    // size
+    GLfloat m_width;
+    GLfloat m_height;
+    // for fading
+    Vector3D m_iAlpha;
+};
+
+
+
+
 #endif